@@ -0,0 +1,276 @@
+#include "AllocationProfiler.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+namespace PathCore
+{
+	namespace
+	{
+#if PATH_ALLOCATION_PROFILER
+		/**
+		 * Written in front of every block, so a block knows its size (unsized delete, freed bytes)
+		 * and whether its allocation was tracked (a block allocated before the tracking started is never counted as freed).
+		 */
+		struct BlockHeader
+		{
+			uint64_t Size;
+			/* From the start of the malloc() block to the returned pointer */
+			uint32_t Offset;
+			uint32_t Tracked;
+		};
+
+		constexpr size_t DefaultAlignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+		/* A whole alignment unit, so the returned pointer keeps the alignment of malloc() */
+		constexpr size_t HeaderSize = DefaultAlignment;
+		static_assert(sizeof(BlockHeader) <= HeaderSize, "The block header must fit before the block");
+
+		constexpr size_t UnknownSize = SIZE_MAX;
+#endif
+
+		/* Trivially constructible, so reaching it from operator new never runs a constructor */
+		struct ThreadCounters
+		{
+			uint64_t Allocations;
+			uint64_t Deallocations;
+			uint64_t AllocatedBytes;
+			uint64_t FreedBytes;
+			int64_t LiveBytes;
+			int64_t PeakBytes;
+			/* AllocationScope alive on this thread */
+			uint32_t ScopeDepth;
+		};
+
+		thread_local ThreadCounters Counters;
+
+		std::atomic<bool> TrackingEnabled(false);
+		std::atomic<uint64_t> TotalAllocations(0);
+		std::atomic<uint64_t> TotalDeallocations(0);
+		std::atomic<uint64_t> TotalAllocatedBytes(0);
+		std::atomic<uint64_t> TotalFreedBytes(0);
+		std::atomic<int64_t> TotalLiveBytes(0);
+		std::atomic<int64_t> TotalPeakBytes(0);
+
+#if PATH_ALLOCATION_PROFILER
+		bool IsTracked()
+		{
+			return (Counters.ScopeDepth > 0 || TrackingEnabled.load(std::memory_order_relaxed));
+		}
+
+		void CountAllocation(size_t size)
+		{
+			Counters.Allocations++;
+			Counters.AllocatedBytes += size;
+			Counters.LiveBytes += size;
+			if (Counters.LiveBytes > Counters.PeakBytes)
+				Counters.PeakBytes = Counters.LiveBytes;
+
+			TotalAllocations.fetch_add(1, std::memory_order_relaxed);
+			TotalAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+			int64_t live = TotalLiveBytes.fetch_add(size, std::memory_order_relaxed) + static_cast<int64_t>(size);
+			int64_t peak = TotalPeakBytes.load(std::memory_order_relaxed);
+			while (live > peak && TotalPeakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed) == false)
+				;
+		}
+
+		void CountDeallocation(size_t size)
+		{
+			Counters.Deallocations++;
+			Counters.FreedBytes += size;
+			Counters.LiveBytes -= size;
+
+			TotalDeallocations.fetch_add(1, std::memory_order_relaxed);
+			TotalFreedBytes.fetch_add(size, std::memory_order_relaxed);
+			TotalLiveBytes.fetch_sub(size, std::memory_order_relaxed);
+		}
+
+		/* @return nullptr when out of memory */
+		void* Allocate(size_t size, size_t alignment)
+		{
+			if (alignment < DefaultAlignment)
+				alignment = DefaultAlignment;
+
+			// malloc() only guarantees the default alignment, a bigger one needs room to move the block forward
+			size_t padding = HeaderSize + alignment - DefaultAlignment;
+			if (size > SIZE_MAX - padding)
+				return (nullptr);
+			unsigned char* block = static_cast<unsigned char*>(std::malloc(size + padding));
+			if (block == nullptr)
+				return (nullptr);
+
+			uintptr_t pointer = (reinterpret_cast<uintptr_t>(block) + HeaderSize + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+			BlockHeader* header = reinterpret_cast<BlockHeader*>(pointer - HeaderSize);
+			header->Size = size;
+			header->Offset = static_cast<uint32_t>(pointer - reinterpret_cast<uintptr_t>(block));
+			header->Tracked = IsTracked();
+			if (header->Tracked)
+				CountAllocation(size);
+			return (reinterpret_cast<void*>(pointer));
+		}
+
+		void* AllocateOrThrow(size_t size, size_t alignment)
+		{
+			while (true)
+			{
+				void* pointer = Allocate(size, alignment);
+				if (pointer)
+					return (pointer);
+
+				// Same contract as the default operator new: let the handler free memory, or give up
+				std::new_handler handler = std::get_new_handler();
+				if (handler == nullptr)
+					throw std::bad_alloc();
+				handler();
+			}
+		}
+
+		void Deallocate(void* pointer, size_t expectedSize)
+		{
+			if (pointer == nullptr)
+				return;
+
+			BlockHeader* header = reinterpret_cast<BlockHeader*>(static_cast<unsigned char*>(pointer) - HeaderSize);
+			assert((expectedSize == UnknownSize || expectedSize == header->Size) && "Sized delete of a block with a different size");
+			if (header->Tracked)
+				CountDeallocation(header->Size);
+			std::free(static_cast<unsigned char*>(pointer) - header->Offset);
+		}
+#endif
+
+		AllocationStats ToStats(const ThreadCounters& counters)
+		{
+			AllocationStats stats;
+			stats.Allocations = counters.Allocations;
+			stats.Deallocations = counters.Deallocations;
+			stats.AllocatedBytes = counters.AllocatedBytes;
+			stats.FreedBytes = counters.FreedBytes;
+			stats.LiveBytes = counters.LiveBytes;
+			stats.PeakBytes = counters.PeakBytes;
+			return (stats);
+		}
+	}
+
+	void EnableAllocationTracking(bool enable)
+	{
+		TrackingEnabled.store(enable, std::memory_order_relaxed);
+	}
+
+	bool IsAllocationTrackingEnabled()
+	{
+		return (TrackingEnabled.load(std::memory_order_relaxed));
+	}
+
+	AllocationStats GetAllocationTotals()
+	{
+		AllocationStats stats;
+		stats.Allocations = TotalAllocations.load(std::memory_order_relaxed);
+		stats.Deallocations = TotalDeallocations.load(std::memory_order_relaxed);
+		stats.AllocatedBytes = TotalAllocatedBytes.load(std::memory_order_relaxed);
+		stats.FreedBytes = TotalFreedBytes.load(std::memory_order_relaxed);
+		stats.LiveBytes = TotalLiveBytes.load(std::memory_order_relaxed);
+		stats.PeakBytes = TotalPeakBytes.load(std::memory_order_relaxed);
+		return (stats);
+	}
+
+	void WriteAllocationJson(std::ostream& stream, const char* name, const AllocationStats& stats)
+	{
+		stream << "{\"name\":\"";
+		for (const char* character = name; *character; character++)
+		{
+			if (*character == '"' || *character == '\\')
+				stream << '\\';
+			stream << *character;
+		}
+		stream << "\",\"allocations\":" << stats.Allocations
+			<< ",\"deallocations\":" << stats.Deallocations
+			<< ",\"allocated_bytes\":" << stats.AllocatedBytes
+			<< ",\"freed_bytes\":" << stats.FreedBytes
+			<< ",\"live_bytes\":" << stats.LiveBytes
+			<< ",\"peak_bytes\":" << stats.PeakBytes << "}\n";
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// ALLOCATION SCOPE
+	///////////////////////////////////////////////////////////////////////////
+
+	AllocationScope::AllocationScope()
+		: m_Start(ToStats(Counters)),
+		m_OuterPeak(Counters.PeakBytes)
+	{
+		Counters.ScopeDepth++;
+		// The peak of the scope starts from what is live now
+		Counters.PeakBytes = Counters.LiveBytes;
+	}
+
+	AllocationScope::~AllocationScope()
+	{
+		Counters.ScopeDepth--;
+		if (m_OuterPeak > Counters.PeakBytes)
+			Counters.PeakBytes = m_OuterPeak;
+	}
+
+	AllocationStats AllocationScope::Stats() const
+	{
+		AllocationStats stats;
+		stats.Allocations = Counters.Allocations - m_Start.Allocations;
+		stats.Deallocations = Counters.Deallocations - m_Start.Deallocations;
+		stats.AllocatedBytes = Counters.AllocatedBytes - m_Start.AllocatedBytes;
+		stats.FreedBytes = Counters.FreedBytes - m_Start.FreedBytes;
+		stats.LiveBytes = Counters.LiveBytes - m_Start.LiveBytes;
+		stats.PeakBytes = Counters.PeakBytes - m_Start.LiveBytes;
+		return (stats);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// ALLOCATION BUDGET
+	///////////////////////////////////////////////////////////////////////////
+
+	AllocationBudget::AllocationBudget(uint64_t maxAllocations, uint64_t maxBytes)
+		: m_MaxAllocations(maxAllocations),
+		m_MaxBytes(maxBytes)
+	{}
+
+	AllocationBudget::~AllocationBudget()
+	{
+		assert(IsRespected() && "Allocation budget exceeded");
+	}
+
+	bool AllocationBudget::IsRespected() const
+	{
+		AllocationStats stats = Stats();
+		return (stats.Allocations <= m_MaxAllocations && stats.AllocatedBytes <= m_MaxBytes);
+	}
+}
+
+#if PATH_ALLOCATION_PROFILER
+
+///////////////////////////////////////////////////////////////////////////////
+// GLOBAL OPERATOR NEW / DELETE
+///////////////////////////////////////////////////////////////////////////////
+
+void* operator new(size_t size) { return (PathCore::AllocateOrThrow(size, 0)); }
+void* operator new[](size_t size) { return (PathCore::AllocateOrThrow(size, 0)); }
+void* operator new(size_t size, std::align_val_t alignment) { return (PathCore::AllocateOrThrow(size, static_cast<size_t>(alignment))); }
+void* operator new[](size_t size, std::align_val_t alignment) { return (PathCore::AllocateOrThrow(size, static_cast<size_t>(alignment))); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return (PathCore::Allocate(size, 0)); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return (PathCore::Allocate(size, 0)); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return (PathCore::Allocate(size, static_cast<size_t>(alignment))); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return (PathCore::Allocate(size, static_cast<size_t>(alignment))); }
+
+void operator delete(void* pointer) noexcept { PathCore::Deallocate(pointer, PathCore::UnknownSize); }
+void operator delete[](void* pointer) noexcept { PathCore::Deallocate(pointer, PathCore::UnknownSize); }
+void operator delete(void* pointer, size_t size) noexcept { PathCore::Deallocate(pointer, size); }
+void operator delete[](void* pointer, size_t size) noexcept { PathCore::Deallocate(pointer, size); }
+void operator delete(void* pointer, std::align_val_t) noexcept { PathCore::Deallocate(pointer, PathCore::UnknownSize); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { PathCore::Deallocate(pointer, PathCore::UnknownSize); }
+void operator delete(void* pointer, size_t size, std::align_val_t) noexcept { PathCore::Deallocate(pointer, size); }
+void operator delete[](void* pointer, size_t size, std::align_val_t) noexcept { PathCore::Deallocate(pointer, size); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { PathCore::Deallocate(pointer, PathCore::UnknownSize); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { PathCore::Deallocate(pointer, PathCore::UnknownSize); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { PathCore::Deallocate(pointer, PathCore::UnknownSize); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { PathCore::Deallocate(pointer, PathCore::UnknownSize); }
+
+#endif
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <ostream>
+
+///////////////////////////////////////////////////////////////////////////////
+//  Allocation profiler, the global operator new/delete are replaced in AllocationProfiler.cpp.
+//  Define PATH_ALLOCATION_PROFILER to 1 in the build to replace them, nothing is counted otherwise (every stats stays 0).
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef PATH_ALLOCATION_PROFILER
+# define PATH_ALLOCATION_PROFILER 0
+#endif
+
+namespace PathCore
+{
+	struct AllocationStats
+	{
+		uint64_t Allocations = 0;
+		uint64_t Deallocations = 0;
+		uint64_t AllocatedBytes = 0;
+		uint64_t FreedBytes = 0;
+		/* Bytes allocated and not freed yet, negative in a scope that frees more than it allocates */
+		int64_t LiveBytes = 0;
+		/* Highest LiveBytes reached */
+		int64_t PeakBytes = 0;
+	};
+
+	/**
+	 * @brief Track the allocations of every thread (off by default)
+	 * @note A thread inside an AllocationScope is tracked either way
+	 */
+	void EnableAllocationTracking(bool enable);
+	bool IsAllocationTrackingEnabled();
+
+	/**
+	 * @brief Every tracked allocation of every thread since the start
+	 * @note A block is only counted as freed if its allocation was tracked, so LiveBytes never drifts
+	 */
+	AllocationStats GetAllocationTotals();
+
+	/**
+	 * @brief Write stats as one JSON object on one line
+	 * @example {"name":"Path(const TCHAR*)","allocations":1,"deallocations":1,"allocated_bytes":16388,"freed_bytes":16388,"live_bytes":0,"peak_bytes":16388}
+	 */
+	void WriteAllocationJson(std::ostream& stream, const char* name, const AllocationStats& stats);
+
+	/**
+	 * Count the allocations of the calling thread while the scope is alive.
+	 *
+	 * The counters are per thread (no contention, and the allocations of other threads are not mixed in),
+	 * a block allocated by the scope and freed by another thread is not seen as freed.
+	 * Scopes nest, the peak of an inner scope is also seen by the outer ones.
+	 *
+	 * @example AllocationScope scope; path.Insert(where, from, to); assert(scope.Stats().Allocations == 0);
+	 */
+	class AllocationScope
+	{
+	public:
+		AllocationScope();
+		~AllocationScope();
+
+		AllocationScope(const AllocationScope&) = delete;
+		AllocationScope& operator=(const AllocationScope&) = delete;
+
+	public:
+		/* What the calling thread did since the scope was created, PeakBytes is relative to the start of the scope */
+		AllocationStats Stats() const;
+
+	private:
+		AllocationStats m_Start;
+		/* Peak of the enclosing scope, restored when this one ends */
+		int64_t m_OuterPeak;
+	};
+
+	/**
+	 * An AllocationScope that asserts, when it ends, that the calling thread stayed within a budget.
+	 *
+	 * @example { AllocationBudget budget(0); path.Shrink(segment); } // Shrinking never allocates
+	 */
+	class AllocationBudget : public AllocationScope
+	{
+	public:
+		explicit AllocationBudget(uint64_t maxAllocations, uint64_t maxBytes = std::numeric_limits<uint64_t>::max());
+		~AllocationBudget();
+
+	public:
+		/* For the builds without asserts */
+		bool IsRespected() const;
+
+	private:
+		uint64_t m_MaxAllocations;
+		uint64_t m_MaxBytes;
+	};
+}
@@ -0,0 +1,74 @@
+#include "Benchmarks.h"
+#include "AllocationProfiler.h"
+#include "PathInstrumentation.h"
+
+#include <iostream>
+
+int CountAllocations(const std::function<void()>& function)
+{
+	PathCore::AllocationScope scope;
+	function();
+	return (static_cast<int>(scope.Stats().Allocations));
+}
+
+void AppendDigits(std::basic_string<TCHAR>& name, size_t value)
+{
+	do
+	{
+		name += static_cast<TCHAR>(TEXT('0') + value % 10);
+		value /= 10;
+	} while (value > 0);
+}
+
+std::vector<StaticPath> GenerateNumberedPaths(size_t count, const TCHAR* root, const TCHAR* folder, const TCHAR* file,
+	std::initializer_list<const TCHAR*> extensions)
+{
+	std::vector<StaticPath> paths;
+	paths.reserve(count);
+	Path rootPath(root);
+	std::basic_string<TCHAR> name;
+	for (size_t index = 0; index < count; index++)
+	{
+		name.clear();
+		if (folder != nullptr)
+		{
+			name += folder;
+			name += static_cast<TCHAR>(TEXT('A') + index % 26);
+			name += TEXT("/");
+		}
+		name += file;
+		AppendDigits(name, index);
+		name += extensions.begin()[(index * 7) % extensions.size()];
+		paths.emplace_back(rootPath, name.c_str());
+	}
+	return (paths);
+}
+
+void RunBenchmarks()
+{
+	BenchmarkPathAllocations();
+	BenchmarkGlobRuleSet();
+	BenchmarkDirectoryFdCache();
+	BenchmarkDirectoryWalker();
+	BenchmarkDirectoryTraversal();
+	BenchmarkMetadataCache();
+	BenchmarkPathCanonicalizer();
+	BenchmarkPathWatcher();
+	BenchmarkPathEncoding();
+	BenchmarkPathWriter();
+	BenchmarkSharedPath();
+	BenchmarkNaturalSort();
+	BenchmarkExtensionIndex();
+	BenchmarkPathSetOperations();
+	BenchmarkSharedPathTable();
+	BenchmarkPathFilter();
+	BenchmarkPathFuzzyFinder();
+	BenchmarkPathTrigramIndex();
+	BenchmarkPathQueue();
+
+#if PATH_INSTRUMENTATION
+	// Every PathBase operation the benchmarks above did, on every thread
+	std::cout << "PathInstrumentation: ";
+	PathCore::WriteInstrumentationJson(std::cout, PathCore::TakeInstrumentationSnapshot());
+#endif
+}
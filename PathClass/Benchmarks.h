@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Path.h"
+
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+//  Benchmarks of the PathClass modules, run the executable with "--bench"
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Call function once and return how long it took
+ */
+template<typename Function>
+double MeasureSeconds(Function&& function)
+{
+	auto start = std::chrono::steady_clock::now();
+	function();
+	return (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+/**
+ * @brief Call function once and return how many allocations it did
+ * @note Uses an AllocationScope, the allocations of other threads are not counted (always 0 without PATH_ALLOCATION_PROFILER)
+ */
+int CountAllocations(const std::function<void()>& function);
+
+/**
+ * @brief Append the digits of value, least significant first: numbered names that don't share their first digits
+ */
+void AppendDigits(std::basic_string<TCHAR>& name, size_t value);
+
+/**
+ * @brief count numbered files below root: root/<folder><letter>/<file><index><extension>, the letter cycles through 'A' to 'Z'
+ * @param folder When null, the files are right below root
+ * @param extensions Picked in a scattered order, (index * 7) % size
+ * @example GenerateNumberedPaths(2, TEXT("C:/Assets"), TEXT("Pack_"), TEXT("Texture_"), { TEXT(".png") }) gives "C:/Assets/Pack_A/Texture_0.png" and "C:/Assets/Pack_B/Texture_1.png"
+ */
+std::vector<StaticPath> GenerateNumberedPaths(size_t count, const TCHAR* root, const TCHAR* folder, const TCHAR* file,
+	std::initializer_list<const TCHAR*> extensions);
+
+/** Allocations of every PathBase operation, asserted against a budget and written as JSON lines */
+void BenchmarkPathAllocations();
+/** Compiled GlobRuleSet against matching every rule separately */
+void BenchmarkGlobRuleSet();
+/** DirectoryFdCache relative stat against stat of the absolute path, on a deep temporary tree */
+void BenchmarkDirectoryFdCache();
+/** Work stealing DirectoryWalker against std::filesystem::recursive_directory_iterator, on a generated temporary tree */
+void BenchmarkDirectoryWalker();
+/** TraverseDirectory generator: full traversal, allocations per entry and first match */
+void BenchmarkDirectoryTraversal();
+/** Batched MetadataCache (thread pool and io_uring) against one lstat per path per pipeline stage */
+void BenchmarkMetadataCache();
+/** Memoized PathCanonicalizer against realpath(), on paths reached through directory links */
+void BenchmarkPathCanonicalizer();
+/** PathWatcher setup, coalescing of a write burst and watch limit, against a full rescan of the tree */
+void BenchmarkPathWatcher();
+/** Block UTF-8 <-> wchar_t transcoding and UTF-8 validation against decoding one code point at a time */
+void BenchmarkPathEncoding();
+/** PathWriter (UTF-8, UTF-16, NUL delimited) against inserting paths in an ofstream one character at a time */
+void BenchmarkPathWriter();
+/** Copying paths through pipeline stages as reference counted SharedPath against deep copied StaticPath */
+void BenchmarkSharedPath();
+/** Natural order of 1M paths: sort keys built once (radix and memcmp sorted) against parsing both paths on every comparison */
+void BenchmarkNaturalSort();
+/** Grouping 1M paths by extension with an ExtensionIndex against scanning every file name into a std::map */
+void BenchmarkExtensionIndex();
+/** Nightly diff of two sorted snapshots: merge (in memory, on disk, in parallel) against hash sets of both snapshots */
+void BenchmarkPathSetOperations();
+/** Path set shared by worker processes through a SharedPathTable against every worker loading and indexing its own copy */
+void BenchmarkSharedPathTable();
+/** Blocked Bloom and xor PathFilter over 1M paths: bytes per path, measured false positives and query time against a hash set probe */
+void BenchmarkPathFilter();
+/** Fuzzy search typed one character at a time over 1M paths: full and incremental PathFuzzyFinder scans against a naive fold and compare */
+void BenchmarkPathFuzzyFinder();
+/** "Paths containing X" over 1M paths: PathTrigramIndex intersections against a linear scan, then removals, additions and a save / load */
+void BenchmarkPathTrigramIndex();
+/** Handing 1M paths from 1 to 64 producer threads to a consumer: PathQueue records in place against StaticPath copies behind a mutex */
+void BenchmarkPathQueue();
+
+void RunBenchmarks();
+
+/**
+ * @brief Time every PathBase and StaticPath operation against std::filesystem::path, results written as JSON
+ * @param argv The arguments after "--microbench": [--depth N] [--segment-length N] [--iterations N] [--output file.json]
+ * @return The exit code
+ * @note bytes_per_op and allocs_per_op are null without PATH_ALLOCATION_PROFILER
+ */
+int RunPathMicroBenchmarks(int argc, char** argv);
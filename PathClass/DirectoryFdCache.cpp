@@ -0,0 +1,211 @@
+#include "DirectoryFdCache.h"
+
+#ifndef PLATFORM_WINDOWS
+
+#include "PathEncoding.h"
+
+#include <cerrno>
+#include <vector>
+
+#include <unistd.h>
+
+namespace PathCore
+{
+	namespace
+	{
+		/* Enough for any segment, SegmentSize bounds its length */
+		constexpr size_t NameBufferSize = MaxUtf8Size(std::numeric_limits<SegmentSize>::max()) + NULL_TERMINATOR_LENGTH;
+		constexpr size_t RelativeBufferSize = MaxUtf8Size(MAX_PATH_LENGTH) + NULL_TERMINATOR_LENGTH;
+
+		/* Directories are only used as openat()/fstatat() anchors, a path descriptor is enough where it exists */
+#ifdef O_PATH
+		constexpr int DirectoryFlags = O_PATH | O_DIRECTORY | O_CLOEXEC;
+#else
+		constexpr int DirectoryFlags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+#endif
+
+		/* Tells the caches apart in the miss history of a thread, an address could be reused */
+		std::atomic<uint64_t> NextCacheId(1);
+
+		/* The last parent a thread missed, and in which cache */
+		struct MissedParent
+		{
+			uint64_t CacheId = 0;
+			uint64_t Hash = 0;
+		};
+	}
+
+	DirectoryFd::~DirectoryFd()
+	{
+		if (m_Fd >= 0)
+			close(m_Fd);
+	}
+
+	DirectoryFdCache::DirectoryFdCache(const char* rootDirectory, size_t fdBudget)
+		: m_Directories(fdBudget, PathCacheEviction::Lru, fdBudget >= 64 ? 16 : 1), // Small budgets would be rounded up too much by the shards
+		m_Id(NextCacheId.fetch_add(1, std::memory_order_relaxed)),
+		m_Lookups(0),
+		m_ParentHits(0),
+		m_DirectoriesOpened(0),
+		m_AncestorFallbacks(0)
+	{
+		int fd = open(rootDirectory, DirectoryFlags);
+		if (fd >= 0)
+			m_Root = std::make_shared<DirectoryFd>(fd);
+	}
+
+	int DirectoryFdCache::Open(const IPath& path, int flags, mode_t mode)
+	{
+		char name[RelativeBufferSize];
+		std::shared_ptr<DirectoryFd> parent = FindParent(path, name);
+		if (parent == nullptr)
+			return (-1);
+		return (openat(parent->Get(), name, flags | O_CLOEXEC, mode));
+	}
+
+	int DirectoryFdCache::Stat(const IPath& path, struct stat& outStat, int flags)
+	{
+		char name[RelativeBufferSize];
+		std::shared_ptr<DirectoryFd> parent = FindParent(path, name);
+		if (parent == nullptr)
+			return (-1);
+		return (fstatat(parent->Get(), name, &outStat, flags));
+	}
+
+	ssize_t DirectoryFdCache::ReadLink(const IPath& path, char* buffer, size_t bufferSize)
+	{
+		char name[RelativeBufferSize];
+		std::shared_ptr<DirectoryFd> parent = FindParent(path, name);
+		if (parent == nullptr)
+			return (-1);
+		return (readlinkat(parent->Get(), name, buffer, bufferSize));
+	}
+
+	std::shared_ptr<DirectoryFd> DirectoryFdCache::OpenDirectory(const IPath& directory)
+	{
+		// Cached under the same key as the ancestors FindParent() looks for: no trailing separator
+		PathView key(directory.Data(), directory.Size());
+		while (key.Size() > 0 && IsSeparator(key.Data()[key.Size() - 1]))
+			key = PathView(key.Data(), key.Size() - 1);
+
+		std::shared_ptr<DirectoryFd> cached;
+		if (m_Directories.Find(key, cached))
+			return (cached);
+
+		char name[RelativeBufferSize];
+		std::shared_ptr<DirectoryFd> parent = FindParent(directory, name);
+		if (parent == nullptr)
+			return (nullptr);
+		if (name[0] == '.' && name[1] == '\0')
+			return (parent); // The root anchor
+
+		int fd = openat(parent->Get(), name, DirectoryFlags);
+		if (fd < 0)
+			return (nullptr);
+		m_DirectoriesOpened.fetch_add(1, std::memory_order_relaxed);
+
+		cached = std::make_shared<DirectoryFd>(fd);
+		m_Directories.Insert(key, cached);
+		return (cached);
+	}
+
+	DirectoryFdCacheStats DirectoryFdCache::Stats() const
+	{
+		DirectoryFdCacheStats stats;
+		stats.Lookups = m_Lookups.load(std::memory_order_relaxed);
+		stats.ParentHits = m_ParentHits.load(std::memory_order_relaxed);
+		stats.DirectoriesOpened = m_DirectoriesOpened.load(std::memory_order_relaxed);
+		stats.AncestorFallbacks = m_AncestorFallbacks.load(std::memory_order_relaxed);
+		stats.Evictions = m_Directories.Stats().Evictions;
+		return (stats);
+	}
+
+	std::shared_ptr<DirectoryFd> DirectoryFdCache::FindParent(const IPath& path, char* outName)
+	{
+		if (m_Root == nullptr)
+		{
+			errno = EBADF;
+			return (nullptr);
+		}
+		m_Lookups.fetch_add(1, std::memory_order_relaxed);
+
+		const TCHAR* data = path.Data();
+		PathSize anchorLength = RootAnchorLength(path);
+		if (path.Size() <= anchorLength)
+		{
+			// The path is the root anchor alone
+			outName[0] = '.';
+			outName[1] = '\0';
+			return (m_Root);
+		}
+
+		ConstSegmentIterator name = path.EndSegment();
+		--name; // Step back over a trailing separator too
+		if (name.Pos() <= anchorLength)
+		{
+			// The parent is the root directory
+			EncodePosixPath(data + name.Pos(), name.Size(), outName);
+			return (m_Root);
+		}
+
+		std::shared_ptr<DirectoryFd> ancestorFd;
+		PathSize parentEnd = name.Pos() - PATH_SEPARATOR_LENGTH;
+		if (m_Directories.Find(data, parentEnd, ancestorFd))
+		{
+			m_ParentHits.fetch_add(1, std::memory_order_relaxed);
+			EncodePosixPath(data + name.Pos(), name.Size(), outName);
+			return (ancestorFd);
+		}
+
+		// Missed: the hash of every folder prefix in one pass, the parent last, so the walk up doesn't hash them again
+		thread_local std::vector<uint64_t> prefixHashes;
+		prefixHashes.clear();
+		HashPathPrefixes(data, name.Pos(), [](uint64_t hash) { prefixHashes.push_back(hash); });
+
+		// Walk up from the grandparent to the deepest cached ancestor, the root anchor ends the walk (the first segment of a relative path is below it)
+		ConstSegmentIterator child = name;
+		--child;
+		size_t prefix = prefixHashes.size() - 1;
+		while (child.Pos() > anchorLength && prefix > 0
+			&& m_Directories.Find(data, child.Pos() - PATH_SEPARATOR_LENGTH, prefixHashes[--prefix], ancestorFd) == false)
+			--child;
+		if (child.Pos() <= anchorLength || ancestorFd == nullptr)
+			ancestorFd = m_Root;
+
+		// Only a parent a thread missed twice in a row is worth opening, a walk misses once per directory:
+		// paths in random order would evict a descriptor for every one they open.
+		// Otherwise the kernel resolves the rest of the path from the deepest cached ancestor, in one call
+		thread_local MissedParent lastMissed;
+		bool missedBefore = lastMissed.CacheId == m_Id && lastMissed.Hash == prefixHashes.back();
+		lastMissed = { m_Id, prefixHashes.back() };
+		if (missedBefore == false)
+		{
+			m_AncestorFallbacks.fetch_add(1, std::memory_order_relaxed);
+			PathSize from = child.Pos() > anchorLength ? child.Pos() : anchorLength;
+			EncodePosixPath(data + from, name.Pos() + name.Size() - from, outName);
+			return (ancestorFd);
+		}
+
+		// Open every missing directory in one call, only the parent is cached:
+		// it is the one the next paths of a walk will share
+		EncodePosixPath(data + name.Pos(), name.Size(), outName);
+		return (OpenAndCache(*ancestorFd, data, child.Pos() > anchorLength ? child.Pos() : anchorLength, parentEnd));
+	}
+
+	std::shared_ptr<DirectoryFd> DirectoryFdCache::OpenAndCache(const DirectoryFd& base, const TCHAR* data, PathSize from, PathSize to)
+	{
+		char relative[RelativeBufferSize];
+		EncodePosixPath(data + from, to - from, relative);
+
+		int fd = openat(base.Get(), relative, DirectoryFlags);
+		if (fd < 0)
+			return (nullptr);
+		m_DirectoriesOpened.fetch_add(1, std::memory_order_relaxed);
+
+		std::shared_ptr<DirectoryFd> directory = std::make_shared<DirectoryFd>(fd);
+		m_Directories.Insert(PathView(data, to), directory); // The key is copied, the view needs no terminator
+		return (directory);
+	}
+}
+
+#endif
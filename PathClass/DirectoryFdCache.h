@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Path.h"
+#include "PathLRU.h"
+
+#ifndef PLATFORM_WINDOWS
+
+#include <atomic>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace PathCore
+{
+	/**
+	 * An open directory descriptor, closed when the last reference goes away.
+	 * Shared so an evicted directory stays usable by the calls that are still using it.
+	 */
+	class DirectoryFd
+	{
+	public:
+		explicit DirectoryFd(int fd)
+			: m_Fd(fd)
+		{}
+		~DirectoryFd();
+
+		DirectoryFd(const DirectoryFd&) = delete;
+		DirectoryFd& operator=(const DirectoryFd&) = delete;
+
+	public:
+		int Get() const { return (m_Fd); }
+
+	private:
+		int m_Fd;
+	};
+
+	struct DirectoryFdCacheStats
+	{
+		/* Paths resolved to a parent directory */
+		uint64_t Lookups = 0;
+		/* The parent directory itself was cached, no directory had to be opened */
+		uint64_t ParentHits = 0;
+		/* Directories opened because no cached descriptor was deep enough */
+		uint64_t DirectoriesOpened = 0;
+		/* Descriptors closed to stay within the budget */
+		uint64_t Evictions = 0;
+		/* Parents missed once in a row, the rest of the path was resolved from the deepest cached ancestor instead of opening them */
+		uint64_t AncestorFallbacks = 0;
+	};
+
+	/**
+	 * Access files relative to cached directory descriptors (openat, fstatat, ...),
+	 * so the kernel only resolves the last segments of a path instead of the whole path every time.
+	 *
+	 * A lookup walks the path from its end looking for the deepest cached ancestor,
+	 * opens what is missing down to the parent in one call, caches the parent, then works relative to it.
+	 * Paths of a directory walk share their parents, so most lookups only hash the parent prefix once.
+	 * A parent is only opened when a thread misses it twice in a row, the first miss resolves the rest of the path
+	 * from the deepest cached ancestor: paths in random order don't open (and evict) a directory each.
+	 *
+	 * The empty first segment of an absolute path ("/usr") is the root anchor, a relative path ("usr/lib") has none:
+	 * the anchor is never opened, every path is resolved relative to the root directory given to the constructor.
+	 *
+	 * Thread safe. The amount of cached descriptors is bounded by the budget (LRU),
+	 * descriptors still in use by a running call are closed once that call is done.
+	 */
+	class DirectoryFdCache
+	{
+	public:
+		/**
+		 * @param rootDirectory The directory the root anchor of the paths maps to
+		 * @param fdBudget The maximum amount of directory descriptors kept open (the root descriptor aside)
+		 */
+		explicit DirectoryFdCache(const char* rootDirectory = "/", size_t fdBudget = 256);
+
+		DirectoryFdCache(const DirectoryFdCache&) = delete;
+		DirectoryFdCache& operator=(const DirectoryFdCache&) = delete;
+
+	public:
+		/* false if the root directory could not be opened */
+		bool IsValid() const { return (m_Root != nullptr); }
+
+		/**
+		 * @brief openat() relative to the cached parent of path
+		 * @return The new descriptor (owned by the caller), or -1 with errno set
+		 */
+		int Open(const IPath& path, int flags, mode_t mode = 0);
+		/**
+		 * @brief fstatat() relative to the cached parent of path
+		 * @param flags fstatat flags, symbolic links are not followed by default
+		 * @return 0, or -1 with errno set
+		 */
+		int Stat(const IPath& path, struct stat& outStat, int flags = AT_SYMLINK_NOFOLLOW);
+		/**
+		 * @brief readlinkat() relative to the cached parent of path
+		 * @return The size of the target (not null terminated), or -1 with errno set
+		 */
+		ssize_t ReadLink(const IPath& path, char* buffer, size_t bufferSize);
+		/**
+		 * @brief The cached descriptor of directory itself, opened and cached on a miss
+		 * @return nullptr with errno set if the directory could not be opened
+		 */
+		std::shared_ptr<DirectoryFd> OpenDirectory(const IPath& directory);
+
+		/* Close every cached descriptor, needed when directories are renamed or removed behind the cache */
+		void Clear() { m_Directories.Clear(); }
+
+	public:
+		size_t Size() const { return (m_Directories.Size()); }
+		DirectoryFdCacheStats Stats() const;
+
+	private:
+		/**
+		 * @brief The descriptor to resolve path from: its parent, or its deepest cached ancestor when the parent is not worth opening
+		 * @param outName Set to the null terminated UTF-8 part of path to resolve from it: the last segment, or every segment below the ancestor
+		 */
+		std::shared_ptr<DirectoryFd> FindParent(const IPath& path, char* outName);
+		/* Open data[from, to) relative to base and cache it as the directory data[0, to) */
+		std::shared_ptr<DirectoryFd> OpenAndCache(const DirectoryFd& base, const TCHAR* data, PathSize from, PathSize to);
+
+	private:
+		std::shared_ptr<DirectoryFd> m_Root;
+		PathLRU<std::shared_ptr<DirectoryFd>> m_Directories;
+		/* Unique to this cache, keys the miss history of the threads */
+		uint64_t m_Id;
+
+		std::atomic<uint64_t> m_Lookups;
+		std::atomic<uint64_t> m_ParentHits;
+		std::atomic<uint64_t> m_DirectoriesOpened;
+		std::atomic<uint64_t> m_AncestorFallbacks;
+	};
+}
+
+#endif
@@ -0,0 +1,173 @@
+#include "Benchmarks.h"
+#include "DirectoryFdCache.h"
+
+#ifndef PLATFORM_WINDOWS
+
+#include <algorithm>
+#include <random>
+#include <string>
+
+#include <ftw.h>
+#include <unistd.h>
+
+using namespace PathCore;
+
+namespace
+{
+	using String = std::basic_string<TCHAR>;
+
+	String ToString(const std::string& narrow) { return (String(narrow.begin(), narrow.end())); }
+
+	int RemoveEntry(const char* path, const struct stat*, int, struct FTW*) { return (remove(path)); }
+
+	struct SyntheticTree
+	{
+		/* Absolute narrow paths, what a plain stat() gets */
+		std::vector<std::string> Absolute;
+		/* The same files below the "/" root anchor */
+		std::vector<StaticPath> Paths;
+	};
+
+	/**
+	 * A deep tree: a shared trunk, then branches that go deep on their own, files in the deepest directories.
+	 * Returns false if the tree could not be created.
+	 */
+	bool CreateTree(const std::string& root, SyntheticTree& tree)
+	{
+		const int trunkDepth = 8;
+		const int branchCount = 32;
+		const int branchDepth = 8;
+		const int fileCount = 64;
+
+		std::string trunk;
+		for (int level = 0; level < trunkDepth; level++)
+		{
+			trunk += "/trunk_directory_" + std::to_string(level);
+			if (mkdir((root + trunk).c_str(), 0755) != 0)
+				return (false);
+		}
+
+		for (int branch = 0; branch < branchCount; branch++)
+		{
+			std::string directory = trunk;
+			for (int level = 0; level < branchDepth; level++)
+			{
+				directory += "/branch" + std::to_string(branch) + "_level" + std::to_string(level);
+				if (mkdir((root + directory).c_str(), 0755) != 0)
+					return (false);
+			}
+
+			for (int file = 0; file < fileCount; file++)
+			{
+				std::string relative = directory + "/file_" + std::to_string(file) + ".dat";
+				std::string absolute = root + relative;
+				int fd = open(absolute.c_str(), O_CREAT | O_WRONLY, 0644);
+				if (fd < 0)
+					return (false);
+				close(fd);
+
+				tree.Absolute.push_back(absolute);
+				tree.Paths.emplace_back(Path(ToString(relative).c_str()));
+			}
+		}
+		return (true);
+	}
+}
+
+void BenchmarkDirectoryFdCache()
+{
+	char rootTemplate[] = "/tmp/PathDirectoryFdCache.XXXXXX";
+	if (mkdtemp(rootTemplate) == nullptr)
+	{
+		std::cout << "DirectoryFdCache: could not create a temporary directory" << std::endl;
+		return;
+	}
+	std::string root = rootTemplate;
+
+	SyntheticTree tree;
+	if (CreateTree(root, tree))
+	{
+		const int passes = 5;
+		size_t calls = tree.Paths.size() * passes;
+		struct stat status;
+
+		size_t plainFailures = 0;
+		double plainSeconds = MeasureSeconds([&]()
+		{
+			for (int pass = 0; pass < passes; pass++)
+			{
+				for (const std::string& absolute : tree.Absolute)
+					plainFailures += (lstat(absolute.c_str(), &status) != 0);
+			}
+		});
+
+		// Walk order: the files of a directory follow each other
+		DirectoryFdCache cache(root.c_str(), 16);
+		size_t cachedFailures = 0;
+		double cachedSeconds = MeasureSeconds([&]()
+		{
+			for (int pass = 0; pass < passes; pass++)
+			{
+				for (const StaticPath& path : tree.Paths)
+					cachedFailures += (cache.Stat(path, status) != 0);
+			}
+		});
+		DirectoryFdCacheStats walkStats = cache.Stats();
+
+		// Random order with a budget smaller than the directory count: the worst case for the cache
+		std::vector<const StaticPath*> shuffled;
+		for (const StaticPath& path : tree.Paths)
+			shuffled.push_back(&path);
+		std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(42));
+
+		DirectoryFdCache smallCache(root.c_str(), 16);
+		size_t randomFailures = 0;
+		double randomSeconds = MeasureSeconds([&]()
+		{
+			for (int pass = 0; pass < passes; pass++)
+			{
+				for (const StaticPath* path : shuffled)
+					randomFailures += (smallCache.Stat(*path, status) != 0);
+			}
+		});
+		DirectoryFdCacheStats randomStats = smallCache.Stats();
+
+		// Random order with the default budget, every parent fits
+		DirectoryFdCache defaultCache(root.c_str());
+		size_t defaultFailures = 0;
+		double defaultSeconds = MeasureSeconds([&]()
+		{
+			for (int pass = 0; pass < passes; pass++)
+			{
+				for (const StaticPath* path : shuffled)
+					defaultFailures += (defaultCache.Stat(*path, status) != 0);
+			}
+		});
+		DirectoryFdCacheStats defaultStats = defaultCache.Stats();
+
+		std::cout << "DirectoryFdCache: " << tree.Paths.size() << " files 17 directories deep, " << passes << " passes" << std::endl;
+		std::cout << "\tlstat(absolute):    " << plainSeconds * 1e9 / calls << " ns/call (" << plainFailures << " failures)" << std::endl;
+		std::cout << "\tCached, walk order: " << cachedSeconds * 1e9 / calls << " ns/call (" << cachedFailures << " failures, "
+			<< walkStats.ParentHits << " parent hits, " << walkStats.DirectoriesOpened << " directories opened, "
+			<< walkStats.AncestorFallbacks << " resolved from an ancestor)" << std::endl;
+		std::cout << "\tCached, random:     " << randomSeconds * 1e9 / calls << " ns/call (" << randomFailures << " failures, "
+			<< randomStats.ParentHits << " parent hits, " << randomStats.DirectoriesOpened << " directories opened, "
+			<< randomStats.Evictions << " evictions, " << randomStats.AncestorFallbacks << " resolved from an ancestor)" << std::endl;
+		std::cout << "\tCached, random, default budget: " << defaultSeconds * 1e9 / calls << " ns/call (" << defaultFailures << " failures, "
+			<< defaultStats.ParentHits << " parent hits, " << defaultStats.DirectoriesOpened << " directories opened, "
+			<< defaultStats.AncestorFallbacks << " resolved from an ancestor)" << std::endl;
+	}
+	else
+		std::cout << "DirectoryFdCache: could not create the synthetic tree in " << root << std::endl;
+
+	nftw(root.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+#else
+
+void BenchmarkDirectoryFdCache()
+{
+	std::cout << "DirectoryFdCache: not available on this platform" << std::endl;
+}
+
+#endif
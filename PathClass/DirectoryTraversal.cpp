@@ -0,0 +1,143 @@
+#include "DirectoryTraversal.h"
+
+#ifdef PLATFORM_LINUX
+
+#include "LinuxDirectory.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace PathCore
+{
+	namespace
+	{
+		/* Bytes asked to getdents64 per call, per depth level */
+		constexpr size_t DirectoryBufferSize = 32 * 1024;
+		constexpr size_t RelativeBufferSize = MaxUtf8Size(MAX_PATH_LENGTH) + NULL_TERMINATOR_LENGTH;
+
+		/* A directory being read, one per depth level */
+		struct Frame
+		{
+			int Fd = -1;
+			std::vector<char> Buffer;
+			long Size = 0;
+			long Offset = 0;
+		};
+
+		/* The open directories, closed with the coroutine even when the consumer stops early */
+		struct FrameStack
+		{
+			std::vector<Frame> Frames;
+			size_t Depth = 0;
+
+			~FrameStack()
+			{
+				for (size_t index = 0; index < Depth; index++)
+					close(Frames[index].Fd);
+			}
+
+			/* Reuse the frame of this depth level if it was already reached */
+			void Push(int fd)
+			{
+				if (Depth == Frames.size())
+				{
+					Frames.emplace_back();
+					Frames.back().Buffer.resize(DirectoryBufferSize);
+				}
+				Frame& frame = Frames[Depth++];
+				frame.Fd = fd;
+				frame.Size = 0;
+				frame.Offset = 0;
+			}
+
+			void Pop()
+			{
+				close(Frames[--Depth].Fd);
+			}
+		};
+
+		void ShrinkLastSegment(Path& path)
+		{
+			SegmentIterator last = path.EndSegment();
+			--last;
+			path.Shrink(last);
+		}
+
+		/* The root path is copied before the coroutine starts, the caller's path may be a temporary */
+		Generator<const IPath&> Traverse(Path path, DirectoryTraversalOptions options)
+		{
+			int rootFd = open(options.RootDirectory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			if (rootFd < 0)
+				co_return;
+
+			FrameStack stack;
+			PathSize nameStart = RootAnchorLength(path);
+			if (nameStart >= path.Size())
+				stack.Push(rootFd); // The root anchor itself
+			else
+			{
+				char relative[RelativeBufferSize];
+				EncodePosixPath(path.Data() + nameStart, path.Size() - nameStart, relative);
+				int fd = openat(rootFd, relative, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+				close(rootFd);
+				if (fd < 0)
+					co_return;
+				stack.Push(fd);
+			}
+
+			TCHAR name[PATH_MAX_FOLDER_NAME_LENGTH + NULL_TERMINATOR_LENGTH];
+			while (stack.Depth > 0)
+			{
+				Frame& frame = stack.Frames[stack.Depth - 1];
+				if (frame.Offset == frame.Size)
+				{
+					frame.Size = ReadDirectoryEntries(frame.Fd, frame.Buffer.data(), frame.Buffer.size());
+					frame.Offset = 0;
+					if (frame.Size <= 0)
+					{
+						// This directory is done, go back to its parent
+						frame.Size = 0;
+						stack.Pop();
+						if (stack.Depth > 0)
+							ShrinkLastSegment(path);
+						continue;
+					}
+				}
+
+				const LinuxDirent64* record = reinterpret_cast<const LinuxDirent64*>(frame.Buffer.data() + frame.Offset);
+				frame.Offset += record->RecordLength;
+				if (IsDotOrDotDot(record->Name))
+					continue;
+
+				WalkEntryType type;
+				SegmentSize nameSize;
+				if (ReadEntryType(frame.Fd, *record, type) == false || DecodeEntryName(record->Name, name, nameSize) == false
+					|| path.Size() + PATH_SEPARATOR_LENGTH + nameSize > MAX_PATH_LENGTH)
+					continue;
+
+				path.Append(name);
+				co_yield path;
+
+				if (type == WalkEntryType::Directory && stack.Depth < options.MaxDepth)
+				{
+					int fd = openat(frame.Fd, record->Name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+					if (fd >= 0)
+					{
+						stack.Push(fd);
+						continue; // The directory name stays in path while its entries are yielded
+					}
+				}
+				ShrinkLastSegment(path);
+			}
+		}
+	}
+
+	Generator<const IPath&> TraverseDirectory(const IPath& root, const DirectoryTraversalOptions& options)
+	{
+		Path path;
+		path.Append(root.BeginSegment(), root.EndSegment());
+		return (Traverse(std::move(path), options));
+	}
+}
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Generator.h"
+#include "Path.h"
+
+#ifdef PLATFORM_LINUX
+
+#include <cstdint>
+#include <limits>
+
+namespace PathCore
+{
+	struct DirectoryTraversalOptions
+	{
+		/* The directory the root anchor of the paths (the empty segment of "/usr", relative paths have none) maps to */
+		const char* RootDirectory = "/";
+		/* Directories deeper than this are yielded but not entered */
+		uint16_t MaxDepth = std::numeric_limits<uint16_t>::max();
+	};
+
+	/**
+	 * @brief Lazily yield every entry below root, depth first, on the calling thread
+	 *
+	 * One PathBase follows the traversal: an entry is appended to it, yielded, then removed with Shrink
+	 * (or kept while its own entries are yielded, for a directory).
+	 * Entries are read on demand with getdents64, one reused buffer per depth level,
+	 * so once the deepest level was reached nothing is allocated anymore.
+	 * Stopping the loop early closes the open directories and skips the rest of the tree.
+	 *
+	 * Symbolic links are yielded, never followed. Names that cannot be a segment (not UTF-8, too long, ...) are skipped.
+	 *
+	 * @return The yielded path is only valid until the loop moves to the next entry, copy it to a StaticPath to keep it
+	 * @example for (const IPath& path : TraverseDirectory(Path(TEXT("/home/user/Projects")))) { ... }
+	 */
+	Generator<const IPath&> TraverseDirectory(const IPath& root, const DirectoryTraversalOptions& options = DirectoryTraversalOptions());
+}
+
+#endif
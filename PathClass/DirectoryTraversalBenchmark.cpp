@@ -0,0 +1,112 @@
+#include "Benchmarks.h"
+#include "DirectoryTraversal.h"
+
+#ifdef PLATFORM_LINUX
+
+#include <filesystem>
+#include <string>
+
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace PathCore;
+
+namespace
+{
+	int RemoveEntry(const char* path, const struct stat*, int, struct FTW*) { return (remove(path)); }
+
+	/* fanout^depth directories, files in every directory, returns the amount of entries created */
+	size_t CreateTree(const std::string& directory, int depth, int fanout, int fileCount)
+	{
+		size_t created = 0;
+		for (int file = 0; file < fileCount; file++)
+		{
+			int fd = open((directory + "/file_" + std::to_string(file) + ".txt").c_str(), O_CREAT | O_WRONLY, 0644);
+			if (fd >= 0)
+			{
+				close(fd);
+				created++;
+			}
+		}
+		if (depth == 0)
+			return (created);
+
+		for (int child = 0; child < fanout; child++)
+		{
+			std::string childDirectory = directory + "/directory_" + std::to_string(child);
+			if (mkdir(childDirectory.c_str(), 0755) == 0)
+				created += 1 + CreateTree(childDirectory, depth - 1, fanout, fileCount);
+		}
+		return (created);
+	}
+}
+
+void BenchmarkDirectoryTraversal()
+{
+	char rootTemplate[] = "/tmp/PathDirectoryTraversal.XXXXXX";
+	if (mkdtemp(rootTemplate) == nullptr)
+	{
+		std::cout << "DirectoryTraversal: could not create a temporary directory" << std::endl;
+		return;
+	}
+	std::string root = rootTemplate;
+	size_t created = CreateTree(root, 4, 8, 8);
+
+	size_t filesystemEntries = 0;
+	double filesystemSeconds = MeasureSeconds([&]()
+	{
+		for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(root))
+			filesystemEntries += entry.path().native().size() > 0;
+	});
+
+	DirectoryTraversalOptions options;
+	options.RootDirectory = root.c_str();
+	Path walkedRoot(TEXT("/"));
+
+	size_t entries = 0;
+	int allocations = 0;
+	double seconds = MeasureSeconds([&]()
+	{
+		allocations = CountAllocations([&]()
+		{
+			for (const IPath& path : TraverseDirectory(walkedRoot, options))
+				entries += path.Size() > 0;
+		});
+	});
+
+	// Many tools stop at the first match
+	int target = 0;
+	std::basic_string<TCHAR> targetName = TEXT("file_3.txt");
+	double firstMatchSeconds = MeasureSeconds([&]()
+	{
+		for (const IPath& path : TraverseDirectory(walkedRoot, options))
+		{
+			ConstSegmentIterator name = path.EndSegment();
+			--name;
+			if (targetName.compare(0, targetName.size(), *name, name.Size()) == 0)
+			{
+				target++;
+				break;
+			}
+		}
+	});
+
+	std::cout << "DirectoryTraversal: " << created << " entries" << std::endl;
+	std::cout << "\tstd::filesystem: " << filesystemEntries / filesystemSeconds / 1e6 << " M entries/s" << std::endl;
+	std::cout << "\tGenerator:       " << entries / seconds / 1e6 << " M entries/s, " << allocations << " allocations for "
+		<< entries << " entries (one frame per depth level, the coroutine, the root path)" << std::endl;
+	std::cout << "\tFirst match:     " << firstMatchSeconds * 1e6 << " us (" << target << " found)" << std::endl;
+
+	nftw(root.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+#else
+
+void BenchmarkDirectoryTraversal()
+{
+	std::cout << "DirectoryTraversal: not available on this platform" << std::endl;
+}
+
+#endif
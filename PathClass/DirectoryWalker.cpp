@@ -0,0 +1,461 @@
+#include "DirectoryWalker.h"
+
+#ifdef PLATFORM_LINUX
+
+#include "DirectoryFdCache.h"
+#include "LinuxDirectory.h"
+#include "PathEncoding.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace PathCore
+{
+	namespace
+	{
+		/* Bytes asked to getdents64 per call, a few hundred entries */
+		constexpr size_t DirectoryBufferSize = 64 * 1024;
+		constexpr size_t RelativeBufferSize = MaxUtf8Size(MAX_PATH_LENGTH) + NULL_TERMINATOR_LENGTH;
+		/* TCHARs per name arena, the names of a few thousand directories */
+		constexpr size_t NameArenaSize = 64 * 1024;
+		/* Descriptors a worker keeps open along the path it is reading, the shallowest one is closed past that */
+		constexpr size_t MaxHeldDirectories = 32;
+
+		/**
+		 * A directory to read, recorded in the arena of the worker that found it.
+		 * Only its name is stored, its path is the root followed by the names of its parents.
+		 * Records live until the end of the walk: a stolen directory still points to the parents recorded by its victim.
+		 */
+		struct DirectoryRecord
+		{
+			/* Null for the root */
+			const DirectoryRecord* Parent;
+			const TCHAR* Name;
+			SegmentSize NameSize;
+			uint16_t Depth;
+		};
+
+		struct PendingEntry
+		{
+			size_t NameOffset;
+			SegmentSize NameSize;
+			WalkEntryType Type;
+		};
+
+		struct Worker
+		{
+			std::mutex Mutex;
+			std::deque<const DirectoryRecord*> Queue;
+
+			/* The directories queued by this worker, only appended to (a deque never moves its elements) */
+			std::deque<DirectoryRecord> Records;
+			std::vector<std::unique_ptr<TCHAR[]>> NameArenas;
+			size_t NameArenaUsed = NameArenaSize;
+
+			/* The directories of Buffer by depth, the root first, and their descriptor while it is open (-1 otherwise) */
+			std::vector<const DirectoryRecord*> Chain;
+			std::vector<int> ChainFds;
+			size_t HeldFds = 0;
+			/* The directories between a taken one and Chain, the deepest first */
+			std::vector<const DirectoryRecord*> Ancestors;
+
+			/* Reused for every directory, a worker doesn't allocate per entry */
+			Path Buffer;
+			std::vector<char> DirectoryBuffer;
+			std::vector<PendingEntry> Entries;
+			std::vector<TCHAR> Names;
+
+			DirectoryWalkerStats Stats;
+		};
+
+		class DirectoryWalker
+		{
+		public:
+			DirectoryWalker(const IPath& root, const WalkCallback& callback, const DirectoryWalkerOptions& options, unsigned int workerCount)
+				: m_Root(root),
+				m_RootRecord{ nullptr, nullptr, 0, 0 },
+				m_Callback(callback),
+				m_Options(options),
+				m_Pending(0),
+				m_WorkEpoch(0)
+			{
+				for (unsigned int index = 0; index < workerCount; index++)
+				{
+					m_Workers.emplace_back(std::make_unique<Worker>());
+					m_Workers.back()->DirectoryBuffer.resize(DirectoryBufferSize);
+				}
+			}
+
+		public:
+			bool Start()
+			{
+				int rootFd = open(m_Options.RootDirectory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+				if (rootFd < 0)
+					return (false);
+
+				// The root anchor is opened here, the rest of the root path by the first worker
+				m_RootDirectory = std::make_unique<DirectoryFd>(rootFd);
+				Push(*m_Workers[0], &m_RootRecord);
+				return (true);
+			}
+
+			void Run(unsigned int workerIndex)
+			{
+				Worker& worker = *m_Workers[workerIndex];
+				const DirectoryRecord* directory;
+				while (true)
+				{
+					// Read before looking at the queues: a Push after the look changes it and the wait below returns at once
+					uint32_t epoch = m_WorkEpoch.load(std::memory_order_acquire);
+					if (PopNewest(worker, directory) || Steal(workerIndex, directory))
+					{
+						ReadDirectory(workerIndex, worker, directory);
+						if (m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+							Wake(true); // The last directory, the sleeping workers are done
+						continue;
+					}
+
+					// Nothing queued anywhere: done once no directory is being read either (it could queue more)
+					if (m_Pending.load(std::memory_order_acquire) == 0)
+						break;
+					worker.Stats.IdleWaits++;
+					m_WorkEpoch.wait(epoch, std::memory_order_acquire);
+				}
+				LeaveDirectories(worker, 0);
+			}
+
+			DirectoryWalkerStats Stats() const
+			{
+				DirectoryWalkerStats stats;
+				for (const std::unique_ptr<Worker>& worker : m_Workers)
+				{
+					stats.Directories += worker->Stats.Directories;
+					stats.Entries += worker->Stats.Entries;
+					stats.Steals += worker->Stats.Steals;
+					stats.Errors += worker->Stats.Errors;
+					stats.SkippedNames += worker->Stats.SkippedNames;
+					stats.IdleWaits += worker->Stats.IdleWaits;
+				}
+				return (stats);
+			}
+
+		private:
+			void Push(Worker& worker, const DirectoryRecord* directory)
+			{
+				m_Pending.fetch_add(1, std::memory_order_acq_rel);
+				{
+					std::lock_guard<std::mutex> lock(worker.Mutex);
+					worker.Queue.push_back(directory);
+				}
+				Wake(false);
+			}
+
+			/* Wake one sleeping worker for a new directory, or all of them when the walk is over */
+			void Wake(bool all)
+			{
+				m_WorkEpoch.fetch_add(1, std::memory_order_release);
+				if (all)
+					m_WorkEpoch.notify_all();
+				else
+					m_WorkEpoch.notify_one();
+			}
+
+			bool PopNewest(Worker& worker, const DirectoryRecord*& outDirectory)
+			{
+				std::lock_guard<std::mutex> lock(worker.Mutex);
+				if (worker.Queue.empty())
+					return (false);
+				outDirectory = worker.Queue.back();
+				worker.Queue.pop_back();
+				return (true);
+			}
+
+			bool Steal(unsigned int thiefIndex, const DirectoryRecord*& outDirectory)
+			{
+				for (size_t offset = 1; offset < m_Workers.size(); offset++)
+				{
+					Worker& victim = *m_Workers[(thiefIndex + offset) % m_Workers.size()];
+					std::lock_guard<std::mutex> lock(victim.Mutex);
+					if (victim.Queue.empty())
+						continue;
+
+					outDirectory = victim.Queue.front();
+					victim.Queue.pop_front();
+					m_Workers[thiefIndex]->Stats.Steals++;
+					return (true);
+				}
+				return (false);
+			}
+
+			/* Copy the name of a subdirectory to the arena of the worker and record it */
+			static const DirectoryRecord* RecordDirectory(Worker& worker, const DirectoryRecord& parent, const TCHAR* name, SegmentSize nameSize)
+			{
+				if (worker.NameArenaUsed + nameSize + NULL_TERMINATOR_LENGTH > NameArenaSize)
+				{
+					worker.NameArenas.emplace_back(new TCHAR[NameArenaSize]);
+					worker.NameArenaUsed = 0;
+				}
+				TCHAR* copy = worker.NameArenas.back().get() + worker.NameArenaUsed;
+				std::copy(name, name + nameSize + NULL_TERMINATOR_LENGTH, copy);
+				worker.NameArenaUsed += nameSize + NULL_TERMINATOR_LENGTH;
+
+				worker.Records.push_back(DirectoryRecord{ &parent, copy, nameSize, static_cast<uint16_t>(parent.Depth + 1) });
+				return (&worker.Records.back());
+			}
+
+			/* Shrink the buffer to what it shares with path, then append the rest of path */
+			static void MoveBufferTo(Path& buffer, const IPath& path)
+			{
+				SegmentIterator bufferSegment = buffer.BeginSegment();
+				ConstSegmentIterator pathSegment = path.BeginSegment();
+				while (bufferSegment && pathSegment && bufferSegment.Size() == pathSegment.Size()
+					&& std::equal(*pathSegment, *pathSegment + pathSegment.Size(), *bufferSegment))
+				{
+					++bufferSegment;
+					++pathSegment;
+				}
+				buffer.Shrink(bufferSegment);
+				buffer.Append(pathSegment, path.EndSegment());
+			}
+
+			/* Close the directories of the worker deeper than keep, and remove their names from the buffer */
+			static void LeaveDirectories(Worker& worker, size_t keep)
+			{
+				ConstSegmentIterator segment = worker.Buffer.EndSegment();
+				for (size_t depth = worker.Chain.size(); depth > keep; depth--)
+				{
+					if (worker.ChainFds[depth - 1] >= 0)
+					{
+						close(worker.ChainFds[depth - 1]);
+						worker.HeldFds--;
+					}
+					if (keep > 0)
+						--segment;
+				}
+				// Without the root, the buffer is moved to the root path when a directory is entered
+				if (keep > 0 && keep < worker.Chain.size())
+					worker.Buffer.Shrink(segment);
+				worker.Chain.resize(std::min(keep, worker.Chain.size()));
+				worker.ChainFds.resize(worker.Chain.size());
+			}
+
+			/**
+			 * Move the buffer of the worker to directory and open it,
+			 * relative to the deepest directory of its path the worker still has open (its parent, unless it was stolen)
+			 * @return The descriptor, owned by the worker, or -1
+			 */
+			int EnterDirectory(Worker& worker, const DirectoryRecord& directory)
+			{
+				// Walk up to the deepest directory the worker is already in
+				worker.Ancestors.clear();
+				const DirectoryRecord* shared = &directory;
+				while (shared && (shared->Depth >= worker.Chain.size() || worker.Chain[shared->Depth] != shared))
+				{
+					worker.Ancestors.push_back(shared);
+					shared = shared->Parent;
+				}
+				LeaveDirectories(worker, shared ? shared->Depth + 1 : 0);
+
+				for (size_t index = worker.Ancestors.size(); index > 0; index--)
+				{
+					const DirectoryRecord* record = worker.Ancestors[index - 1];
+					if (record->Parent == nullptr)
+						MoveBufferTo(worker.Buffer, m_Root);
+					else
+						worker.Buffer.Append(record->Name);
+					worker.Chain.push_back(record);
+					worker.ChainFds.push_back(-1);
+				}
+
+				// Open the path below the deepest open directory in one call, the root directory of the options when there is none
+				size_t from = directory.Depth;
+				while (from > 0 && worker.ChainFds[from - 1] < 0)
+					from--;
+				const TCHAR* relativeStart = worker.Buffer.Data() + RootAnchorLength(m_Root);
+				if (from > 0)
+				{
+					ConstSegmentIterator segment = worker.Buffer.EndSegment();
+					for (size_t depth = from; depth <= directory.Depth; depth++)
+						--segment;
+					relativeStart = *segment;
+				}
+				const TCHAR* relativeEnd = worker.Buffer.Data() + worker.Buffer.Size();
+
+				char relative[RelativeBufferSize];
+				if (relativeStart >= relativeEnd)
+					std::strcpy(relative, "."); // The root anchor itself
+				else
+					EncodePosixPath(relativeStart, relativeEnd - relativeStart, relative);
+
+				// Symbolic links are reported, never entered, but the walked directory itself may be one
+				int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC | (directory.Depth > 0 ? O_NOFOLLOW : 0);
+				int fd = openat(from > 0 ? worker.ChainFds[from - 1] : m_RootDirectory->Get(), relative, flags);
+				if (fd < 0)
+					return (-1);
+
+				worker.ChainFds[directory.Depth] = fd;
+				if (++worker.HeldFds > MaxHeldDirectories)
+				{
+					std::vector<int>::iterator shallowest = std::find_if(worker.ChainFds.begin(), worker.ChainFds.end(), [](int heldFd) { return (heldFd >= 0); });
+					close(*shallowest);
+					*shallowest = -1;
+					worker.HeldFds--;
+				}
+				return (fd);
+			}
+
+			void ReadDirectory(unsigned int workerIndex, Worker& worker, const DirectoryRecord* directory)
+			{
+				int fd = EnterDirectory(worker, *directory);
+				if (fd < 0)
+				{
+					worker.Stats.Errors++;
+					return;
+				}
+				worker.Stats.Directories++;
+
+				// Read everything first: the entries can be sorted before they are reported
+				worker.Entries.clear();
+				worker.Names.clear();
+				while (true)
+				{
+					long read = ReadDirectoryEntries(fd, worker.DirectoryBuffer.data(), worker.DirectoryBuffer.size());
+					if (read <= 0)
+					{
+						worker.Stats.Errors += (read < 0);
+						break;
+					}
+
+					for (long offset = 0; offset < read; )
+					{
+						const LinuxDirent64* record = reinterpret_cast<const LinuxDirent64*>(worker.DirectoryBuffer.data() + offset);
+						offset += record->RecordLength;
+						if (IsDotOrDotDot(record->Name))
+							continue;
+
+						WalkEntryType type;
+						if (ReadEntryType(fd, *record, type) == false)
+							continue; // Removed in between
+
+						size_t nameOffset = worker.Names.size();
+						worker.Names.resize(nameOffset + PATH_MAX_FOLDER_NAME_LENGTH + NULL_TERMINATOR_LENGTH);
+						SegmentSize nameSize;
+						if (DecodeEntryName(record->Name, worker.Names.data() + nameOffset, nameSize) == false)
+						{
+							worker.Names.resize(nameOffset);
+							worker.Stats.SkippedNames++;
+							continue;
+						}
+						worker.Names.resize(nameOffset + nameSize + NULL_TERMINATOR_LENGTH);
+						worker.Entries.push_back({ nameOffset, nameSize, type });
+					}
+				}
+
+				if (m_Options.SortEntries)
+				{
+					const TCHAR* names = worker.Names.data();
+					std::sort(worker.Entries.begin(), worker.Entries.end(), [names](const PendingEntry& left, const PendingEntry& right)
+					{
+						return (std::lexicographical_compare(names + left.NameOffset, names + left.NameOffset + left.NameSize,
+							names + right.NameOffset, names + right.NameOffset + right.NameSize));
+					});
+				}
+
+				PathSize directorySize = worker.Buffer.Size();
+				uint16_t depth = directory->Depth + 1;
+				for (const PendingEntry& entry : worker.Entries)
+				{
+					if (directorySize + PATH_SEPARATOR_LENGTH + entry.NameSize > MAX_PATH_LENGTH)
+					{
+						worker.Stats.SkippedNames++;
+						continue;
+					}
+
+					worker.Buffer.Append(worker.Names.data() + entry.NameOffset);
+					worker.Stats.Entries++;
+					m_Callback(worker.Buffer, WalkEntry{ entry.Type, depth, workerIndex });
+
+					if (entry.Type == WalkEntryType::Directory && depth < m_Options.MaxDepth)
+						Push(worker, RecordDirectory(worker, *directory, worker.Names.data() + entry.NameOffset, entry.NameSize));
+
+					ConstSegmentIterator name = worker.Buffer.EndSegment();
+					--name;
+					worker.Buffer.Shrink(name);
+				}
+			}
+
+		private:
+			StaticPath m_Root;
+			DirectoryRecord m_RootRecord;
+			std::unique_ptr<DirectoryFd> m_RootDirectory;
+			const WalkCallback& m_Callback;
+			const DirectoryWalkerOptions& m_Options;
+			std::vector<std::unique_ptr<Worker>> m_Workers;
+			/* Directories queued or being read */
+			std::atomic<size_t> m_Pending;
+			/* Changed by every Push, the idle workers sleep on it instead of spinning */
+			std::atomic<uint32_t> m_WorkEpoch;
+		};
+	}
+
+	DirectoryWalkerStats WalkDirectory(const IPath& root, const WalkCallback& callback, const DirectoryWalkerOptions& options)
+	{
+		std::unique_ptr<ThreadPool> temporaryPool;
+		ThreadPool* pool = options.Pool;
+		if (pool == nullptr)
+		{
+			temporaryPool = std::make_unique<ThreadPool>();
+			pool = temporaryPool.get();
+		}
+
+		DirectoryWalker walker(root, callback, options, pool->ThreadCount());
+		DirectoryWalkerStats stats;
+		if (walker.Start() == false)
+		{
+			stats.Errors++;
+			return (stats);
+		}
+
+		for (unsigned int index = 0; index < pool->ThreadCount(); index++)
+			pool->Enqueue([&walker, index]() { walker.Run(index); });
+		pool->Wait();
+
+		return (walker.Stats());
+	}
+
+	std::vector<StaticPath> CollectDirectory(const IPath& root, const DirectoryWalkerOptions& options, DirectoryWalkerStats* outStats)
+	{
+		std::unique_ptr<ThreadPool> temporaryPool;
+		DirectoryWalkerOptions collectOptions = options;
+		if (collectOptions.Pool == nullptr)
+		{
+			temporaryPool = std::make_unique<ThreadPool>();
+			collectOptions.Pool = temporaryPool.get();
+		}
+
+		// One list per worker, so the callback never locks
+		std::vector<std::vector<StaticPath>> workerPaths(collectOptions.Pool->ThreadCount());
+		DirectoryWalkerStats stats = WalkDirectory(root, [&workerPaths](const IPath& path, const WalkEntry& entry)
+		{
+			workerPaths[entry.Worker].emplace_back(path);
+		}, collectOptions);
+		if (outStats)
+			*outStats = stats;
+
+		std::vector<StaticPath> paths;
+		paths.reserve(stats.Entries);
+		for (std::vector<StaticPath>& list : workerPaths)
+			std::move(list.begin(), list.end(), std::back_inserter(paths));
+		return (paths);
+	}
+}
+
+#endif
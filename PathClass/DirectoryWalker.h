@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Path.h"
+
+#ifdef PLATFORM_LINUX
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+
+namespace PathCore
+{
+	class ThreadPool;
+
+	enum class WalkEntryType : uint8_t
+	{
+		File,
+		Directory,
+		Symlink,	// Reported, never followed
+		Other		// Devices, sockets, pipes, ...
+	};
+
+	struct WalkEntry
+	{
+		WalkEntryType Type;
+		/* 1 for the entries of the walked directory itself */
+		uint16_t Depth;
+		/* The worker reporting the entry, to keep per worker state without locking */
+		unsigned int Worker;
+	};
+
+	struct DirectoryWalkerOptions
+	{
+		/* Pool running the workers, when null a temporary pool is created for the walk */
+		ThreadPool* Pool = nullptr;
+		/* The directory the root anchor of the paths (the empty segment of "/usr", relative paths have none) maps to */
+		const char* RootDirectory = "/";
+		/* Report the entries of each directory sorted by name, the directories themselves are still walked in parallel */
+		bool SortEntries = false;
+		/* Directories deeper than this are reported but not entered */
+		uint16_t MaxDepth = std::numeric_limits<uint16_t>::max();
+	};
+
+	struct DirectoryWalkerStats
+	{
+		uint64_t Directories = 0;
+		uint64_t Entries = 0;
+		/* Directories taken from the queue of another worker */
+		uint64_t Steals = 0;
+		/* Directories that could not be opened or read */
+		uint64_t Errors = 0;
+		/* Entries whose name is not valid UTF-8 or cannot be a segment (too long, forbidden character) */
+		uint64_t SkippedNames = 0;
+		/* Times a worker found nothing to take and slept until a directory was queued */
+		uint64_t IdleWaits = 0;
+	};
+
+	/**
+	 * @brief Called for every entry, concurrently from every worker
+	 * @param path Only valid during the call, it is the buffer of the worker
+	 */
+	using WalkCallback = std::function<void(const IPath& path, const WalkEntry& entry)>;
+
+	/**
+	 * @brief Enumerate every entry below root in parallel, with openat() and getdents64()
+	 *
+	 * Each worker owns one PathBase: an entry is reported by appending its name to the directory being read,
+	 * and removed with Shrink once reported, paths are never rebuilt from scratch.
+	 * A worker reads a whole directory before reporting its entries, then queues its subdirectories in its own deque.
+	 * Workers take their newest directory first (depth first, cache friendly)
+	 * and steal the oldest directory of another worker when they run out of work (big subtrees near the root).
+	 * A queued directory is only its name, kept in an arena of the worker that found it with a link to its parent.
+	 * The worker that takes it opens it relative to the deepest directory of its path that worker still has open,
+	 * so queued directories hold no descriptor and a worker holds a few, along the path it is reading.
+	 *
+	 * @param root A directory, absolute or relative to DirectoryWalkerOptions::RootDirectory (see RootAnchorLength)
+	 * @note All the entries of one directory are reported by the same worker, one after the other
+	 */
+	DirectoryWalkerStats WalkDirectory(const IPath& root, const WalkCallback& callback, const DirectoryWalkerOptions& options = DirectoryWalkerOptions());
+
+	/**
+	 * @brief Walk root and keep every path
+	 * @note The paths of a directory are contiguous, the order of the directories depends on the scheduling
+	 */
+	std::vector<StaticPath> CollectDirectory(const IPath& root, const DirectoryWalkerOptions& options = DirectoryWalkerOptions(), DirectoryWalkerStats* outStats = nullptr);
+}
+
+#endif
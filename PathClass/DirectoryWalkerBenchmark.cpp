@@ -0,0 +1,107 @@
+#include "Benchmarks.h"
+#include "DirectoryWalker.h"
+#include "ThreadPool.h"
+
+#ifdef PLATFORM_LINUX
+
+#include <atomic>
+#include <filesystem>
+#include <string>
+
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace PathCore;
+
+namespace
+{
+	using String = std::basic_string<TCHAR>;
+
+	int RemoveEntry(const char* path, const struct stat*, int, struct FTW*) { return (remove(path)); }
+
+	/* fanout^depth directories, files in every directory, returns the amount of entries created */
+	size_t CreateTree(const std::string& directory, int depth, int fanout, int fileCount)
+	{
+		size_t created = 0;
+		for (int file = 0; file < fileCount; file++)
+		{
+			int fd = open((directory + "/file_" + std::to_string(file) + ".txt").c_str(), O_CREAT | O_WRONLY, 0644);
+			if (fd >= 0)
+			{
+				close(fd);
+				created++;
+			}
+		}
+		if (depth == 0)
+			return (created);
+
+		for (int child = 0; child < fanout; child++)
+		{
+			std::string childDirectory = directory + "/directory_" + std::to_string(child);
+			if (mkdir(childDirectory.c_str(), 0755) == 0)
+				created += 1 + CreateTree(childDirectory, depth - 1, fanout, fileCount);
+		}
+		return (created);
+	}
+}
+
+void BenchmarkDirectoryWalker()
+{
+	char rootTemplate[] = "/tmp/PathDirectoryWalker.XXXXXX";
+	if (mkdtemp(rootTemplate) == nullptr)
+	{
+		std::cout << "DirectoryWalker: could not create a temporary directory" << std::endl;
+		return;
+	}
+	std::string root = rootTemplate;
+	size_t created = CreateTree(root, 4, 10, 8);
+
+	size_t filesystemEntries = 0;
+	double filesystemSeconds = MeasureSeconds([&]()
+	{
+		for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(root))
+		{
+			filesystemEntries += entry.path().native().size() > 0;
+		}
+	});
+
+	std::cout << "DirectoryWalker: " << created << " entries" << std::endl;
+	std::cout << "\tstd::filesystem: " << filesystemEntries / filesystemSeconds / 1e6 << " M entries/s" << std::endl;
+
+	// The whole temporary tree is the root anchor, so the walked path is "/"
+	Path walkedRoot(TEXT("/"));
+	for (unsigned int threadCount : { 1u, 2u, 4u, std::thread::hardware_concurrency() })
+	{
+		ThreadPool pool(threadCount);
+		DirectoryWalkerOptions options;
+		options.Pool = &pool;
+		options.RootDirectory = root.c_str();
+
+		std::atomic<size_t> walkedEntries(0);
+		DirectoryWalkerStats stats;
+		double seconds = MeasureSeconds([&]()
+		{
+			stats = WalkDirectory(walkedRoot, [&walkedEntries](const IPath& path, const WalkEntry&)
+			{
+				walkedEntries.fetch_add(path.Size() > 0, std::memory_order_relaxed);
+			}, options);
+		});
+
+		std::cout << "\tWalker, " << threadCount << " threads: " << walkedEntries / seconds / 1e6 << " M entries/s ("
+			<< stats.Directories << " directories, " << stats.Steals << " steals, " << stats.IdleWaits << " idle waits, " << stats.Errors << " errors)"
+			<< (walkedEntries == created ? "" : " (MISMATCH)") << std::endl;
+	}
+
+	nftw(root.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+#else
+
+void BenchmarkDirectoryWalker()
+{
+	std::cout << "DirectoryWalker: not available on this platform" << std::endl;
+}
+
+#endif
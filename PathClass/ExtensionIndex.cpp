@@ -0,0 +1,151 @@
+#include "ExtensionIndex.h"
+#include "PathHash.h"
+
+namespace PathCore
+{
+	namespace
+	{
+		constexpr size_t InitialSlotCount = 64;
+
+		TCHAR FoldCase(TCHAR character)
+		{
+			return (character >= TEXT('A') && character <= TEXT('Z') ? static_cast<TCHAR>(character - TEXT('A') + TEXT('a')) : character);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// EXTENSION TABLE
+
+	ExtensionTable::ExtensionTable(bool ignoreCase)
+		: m_IgnoreCase(ignoreCase)
+	{
+		Clear();
+	}
+
+	uint32_t ExtensionTable::Intern(StringView extension)
+	{
+		uint64_t hash = Hash(extension);
+		size_t slot = FindSlot(extension, hash);
+		if (m_Slots[slot] != 0)
+			return (m_Slots[slot] - 1);
+
+		uint32_t id = static_cast<uint32_t>(Size());
+		m_Characters.insert(m_Characters.end(), extension.begin(), extension.end());
+		m_Offsets.push_back(static_cast<uint32_t>(m_Characters.size()));
+		m_Slots[slot] = id + 1;
+		if (Size() * 2 > m_Slots.size())
+			Grow();
+		return (id);
+	}
+
+	uint32_t ExtensionTable::Find(StringView extension) const
+	{
+		size_t slot = FindSlot(extension, Hash(extension));
+		return (m_Slots[slot] != 0 ? m_Slots[slot] - 1 : InvalidExtension);
+	}
+
+	void ExtensionTable::Clear()
+	{
+		m_Characters.clear();
+		m_Offsets.assign(1, 0);
+		m_Slots.assign(InitialSlotCount, 0);
+		// The empty extension is always there, so the paths without extension don't need a special case
+		Intern(StringView());
+	}
+
+	uint64_t ExtensionTable::Hash(StringView extension) const
+	{
+		uint64_t hash = PathHashSeed;
+		for (TCHAR character : extension)
+		{
+			hash ^= static_cast<uint64_t>(m_IgnoreCase ? FoldCase(character) : character);
+			hash *= 1099511628211ull;
+		}
+		return (MixHash(hash));
+	}
+
+	bool ExtensionTable::IsSame(uint32_t id, StringView extension) const
+	{
+		StringView stored = (*this)[id];
+		if (stored.size() != extension.size())
+			return (false);
+		if (m_IgnoreCase == false)
+			return (stored == extension);
+		for (size_t index = 0; index < stored.size(); index++)
+		{
+			if (FoldCase(stored[index]) != FoldCase(extension[index]))
+				return (false);
+		}
+		return (true);
+	}
+
+	size_t ExtensionTable::FindSlot(StringView extension, uint64_t hash) const
+	{
+		size_t mask = m_Slots.size() - 1;
+		for (size_t slot = hash & mask; ; slot = (slot + 1) & mask)
+		{
+			if (m_Slots[slot] == 0 || IsSame(m_Slots[slot] - 1, extension))
+				return (slot);
+		}
+	}
+
+	void ExtensionTable::Grow()
+	{
+		std::vector<uint32_t> slots(m_Slots.size() * 2, 0);
+		m_Slots.swap(slots);
+		for (uint32_t id = 0; id < Size(); id++)
+		{
+			StringView extension = (*this)[id];
+			m_Slots[FindSlot(extension, Hash(extension))] = id + 1;
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// EXTENSION INDEX
+
+	ExtensionIndex::ExtensionIndex(bool ignoreCase)
+		: m_Extensions(ignoreCase),
+		m_GroupStarts(2, 0)
+	{}
+
+	std::span<const uint32_t> ExtensionIndex::Group(StringView extension) const
+	{
+		uint32_t id = m_Extensions.Find(extension);
+		if (id == ExtensionTable::InvalidExtension || id + 1 >= m_GroupStarts.size())
+			return (std::span<const uint32_t>());
+		return (Group(id));
+	}
+
+	void ExtensionIndex::Build(size_t count, const std::function<const IPath&(size_t)>& pathAt)
+	{
+		assert(count <= UINT32_MAX && "Too many paths for 32 bits indices");
+
+		m_Extensions.Clear();
+		m_PathExtensions.resize(count);
+		// Most paths of a collection share a few extensions, remember the last one to skip the hash
+		uint32_t lastId = ExtensionTable::NoExtension;
+		StringView lastExtension;
+		for (size_t index = 0; index < count; index++)
+		{
+			StringView extension = pathAt(index).Extension();
+			if (extension != lastExtension)
+			{
+				lastId = m_Extensions.Intern(extension);
+				lastExtension = extension;
+			}
+			m_PathExtensions[index] = lastId;
+		}
+
+		// Counting sort of the path indices by extension id, stable so every group keeps the order of the collection
+		m_GroupStarts.assign(m_Extensions.Size() + 1, 0);
+		for (uint32_t id : m_PathExtensions)
+			m_GroupStarts[id + 1]++;
+		for (size_t id = 1; id < m_GroupStarts.size(); id++)
+			m_GroupStarts[id] += m_GroupStarts[id - 1];
+
+		m_Members.resize(count);
+		std::vector<uint32_t> positions(m_GroupStarts.begin(), m_GroupStarts.end() - 1);
+		for (size_t index = 0; index < count; index++)
+			m_Members[positions[m_PathExtensions[index]]++] = static_cast<uint32_t>(index);
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Path.h"
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace PathCore
+{
+	/**
+	 * The distinct extensions of a path collection, each with a small id.
+	 *
+	 * The id 0 is always the empty extension (no extension), the others are given in the order the extensions are first seen.
+	 * The characters of every extension are stored back to back in one buffer.
+	 */
+	class ExtensionTable
+	{
+	public:
+		static constexpr uint32_t NoExtension = 0;
+		static constexpr uint32_t InvalidExtension = UINT32_MAX;
+
+	public:
+		/**
+		 * @param ignoreCase ".PNG" and ".png" get the same id, 'A' to 'Z' are folded (the other letters are not)
+		 */
+		explicit ExtensionTable(bool ignoreCase = true);
+
+	public:
+		/* The id of extension (with its dot, eg: ".png"), added when it is not in the table yet */
+		uint32_t Intern(StringView extension);
+		/* The id of extension, InvalidExtension when it is not in the table */
+		uint32_t Find(StringView extension) const;
+
+		/* The extension as it was first interned */
+		StringView operator[](uint32_t id) const { return (StringView(m_Characters.data() + m_Offsets[id], m_Offsets[id + 1] - m_Offsets[id])); }
+		size_t Size() const { return (m_Offsets.size() - 1); }
+		void Clear();
+
+	private:
+		/* Hash of the folded characters */
+		uint64_t Hash(StringView extension) const;
+		bool IsSame(uint32_t id, StringView extension) const;
+		/* The slot of extension, or the empty slot where it would go */
+		size_t FindSlot(StringView extension, uint64_t hash) const;
+		void Grow();
+
+	private:
+		bool m_IgnoreCase;
+		std::vector<TCHAR> m_Characters;
+		/* Where every extension starts in m_Characters, plus where the last one ends */
+		std::vector<uint32_t> m_Offsets;
+		/* Open addressing table of id + 1, 0 is an empty slot. Its size is a power of 2, kept at most half full */
+		std::vector<uint32_t> m_Slots;
+	};
+
+	/**
+	 * A path collection grouped by extension, for the stages that only want some file types.
+	 *
+	 * Build() reads the extension of every path (stored by StaticPath, no scan), interns it,
+	 * then places the path indices in one array where the paths of an extension are next to each other (counting sort).
+	 *
+	 * @example ExtensionIndex index; index.Build(paths); for (uint32_t path : index.Group(TEXT(".cpp"))) Compile(paths[path]);
+	 */
+	class ExtensionIndex
+	{
+	public:
+		explicit ExtensionIndex(bool ignoreCase = true);
+
+	public:
+		/* Group paths by extension, replacing what the index held */
+		template<typename PathType>
+		void Build(const std::vector<PathType>& paths)
+		{
+			Build(paths.size(), [&paths](size_t index) -> const IPath& { return (paths[index]); });
+		}
+
+		const ExtensionTable& Extensions() const { return (m_Extensions); }
+		size_t PathCount() const { return (m_PathExtensions.size()); }
+
+		/* The extension id of the path at pathIndex */
+		uint32_t ExtensionOf(size_t pathIndex) const { return (m_PathExtensions[pathIndex]); }
+
+		/* The indices of the paths with the extension id, in the order of the collection */
+		std::span<const uint32_t> Group(uint32_t id) const
+		{
+			return (std::span<const uint32_t>(m_Members.data() + m_GroupStarts[id], m_GroupStarts[id + 1] - m_GroupStarts[id]));
+		}
+		/* The indices of the paths with extension (with its dot, "" for the paths without extension), empty when there is none */
+		std::span<const uint32_t> Group(StringView extension) const;
+
+	private:
+		void Build(size_t count, const std::function<const IPath&(size_t)>& pathAt);
+
+	private:
+		ExtensionTable m_Extensions;
+		std::vector<uint32_t> m_PathExtensions;
+		/* Where the indices of every extension start in m_Members, plus where the last group ends */
+		std::vector<uint32_t> m_GroupStarts;
+		std::vector<uint32_t> m_Members;
+	};
+}
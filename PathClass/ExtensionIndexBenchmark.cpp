@@ -0,0 +1,68 @@
+#include "Benchmarks.h"
+#include "ExtensionIndex.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace PathCore;
+
+namespace
+{
+	using String = std::basic_string<TCHAR>;
+
+	/* What the stages did before: find the extension by hand, and group on a copy of it */
+	std::map<String, std::vector<size_t>> GroupByScanning(const std::vector<StaticPath>& paths)
+	{
+		std::map<String, std::vector<size_t>> groups;
+		for (size_t index = 0; index < paths.size(); index++)
+		{
+			const StaticPath& path = paths[index];
+			size_t dot = path.Size();
+			for (size_t position = path.Size(); position > 0 && IsSeparator(path[position - 1]) == false; position--)
+			{
+				if (path[position - 1] == TEXT('.'))
+				{
+					dot = position - 1;
+					break;
+				}
+			}
+			String extension(path.Data() + dot, path.Size() - dot);
+			for (TCHAR& character : extension)
+				character = (character >= TEXT('A') && character <= TEXT('Z')) ? static_cast<TCHAR>(character - TEXT('A') + TEXT('a')) : character;
+			groups[extension].push_back(index);
+		}
+		return (groups);
+	}
+}
+
+void BenchmarkExtensionIndex()
+{
+	const size_t pathCount = 1000000;
+	// A source tree: most files share a handful of extensions, some have none
+	std::vector<StaticPath> paths = GenerateNumberedPaths(pathCount, TEXT("C:/Projects/VideoReferences/Source"), TEXT("Module_"), TEXT("File_"),
+		{ TEXT(".cpp"), TEXT(".h"), TEXT(".CPP"), TEXT(".png"), TEXT(".json"), TEXT(".obj"), TEXT(""), TEXT(".tar.gz") });
+	std::vector<PathView> views(paths.begin(), paths.end());
+
+	std::map<String, std::vector<size_t>> scanned;
+	double scanSeconds = MeasureSeconds([&]() { scanned = GroupByScanning(paths); });
+	int scanAllocations = CountAllocations([&]() { GroupByScanning(paths); });
+
+	ExtensionIndex index;
+	double indexSeconds = MeasureSeconds([&]() { index.Build(paths); });
+	int indexAllocations = CountAllocations([&]() { ExtensionIndex other; other.Build(paths); });
+
+	// A PathView stores no offsets, its extension is found by scanning the file name
+	ExtensionIndex viewIndex;
+	double viewIndexSeconds = MeasureSeconds([&]() { viewIndex.Build(views); });
+
+	bool sameGroups = scanned.size() == index.Extensions().Size();
+	for (uint32_t id = 0; sameGroups && id < index.Extensions().Size(); id++)
+		sameGroups = index.Group(id).size() == viewIndex.Group(id).size();
+	sameGroups = sameGroups && index.Group(TEXT(".cpp")).size() == scanned[TEXT(".cpp")].size();
+
+	std::cout << "ExtensionIndex: " << pathCount << " paths, " << index.Extensions().Size() << " extensions" << (sameGroups ? "" : " (MISMATCH)") << std::endl;
+	std::cout << "\tScan + std::map of copied extensions: " << scanSeconds * 1e3 << " ms (" << scanAllocations << " allocations)" << std::endl;
+	std::cout << "\tExtensionIndex of StaticPath:        " << indexSeconds * 1e3 << " ms (" << indexAllocations << " allocations)" << std::endl;
+	std::cout << "\tExtensionIndex of PathView:          " << viewIndexSeconds * 1e3 << " ms" << std::endl;
+}
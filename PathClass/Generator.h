@@ -0,0 +1,128 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace PathCore
+{
+	/**
+	 * A lazy sequence produced by a coroutine, consumed with a range based for loop.
+	 *
+	 * The coroutine runs until its next co_yield each time the iterator is incremented,
+	 * so a consumer that stops early never pays for the values it didn't ask for.
+	 * Yielded values are not copied: the generator keeps a pointer to them,
+	 * they stay valid until the iterator is incremented (a yielded reference may point inside the coroutine).
+	 *
+	 * \tparam T The yielded type, usually a const reference (eg: Generator<const IPath&>)
+	 */
+	template<typename T>
+	class Generator
+	{
+	public:
+		using ValueType = std::remove_reference_t<T>;
+
+		struct promise_type
+		{
+			ValueType* Value = nullptr;
+			std::exception_ptr Exception;
+
+			Generator get_return_object() { return (Generator(std::coroutine_handle<promise_type>::from_promise(*this))); }
+			std::suspend_always initial_suspend() noexcept { return {}; }
+			std::suspend_always final_suspend() noexcept { return {}; }
+			std::suspend_always yield_value(ValueType& value) noexcept
+			{
+				Value = std::addressof(value);
+				return {};
+			}
+			void return_void() {}
+			void unhandled_exception() { Exception = std::current_exception(); }
+
+			/* Only references to values are yielded, co_await has no meaning here */
+			template<typename U>
+			std::suspend_never await_transform(U&&) = delete;
+		};
+
+		class Iterator
+		{
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using difference_type = std::ptrdiff_t;
+			using value_type = std::remove_cv_t<ValueType>;
+
+		public:
+			Iterator() = default;
+			explicit Iterator(std::coroutine_handle<promise_type> coroutine)
+				: m_Coroutine(coroutine)
+			{}
+
+		public:
+			ValueType& operator*() const { return (*m_Coroutine.promise().Value); }
+			ValueType* operator->() const { return (m_Coroutine.promise().Value); }
+
+			Iterator& operator++()
+			{
+				Resume(m_Coroutine);
+				return (*this);
+			}
+			void operator++(int) { ++*this; }
+
+			bool operator==(std::default_sentinel_t) const { return (m_Coroutine == nullptr || m_Coroutine.done()); }
+
+		private:
+			std::coroutine_handle<promise_type> m_Coroutine;
+		};
+
+	public:
+		Generator() = default;
+		~Generator()
+		{
+			if (m_Coroutine)
+				m_Coroutine.destroy();
+		}
+
+		Generator(const Generator&) = delete;
+		Generator& operator=(const Generator&) = delete;
+		Generator(Generator&& other) noexcept
+			: m_Coroutine(std::exchange(other.m_Coroutine, nullptr))
+		{}
+		Generator& operator=(Generator&& other) noexcept
+		{
+			if (this != &other)
+			{
+				if (m_Coroutine)
+					m_Coroutine.destroy();
+				m_Coroutine = std::exchange(other.m_Coroutine, nullptr);
+			}
+			return (*this);
+		}
+
+	public:
+		/* Run the coroutine up to its first value, can only be called once */
+		Iterator begin()
+		{
+			if (m_Coroutine)
+				Resume(m_Coroutine);
+			return (Iterator(m_Coroutine));
+		}
+		std::default_sentinel_t end() const { return {}; }
+
+	private:
+		explicit Generator(std::coroutine_handle<promise_type> coroutine)
+			: m_Coroutine(coroutine)
+		{}
+
+		static void Resume(std::coroutine_handle<promise_type> coroutine)
+		{
+			coroutine.resume();
+			if (coroutine.done() && coroutine.promise().Exception)
+				std::rethrow_exception(coroutine.promise().Exception);
+		}
+
+	private:
+		std::coroutine_handle<promise_type> m_Coroutine = nullptr;
+	};
+}
@@ -0,0 +1,531 @@
+#include "GlobRuleSet.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace PathCore
+{
+	namespace
+	{
+		constexpr uint32_t InvalidIndex = std::numeric_limits<uint32_t>::max();
+
+		bool IsGlobSegment(GlobRuleSet::StringView segment)
+		{
+			for (TCHAR character : segment)
+			{
+				if (character == TEXT('*') || character == TEXT('?') || character == TEXT('['))
+					return (true);
+			}
+			return (false);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// GLOB RULE SET
+	///////////////////////////////////////////////////////////////////////////
+
+	bool GlobRuleSet::AddRule(const TCHAR* pattern)
+	{
+		StringView text(pattern);
+
+		// Trim trailing white spaces and line breaks
+		while (text.empty() == false && (text.back() == TEXT(' ') || text.back() == TEXT('\r') || text.back() == TEXT('\n')))
+			text.remove_suffix(1);
+		if (text.empty() || text.front() == TEXT('#'))
+			return (false);
+
+		Rule rule;
+		rule.Negated = text.front() == TEXT('!');
+		if (rule.Negated)
+			text.remove_prefix(1);
+
+		rule.DirectoryOnly = text.empty() == false && IsSeparator(text.back());
+		while (text.empty() == false && IsSeparator(text.back()))
+			text.remove_suffix(1);
+
+		bool anchored = text.empty() == false && IsSeparator(text.front());
+		while (text.empty() == false && IsSeparator(text.front()))
+			text.remove_prefix(1);
+
+		// Split the pattern into segments
+		std::vector<StringView> segments;
+		size_t segmentStart = 0;
+		for (size_t index = 0; index <= text.size(); index++)
+		{
+			if (index == text.size() || IsSeparator(text[index]))
+			{
+				if (index > segmentStart)
+					segments.push_back(text.substr(segmentStart, index - segmentStart));
+				segmentStart = index + 1;
+			}
+		}
+		if (segments.empty())
+			return (false);
+
+		// Like gitignore, a separator in the middle of the pattern anchors it too
+		if (segments.size() > 1)
+			anchored = true;
+		if (anchored == false)
+			rule.Elements.push_back({ ElementType::DoubleStar, 0 });
+
+		for (StringView segment : segments)
+		{
+			if (segment == StringView(TEXT("**")))
+			{
+				if (rule.Elements.empty() || rule.Elements.back().Type != ElementType::DoubleStar)
+					rule.Elements.push_back({ ElementType::DoubleStar, 0 });
+				continue;
+			}
+
+			Element element;
+			element.Index = AddSegmentPattern(segment, element.Type);
+			if (element.Index == InvalidIndex)
+				return (false); // Malformed glob
+			rule.Elements.push_back(element);
+		}
+
+		// A trailing "**" matches everything inside, but not the directory itself: "foo/**" is "foo/*/**"
+		if (rule.Elements.size() > 1 && rule.Elements.back().Type == ElementType::DoubleStar)
+		{
+			Element anySegment;
+			anySegment.Index = AddSegmentPattern(TEXT("*"), anySegment.Type);
+			rule.Elements.insert(rule.Elements.end() - 1, anySegment);
+		}
+
+		m_Rules.push_back(std::move(rule));
+		m_Compiled = false;
+		return (true);
+	}
+
+	void GlobRuleSet::Compile()
+	{
+		m_States.clear();
+		m_RootStates.clear();
+		m_PersistentLiteralTargets.assign(m_LiteralStorage.size(), std::vector<uint32_t>());
+		m_PersistentGlobs.clear();
+		m_PersistentFileRule = -1;
+		m_PersistentDirectoryRule = -1;
+
+		// One state per element, plus one accepting state per rule. The states of a rule are contiguous,
+		// so a state consuming a segment always moves to the next state
+		std::vector<uint32_t> firstStates;
+		firstStates.reserve(m_Rules.size());
+		for (uint32_t ruleIndex = 0; ruleIndex < m_Rules.size(); ruleIndex++)
+		{
+			firstStates.push_back(static_cast<uint32_t>(m_States.size()));
+			for (const Element& element : m_Rules[ruleIndex].Elements)
+				m_States.push_back({ element, ruleIndex });
+			m_States.push_back({ { ElementType::Accept, 0 }, ruleIndex });
+		}
+
+		std::vector<uint8_t> rootMarks(m_States.size(), 0);
+		std::vector<uint32_t> rootStates;
+		for (uint32_t firstState : firstStates)
+			AddWithClosure(firstState, rootStates, rootMarks);
+
+		// The "**" active at the root loop on themselves, so they (and what they reach for free) are active at every depth
+		m_IsPersistent.assign(m_States.size(), 0);
+		std::vector<uint32_t> persistentStates;
+		for (uint32_t state : rootStates)
+		{
+			if (m_States[state].SegmentPattern.Type == ElementType::DoubleStar)
+				AddWithClosure(state, persistentStates, m_IsPersistent);
+		}
+
+		for (uint32_t state : rootStates)
+		{
+			if (m_IsPersistent[state] == false)
+				m_RootStates.push_back(state);
+		}
+
+		// Precompute the transitions of the persistent states, grouped by segment pattern
+		std::unordered_map<uint32_t, size_t> persistentGlobIndices;
+		for (uint32_t state : persistentStates)
+		{
+			const State& persistentState = m_States[state];
+			switch (persistentState.SegmentPattern.Type)
+			{
+			case ElementType::Literal:
+				m_PersistentLiteralTargets[persistentState.SegmentPattern.Index].push_back(state + 1);
+				break;
+			case ElementType::Glob:
+			{
+				auto found = persistentGlobIndices.find(persistentState.SegmentPattern.Index);
+				if (found == persistentGlobIndices.end())
+				{
+					found = persistentGlobIndices.emplace(persistentState.SegmentPattern.Index, m_PersistentGlobs.size()).first;
+					m_PersistentGlobs.push_back({ persistentState.SegmentPattern.Index, {} });
+				}
+				m_PersistentGlobs[found->second].Targets.push_back(state + 1);
+				break;
+			}
+			case ElementType::Accept:
+			{
+				int32_t ruleIndex = static_cast<int32_t>(persistentState.Rule);
+				m_PersistentDirectoryRule = std::max(m_PersistentDirectoryRule, ruleIndex);
+				if (m_Rules[ruleIndex].DirectoryOnly == false)
+					m_PersistentFileRule = std::max(m_PersistentFileRule, ruleIndex);
+				break;
+			}
+			case ElementType::DoubleStar:
+				break; // Loops on itself
+			}
+		}
+
+		m_Compiled = true;
+	}
+
+	uint32_t GlobRuleSet::AddSegmentPattern(StringView segment, ElementType& type)
+	{
+		if (IsGlobSegment(segment))
+		{
+			type = ElementType::Glob;
+
+			String key(segment);
+			auto found = m_GlobIndices.find(key);
+			if (found != m_GlobIndices.end())
+				return (found->second);
+
+			Glob glob;
+			if (ParseGlob(segment, glob) == false)
+				return (InvalidIndex);
+
+			uint32_t globIndex = static_cast<uint32_t>(m_Globs.size());
+			m_Globs.push_back(std::move(glob));
+			m_GlobIndices.emplace(std::move(key), globIndex);
+			return (globIndex);
+		}
+
+		type = ElementType::Literal;
+
+		auto found = m_Literals.find(segment);
+		if (found != m_Literals.end())
+			return (found->second);
+
+		uint32_t literalIndex = static_cast<uint32_t>(m_LiteralStorage.size());
+		m_LiteralStorage.emplace_back(segment);
+		m_Literals.emplace(StringView(m_LiteralStorage.back()), literalIndex);
+		return (literalIndex);
+	}
+
+	bool GlobRuleSet::ParseGlob(StringView segment, Glob& glob)
+	{
+		for (size_t index = 0; index < segment.size(); index++)
+		{
+			TCHAR character = segment[index];
+			if (character == TEXT('*'))
+			{
+				// Consecutive stars behave like one
+				if (glob.Tokens.empty() || glob.Tokens.back().Type != GlobTokenType::Star)
+					glob.Tokens.push_back({ GlobTokenType::Star, 0, 0 });
+			}
+			else if (character == TEXT('?'))
+				glob.Tokens.push_back({ GlobTokenType::AnyCharacter, 0, 0 });
+			else if (character == TEXT('['))
+			{
+				CharacterClass characterClass;
+				index++;
+				characterClass.Negated = index < segment.size() && (segment[index] == TEXT('!') || segment[index] == TEXT('^'));
+				if (characterClass.Negated)
+					index++;
+
+				// A ']' right after the opening bracket is a regular character
+				size_t classStart = index;
+				while (index < segment.size() && (segment[index] != TEXT(']') || index == classStart))
+				{
+					TCHAR first = segment[index];
+					TCHAR last = first;
+					if (index + 2 < segment.size() && segment[index + 1] == TEXT('-') && segment[index + 2] != TEXT(']'))
+					{
+						last = segment[index + 2];
+						index += 2;
+					}
+					if (last < first)
+						return (false);
+					characterClass.Ranges.emplace_back(first, last);
+					index++;
+				}
+				if (index >= segment.size())
+					return (false); // Missing ']'
+
+				glob.Tokens.push_back({ GlobTokenType::Class, 0, static_cast<uint32_t>(m_Classes.size()) });
+				m_Classes.push_back(std::move(characterClass));
+			}
+			else
+				glob.Tokens.push_back({ GlobTokenType::Character, character, 0 });
+		}
+
+		for (const GlobToken& token : glob.Tokens)
+			glob.MinSize += (token.Type != GlobTokenType::Star);
+		for (size_t index = glob.Tokens.size(); index > 0 && glob.Tokens[index - 1].Type == GlobTokenType::Character; index--)
+			glob.Suffix.insert(glob.Suffix.begin(), glob.Tokens[index - 1].Character);
+		return (true);
+	}
+
+	bool GlobRuleSet::MatchClass(uint32_t classIndex, TCHAR character) const
+	{
+		const CharacterClass& characterClass = m_Classes[classIndex];
+		for (const std::pair<TCHAR, TCHAR>& range : characterClass.Ranges)
+		{
+			if (character >= range.first && character <= range.second)
+				return (characterClass.Negated == false);
+		}
+		return (characterClass.Negated);
+	}
+
+	bool GlobRuleSet::MatchGlob(uint32_t globIndex, const TCHAR* segment, SegmentSize size) const
+	{
+		const Glob& glob = m_Globs[globIndex];
+		if (size < glob.MinSize || StringView(segment, size).substr(size - glob.Suffix.size()) != glob.Suffix)
+			return (false); // Most globs are "*.ext" like, this rejects them without backtracking
+
+		const std::vector<GlobToken>& tokens = glob.Tokens;
+
+		// Classic wildcard matching, only the last star needs to be backtracked to
+		size_t tokenIndex = 0;
+		size_t charIndex = 0;
+		size_t starTokenIndex = InvalidIndex;
+		size_t starCharIndex = 0;
+		while (charIndex < size)
+		{
+			if (tokenIndex < tokens.size())
+			{
+				const GlobToken& token = tokens[tokenIndex];
+				if (token.Type == GlobTokenType::Star)
+				{
+					starTokenIndex = tokenIndex++;
+					starCharIndex = charIndex;
+					continue;
+				}
+
+				bool matched = (token.Type == GlobTokenType::AnyCharacter)
+					|| (token.Type == GlobTokenType::Character && token.Character == segment[charIndex])
+					|| (token.Type == GlobTokenType::Class && MatchClass(token.ClassIndex, segment[charIndex]));
+				if (matched)
+				{
+					tokenIndex++;
+					charIndex++;
+					continue;
+				}
+			}
+
+			if (starTokenIndex == InvalidIndex)
+				return (false);
+
+			// Let the last star eat one more character
+			tokenIndex = starTokenIndex + 1;
+			charIndex = ++starCharIndex;
+		}
+
+		while (tokenIndex < tokens.size() && tokens[tokenIndex].Type == GlobTokenType::Star)
+			tokenIndex++;
+		return (tokenIndex == tokens.size());
+	}
+
+	void GlobRuleSet::AddWithClosure(uint32_t state, std::vector<uint32_t>& states, std::vector<uint8_t>& marks) const
+	{
+		while (marks[state] == false)
+		{
+			marks[state] = true;
+			states.push_back(state);
+
+			// "**" can match zero segments, so the next state is reached without consuming anything
+			if (m_States[state].SegmentPattern.Type != ElementType::DoubleStar)
+				break;
+			state++;
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// GLOB MATCHER
+	///////////////////////////////////////////////////////////////////////////
+
+	GlobMatcher::GlobMatcher(const GlobRuleSet& ruleSet)
+		: m_RuleSet(ruleSet),
+		m_LevelCount(1),
+		m_StateMarks(ruleSet.m_States.size(), 0),
+		m_GlobStamps(ruleSet.m_Globs.size(), 0),
+		m_GlobResults(ruleSet.m_Globs.size(), 0),
+		m_Stamp(0)
+	{
+		assert(ruleSet.IsCompiled() && "The rule set must be compiled before being matched");
+
+		Level root;
+		root.End = std::numeric_limits<PathSize>::max();
+		root.States = ruleSet.m_RootStates;
+		root.ExcludedByParent = false;
+		root.ExcludedDirectory = false; // The root itself is never excluded
+		SetDecisions(root);
+		m_Levels.push_back(std::move(root));
+	}
+
+	GlobRuleResult GlobMatcher::Match(const IPath& path, bool isDirectory)
+	{
+		const TCHAR* data = path.Data();
+		PathSize size = path.Size();
+
+		// Everything in common with the previous path doesn't need to be matched again
+		PathSize commonSize = 0;
+		PathSize maxCommonSize = static_cast<PathSize>(std::min<size_t>(size, m_PreviousPath.size()));
+		while (commonSize < maxCommonSize && data[commonSize] == m_PreviousPath[commonSize])
+			commonSize++;
+
+		// The first level is the root anchor, empty for a relative path: its first segment is matched like the others
+		ConstSegmentIterator segment = path.BeginSegment();
+		PathSize anchorLength = RootAnchorLength(path);
+		PathSize diskEnd = anchorLength > 0 ? anchorLength - PATH_SEPARATOR_LENGTH : 0;
+		bool reuse = (m_Levels[0].End == diskEnd && diskEnd <= commonSize);
+		m_Levels[0].End = diskEnd;
+		if (anchorLength > 0)
+			++segment;
+
+		size_t depth = 1;
+		for (; segment; ++segment, depth++)
+		{
+			SegmentSize segmentSize = segment.Size();
+			PathSize segmentEnd = segment.Pos() + segmentSize;
+
+			// Same parent directories as the previous path, reuse their state
+			if (reuse && depth < m_LevelCount && m_Levels[depth].End == segmentEnd && segmentEnd <= commonSize)
+				continue;
+			reuse = false;
+
+			if (depth == m_Levels.size())
+				m_Levels.emplace_back();
+			Step(m_Levels[depth - 1], m_Levels[depth], *segment, segmentSize);
+			m_Levels[depth].End = segmentEnd;
+		}
+		m_LevelCount = depth;
+		m_PreviousPath.assign(data, data + size);
+
+		if (depth == 1)
+			return (GlobRuleResult::NoMatch); // Only the disk
+
+		const Level& last = m_Levels[depth - 1];
+		if (last.ExcludedByParent)
+			return (GlobRuleResult::Excluded);
+
+		int32_t ruleIndex = isDirectory ? last.DirectoryRule : last.FileRule;
+		if (ruleIndex < 0)
+			return (GlobRuleResult::NoMatch);
+		return (m_RuleSet.m_Rules[ruleIndex].Negated ? GlobRuleResult::Included : GlobRuleResult::Excluded);
+	}
+
+	void GlobMatcher::Reset()
+	{
+		m_LevelCount = 1;
+		m_Levels[0].End = std::numeric_limits<PathSize>::max();
+		m_PreviousPath.clear();
+	}
+
+	void GlobMatcher::Step(const Level& parent, Level& level, const TCHAR* segment, SegmentSize size)
+	{
+		using ElementType = GlobRuleSet::ElementType;
+
+		level.States.clear();
+		level.ExcludedByParent = parent.ExcludedDirectory;
+		if (level.ExcludedByParent)
+		{
+			// Nothing can be included back, don't even run the automaton
+			level.FileRule = -1;
+			level.DirectoryRule = -1;
+			level.ExcludedDirectory = true;
+			return;
+		}
+
+		// New stamp, so every glob is evaluated at most once for this segment
+		if (++m_Stamp == 0)
+		{
+			std::fill(m_GlobStamps.begin(), m_GlobStamps.end(), 0);
+			m_Stamp = 1;
+		}
+
+		auto literal = m_RuleSet.m_Literals.find(GlobRuleSet::StringView(segment, size));
+		uint32_t literalIndex = (literal != m_RuleSet.m_Literals.end()) ? literal->second : InvalidIndex;
+
+		// Transitions of the states active at every depth
+		if (literalIndex != InvalidIndex)
+		{
+			for (uint32_t target : m_RuleSet.m_PersistentLiteralTargets[literalIndex])
+				AddState(target, level);
+		}
+		for (const GlobRuleSet::PersistentGlob& persistentGlob : m_RuleSet.m_PersistentGlobs)
+		{
+			if (MatchGlob(persistentGlob.Glob, segment, size))
+			{
+				for (uint32_t target : persistentGlob.Targets)
+					AddState(target, level);
+			}
+		}
+
+		// Transitions of the states specific to this directory
+		for (uint32_t state : parent.States)
+		{
+			const GlobRuleSet::Element& element = m_RuleSet.m_States[state].SegmentPattern;
+			switch (element.Type)
+			{
+			case ElementType::DoubleStar:
+				AddState(state, level);
+				break;
+			case ElementType::Literal:
+				if (element.Index == literalIndex)
+					AddState(state + 1, level);
+				break;
+			case ElementType::Glob:
+				if (MatchGlob(element.Index, segment, size))
+					AddState(state + 1, level);
+				break;
+			case ElementType::Accept:
+				break;
+			}
+		}
+
+		for (uint32_t state : level.States)
+			m_StateMarks[state] = false;
+
+		SetDecisions(level);
+		level.ExcludedDirectory = level.DirectoryRule >= 0 && m_RuleSet.m_Rules[level.DirectoryRule].Negated == false;
+	}
+
+	void GlobMatcher::AddState(uint32_t state, Level& level)
+	{
+		// The persistent states are implicitly active, they are never stored
+		while (m_RuleSet.m_IsPersistent[state] == false && m_StateMarks[state] == false)
+		{
+			m_StateMarks[state] = true;
+			level.States.push_back(state);
+
+			if (m_RuleSet.m_States[state].SegmentPattern.Type != GlobRuleSet::ElementType::DoubleStar)
+				break;
+			state++;
+		}
+	}
+
+	bool GlobMatcher::MatchGlob(uint32_t globIndex, const TCHAR* segment, SegmentSize size)
+	{
+		if (m_GlobStamps[globIndex] != m_Stamp)
+		{
+			m_GlobStamps[globIndex] = m_Stamp;
+			m_GlobResults[globIndex] = m_RuleSet.MatchGlob(globIndex, segment, size);
+		}
+		return (m_GlobResults[globIndex]);
+	}
+
+	void GlobMatcher::SetDecisions(Level& level) const
+	{
+		level.FileRule = m_RuleSet.m_PersistentFileRule;
+		level.DirectoryRule = m_RuleSet.m_PersistentDirectoryRule;
+
+		for (uint32_t state : level.States)
+		{
+			const GlobRuleSet::State& acceptState = m_RuleSet.m_States[state];
+			if (acceptState.SegmentPattern.Type != GlobRuleSet::ElementType::Accept)
+				continue;
+
+			int32_t ruleIndex = static_cast<int32_t>(acceptState.Rule);
+			level.DirectoryRule = std::max(level.DirectoryRule, ruleIndex);
+			if (m_RuleSet.m_Rules[ruleIndex].DirectoryOnly == false)
+				level.FileRule = std::max(level.FileRule, ruleIndex);
+		}
+	}
+}
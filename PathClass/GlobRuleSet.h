@@ -0,0 +1,214 @@
+#pragma once
+
+#include "Path.h"
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace PathCore
+{
+	enum class GlobRuleResult : uint8_t
+	{
+		NoMatch,	// No rule matched the path
+		Excluded,	// The last matching rule is a regular rule (or a parent directory is excluded)
+		Included	// The last matching rule is a negated ('!') rule
+	};
+
+	/**
+	 * A set of gitignore style rules compiled into one segment level automaton.
+	 *
+	 * Supported syntax (one rule per AddRule call):
+	 * - '*' any run of characters in a segment, '?' any character, "[a-z]" / "[!a-z]" character classes
+	 * - "**" as a whole segment matches any amount of segments
+	 * - A leading '!' negates the rule, a trailing separator only matches directories
+	 * - A rule with a leading or middle separator is anchored to the root, otherwise it matches at any depth
+	 * - Empty rules and rules starting with '#' are ignored
+	 * Like gitignore the last matching rule wins, and nothing can be included back below an excluded directory.
+	 * Both '/' and '\\' are separators, so there is no escaping.
+	 *
+	 * Every rule is compiled to a chain of states (one per segment pattern) in a single NFA.
+	 * The states kept alive by a leading "**" are active at every depth, their transitions are precomputed
+	 * (literal segments are found with one hash lookup, identical globs are evaluated once per segment).
+	 *
+	 * The rule set is immutable once compiled, use one GlobMatcher per thread to evaluate it.
+	 */
+	class GlobRuleSet
+	{
+	public:
+		using String = std::basic_string<TCHAR>;
+		using StringView = std::basic_string_view<TCHAR>;
+
+	public:
+		/**
+		 * @brief Parse and add a rule, rules added later have priority
+		 * @return false if the rule is ignored (empty, comment) or malformed
+		 */
+		bool AddRule(const TCHAR* pattern);
+		void Compile();
+
+	public:
+		bool IsCompiled() const { return (m_Compiled); }
+		size_t RuleCount() const { return (m_Rules.size()); }
+		size_t StateCount() const { return (m_States.size()); }
+
+	private:
+		enum class ElementType : uint8_t
+		{
+			DoubleStar,
+			Literal,
+			Glob,
+			Accept
+		};
+
+		enum class GlobTokenType : uint8_t
+		{
+			Character,
+			AnyCharacter,
+			Star,
+			Class
+		};
+
+		struct GlobToken
+		{
+			GlobTokenType Type;
+			TCHAR Character;
+			uint32_t ClassIndex;
+		};
+
+		struct CharacterClass
+		{
+			std::vector<std::pair<TCHAR, TCHAR>> Ranges;
+			bool Negated;
+		};
+
+		struct Glob
+		{
+			std::vector<GlobToken> Tokens;
+			/* Cheap rejection before the real match: the smallest segment that can match, and its literal ending */
+			size_t MinSize = 0;
+			String Suffix;
+		};
+
+		struct Element
+		{
+			ElementType Type;
+			/* Index in m_Literals or m_Globs, depending on the type */
+			uint32_t Index;
+		};
+
+		struct Rule
+		{
+			std::vector<Element> Elements;
+			bool Negated;
+			bool DirectoryOnly;
+		};
+
+		struct State
+		{
+			Element SegmentPattern;
+			uint32_t Rule;
+		};
+
+		/* A precomputed transition of the persistent states */
+		struct PersistentGlob
+		{
+			uint32_t Glob;
+			std::vector<uint32_t> Targets;
+		};
+
+	private:
+		uint32_t AddSegmentPattern(StringView segment, ElementType& type);
+		bool ParseGlob(StringView segment, Glob& glob);
+		bool MatchGlob(uint32_t globIndex, const TCHAR* segment, SegmentSize size) const;
+		bool MatchClass(uint32_t classIndex, TCHAR character) const;
+
+		/* Add state and the states reachable through "**" without consuming a segment */
+		void AddWithClosure(uint32_t state, std::vector<uint32_t>& states, std::vector<uint8_t>& marks) const;
+
+	private:
+		std::vector<Rule> m_Rules;
+
+		/* A deque so the views in m_Literals stay valid */
+		std::deque<String> m_LiteralStorage;
+		std::unordered_map<StringView, uint32_t> m_Literals;
+		std::vector<Glob> m_Globs;
+		std::unordered_map<String, uint32_t> m_GlobIndices;
+		std::vector<CharacterClass> m_Classes;
+
+		// Compiled automaton
+		std::vector<State> m_States;
+		/* States active at the root before the first segment, excluding the persistent ones */
+		std::vector<uint32_t> m_RootStates;
+		/* Marks the states that are active at every depth (leading "**" of unanchored rules) */
+		std::vector<uint8_t> m_IsPersistent;
+		/* For each literal, the states reached when a persistent state consumes it */
+		std::vector<std::vector<uint32_t>> m_PersistentLiteralTargets;
+		std::vector<PersistentGlob> m_PersistentGlobs;
+		/* Highest rule accepted by a persistent state (-1 if none), for files and for directories */
+		int32_t m_PersistentFileRule = -1;
+		int32_t m_PersistentDirectoryRule = -1;
+		bool m_Compiled = false;
+
+		friend class GlobMatcher;
+	};
+
+	/**
+	 * Evaluate a compiled GlobRuleSet against paths.
+	 *
+	 * The automaton state of every directory of the previous path is kept,
+	 * so sibling files only pay for their last segment (feed paths in sorted order to get the most out of it).
+	 * Not thread safe, use one matcher per thread.
+	 */
+	class GlobMatcher
+	{
+	public:
+		explicit GlobMatcher(const GlobRuleSet& ruleSet);
+
+	public:
+		/**
+		 * @brief Match the path, the first segment (the disk) is the root the rules are anchored to
+		 * @param isDirectory Whether the last segment is a directory (rules with a trailing separator only match directories)
+		 */
+		GlobRuleResult Match(const IPath& path, bool isDirectory = false);
+
+		/* Forget the memoized directories */
+		void Reset();
+
+	private:
+		struct Level
+		{
+			/* Position of the end of this level's segment in m_PreviousPath */
+			PathSize End;
+			std::vector<uint32_t> States;
+			int32_t FileRule;
+			int32_t DirectoryRule;
+			/* A parent directory is excluded, so this level is excluded whatever the rules say */
+			bool ExcludedByParent;
+			/* This directory, or one of its parent, is excluded so everything under it is */
+			bool ExcludedDirectory;
+		};
+
+	private:
+		void Step(const Level& parent, Level& level, const TCHAR* segment, SegmentSize size);
+		void AddState(uint32_t state, Level& level);
+		bool MatchGlob(uint32_t globIndex, const TCHAR* segment, SegmentSize size);
+		void SetDecisions(Level& level) const;
+
+	private:
+		const GlobRuleSet& m_RuleSet;
+
+		std::vector<Level> m_Levels;
+		/* Amount of valid levels (the root level is always valid) */
+		size_t m_LevelCount;
+		std::vector<TCHAR> m_PreviousPath;
+
+		// Scratch buffers reused between steps to avoid allocations
+		std::vector<uint8_t> m_StateMarks;
+		std::vector<uint32_t> m_GlobStamps;
+		std::vector<uint8_t> m_GlobResults;
+		uint32_t m_Stamp;
+	};
+}
@@ -0,0 +1,222 @@
+#include "Benchmarks.h"
+#include "GlobRuleSet.h"
+
+#include <string>
+#include <string_view>
+
+using namespace PathCore;
+
+namespace
+{
+	using String = std::basic_string<TCHAR>;
+	using StringView = std::basic_string_view<TCHAR>;
+
+	/**
+	 * The straightforward way: every rule is matched on its own, segment by segment,
+	 * against the path and against every parent directory of the path.
+	 */
+	class NaiveRule
+	{
+	public:
+		NaiveRule(StringView pattern)
+		{
+			m_Negated = pattern.front() == TEXT('!');
+			if (m_Negated)
+				pattern.remove_prefix(1);
+			m_DirectoryOnly = IsSeparator(pattern.back());
+			if (m_DirectoryOnly)
+				pattern.remove_suffix(1);
+			bool anchored = IsSeparator(pattern.front());
+			if (anchored)
+				pattern.remove_prefix(1);
+
+			size_t start = 0;
+			for (size_t index = 0; index <= pattern.size(); index++)
+			{
+				if (index == pattern.size() || IsSeparator(pattern[index]))
+				{
+					m_Segments.emplace_back(pattern.substr(start, index - start));
+					start = index + 1;
+				}
+			}
+			if (m_Segments.size() == 1 && anchored == false)
+				m_Segments.insert(m_Segments.begin(), String(TEXT("**")));
+			if (m_Segments.size() > 1 && m_Segments.back() == TEXT("**"))
+				m_Segments.insert(m_Segments.end() - 1, String(TEXT("*")));
+		}
+
+		bool Match(const std::vector<StringView>& segments, size_t segmentCount) const
+		{
+			return (MatchFrom(0, segments, 0, segmentCount));
+		}
+
+	private:
+		bool MatchFrom(size_t ruleIndex, const std::vector<StringView>& segments, size_t segmentIndex, size_t segmentCount) const
+		{
+			if (ruleIndex == m_Segments.size())
+				return (segmentIndex == segmentCount);
+			if (m_Segments[ruleIndex] == TEXT("**"))
+			{
+				for (size_t next = segmentIndex; next <= segmentCount; next++)
+				{
+					if (MatchFrom(ruleIndex + 1, segments, next, segmentCount))
+						return (true);
+				}
+				return (false);
+			}
+			if (segmentIndex == segmentCount || Wildcard(m_Segments[ruleIndex].c_str(), segments[segmentIndex]) == false)
+				return (false);
+			return (MatchFrom(ruleIndex + 1, segments, segmentIndex + 1, segmentCount));
+		}
+
+		static bool Wildcard(const TCHAR* pattern, StringView text)
+		{
+			if (*pattern == NULL)
+				return (text.empty());
+			if (*pattern == TEXT('*'))
+			{
+				for (size_t skip = 0; skip <= text.size(); skip++)
+				{
+					if (Wildcard(pattern + 1, text.substr(skip)))
+						return (true);
+				}
+				return (false);
+			}
+			if (text.empty())
+				return (false);
+			if (*pattern == TEXT('['))
+			{
+				const TCHAR* cursor = pattern + 1;
+				bool negated = (*cursor == TEXT('!'));
+				if (negated)
+					cursor++;
+				bool found = false;
+				for (; *cursor != TEXT(']'); cursor++)
+				{
+					if (cursor[1] == TEXT('-') && cursor[2] != TEXT(']'))
+					{
+						found |= (text[0] >= cursor[0] && text[0] <= cursor[2]);
+						cursor += 2;
+					}
+					else
+						found |= (text[0] == *cursor);
+				}
+				return (found != negated && Wildcard(cursor + 1, text.substr(1)));
+			}
+			if (*pattern != TEXT('?') && *pattern != text[0])
+				return (false);
+			return (Wildcard(pattern + 1, text.substr(1)));
+		}
+
+	public:
+		std::vector<String> m_Segments;
+		bool m_Negated;
+		bool m_DirectoryOnly;
+	};
+
+	GlobRuleResult NaiveMatch(const std::vector<NaiveRule>& rules, const IPath& path, std::vector<StringView>& segments)
+	{
+		segments.clear();
+		ConstSegmentIterator segment = path.BeginSegment();
+		if (RootAnchorLength(path) > 0)
+			++segment;
+		for (; segment; ++segment)
+			segments.emplace_back(*segment, segment.Size());
+
+		for (size_t depth = 1; depth <= segments.size(); depth++)
+		{
+			bool isLast = (depth == segments.size());
+			const NaiveRule* lastMatch = nullptr;
+			for (const NaiveRule& rule : rules)
+			{
+				if ((isLast == false || rule.m_DirectoryOnly == false) && rule.Match(segments, depth))
+					lastMatch = &rule;
+			}
+
+			if (isLast)
+				return (lastMatch ? (lastMatch->m_Negated ? GlobRuleResult::Included : GlobRuleResult::Excluded) : GlobRuleResult::NoMatch);
+			if (lastMatch && lastMatch->m_Negated == false)
+				return (GlobRuleResult::Excluded); // A parent directory is excluded
+		}
+		return (GlobRuleResult::NoMatch);
+	}
+
+	String ToString(int value)
+	{
+		std::string narrow = std::to_string(value);
+		return (String(narrow.begin(), narrow.end()));
+	}
+}
+
+void BenchmarkGlobRuleSet()
+{
+	// Rules in the spirit of a big monorepo ignore file
+	std::vector<String> patterns;
+	for (int index = 0; index < 100; index++)
+		patterns.push_back(TEXT("*.ext") + ToString(index));
+	for (int index = 0; index < 80; index++)
+		patterns.push_back(TEXT("name") + ToString(index));
+	for (int index = 0; index < 60; index++)
+		patterns.push_back(TEXT("/proj") + ToString(index) + TEXT("/build") + ToString(index % 7) + TEXT("/"));
+	for (int index = 0; index < 30; index++)
+		patterns.push_back(TEXT("**/tmp") + ToString(index) + TEXT("/**"));
+	for (int index = 0; index < 20; index++)
+		patterns.push_back(TEXT("[a-f]*cache") + ToString(index) + TEXT(".t?p"));
+	for (int index = 0; index < 10; index++)
+		patterns.push_back(TEXT("!keep") + ToString(index) + TEXT(".ext3"));
+
+	GlobRuleSet ruleSet;
+	std::vector<NaiveRule> naiveRules;
+	for (const String& pattern : patterns)
+	{
+		ruleSet.AddRule(pattern.c_str());
+		naiveRules.emplace_back(pattern);
+	}
+	ruleSet.Compile();
+
+	// Sorted like a directory walk would produce them, below the root anchor of the platform ("C:/" or "/")
+	const TCHAR* disk = PATH_DISK_NAME_LENGTH > 0 ? TEXT("C:") : TEXT("");
+	std::vector<StaticPath> paths;
+	for (int project = 0; project < 40; project++)
+	{
+		for (int directory = 0; directory < 10; directory++)
+		{
+			String parent = disk + (TEXT("/proj") + ToString(project)) + TEXT("/build") + ToString(directory)
+				+ TEXT("/src/tmp") + ToString(directory * 7) + TEXT("/module");
+			for (int file = 0; file < 250; file++)
+			{
+				String name = (file % 50 == 0) ? TEXT("keep") + ToString(file % 11) : TEXT("file") + ToString(file);
+				if (file % 13 == 0)
+					name = TEXT("acache") + ToString(file % 23) + TEXT(".tmp");
+				name += TEXT(".ext") + ToString(file % 150);
+				paths.emplace_back(Path((parent + TEXT("/") + name).c_str()));
+			}
+		}
+	}
+
+	size_t naiveExcluded = 0;
+	std::vector<StringView> segments;
+	double naiveSeconds = MeasureSeconds([&]()
+	{
+		for (const StaticPath& path : paths)
+			naiveExcluded += (NaiveMatch(naiveRules, path, segments) == GlobRuleResult::Excluded);
+	});
+
+	size_t compiledExcluded = 0;
+	GlobMatcher matcher(ruleSet);
+	double compiledSeconds = MeasureSeconds([&]()
+	{
+		for (const StaticPath& path : paths)
+			compiledExcluded += (matcher.Match(path) == GlobRuleResult::Excluded);
+	});
+
+	size_t mismatches = 0;
+	matcher.Reset();
+	for (const StaticPath& path : paths)
+		mismatches += (matcher.Match(path) != NaiveMatch(naiveRules, path, segments));
+
+	std::cout << "GlobRuleSet: " << ruleSet.RuleCount() << " rules (" << ruleSet.StateCount() << " states), " << paths.size() << " paths" << std::endl;
+	std::cout << "\tNaive per rule: " << naiveSeconds * 1e9 / paths.size() << " ns/path (" << naiveExcluded << " excluded)" << std::endl;
+	std::cout << "\tCompiled:       " << compiledSeconds * 1e9 / paths.size() << " ns/path (" << compiledExcluded << " excluded)" << std::endl;
+	std::cout << "\tMismatches:     " << mismatches << std::endl;
+}
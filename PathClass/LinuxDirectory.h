@@ -0,0 +1,104 @@
+#pragma once
+
+#include "DirectoryWalker.h"
+#include "PathEncoding.h"
+
+#ifdef PLATFORM_LINUX
+
+#include <cstring>
+#include <type_traits>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//  Helpers shared by the getdents64 based directory readers
+///////////////////////////////////////////////////////////////////////////////
+
+namespace PathCore
+{
+	/* The record written by getdents64, the libc doesn't declare it */
+	struct LinuxDirent64
+	{
+		uint64_t Inode;
+		int64_t Offset;
+		unsigned short RecordLength;
+		unsigned char Type;
+		char Name[1];
+	};
+
+	/**
+	 * @brief Fill buffer with the next records of the directory
+	 * @return The amount of bytes written, 0 at the end of the directory, -1 on error
+	 */
+	inline long ReadDirectoryEntries(int fd, char* buffer, size_t size)
+	{
+		return (syscall(SYS_getdents64, fd, buffer, size));
+	}
+
+	inline bool IsDotOrDotDot(const char* name)
+	{
+		return (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')));
+	}
+
+	inline WalkEntryType ToEntryType(mode_t mode)
+	{
+		if (S_ISREG(mode))
+			return (WalkEntryType::File);
+		if (S_ISDIR(mode))
+			return (WalkEntryType::Directory);
+		if (S_ISLNK(mode))
+			return (WalkEntryType::Symlink);
+		return (WalkEntryType::Other);
+	}
+
+	/**
+	 * @brief The type of a record, asked to the file system when it doesn't fill it
+	 * @return false if the entry is gone
+	 */
+	inline bool ReadEntryType(int directoryFd, const LinuxDirent64& record, WalkEntryType& outType)
+	{
+		switch (record.Type)
+		{
+		case DT_REG: outType = WalkEntryType::File; return (true);
+		case DT_DIR: outType = WalkEntryType::Directory; return (true);
+		case DT_LNK: outType = WalkEntryType::Symlink; return (true);
+		case DT_UNKNOWN: break;
+		default: outType = WalkEntryType::Other; return (true);
+		}
+
+		struct stat status;
+		if (fstatat(directoryFd, record.Name, &status, AT_SYMLINK_NOFOLLOW) != 0)
+			return (false);
+		outType = ToEntryType(status.st_mode);
+		return (true);
+	}
+
+	/**
+	 * @brief Decode a UTF-8 entry name to out, and check it can be a segment of a path
+	 * @param out Must hold PATH_MAX_FOLDER_NAME_LENGTH + NULL_TERMINATOR_LENGTH characters
+	 * @return false if the name must be skipped
+	 */
+	inline bool DecodeEntryName(const char* name, TCHAR* out, SegmentSize& outSize)
+	{
+		size_t size;
+		if (DecodeUtf8(name, std::strlen(name), out, PATH_MAX_FOLDER_NAME_LENGTH, size) == false)
+			return (false);
+
+		// The characters to refuse are all ASCII, and the units of a multi byte character never are
+		for (size_t index = 0; index < size; index++)
+		{
+			auto character = static_cast<std::make_unsigned_t<TCHAR>>(out[index]);
+			if (character <= 0x7F && (IsSeparator(out[index]) || IsAValidFolderNameChar(out[index]) == false))
+				return (false);
+		}
+		out[size] = NULL;
+		outSize = static_cast<SegmentSize>(size);
+		return (true);
+	}
+}
+
+#endif
@@ -0,0 +1,125 @@
+#include "MappedFile.h"
+
+#ifdef PLATFORM_WINDOWS
+# define WIN32_LEAN_AND_MEAN
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+namespace PathCore
+{
+#ifdef PLATFORM_WINDOWS
+
+	MappedFile::MappedFile(const char* fileName)
+	{
+		HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return;
+		m_FileHandle = file;
+
+		LARGE_INTEGER fileSize;
+		if (GetFileSizeEx(file, &fileSize) == FALSE || fileSize.QuadPart == 0)
+		{
+			Close();
+			return; // Empty files cannot be mapped
+		}
+
+		m_MappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_MappingHandle == nullptr)
+		{
+			Close();
+			return;
+		}
+
+		m_Data = static_cast<const char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+		if (m_Data == nullptr)
+		{
+			Close();
+			return;
+		}
+		m_Size = static_cast<size_t>(fileSize.QuadPart);
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_Data)
+			UnmapViewOfFile(m_Data);
+		if (m_MappingHandle)
+			CloseHandle(m_MappingHandle);
+		if (m_FileHandle)
+			CloseHandle(m_FileHandle);
+
+		m_Data = nullptr;
+		m_Size = 0;
+		m_MappingHandle = nullptr;
+		m_FileHandle = nullptr;
+	}
+
+#else
+
+	MappedFile::MappedFile(const char* fileName)
+	{
+		int fd = open(fileName, O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			return;
+
+		struct stat fileStat;
+		if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+		{
+			close(fd);
+			return; // Empty files cannot be mapped
+		}
+
+		void* data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd); // The mapping keeps its own reference on the file
+		if (data == MAP_FAILED)
+			return;
+
+		// We always read the whole file front to back (advice values are not flags, one call each)
+		madvise(data, static_cast<size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+		madvise(data, static_cast<size_t>(fileStat.st_size), MADV_WILLNEED);
+
+		m_Data = static_cast<const char*>(data);
+		m_Size = static_cast<size_t>(fileStat.st_size);
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_Data)
+			munmap(const_cast<char*>(m_Data), m_Size);
+
+		m_Data = nullptr;
+		m_Size = 0;
+	}
+
+#endif
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this == &other)
+			return (*this);
+
+		Close();
+		std::swap(m_Data, other.m_Data);
+		std::swap(m_Size, other.m_Size);
+#ifdef PLATFORM_WINDOWS
+		std::swap(m_FileHandle, other.m_FileHandle);
+		std::swap(m_MappingHandle, other.m_MappingHandle);
+#endif
+		return (*this);
+	}
+}
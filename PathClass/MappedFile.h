@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Path.h"
+
+namespace PathCore
+{
+	/**
+	 * A read only memory mapping of a whole file.
+	 *
+	 * The mapping is released when the object is destroyed.
+	 * An empty file, or a file that could not be opened, gives an invalid mapping (check with IsValid()).
+	 */
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		explicit MappedFile(const char* fileName);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+	public:
+		operator bool() const { return (IsValid()); }
+
+	public:
+		bool IsValid() const { return (m_Data != nullptr); }
+		const char* Data() const { return (m_Data); }
+		size_t Size() const { return (m_Size); }
+
+		void Close();
+
+	private:
+		const char* m_Data = nullptr;
+		size_t m_Size = 0;
+#ifdef PLATFORM_WINDOWS
+		void* m_FileHandle = nullptr;
+		void* m_MappingHandle = nullptr;
+#endif
+	};
+}
@@ -0,0 +1,387 @@
+#include "MetadataCache.h"
+
+#ifdef PLATFORM_LINUX
+
+#include "LinuxDirectory.h"
+#include "PathEncoding.h"
+#include "PathHash.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace PathCore
+{
+	namespace
+	{
+		constexpr unsigned int StatxMask = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME;
+		/* Submission queue size, bigger batches are submitted in several rounds */
+		constexpr unsigned int RingEntries = 256;
+
+		PathMetadata ToMetadata(const struct statx& status)
+		{
+			PathMetadata metadata;
+			metadata.Type = ToEntryType(status.stx_mode);
+			metadata.Size = status.stx_size;
+			metadata.ModificationTime = static_cast<int64_t>(status.stx_mtime.tv_sec) * 1000000000 + status.stx_mtime.tv_nsec;
+			return (metadata);
+		}
+
+		PathMetadata ToMetadataError(int error)
+		{
+			PathMetadata metadata;
+			metadata.Error = error;
+			return (metadata);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// IO_URING RING
+	///////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * The bare minimum of io_uring to submit statx operations, without liburing.
+	 * Used by one batch at a time.
+	 */
+	class MetadataCache::Ring
+	{
+	public:
+		~Ring()
+		{
+			if (m_SubmissionEntries != MAP_FAILED)
+				munmap(m_SubmissionEntries, m_SubmissionEntriesSize);
+			if (m_CompletionRing != MAP_FAILED && m_CompletionRing != m_SubmissionRing)
+				munmap(m_CompletionRing, m_CompletionRingSize);
+			if (m_SubmissionRing != MAP_FAILED)
+				munmap(m_SubmissionRing, m_SubmissionRingSize);
+			if (m_Fd >= 0)
+				close(m_Fd);
+		}
+
+		/* @return nullptr if io_uring, or its statx operation, is not available */
+		static std::unique_ptr<Ring> Create(int rootFd)
+		{
+			std::unique_ptr<Ring> ring(new Ring());
+			if (ring->Setup() == false)
+				return (nullptr);
+
+			// Kernels before 5.6 know io_uring but not statx: they answer EINVAL
+			struct statx status;
+			const char* names[] = { "." };
+			int results[1];
+			uint64_t syscalls = 0;
+			ring->Statx(rootFd, names, 1, 0, &status, results, syscalls);
+			if (results[0] != 0)
+				return (nullptr);
+			return (ring);
+		}
+
+		/**
+		 * @brief statx every name relative to directoryFd
+		 * @param outResults 0 or a negated errno per name
+		 * @param syscalls Incremented for every io_uring_enter
+		 */
+		void Statx(int directoryFd, const char* const* names, size_t count, int flags, struct statx* outStatus, int* outResults, uint64_t& syscalls)
+		{
+			size_t submitted = 0;
+			while (submitted < count)
+			{
+				unsigned int round = static_cast<unsigned int>(std::min<size_t>(count - submitted, m_EntryCount));
+
+				unsigned int tail = *m_SubmissionTail;
+				for (unsigned int index = 0; index < round; index++)
+				{
+					size_t request = submitted + index;
+					unsigned int slot = (tail + index) & *m_SubmissionMask;
+
+					io_uring_sqe& entry = m_Entries[slot];
+					std::memset(&entry, 0, sizeof(entry));
+					entry.opcode = IORING_OP_STATX;
+					entry.fd = directoryFd;
+					entry.addr = reinterpret_cast<uint64_t>(names[request]);
+					entry.len = StatxMask;
+					entry.statx_flags = flags;
+					entry.off = reinterpret_cast<uint64_t>(&outStatus[request]);
+					entry.user_data = request;
+					m_SubmissionArray[slot] = slot;
+				}
+				__atomic_store_n(m_SubmissionTail, tail + round, __ATOMIC_RELEASE);
+
+				// Submit the whole round and wait for all of it in one call
+				unsigned int completed = 0;
+				while (completed < round)
+				{
+					unsigned int toSubmit = (completed == 0) ? round : 0;
+					int entered = static_cast<int>(syscall(__NR_io_uring_enter, m_Fd, toSubmit, round - completed, IORING_ENTER_GETEVENTS, nullptr, 0));
+					syscalls++;
+					if (entered < 0 && errno != EINTR)
+					{
+						for (size_t request = submitted; request < submitted + round; request++)
+							outResults[request] = -errno;
+						return; // The ring is broken, nothing more can be done with it
+					}
+
+					unsigned int head = *m_CompletionHead;
+					unsigned int completionTail = __atomic_load_n(m_CompletionTail, __ATOMIC_ACQUIRE);
+					for (; head != completionTail; head++)
+					{
+						const io_uring_cqe& completion = m_Completions[head & *m_CompletionMask];
+						outResults[completion.user_data] = completion.res;
+						completed++;
+					}
+					__atomic_store_n(m_CompletionHead, head, __ATOMIC_RELEASE);
+				}
+				submitted += round;
+			}
+		}
+
+	private:
+		Ring() = default;
+
+		bool Setup()
+		{
+			io_uring_params parameters;
+			std::memset(&parameters, 0, sizeof(parameters));
+			m_Fd = static_cast<int>(syscall(__NR_io_uring_setup, RingEntries, &parameters));
+			if (m_Fd < 0)
+				return (false);
+			m_EntryCount = parameters.sq_entries;
+
+			m_SubmissionRingSize = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned int);
+			m_CompletionRingSize = parameters.cq_off.cqes + parameters.cq_entries * sizeof(io_uring_cqe);
+			bool singleMapping = (parameters.features & IORING_FEAT_SINGLE_MMAP) != 0;
+			if (singleMapping)
+				m_SubmissionRingSize = m_CompletionRingSize = std::max(m_SubmissionRingSize, m_CompletionRingSize);
+
+			m_SubmissionRing = mmap(nullptr, m_SubmissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Fd, IORING_OFF_SQ_RING);
+			if (m_SubmissionRing == MAP_FAILED)
+				return (false);
+			m_CompletionRing = singleMapping ? m_SubmissionRing
+				: mmap(nullptr, m_CompletionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Fd, IORING_OFF_CQ_RING);
+			if (m_CompletionRing == MAP_FAILED)
+				return (false);
+			m_SubmissionEntriesSize = parameters.sq_entries * sizeof(io_uring_sqe);
+			m_SubmissionEntries = mmap(nullptr, m_SubmissionEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Fd, IORING_OFF_SQES);
+			if (m_SubmissionEntries == MAP_FAILED)
+				return (false);
+
+			char* submission = static_cast<char*>(m_SubmissionRing);
+			m_SubmissionTail = reinterpret_cast<unsigned int*>(submission + parameters.sq_off.tail);
+			m_SubmissionMask = reinterpret_cast<unsigned int*>(submission + parameters.sq_off.ring_mask);
+			m_SubmissionArray = reinterpret_cast<unsigned int*>(submission + parameters.sq_off.array);
+			m_Entries = static_cast<io_uring_sqe*>(m_SubmissionEntries);
+
+			char* completion = static_cast<char*>(m_CompletionRing);
+			m_CompletionHead = reinterpret_cast<unsigned int*>(completion + parameters.cq_off.head);
+			m_CompletionTail = reinterpret_cast<unsigned int*>(completion + parameters.cq_off.tail);
+			m_CompletionMask = reinterpret_cast<unsigned int*>(completion + parameters.cq_off.ring_mask);
+			m_Completions = reinterpret_cast<io_uring_cqe*>(completion + parameters.cq_off.cqes);
+			return (true);
+		}
+
+	private:
+		int m_Fd = -1;
+		unsigned int m_EntryCount = 0;
+
+		void* m_SubmissionRing = MAP_FAILED;
+		size_t m_SubmissionRingSize = 0;
+		void* m_CompletionRing = MAP_FAILED;
+		size_t m_CompletionRingSize = 0;
+		void* m_SubmissionEntries = MAP_FAILED;
+		size_t m_SubmissionEntriesSize = 0;
+
+		unsigned int* m_SubmissionTail = nullptr;
+		unsigned int* m_SubmissionMask = nullptr;
+		unsigned int* m_SubmissionArray = nullptr;
+		io_uring_sqe* m_Entries = nullptr;
+
+		unsigned int* m_CompletionHead = nullptr;
+		unsigned int* m_CompletionTail = nullptr;
+		unsigned int* m_CompletionMask = nullptr;
+		io_uring_cqe* m_Completions = nullptr;
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// METADATA CACHE
+	///////////////////////////////////////////////////////////////////////////
+
+	MetadataCache::MetadataCache(const MetadataCacheOptions& options)
+		: m_Options(options),
+		m_Cache(options.Capacity),
+		m_RootFd(open(options.RootDirectory, O_PATH | O_DIRECTORY | O_CLOEXEC)),
+		m_Requests(0),
+		m_Hits(0),
+		m_Expired(0),
+		m_Deduplicated(0),
+		m_Statx(0),
+		m_Syscalls(0)
+	{
+		if (m_Options.Backend != MetadataBackend::ThreadPool && m_RootFd >= 0)
+			m_Ring = Ring::Create(m_RootFd);
+		if (m_Ring == nullptr && m_Options.Pool == nullptr)
+		{
+			m_OwnedPool = std::make_unique<ThreadPool>();
+			m_Options.Pool = m_OwnedPool.get();
+		}
+	}
+
+	MetadataCache::~MetadataCache()
+	{
+		if (m_RootFd >= 0)
+			close(m_RootFd);
+	}
+
+	void MetadataCache::Query(const IPath* const* paths, size_t count, PathMetadata* outMetadata)
+	{
+		m_Requests.fetch_add(count, std::memory_order_relaxed);
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+		// Answer what can be answered from the cache
+		std::vector<size_t> misses;
+		uint64_t hits = 0;
+		uint64_t expired = 0;
+		for (size_t index = 0; index < count; index++)
+		{
+			CachedMetadata cached;
+			if (m_Cache.Find(*paths[index], cached))
+			{
+				if (cached.Expiry > now)
+				{
+					outMetadata[index] = cached.Metadata;
+					hits++;
+					continue;
+				}
+				expired++;
+			}
+			misses.push_back(index);
+		}
+		m_Hits.fetch_add(hits, std::memory_order_relaxed);
+		m_Expired.fetch_add(expired, std::memory_order_relaxed);
+		if (misses.empty())
+			return;
+
+		// Deduplicate the misses: sort them by hash, equal paths end up next to each other
+		std::vector<std::pair<uint64_t, size_t>> hashed;
+		hashed.reserve(misses.size());
+		for (size_t index : misses)
+			hashed.emplace_back(HashPath(*paths[index]), index);
+		std::sort(hashed.begin(), hashed.end());
+
+		std::vector<size_t> unique;
+		std::vector<std::pair<size_t, size_t>> duplicates; // (duplicate, unique it copies)
+		for (size_t groupStart = 0; groupStart < hashed.size(); )
+		{
+			size_t groupEnd = groupStart + 1;
+			while (groupEnd < hashed.size() && hashed[groupEnd].first == hashed[groupStart].first)
+				groupEnd++;
+
+			// Almost always a single path, unless it was asked several times (or on a hash collision)
+			size_t groupUnique = unique.size();
+			for (size_t position = groupStart; position < groupEnd; position++)
+			{
+				size_t index = hashed[position].second;
+				size_t candidate = groupUnique;
+				while (candidate < unique.size() && ArePathsEqual(*paths[unique[candidate]], *paths[index]) == false)
+					candidate++;
+
+				if (candidate < unique.size())
+					duplicates.emplace_back(index, unique[candidate]);
+				else
+					unique.push_back(index);
+			}
+			groupStart = groupEnd;
+		}
+		m_Deduplicated.fetch_add(duplicates.size(), std::memory_order_relaxed);
+
+		// Names relative to the root directory, in one buffer
+		std::vector<char> nameBuffer;
+		std::vector<size_t> nameOffsets;
+		for (size_t index : unique)
+		{
+			const IPath& path = *paths[index];
+			PathSize nameStart = RootAnchorLength(path);
+			size_t offset = nameBuffer.size();
+			nameOffsets.push_back(offset);
+			if (nameStart >= path.Size())
+			{
+				nameBuffer.push_back('.'); // The root anchor itself
+				nameBuffer.push_back('\0');
+				continue;
+			}
+			nameBuffer.resize(offset + MaxUtf8Size(path.Size() - nameStart) + NULL_TERMINATOR_LENGTH);
+			size_t written = EncodePosixPath(path.Data() + nameStart, path.Size() - nameStart, nameBuffer.data() + offset);
+			nameBuffer.resize(offset + written + NULL_TERMINATOR_LENGTH);
+		}
+		std::vector<const char*> names;
+		names.reserve(unique.size());
+		for (size_t offset : nameOffsets)
+			names.push_back(nameBuffer.data() + offset);
+
+		std::vector<PathMetadata> results(unique.size());
+		if (m_Ring)
+			StatWithRing(names, results);
+		else
+			StatWithPool(names, results);
+		m_Statx.fetch_add(unique.size(), std::memory_order_relaxed);
+
+		std::chrono::steady_clock::time_point expiry = std::chrono::steady_clock::now() + m_Options.TimeToLive;
+		for (size_t position = 0; position < unique.size(); position++)
+		{
+			outMetadata[unique[position]] = results[position];
+			m_Cache.Insert(*paths[unique[position]], CachedMetadata{ results[position], expiry });
+		}
+		for (const std::pair<size_t, size_t>& duplicate : duplicates)
+			outMetadata[duplicate.first] = outMetadata[duplicate.second];
+	}
+
+	MetadataCacheStats MetadataCache::Stats() const
+	{
+		MetadataCacheStats stats;
+		stats.Requests = m_Requests.load(std::memory_order_relaxed);
+		stats.Hits = m_Hits.load(std::memory_order_relaxed);
+		stats.Expired = m_Expired.load(std::memory_order_relaxed);
+		stats.Deduplicated = m_Deduplicated.load(std::memory_order_relaxed);
+		stats.Statx = m_Statx.load(std::memory_order_relaxed);
+		stats.Syscalls = m_Syscalls.load(std::memory_order_relaxed);
+		return (stats);
+	}
+
+	void MetadataCache::StatWithPool(const std::vector<const char*>& names, std::vector<PathMetadata>& outMetadata)
+	{
+		int flags = m_Options.FollowSymlinks ? 0 : AT_SYMLINK_NOFOLLOW;
+		m_Options.Pool->ParallelFor(names.size(), [&](size_t index)
+		{
+			struct statx status;
+			if (statx(m_RootFd, names[index], flags, StatxMask, &status) == 0)
+				outMetadata[index] = ToMetadata(status);
+			else
+				outMetadata[index] = ToMetadataError(errno);
+		});
+		m_Syscalls.fetch_add(names.size(), std::memory_order_relaxed);
+	}
+
+	void MetadataCache::StatWithRing(const std::vector<const char*>& names, std::vector<PathMetadata>& outMetadata)
+	{
+		std::vector<struct statx> status(names.size());
+		std::vector<int> results(names.size());
+		uint64_t syscalls = 0;
+		{
+			std::lock_guard<std::mutex> lock(m_RingMutex);
+			m_Ring->Statx(m_RootFd, names.data(), names.size(), m_Options.FollowSymlinks ? 0 : AT_SYMLINK_NOFOLLOW, status.data(), results.data(), syscalls);
+		}
+		m_Syscalls.fetch_add(syscalls, std::memory_order_relaxed);
+
+		for (size_t index = 0; index < names.size(); index++)
+			outMetadata[index] = (results[index] == 0) ? ToMetadata(status[index]) : ToMetadataError(-results[index]);
+	}
+}
+
+#endif
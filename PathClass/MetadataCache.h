@@ -0,0 +1,144 @@
+#pragma once
+
+#include "DirectoryWalker.h"
+#include "PathLRU.h"
+
+#ifdef PLATFORM_LINUX
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+namespace PathCore
+{
+	class ThreadPool;
+
+	struct PathMetadata
+	{
+		/* 0, or the errno of statx (eg: ENOENT), missing paths are cached too */
+		int Error = 0;
+		WalkEntryType Type = WalkEntryType::Other;
+		uint64_t Size = 0;
+		/* Nanoseconds since the epoch */
+		int64_t ModificationTime = 0;
+
+		bool Exists() const { return (Error == 0); }
+	};
+
+	enum class MetadataBackend : uint8_t
+	{
+		Auto,		// io_uring when the kernel supports it, otherwise the pool
+		ThreadPool,	// One blocking statx per path, spread on the pool
+		IoUring		// Every statx of a batch submitted to one ring, falls back to the pool if unavailable
+	};
+
+	struct MetadataCacheOptions
+	{
+		/* The directory the root anchor of the paths (the empty segment of "/usr", relative paths have none) maps to */
+		const char* RootDirectory = "/";
+		/* How long a result is trusted */
+		std::chrono::steady_clock::duration TimeToLive = std::chrono::seconds(1);
+		size_t Capacity = 1 << 20;
+		/* Used by the ThreadPool backend, when null a pool is created with the cache */
+		ThreadPool* Pool = nullptr;
+		MetadataBackend Backend = MetadataBackend::Auto;
+		/* Report the target of symbolic links instead of the links */
+		bool FollowSymlinks = false;
+	};
+
+	struct MetadataCacheStats
+	{
+		/* Paths asked, duplicates included */
+		uint64_t Requests = 0;
+		uint64_t Hits = 0;
+		/* Misses because the cached result was older than the time to live */
+		uint64_t Expired = 0;
+		/* Misses that were already asked earlier in the same batch */
+		uint64_t Deduplicated = 0;
+		/* statx operations done, one per unique missed path */
+		uint64_t Statx = 0;
+		/* System calls made to get them: one per statx with the pool, one per ring submission with io_uring */
+		uint64_t Syscalls = 0;
+
+		double HitRate() const { return (Requests ? static_cast<double>(Hits) / Requests : 0.0); }
+	};
+
+	/**
+	 * Size, modification time and type of paths, asked by batches and cached for a while.
+	 *
+	 * A batch is first answered from the cache, the misses are deduplicated,
+	 * then every remaining statx is issued at once: submitted to an io_uring ring (one system call for many paths)
+	 * or spread on a pool, so the latencies overlap instead of adding up.
+	 *
+	 * The results are cached in a PathLRU keyed by StaticPath, both separators are the same path.
+	 * Thread safe, the batches using the ring are serialized.
+	 */
+	class MetadataCache
+	{
+	public:
+		explicit MetadataCache(const MetadataCacheOptions& options = MetadataCacheOptions());
+		~MetadataCache();
+
+		MetadataCache(const MetadataCache&) = delete;
+		MetadataCache& operator=(const MetadataCache&) = delete;
+
+	public:
+		/**
+		 * @brief Fill outMetadata[index] for every paths[index]
+		 * @note The same path may appear several times, it is only asked once
+		 */
+		void Query(const IPath* const* paths, size_t count, PathMetadata* outMetadata);
+		void Query(const std::vector<const IPath*>& paths, std::vector<PathMetadata>& outMetadata)
+		{
+			outMetadata.resize(paths.size());
+			Query(paths.data(), paths.size(), outMetadata.data());
+		}
+		PathMetadata Query(const IPath& path)
+		{
+			const IPath* paths[] = { &path };
+			PathMetadata metadata;
+			Query(paths, 1, &metadata);
+			return (metadata);
+		}
+
+		/* Forget path, the next query asks the file system again */
+		void Invalidate(const IPath& path) { m_Cache.Erase(path); }
+		void Clear() { m_Cache.Clear(); }
+
+	public:
+		bool UsesIoUring() const { return (m_Ring != nullptr); }
+		MetadataCacheStats Stats() const;
+
+	private:
+		struct CachedMetadata
+		{
+			PathMetadata Metadata;
+			std::chrono::steady_clock::time_point Expiry;
+		};
+
+		class Ring;
+
+	private:
+		void StatWithPool(const std::vector<const char*>& names, std::vector<PathMetadata>& outMetadata);
+		void StatWithRing(const std::vector<const char*>& names, std::vector<PathMetadata>& outMetadata);
+
+	private:
+		MetadataCacheOptions m_Options;
+		PathLRU<CachedMetadata> m_Cache;
+		int m_RootFd;
+
+		std::unique_ptr<ThreadPool> m_OwnedPool;
+		std::unique_ptr<Ring> m_Ring;
+		std::mutex m_RingMutex;
+
+		std::atomic<uint64_t> m_Requests;
+		std::atomic<uint64_t> m_Hits;
+		std::atomic<uint64_t> m_Expired;
+		std::atomic<uint64_t> m_Deduplicated;
+		std::atomic<uint64_t> m_Statx;
+		std::atomic<uint64_t> m_Syscalls;
+	};
+}
+
+#endif
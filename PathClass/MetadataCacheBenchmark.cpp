@@ -0,0 +1,111 @@
+#include "Benchmarks.h"
+#include "MetadataCache.h"
+
+#ifdef PLATFORM_LINUX
+
+#include <string>
+
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace PathCore;
+
+namespace
+{
+	int RemoveEntry(const char* path, const struct stat*, int, struct FTW*) { return (remove(path)); }
+}
+
+void BenchmarkMetadataCache()
+{
+	char rootTemplate[] = "/tmp/PathMetadataCache.XXXXXX";
+	if (mkdtemp(rootTemplate) == nullptr)
+	{
+		std::cout << "MetadataCache: could not create a temporary directory" << std::endl;
+		return;
+	}
+	std::string root = rootTemplate;
+
+	const int directoryCount = 64;
+	const int fileCount = 64;
+	std::vector<std::string> absolute;
+	std::vector<StaticPath> paths;
+	for (int directory = 0; directory < directoryCount; directory++)
+	{
+		std::string relative = "/directory_" + std::to_string(directory);
+		mkdir((root + relative).c_str(), 0755);
+		for (int file = 0; file < fileCount; file++)
+		{
+			std::string name = relative + "/file_" + std::to_string(file) + ".bin";
+			int fd = open((root + name).c_str(), O_CREAT | O_WRONLY, 0644);
+			if (fd >= 0)
+				close(fd);
+
+			std::string path = name;
+			absolute.push_back(root + name);
+			paths.emplace_back(Path(std::basic_string<TCHAR>(path.begin(), path.end()).c_str()));
+		}
+	}
+
+	// Every stage of the pipeline asks for every path, some of them twice in the same batch
+	const int stageCount = 4;
+	std::vector<const IPath*> batch;
+	for (const StaticPath& path : paths)
+		batch.push_back(&path);
+	for (size_t index = 0; index < paths.size(); index += 4)
+		batch.push_back(&paths[index]);
+
+	size_t plainSyscalls = 0;
+	double plainSeconds = MeasureSeconds([&]()
+	{
+		struct stat status;
+		for (int stage = 0; stage < stageCount; stage++)
+		{
+			for (const IPath* path : batch)
+			{
+				size_t index = static_cast<const StaticPath*>(path) - paths.data();
+				lstat(absolute[index].c_str(), &status);
+				plainSyscalls++;
+			}
+		}
+	});
+	std::cout << "MetadataCache: " << paths.size() << " files, batches of " << batch.size() << " paths, " << stageCount << " stages" << std::endl;
+	std::cout << "\tlstat per path per stage: " << plainSeconds * 1e3 << " ms, " << plainSyscalls << " syscalls" << std::endl;
+
+	for (MetadataBackend backend : { MetadataBackend::ThreadPool, MetadataBackend::IoUring })
+	{
+		MetadataCacheOptions options;
+		options.RootDirectory = root.c_str();
+		options.Backend = backend;
+		MetadataCache cache(options);
+
+		std::vector<PathMetadata> metadata;
+		size_t missing = 0;
+		double seconds = MeasureSeconds([&]()
+		{
+			for (int stage = 0; stage < stageCount; stage++)
+			{
+				cache.Query(batch, metadata);
+				for (const PathMetadata& entry : metadata)
+					missing += (entry.Exists() == false);
+			}
+		});
+
+		MetadataCacheStats stats = cache.Stats();
+		std::cout << "\t" << (cache.UsesIoUring() ? "io_uring:    " : "Thread pool: ") << seconds * 1e3 << " ms, " << stats.Syscalls << " syscalls, "
+			<< stats.Statx << " statx, " << stats.Deduplicated << " deduplicated, hit rate " << stats.HitRate() * 100 << "% ("
+			<< missing << " missing)" << std::endl;
+	}
+
+	nftw(root.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+#else
+
+void BenchmarkMetadataCache()
+{
+	std::cout << "MetadataCache: not available on this platform" << std::endl;
+}
+
+#endif
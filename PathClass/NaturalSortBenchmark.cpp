@@ -0,0 +1,176 @@
+#include "Benchmarks.h"
+#include "NaturalSortKey.h"
+#include "PathHash.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace PathCore;
+
+namespace
+{
+	void AppendNumber(std::basic_string<TCHAR>& name, uint64_t value)
+	{
+		size_t start = name.size();
+		do
+		{
+			name += static_cast<TCHAR>(TEXT('0') + value % 10);
+			value /= 10;
+		} while (value > 0);
+		std::reverse(name.begin() + start, name.end());
+	}
+
+	/* Shuffled listing of numbered takes, frames and versions, like a video project folder */
+	std::vector<StaticPath> GeneratePaths(size_t count)
+	{
+		std::vector<StaticPath> paths;
+		paths.reserve(count);
+		Path folder(TEXT("C:/Projects/VideoReferences/Footage"));
+		uint64_t random = 0x9E3779B97F4A7C15ull;
+		for (size_t index = 0; index < count; index++)
+		{
+			random ^= random << 13;
+			random ^= random >> 7;
+			random ^= random << 17;
+			std::basic_string<TCHAR> name = (random & 1) ? TEXT("Shot") : TEXT("shot");
+			name += TEXT("_");
+			AppendNumber(name, (random >> 8) % 500);
+			name += TEXT("/Take");
+			name += (random >> 20) % 4 == 0 ? TEXT("0") : TEXT("");
+			AppendNumber(name, (random >> 24) % 40);
+			name += TEXT("_v");
+			name += static_cast<TCHAR>(TEXT('1') + (random >> 32) % 9);
+			name += TEXT(".mov");
+			paths.emplace_back(folder, name.c_str());
+		}
+		return (paths);
+	}
+
+	TCHAR FoldCase(TCHAR character)
+	{
+		return (character >= TEXT('A') && character <= TEXT('Z') ? static_cast<TCHAR>(character - TEXT('A') + TEXT('a')) : character);
+	}
+
+	bool IsDigit(TCHAR character)
+	{
+		return (character >= TEXT('0') && character <= TEXT('9'));
+	}
+
+	/* What a listing did before the keys: parse both paths on every comparison */
+	int CompareNaturalOnTheFly(const IPath& path, const IPath& other)
+	{
+		const TCHAR* data = path.Data();
+		const TCHAR* otherData = other.Data();
+		size_t index = 0;
+		size_t otherIndex = 0;
+		// The first run of digits with other leading zeros, used when everything else is equal
+		int zerosResult = 0;
+		while (index < path.Size() && otherIndex < other.Size())
+		{
+			TCHAR character = data[index];
+			TCHAR otherCharacter = otherData[otherIndex];
+			if (IsSeparator(character) || IsSeparator(otherCharacter))
+			{
+				if (IsSeparator(character) != IsSeparator(otherCharacter))
+					return (IsSeparator(character) ? -1 : 1);
+			}
+			else if (IsDigit(character) && IsDigit(otherCharacter))
+			{
+				size_t zeros = 0, otherZeros = 0;
+				while (index < path.Size() && data[index] == TEXT('0')) { index++; zeros++; }
+				while (otherIndex < other.Size() && otherData[otherIndex] == TEXT('0')) { otherIndex++; otherZeros++; }
+				size_t first = index, otherFirst = otherIndex;
+				while (index < path.Size() && IsDigit(data[index])) index++;
+				while (otherIndex < other.Size() && IsDigit(otherData[otherIndex])) otherIndex++;
+				if (index - first != otherIndex - otherFirst)
+					return (index - first < otherIndex - otherFirst ? -1 : 1);
+				for (size_t digit = 0; digit < index - first; digit++)
+				{
+					if (data[first + digit] != otherData[otherFirst + digit])
+						return (data[first + digit] < otherData[otherFirst + digit] ? -1 : 1);
+				}
+				if (zerosResult == 0 && zeros != otherZeros)
+					zerosResult = zeros < otherZeros ? -1 : 1;
+				continue;
+			}
+			else
+			{
+				// A number sorts where its first digit would
+				TCHAR folded = IsDigit(character) ? TEXT('0') : FoldCase(character);
+				TCHAR otherFolded = IsDigit(otherCharacter) ? TEXT('0') : FoldCase(otherCharacter);
+				if (folded != otherFolded)
+					return (folded < otherFolded ? -1 : 1);
+			}
+			index++;
+			otherIndex++;
+		}
+		if (index < path.Size() || otherIndex < other.Size())
+			return (index < path.Size() ? 1 : -1);
+		return (zerosResult);
+	}
+
+	/* Names whose order is known, given in reverse */
+	bool SortsKnownNames()
+	{
+		const TCHAR* expected[] = { TEXT("/file-1.txt"), TEXT("/file.txt"), TEXT("/file1.txt"), TEXT("/file01.txt"), TEXT("/file2.txt"),
+			TEXT("/file10.txt"), TEXT("/fileA.txt"), TEXT("/take01b"), TEXT("/take1c"), TEXT("/take1c/a") };
+		std::vector<StaticPath> paths;
+		for (size_t index = std::size(expected); index > 0; index--)
+			paths.emplace_back(expected[index - 1]);
+		SortNatural(paths);
+		bool sorted = paths.size() == std::size(expected);
+		for (size_t index = 0; sorted && index < paths.size(); index++)
+			sorted = ArePathsEqual(paths[index], Path(expected[index]));
+		return (sorted);
+	}
+}
+
+void BenchmarkNaturalSort()
+{
+	const size_t pathCount = 1000000;
+	std::vector<StaticPath> paths = GeneratePaths(pathCount);
+
+	std::vector<uint32_t> onTheFlyOrder(paths.size());
+	double onTheFlySeconds = MeasureSeconds([&]()
+	{
+		for (size_t index = 0; index < onTheFlyOrder.size(); index++)
+			onTheFlyOrder[index] = static_cast<uint32_t>(index);
+		std::stable_sort(onTheFlyOrder.begin(), onTheFlyOrder.end(),
+			[&paths](uint32_t index, uint32_t other) { return (CompareNaturalOnTheFly(paths[index], paths[other]) < 0); });
+	});
+
+	NaturalSortKeys keys;
+	double buildSeconds = MeasureSeconds([&]() { keys.Add(paths); });
+	int buildAllocations = CountAllocations([&]() { NaturalSortKeys other; other.Add(paths); });
+
+	std::vector<uint32_t> memcmpOrder(paths.size());
+	double memcmpSeconds = MeasureSeconds([&]()
+	{
+		for (size_t index = 0; index < memcmpOrder.size(); index++)
+			memcmpOrder[index] = static_cast<uint32_t>(index);
+		std::stable_sort(memcmpOrder.begin(), memcmpOrder.end(), [&keys](uint32_t index, uint32_t other) { return (keys.Compare(index, other) < 0); });
+	});
+
+	std::vector<uint32_t> radixOrder;
+	double radixSeconds = MeasureSeconds([&]() { radixOrder = keys.SortedOrder(); });
+
+	ThreadPool pool;
+	NaturalSortKeys parallelKeys;
+	double parallelBuildSeconds = MeasureSeconds([&]() { parallelKeys.Add(paths, &pool); });
+	bool sameKeys = parallelKeys.ByteSize() == keys.ByteSize() && parallelKeys.Size() == keys.Size();
+	for (size_t index = 0; sameKeys && index < keys.Size(); index++)
+		sameKeys = CompareNaturalSortKeys(keys.Key(index), keys.KeySize(index), parallelKeys.Key(index), parallelKeys.KeySize(index)) == 0;
+
+	bool sameOrder = sameKeys && onTheFlyOrder == memcmpOrder && memcmpOrder == radixOrder && SortsKnownNames();
+
+	std::cout << "NaturalSort: " << pathCount << " paths, keys of " << static_cast<double>(keys.ByteSize()) / pathCount << " bytes on average"
+		<< (sameOrder ? "" : " (MISMATCH)") << std::endl;
+	std::cout << "\tstable_sort, natural compare on the fly: " << onTheFlySeconds * 1e3 << " ms" << std::endl;
+	std::cout << "\tKeys built:                              " << buildSeconds * 1e3 << " ms (" << buildAllocations << " allocations), "
+		<< parallelBuildSeconds * 1e3 << " ms on " << pool.ThreadCount() << " threads" << std::endl;
+	std::cout << "\tstable_sort, memcmp of the keys:         " << memcmpSeconds * 1e3 << " ms" << std::endl;
+	std::cout << "\tRadix sort of the keys:                  " << radixSeconds * 1e3 << " ms" << std::endl;
+}
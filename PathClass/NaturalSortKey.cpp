@@ -0,0 +1,347 @@
+#include "NaturalSortKey.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <type_traits>
+
+namespace PathCore
+{
+	namespace
+	{
+		/* Ends the characters, before the leading zero counts */
+		constexpr uint8_t EndByte = 0x00;
+		constexpr uint8_t SeparatorByte = 0x01;
+		/* Added to the ASCII characters, to keep 0x00 and 0x01 for the end and the separators */
+		constexpr uint8_t CharacterShift = 2;
+		/* A number sorts where its first digit would, the digits are never written as characters */
+		constexpr uint8_t NumberByte = '0' + CharacterShift;
+
+		/* Paths given to a parallel key building job */
+		constexpr size_t BatchBlockSize = 16 * 1024;
+		/* Buckets smaller than this are insertion sorted instead of being distributed again */
+		constexpr size_t RadixCutoff = 32;
+
+		bool IsDigit(TCHAR character)
+		{
+			return (character >= TEXT('0') && character <= TEXT('9'));
+		}
+
+		/* Encode the value of the run of digits starting at data[index], return the index after it */
+		size_t WriteNumber(const TCHAR* data, size_t size, size_t index, uint8_t* out, size_t& written, size_t& leadingZeros)
+		{
+			leadingZeros = 0;
+			while (index < size && data[index] == TEXT('0'))
+			{
+				leadingZeros++;
+				index++;
+			}
+			size_t firstDigit = index;
+			while (index < size && IsDigit(data[index]))
+				index++;
+			// A run is in one segment, so the counts fit in a byte
+			size_t digitCount = index - firstDigit;
+
+			out[written++] = NumberByte;
+			out[written++] = static_cast<uint8_t>(digitCount);
+			for (size_t digit = 0; digit < digitCount; digit += 2)
+			{
+				uint8_t high = static_cast<uint8_t>(data[firstDigit + digit] - TEXT('0'));
+				uint8_t low = digit + 1 < digitCount ? static_cast<uint8_t>(data[firstDigit + digit + 1] - TEXT('0')) : 0;
+				out[written++] = static_cast<uint8_t>((high << 4) | low);
+			}
+			return (index);
+		}
+
+		/* The leading zeros of every run of digits, in order, so "1" < "01" only when everything else is equal */
+		void WriteLeadingZeros(const TCHAR* data, size_t size, uint8_t* out, size_t& written)
+		{
+			for (size_t index = 0; index < size; )
+			{
+				if (IsDigit(data[index]) == false)
+				{
+					index++;
+					continue;
+				}
+				size_t zeros = 0;
+				for (; index < size && data[index] == TEXT('0'); index++)
+					zeros++;
+				while (index < size && IsDigit(data[index]))
+					index++;
+				out[written++] = static_cast<uint8_t>(zeros);
+			}
+		}
+
+		void WriteCharacter(TCHAR character, bool ignoreCase, uint8_t* out, size_t& written)
+		{
+			if (ignoreCase && character >= TEXT('A') && character <= TEXT('Z'))
+				character = static_cast<TCHAR>(character - TEXT('A') + TEXT('a'));
+
+			uint32_t codePoint = static_cast<uint32_t>(static_cast<std::make_unsigned_t<TCHAR>>(character));
+			if (codePoint < 0x80)
+				out[written++] = static_cast<uint8_t>(codePoint + CharacterShift);
+			else if constexpr (sizeof(TCHAR) == 1)
+				out[written++] = static_cast<uint8_t>(codePoint); // A byte of a UTF-8 sequence
+			else if (codePoint < 0x800)
+			{
+				out[written++] = static_cast<uint8_t>(0xC0 | (codePoint >> 6));
+				out[written++] = static_cast<uint8_t>(0x80 | (codePoint & 0x3F));
+			}
+			else if (codePoint < 0x10000)
+			{
+				// On Windows a surrogate is encoded alone, a character past U+FFFF sorts between U+D7FF and U+E000
+				out[written++] = static_cast<uint8_t>(0xE0 | (codePoint >> 12));
+				out[written++] = static_cast<uint8_t>(0x80 | ((codePoint >> 6) & 0x3F));
+				out[written++] = static_cast<uint8_t>(0x80 | (codePoint & 0x3F));
+			}
+			else
+			{
+				out[written++] = static_cast<uint8_t>(0xF0 | (codePoint >> 18));
+				out[written++] = static_cast<uint8_t>(0x80 | ((codePoint >> 12) & 0x3F));
+				out[written++] = static_cast<uint8_t>(0x80 | ((codePoint >> 6) & 0x3F));
+				out[written++] = static_cast<uint8_t>(0x80 | (codePoint & 0x3F));
+			}
+		}
+
+		/* The byte the keys are distributed on at depth, 0 for a key that ended before and 1 + the byte otherwise */
+		size_t BucketOf(const NaturalSortKeys& keys, uint32_t index, size_t depth)
+		{
+			return (depth < keys.KeySize(index) ? size_t(1) + keys.Key(index)[depth] : 0);
+		}
+
+		/* Stable, the keys of [begin, end) are known to be equal before depth */
+		void InsertionSort(const NaturalSortKeys& keys, uint32_t* begin, uint32_t* end, size_t depth)
+		{
+			for (uint32_t* current = begin + 1; current < end; current++)
+			{
+				uint32_t index = *current;
+				const uint8_t* key = keys.Key(index) + depth;
+				size_t size = keys.KeySize(index) - depth;
+				uint32_t* position = current;
+				for (; position > begin; position--)
+				{
+					uint32_t previous = position[-1];
+					if (CompareNaturalSortKeys(keys.Key(previous) + depth, keys.KeySize(previous) - depth, key, size) <= 0)
+						break;
+					*position = previous;
+				}
+				*position = index;
+			}
+		}
+
+		/* Keys of [Begin, End) equal before Depth */
+		struct RadixRange
+		{
+			uint32_t* Begin;
+			uint32_t* End;
+			size_t Depth;
+		};
+
+		/* Most significant byte first radix sort, scratch is as big as [begin, end) */
+		void RadixSort(const NaturalSortKeys& keys, uint32_t* begin, uint32_t* end, uint32_t* scratch)
+		{
+			// The buckets left to sort, instead of recursing once per key byte (a long shared key would overflow the stack)
+			std::vector<RadixRange> ranges;
+			ranges.push_back({ begin, end, 0 });
+			while (ranges.empty() == false)
+			{
+				RadixRange range = ranges.back();
+				ranges.pop_back();
+
+				size_t count = static_cast<size_t>(range.End - range.Begin);
+				if (count < RadixCutoff)
+				{
+					InsertionSort(keys, range.Begin, range.End, range.Depth);
+					continue;
+				}
+
+				// Skip what every key of the range shares (the folders they are in) in one pass, instead of one distribution per byte
+				const uint8_t* firstKey = keys.Key(*range.Begin);
+				size_t sharedEnd = keys.KeySize(*range.Begin);
+				for (uint32_t* current = range.Begin + 1; current < range.End && sharedEnd > range.Depth; current++)
+				{
+					const uint8_t* key = keys.Key(*current);
+					size_t limit = std::min(sharedEnd, keys.KeySize(*current));
+					size_t position = range.Depth;
+					while (position < limit && key[position] == firstKey[position])
+						position++;
+					sharedEnd = position;
+				}
+				size_t depth = sharedEnd;
+
+				std::array<size_t, 257> bucketSizes = {};
+				for (uint32_t* current = range.Begin; current < range.End; current++)
+					bucketSizes[BucketOf(keys, *current, depth)]++;
+				if (bucketSizes[0] == count)
+					continue; // Every key ended, they are all equal
+
+				std::array<size_t, 257> bucketStarts;
+				size_t start = 0;
+				for (size_t bucket = 0; bucket < bucketSizes.size(); bucket++)
+				{
+					bucketStarts[bucket] = start;
+					start += bucketSizes[bucket];
+				}
+				uint32_t* rangeScratch = scratch + (range.Begin - begin);
+				for (uint32_t* current = range.Begin; current < range.End; current++)
+					rangeScratch[bucketStarts[BucketOf(keys, *current, depth)]++] = *current;
+				std::memcpy(range.Begin, rangeScratch, count * sizeof(uint32_t));
+
+				// The keys of the bucket 0 ended at depth, they are equal and stay in order
+				uint32_t* bucketBegin = range.Begin + bucketSizes[0];
+				for (size_t bucket = 1; bucket < bucketSizes.size(); bucket++)
+				{
+					if (bucketSizes[bucket] > 1)
+						ranges.push_back({ bucketBegin, bucketBegin + bucketSizes[bucket], depth + 1 });
+					bucketBegin += bucketSizes[bucket];
+				}
+			}
+		}
+	}
+
+	size_t WriteNaturalSortKey(const TCHAR* data, size_t size, uint8_t* out, const NaturalSortOptions& options)
+	{
+		size_t written = 0;
+		size_t index = 0;
+		bool hasLeadingZeros = false;
+		while (index < size)
+		{
+			TCHAR character = data[index];
+			if (IsSeparator(character))
+			{
+				out[written++] = SeparatorByte;
+				index++;
+			}
+			else if (IsDigit(character))
+			{
+				size_t leadingZeros;
+				index = WriteNumber(data, size, index, out, written, leadingZeros);
+				hasLeadingZeros |= leadingZeros > 0;
+			}
+			else
+			{
+				WriteCharacter(character, options.IgnoreCase, out, written);
+				index++;
+			}
+		}
+
+		// Without leading zeros the key ends here, and sorts before the same characters with leading zeros
+		if (hasLeadingZeros)
+		{
+			out[written++] = EndByte;
+			WriteLeadingZeros(data, size, out, written);
+		}
+		return (written);
+	}
+
+	void AppendNaturalSortKey(const IPath& path, std::vector<uint8_t>& key, const NaturalSortOptions& options)
+	{
+		// Written on the stack first, resizing key to the worst case would clear 4 bytes per character every time
+		uint8_t buffer[MaxNaturalSortKeySize(MaxPathLengthOfAllRules)];
+		size_t size = WriteNaturalSortKey(path.Data(), path.Size(), buffer, options);
+		key.insert(key.end(), buffer, buffer + size);
+	}
+
+	int CompareNaturalSortKeys(const uint8_t* key, size_t size, const uint8_t* otherKey, size_t otherSize)
+	{
+		int result = std::memcmp(key, otherKey, std::min(size, otherSize));
+		if (result != 0)
+			return (result);
+		return (size < otherSize ? -1 : (size > otherSize ? 1 : 0));
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// NATURAL SORT KEYS
+
+	NaturalSortKeys::NaturalSortKeys(const NaturalSortOptions& options)
+		: m_Options(options),
+		m_Offsets(1, 0)
+	{}
+
+	void NaturalSortKeys::Reserve(size_t pathCount, size_t characterCount)
+	{
+		m_Offsets.reserve(m_Offsets.size() + pathCount);
+		// Most characters take one byte, the worst case would be 4 times too big
+		m_Bytes.reserve(m_Bytes.size() + characterCount + pathCount);
+	}
+
+	void NaturalSortKeys::Add(const IPath& path)
+	{
+		AppendNaturalSortKey(path, m_Bytes, m_Options);
+		m_Offsets.push_back(m_Bytes.size());
+	}
+
+	void NaturalSortKeys::AddBatch(size_t count, const std::function<const IPath&(size_t)>& pathAt, ThreadPool* pool)
+	{
+		if (pool == nullptr || count <= BatchBlockSize)
+		{
+			size_t characterCount = 0;
+			for (size_t index = 0; index < count; index++)
+				characterCount += pathAt(index).Size();
+			Reserve(count, characterCount);
+			for (size_t index = 0; index < count; index++)
+				Add(pathAt(index));
+			return;
+		}
+
+		struct Block
+		{
+			std::vector<uint8_t> Bytes;
+			/* Where every key of the block ends, in Bytes */
+			std::vector<size_t> Ends;
+		};
+		std::vector<Block> blocks((count + BatchBlockSize - 1) / BatchBlockSize);
+		pool->ParallelFor(blocks.size(), [&](size_t blockIndex)
+		{
+			Block& block = blocks[blockIndex];
+			size_t first = blockIndex * BatchBlockSize;
+			size_t last = std::min(first + BatchBlockSize, count);
+			block.Ends.reserve(last - first);
+			for (size_t index = first; index < last; index++)
+			{
+				AppendNaturalSortKey(pathAt(index), block.Bytes, m_Options);
+				block.Ends.push_back(block.Bytes.size());
+			}
+		});
+
+		size_t byteCount = 0;
+		for (const Block& block : blocks)
+			byteCount += block.Bytes.size();
+		m_Bytes.reserve(m_Bytes.size() + byteCount);
+		m_Offsets.reserve(m_Offsets.size() + count);
+		for (const Block& block : blocks)
+		{
+			size_t base = m_Bytes.size();
+			m_Bytes.insert(m_Bytes.end(), block.Bytes.begin(), block.Bytes.end());
+			for (size_t end : block.Ends)
+				m_Offsets.push_back(base + end);
+		}
+	}
+
+	void NaturalSortKeys::Clear()
+	{
+		m_Bytes.clear();
+		m_Offsets.assign(1, 0);
+	}
+
+	int NaturalSortKeys::Compare(size_t index, size_t otherIndex) const
+	{
+		return (CompareNaturalSortKeys(Key(index), KeySize(index), Key(otherIndex), KeySize(otherIndex)));
+	}
+
+	std::vector<uint32_t> NaturalSortKeys::SortedOrder() const
+	{
+		assert(Size() <= UINT32_MAX && "Too many keys for 32 bits indices");
+
+		std::vector<uint32_t> order(Size());
+		for (size_t index = 0; index < order.size(); index++)
+			order[index] = static_cast<uint32_t>(index);
+		if (order.size() > 1)
+		{
+			std::vector<uint32_t> scratch(order.size());
+			RadixSort(*this, order.data(), order.data() + order.size(), scratch.data());
+		}
+		return (order);
+	}
+}
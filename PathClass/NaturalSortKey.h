@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Path.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace PathCore
+{
+	class ThreadPool;
+
+	struct NaturalSortOptions
+	{
+		/* 'A' to 'Z' sort as 'a' to 'z' (the other letters are not folded) */
+		bool IgnoreCase = true;
+	};
+
+	/**
+	 * Natural sort keys: a binary key per path, so comparing two keys with memcmp
+	 * gives the order a human expects ("File2" before "File10").
+	 *
+	 * The key is built segment by segment:
+	 * - A separator is 0x01, it sorts before any character so "A/B" comes before "A-B" and "AB".
+	 * - A character is its code point plus 2 when it is ASCII, UTF-8 otherwise (UTF-8 bytes sort like the code points).
+	 *   In narrow mode the characters are already UTF-8, only the ASCII ones are shifted.
+	 * - A run of digits is the byte of '0' (so it sorts where a digit would: "file.txt" < "file10.txt" < "fileA.txt"),
+	 *   the count of significant digits and the digits packed two per byte (so "2" < "10").
+	 * - When a run has leading zeros, the key ends with 0x00 and the count of leading zeros of every run,
+	 *   they only decide between otherwise equal paths ("01b" < "1c", "1" < "01" < "2").
+	 *
+	 * When one key is the beginning of the other, the shorter one comes first (CompareNaturalSortKeys).
+	 */
+
+	/* The biggest key a path of pathSize characters can have */
+	constexpr size_t MaxNaturalSortKeySize(size_t pathSize) { return (pathSize * 4); }
+
+	/**
+	 * @brief Write the key of a path
+	 * @param out Must hold MaxNaturalSortKeySize(size) bytes
+	 * @return The size of the key
+	 */
+	size_t WriteNaturalSortKey(const TCHAR* data, size_t size, uint8_t* out, const NaturalSortOptions& options = NaturalSortOptions());
+	/* Append the key of the path at the end of key */
+	void AppendNaturalSortKey(const IPath& path, std::vector<uint8_t>& key, const NaturalSortOptions& options = NaturalSortOptions());
+
+	/* memcmp, then the shortest key first. Negative, zero or positive like memcmp */
+	int CompareNaturalSortKeys(const uint8_t* key, size_t size, const uint8_t* otherKey, size_t otherSize);
+
+	/**
+	 * The keys of many paths, stored back to back in one buffer.
+	 *
+	 * @example NaturalSortKeys keys; keys.Add(paths); for (uint32_t index : keys.SortedOrder()) Print(paths[index]);
+	 */
+	class NaturalSortKeys
+	{
+	public:
+		explicit NaturalSortKeys(const NaturalSortOptions& options = NaturalSortOptions());
+
+	public:
+		/* Make room for pathCount more keys, of paths of characterCount characters in total */
+		void Reserve(size_t pathCount, size_t characterCount);
+		void Add(const IPath& path);
+		/**
+		 * @brief Add the key of every path, in order
+		 * @param pool When not null, the keys are built in parallel (in blocks, each built in its own buffer)
+		 */
+		template<typename PathType>
+		void Add(const std::vector<PathType>& paths, ThreadPool* pool = nullptr)
+		{
+			AddBatch(paths.size(), [&paths](size_t index) -> const IPath& { return (paths[index]); }, pool);
+		}
+		void Clear();
+
+		size_t Size() const { return (m_Offsets.size() - 1); }
+		const uint8_t* Key(size_t index) const { return (m_Bytes.data() + m_Offsets[index]); }
+		size_t KeySize(size_t index) const { return (m_Offsets[index + 1] - m_Offsets[index]); }
+		/* Bytes used by all the keys */
+		size_t ByteSize() const { return (m_Bytes.size()); }
+
+		int Compare(size_t index, size_t otherIndex) const;
+
+		/**
+		 * @brief The indices of the keys in natural order, equal keys stay in the order they were added
+		 * @note Radix sort on the key bytes (the prefix every key shares is skipped), small buckets are insertion sorted
+		 */
+		std::vector<uint32_t> SortedOrder() const;
+
+	private:
+		void AddBatch(size_t count, const std::function<const IPath&(size_t)>& pathAt, ThreadPool* pool);
+
+	private:
+		NaturalSortOptions m_Options;
+		std::vector<uint8_t> m_Bytes;
+		/* Where every key starts, plus where the last one ends */
+		std::vector<size_t> m_Offsets;
+	};
+
+	/**
+	 * @brief Sort the paths in natural order, with one key built per path instead of parsing both paths on every comparison
+	 */
+	template<typename PathType>
+	void SortNatural(std::vector<PathType>& paths, const NaturalSortOptions& options = NaturalSortOptions(), ThreadPool* pool = nullptr)
+	{
+		NaturalSortKeys keys(options);
+		keys.Add(paths, pool);
+		std::vector<PathType> sorted;
+		sorted.reserve(paths.size());
+		for (uint32_t index : keys.SortedOrder())
+			sorted.push_back(std::move(paths[index]));
+		paths = std::move(sorted);
+	}
+}
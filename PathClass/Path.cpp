@@ -1,55 +1,61 @@
 
 
 #include "Path.h"
+#include "PathEncoding.h"
+#include "AllocationProfiler.h"
+#include "Benchmarks.h"
+#include "PathInstrumentation.h"
 #include <cstring>
+#include <limits>
+#include <new>
 
 #define cout std::cout
 #define endl std::endl
 
-static int ALLOCATED_COUNT = 0;
-static size_t ALLOCATED_SIZE = 0;
-static int DEALLOCATED_COUNT = 0;
-
-static bool ACCUMULATE = true;
-static bool PRINT = true;
-
-// Override the default new operator to track memory allocation
-void* operator new(size_t size)
-{
-	void* ptr = malloc(size);
-	if (ACCUMULATE)
-	{
-		if (PRINT)
-			cout << "Allocated: " << size << endl;
-		ALLOCATED_COUNT++;
-		ALLOCATED_SIZE += size;
-	}
-	return (ptr);
-}
-
-// Override the default delete operator to track memory allocation
-void operator delete(void* ptr)
+namespace
 {
-	if (ACCUMULATE)
+	/* Encode and insert the characters a block at a time, instead of one insertion per character */
+	void WriteUtf8(std::ostream& os, const TCHAR* data, size_t size)
 	{
-		if (PRINT)
-			cout << "Deallocated" << endl;
-		DEALLOCATED_COUNT++;
+		constexpr size_t BlockSize = 256;
+		char encoded[PathCore::MaxUtf8Size(BlockSize)];
+		while (size > 0)
+		{
+			size_t blockSize = size < BlockSize ? size : BlockSize;
+			// Keep a surrogate pair in the same block
+			if constexpr (sizeof(TCHAR) == 2)
+			{
+				// The cast keeps a char TCHAR from comparing against values it cannot hold (the branch is still compiled)
+				uint32_t last = static_cast<uint32_t>(data[blockSize - 1]);
+				if (blockSize < size && last >= 0xD800 && last < 0xDC00)
+					blockSize--;
+			}
+			os.write(encoded, PathCore::EncodeUtf8(data, blockSize, encoded));
+			data += blockSize;
+			size -= blockSize;
+		}
 	}
-	free(ptr);
 }
 
 namespace std {
 	ostream& operator<< (ostream& os, wchar_t wc)
 	{
-		if(unsigned(wc) < 256) // or another upper bound
-			return os << (unsigned char)wc;
+		char encoded[4];
+		return (os.write(encoded, PathCore::WideToUtf8(&wc, 1, encoded)));
 	}
 
 	ostream& operator<< (ostream& os, const wchar_t* wc)
 	{
-		while (*wc)
-			os << *wc++;
+		const wchar_t* end = wc;
+		while (*end)
+			end++;
+		if constexpr (sizeof(TCHAR) == sizeof(wchar_t))
+			WriteUtf8(os, reinterpret_cast<const TCHAR*>(wc), end - wc);
+		else
+		{
+			for (; wc != end; wc++)
+				os << *wc;
+		}
 		return (os);
 	}
 }
@@ -72,8 +78,7 @@ public:
 template<typename CharType>
 std::ostream& operator<<(std::ostream& os, const TextSegment<CharType>& segment)
 {
-	for (size_t index = 0; index < segment.m_Size; index++)
-		os << segment.m_Data[index];
+	WriteUtf8(os, segment.m_Data, segment.m_Size);
 	return (os);
 }
 
@@ -85,16 +90,6 @@ std::ostream& operator<<(std::ostream& os, const TextSegment<CharType>& segment)
 
 namespace PathCore
 {
-	bool IsAValidFolderNameChar(const TCHAR character)
-	{
-		for (uint8_t invalidCharIndex = 0; invalidCharIndex < InvalidFolderNameChars.size(); invalidCharIndex++)
-		{
-			if (character == InvalidFolderNameChars[invalidCharIndex])
-				return (false);
-		}
-		return (true);
-	}
-
 	SegmentSize IsFolderSegmentValid(const TCHAR* segmentStart)
 	{
 		if (segmentStart == nullptr)
@@ -117,11 +112,10 @@ namespace PathCore
 
 		SegmentSize segmentIndex = 0;
 		while (segmentIndex < size && segmentStart[segmentIndex] != NULL && IsSeparator(segmentStart[segmentIndex]) == false)
-		{
-			if (IsAValidFolderNameChar(segmentStart[segmentIndex]) == false)
-				return (0); // The segment contains an invalid character
 			segmentIndex++;
-		}
+		// Checked once the segment end is known, in one branchless pass
+		if (IsValidName<OsRules>(segmentStart, segmentIndex) == false)
+			return (0); // The segment contains an invalid character
 		return (segmentIndex);
 	}
 
@@ -141,6 +135,26 @@ namespace PathCore
 		return (true);
 	}
 
+	FileNameOffsets FindFileNameOffsets(const TCHAR* data, PathSize size)
+	{
+		PathSize name = size;
+		PathSize lastDot = size;
+		while (name > 0 && IsSeparator(data[name - 1]) == false)
+		{
+			name--;
+			if (data[name] == TEXT('.') && lastDot == size)
+				lastDot = name;
+		}
+
+		// A dot starting the name is not an extension (eg: ".gitignore"), neither are the dots of "." and ".."
+		bool onlyDots = true;
+		for (PathSize index = name; index < size && onlyDots; index++)
+			onlyDots = data[index] == TEXT('.');
+		if (lastDot == name || onlyDots)
+			lastDot = size;
+		return (FileNameOffsets{ name, lastDot });
+	}
+
 	///////////////////////////////////////////////////////////////////////////
 	// CONST SEGMENT ITERATOR
 	///////////////////////////////////////////////////////////////////////////
@@ -149,7 +163,11 @@ namespace PathCore
 		: m_Path(const_cast<IPath*>(path)), // breaking the const to allow the non const iterator to inherit from this path class
 		m_Pos(0)
 	{
-		*this = index;
+		// Begin and End segment are already at the start of a segment, only an index in the middle of one has to be moved back
+		if (index >= m_Path->Size())
+			m_Pos = m_Path->Size();
+		else if (index > 0)
+			*this = index;
 	}
 
 	ConstSegmentIterator::ConstSegmentIterator(const ConstSegmentIterator& other)
@@ -196,6 +214,7 @@ namespace PathCore
 	}
 	ConstSegmentIterator ConstSegmentIterator::operator+(const PathSize offset)
 	{
+		PATH_INSTRUMENT(SegmentJump);
 		ConstSegmentIterator copy(*this);
 
 		// Move offset segment forward
@@ -211,6 +230,7 @@ namespace PathCore
 	}
 	ConstSegmentIterator& ConstSegmentIterator::operator+=(PathSize offset)
 	{
+		PATH_INSTRUMENT(SegmentJump);
 		// Move offset segment forward
 		for (PathSize index = 0; index < offset; index++)
 		{
@@ -227,6 +247,9 @@ namespace PathCore
 	{
 		DataPtr data = m_Path->Data();
 
+		// Already at the start of a segment: step over the separator, into the previous one
+		if (m_Pos > 0 && IsSeparator(data[m_Pos - 1]))
+			m_Pos--;
 		// move back until you find the start of this segment
 		while (m_Pos > 0 && IsSeparator(data[m_Pos - 1]) == false)
 			m_Pos--;
@@ -234,6 +257,7 @@ namespace PathCore
 	}
 	ConstSegmentIterator ConstSegmentIterator::operator-(PathSize offset)
 	{
+		PATH_INSTRUMENT(SegmentJump);
 		ConstSegmentIterator copy(*this);
 
 		// move offset segment backward
@@ -242,7 +266,7 @@ namespace PathCore
 			--copy;
 
 			// Stop if you reach the start of the path
-			if (m_Pos == 0)
+			if (copy.m_Pos == 0)
 				break;
 		}
 
@@ -250,6 +274,7 @@ namespace PathCore
 	}
 	ConstSegmentIterator& ConstSegmentIterator::operator-=(PathSize offset)
 	{
+		PATH_INSTRUMENT(SegmentJump);
 		for (PathSize index = 0; index < offset; index++)
 		{
 			--*this;
@@ -265,6 +290,7 @@ namespace PathCore
 
 	ConstSegmentIterator& ConstSegmentIterator::operator=(const PathSize index)
 	{
+		PATH_INSTRUMENT(SegmentJump);
 		if (index >= m_Path->Size())
 		{
 			m_Pos = m_Path->Size();
@@ -277,8 +303,10 @@ namespace PathCore
 		}
 
 		// Set pos whatever the index is, then move to the start of the segment
+		DataPtr data = m_Path->Data();
 		m_Pos = index;
-		--*this;
+		while (m_Pos > 0 && IsSeparator(data[m_Pos - 1]) == false)
+			m_Pos--;
 
 		return (*this);
 	}
@@ -382,19 +410,23 @@ namespace PathCore
 	
 	void SegmentIterator::Rename(const TCHAR* newName)
 	{
+		PATH_INSTRUMENT(Rename);
 		SegmentSize newNameSize = 0;
 		while (newName[newNameSize] != NULL)
 			newNameSize++;
+		PATH_INSTRUMENT_BYTES(newNameSize * sizeof(TCHAR));
 
 		SegmentSize segmentIndex = 0;
 		PathSize bufferIndex = m_Pos;
 
-		PathBase<OsSeparator>* basePathPtr = static_cast<PathBase<OsSeparator>*>(this->m_Path);
+		// A SegmentIterator only comes from a PathBase, whatever its separator and rules
+		IMutablePath* basePathPtr = static_cast<IMutablePath*>(this->m_Path);
+		TCHAR* buffer = basePathPtr->MutableData();
 
 		// Copy as much as you can, until you reach the end of the segment
 		while (segmentIndex < newNameSize && IsSeparator(basePathPtr->Data()[bufferIndex]) == false)
 		{
-			basePathPtr->m_Path[bufferIndex] = newName[segmentIndex];
+			buffer[bufferIndex] = newName[segmentIndex];
 			segmentIndex++;
 			bufferIndex++;
 		}
@@ -405,17 +437,18 @@ namespace PathCore
 			// Move the rest of the path to the right
 			SegmentSize offset = newNameSize - segmentIndex;
 			for (PathSize index = basePathPtr->Size(); index >= bufferIndex; index--)
-				basePathPtr->m_Path[index + offset] = basePathPtr->Data()[index];
+				buffer[index + offset] = basePathPtr->Data()[index];
+			PATH_INSTRUMENT_BYTES((basePathPtr->Size() - bufferIndex + NULL_TERMINATOR_LENGTH) * sizeof(TCHAR));
 
 			// Copy the rest of the new name
 			for (SegmentSize index = segmentIndex; index < newNameSize; index++)
 			{
-				basePathPtr->m_Path[bufferIndex] = newName[index];
+				buffer[bufferIndex] = newName[index];
 				bufferIndex++;
 			}
 
 			// Update size to reflect new change
-			basePathPtr->m_Size += offset;
+			basePathPtr->SetSize(basePathPtr->Size() + offset);
 		}
 		// If you finished copying and you didn't reach the end of the segment, we need to bring the rest of the path closer
 		else if (segmentIndex == newNameSize && IsSeparator(basePathPtr->Data()[bufferIndex]) == false)
@@ -427,13 +460,14 @@ namespace PathCore
 			// Move the rest of the path to the left
 			SegmentSize offset = segmentEndPos - bufferIndex;
 			for (PathSize index = segmentEndPos; index < basePathPtr->Size(); index++)
-				basePathPtr->m_Path[index - offset] = basePathPtr->Data()[index];
+				buffer[index - offset] = basePathPtr->Data()[index];
+			PATH_INSTRUMENT_BYTES((basePathPtr->Size() - segmentEndPos) * sizeof(TCHAR));
 
 			// Update size to reflect new change
-			basePathPtr->m_Size -= offset;
+			basePathPtr->SetSize(basePathPtr->Size() - offset);
 
 			// Terminate the path to the new size
-			basePathPtr->m_Path[basePathPtr->Size()] = NULL;
+			buffer[basePathPtr->Size()] = NULL;
 		}
 	}
 
@@ -446,8 +480,8 @@ namespace PathCore
 	// PATH BASE
 	///////////////////////////////////////////////////////////////////////////
 
-	template<TCHAR Separator>
-	PathBase<Separator>::PathBase(const IPath* parent, const TCHAR* rawPath)
+	template<TCHAR Separator, typename Rules>
+	PathBase<Separator, Rules>::PathBase(const IPath* parent, const TCHAR* rawPath)
 		: m_Path(),
 		m_Size(0)
 	{
@@ -462,8 +496,8 @@ namespace PathCore
 		}
 		Append(rawPath);
 	}
-	template<TCHAR Separator>
-	PathBase<Separator>::PathBase(ConstSegmentIterator fromSegment, const ConstSegmentIterator& toSegment)
+	template<TCHAR Separator, typename Rules>
+	PathBase<Separator, Rules>::PathBase(ConstSegmentIterator fromSegment, const ConstSegmentIterator& toSegment)
 		: m_Path(),
 		m_Size(0)
 	{
@@ -478,67 +512,83 @@ namespace PathCore
 		}
 	}
 
-	template<TCHAR Separator>
-	PathBase<Separator>& PathBase<Separator>::operator=(const PathBase<Separator>& other)
+	template<TCHAR Separator, typename Rules>
+	PathBase<Separator, Rules>& PathBase<Separator, Rules>::operator=(const PathBase<Separator, Rules>& other)
 	{
 		m_Path = other.m_Path;
 		m_Size = other.m_Size;
 		return (*this);
 	}
-	template<TCHAR Separator>
-	PathBase<Separator>& PathBase<Separator>::operator=(PathBase<Separator>&& other) noexcept
+	template<TCHAR Separator, typename Rules>
+	PathBase<Separator, Rules>& PathBase<Separator, Rules>::operator=(PathBase<Separator, Rules>&& other) noexcept
 	{
+		if (this == &other)
+			return (*this);
 		m_Path = std::move(other.m_Path);
-		m_Size = std::move(other.m_Size);
+		m_Size = other.m_Size;
+		other.Clear(); // Its buffer may be the one this path had
 		return (*this);
 	}
 
-	template<TCHAR Separator>
-	PathBase<Separator>& PathBase<Separator>::operator+=(const TCHAR* rawPath)
+	template<TCHAR Separator, typename Rules>
+	PathBase<Separator, Rules>& PathBase<Separator, Rules>::operator+=(const TCHAR* rawPath)
 	{
 		Append(rawPath);
 		return (*this);
 	}
-	template<TCHAR Separator>
-	PathBase<Separator>& PathBase<Separator>::operator+=(const ConstSegmentIterator& segment)
+	template<TCHAR Separator, typename Rules>
+	PathBase<Separator, Rules>& PathBase<Separator, Rules>::operator+=(const ConstSegmentIterator& segment)
 	{
 		Append(segment);
 		return (*this);
 	}
 
-	template<TCHAR Separator>
-	PathBase<Separator> PathBase<Separator>::operator+(const TCHAR* rawPath) const
+	template<TCHAR Separator, typename Rules>
+	PathBase<Separator, Rules> PathBase<Separator, Rules>::operator+(const TCHAR* rawPath) const
 	{
 		return (PathBase(this, rawPath));
 	}
-	template<TCHAR Separator>
-	PathBase<Separator> PathBase<Separator>::operator+(const ConstSegmentIterator& segment) const
+	template<TCHAR Separator, typename Rules>
+	PathBase<Separator, Rules> PathBase<Separator, Rules>::operator+(const ConstSegmentIterator& segment) const
 	{
-		PathBase pathCopy(this);
+		PathBase pathCopy(*this);
 		pathCopy.Append(segment);
 
 		return (pathCopy);
 	}
 
-	template<TCHAR Separator>
-	void PathBase<Separator>::Append(const TCHAR* rawPath)
+	template<TCHAR Separator, typename Rules>
+	void PathBase<Separator, Rules>::Append(const TCHAR* rawPath)
 	{
+		PATH_INSTRUMENT(Append);
 		PathSize rawPathIndex = 0;
 
+		// Narrow paths are UTF-8, the folder name checks below are done byte per byte and trust the encoding
+		assert((sizeof(TCHAR) != 1 || IsValidUtf8(reinterpret_cast<const char*>(rawPath), std::char_traits<TCHAR>::length(rawPath))) && "Invalid UTF-8 path");
+
 		if (m_Size == 0)
 		{
-			assert(IsDiskNameValid(rawPath) && "Invalid Disk segment (TODO add rawPath to this message)");
+			if constexpr (Rules::DiskNameLength > 0)
+			{
+				assert(IsDiskNameValid(rawPath) && "Invalid Disk segment (TODO add rawPath to this message)");
 
-			// Copy the disk segment
-			while (m_Size < PATH_DISK_NAME_LENGTH)
+				// Copy the disk segment
+				while (m_Size < Rules::DiskNameLength)
+				{
+					m_Path[m_Size] = rawPath[m_Size];
+					m_Size++;
+				}
+				rawPathIndex = Rules::DiskNameLength;
+			}
+			else if (IsSeparator(rawPath[0]))
 			{
-				m_Path[m_Size] = rawPath[m_Size];
+				// The root of an absolute path, its segment is empty (eg: "/home"), without it the path is relative
+				m_Path[m_Size] = Separator;
 				m_Size++;
 			}
-			rawPathIndex = PATH_DISK_NAME_LENGTH;
 		}
 		else
-			assert(m_Size + PATH_SEPARATOR_LENGTH + PATH_MIN_FOLDER_NAME_LENGTH <= MAX_PATH_LENGTH && "Unable to append segment \'TODO\' path to long!");
+			assert(m_Size + PATH_SEPARATOR_LENGTH + PATH_MIN_FOLDER_NAME_LENGTH <= Rules::MaxPathLength && "Unable to append segment \'TODO\' path to long!");
 		
 		// Add separator
 		if (IsSeparator(rawPath[rawPathIndex]))
@@ -547,20 +597,23 @@ namespace PathCore
 		// Copy rawPath folder segments
 		while (rawPath[rawPathIndex] != NULL)
 		{
-			// Add separator
-			m_Path[m_Size] = Separator;
-			m_Size++;
+			// Add separator, unless this is the first segment of a relative path or the path is only a root
+			if (m_Size > 0 && IsSeparator(m_Path[m_Size - 1]) == false)
+			{
+				m_Path[m_Size] = Separator;
+				m_Size++;
+			}
 
 			// Copy folder segment name
 			while (rawPath[rawPathIndex] != NULL)
 			{
-				assert(IsAValidFolderNameChar(rawPath[rawPathIndex]) && "Invalid folder name char found!");
+				assert(IsValidNameChar<Rules>(rawPath[rawPathIndex]) && "Invalid folder name char found!");
 
 				m_Path[m_Size] = rawPath[rawPathIndex];
 				m_Size++;
 				rawPathIndex++;
 
-				assert(m_Size <= MAX_PATH_LENGTH && "Path is too long");
+				assert(m_Size <= Rules::MaxPathLength && "Path is too long");
 
 				if (IsSeparator(rawPath[rawPathIndex]))
 				{
@@ -570,16 +623,24 @@ namespace PathCore
 			}
 		}
 		m_Path[m_Size] = NULL;
+		PATH_INSTRUMENT_BYTES(rawPathIndex * sizeof(TCHAR));
 	}
 
-	template<TCHAR Separator>
-	void PathCore::PathBase<Separator>::Append(const ConstSegmentIterator& segment)
+	template<TCHAR Separator, typename Rules>
+	void PathCore::PathBase<Separator, Rules>::Append(const ConstSegmentIterator& segment)
 	{
+		PATH_INSTRUMENT(Append);
 		// Check if their is enough space to append the segment
-		assert(m_Size + PATH_SEPARATOR_LENGTH + PATH_MIN_FOLDER_NAME_LENGTH <= MAX_PATH_LENGTH && "Cannot append segment, path will be too long");
+		assert(m_Size + PATH_SEPARATOR_LENGTH + PATH_MIN_FOLDER_NAME_LENGTH <= Rules::MaxPathLength && "Cannot append segment, path will be too long");
 
-		// If were appending after already existing data, add a separator
-		if (m_Size != 0)
+		// If were appending after already existing data, add a separator (a root already ends with one)
+		if (m_Size != 0 && IsSeparator(m_Path[m_Size - 1]) == false)
+		{
+			m_Path[m_Size] = Separator;
+			m_Size++;
+		}
+		// The empty segment of a root, only kept as the first segment (eg: "/home" copied a segment at a time)
+		else if (m_Size == 0 && segment.Pos() == 0 && IsSeparator(*segment[0]))
 		{
 			m_Path[m_Size] = Separator;
 			m_Size++;
@@ -587,20 +648,22 @@ namespace PathCore
 
 		// Copy data char by char
 		SegmentSize segmentSize = segment.Size();
+		PATH_INSTRUMENT_BYTES(segmentSize * sizeof(TCHAR));
 		for (PathSize index = 0; index < segmentSize; index++)
 		{
 			m_Path[m_Size] = *segment[index];
 			m_Size++;
-			assert(m_Size <= MAX_PATH_LENGTH && "Cannot append segment, path is too long");
+			assert(m_Size <= Rules::MaxPathLength && "Cannot append segment, path is too long");
 		}
 
 		// Add null terminator
 		m_Path[m_Size] = NULL;
 	}
-	template<TCHAR Separator>
-	void PathBase<Separator>::Append(ConstSegmentIterator fromSegment, const ConstSegmentIterator& toSegment)
+	template<TCHAR Separator, typename Rules>
+	void PathBase<Separator, Rules>::Append(ConstSegmentIterator fromSegment, const ConstSegmentIterator& toSegment)
 	{
 		assert(fromSegment <= toSegment); // 'from' is after 'to' (also check if they are from the same path)
+		PATH_INSTRUMENT(Append);
 
 		while (fromSegment != toSegment)
 		{
@@ -609,29 +672,35 @@ namespace PathCore
 		}
 	}
 
-	template<TCHAR Separator>
-	void PathBase<Separator>::Shrink(const ConstSegmentIterator& toSegment)
+	template<TCHAR Separator, typename Rules>
+	void PathBase<Separator, Rules>::Shrink(const ConstSegmentIterator& toSegment)
 	{
 		assert(toSegment.BelongTo(this)); // 'toSegment' is not from this path
+		PATH_INSTRUMENT(Shrink);
 
 		if (toSegment == IPath::EndSegment())
 			return; // Nothing to do
 		if (toSegment == IPath::BeginSegment())
 		{
 			Clear();
+			PATH_INSTRUMENT_BYTES(NULL_TERMINATOR_LENGTH * sizeof(TCHAR));
 			return;
 		}
 
-		// Terminal the path, by replacing the separator before the toSegment segment by a NULL terminator
-		m_Path[toSegment.Pos() - 1] = NULL;
-		m_Size = toSegment.Pos() - 1;
+		// Terminal the path, by replacing the separator before the toSegment segment by a NULL terminator, but keep a root (eg: "/home" to "/")
+		PathSize size = toSegment.Pos() - PATH_SEPARATOR_LENGTH;
+		if (size == 0)
+			size = PATH_SEPARATOR_LENGTH;
+		m_Path[size] = NULL;
+		m_Size = size;
 	};
 
-	template<TCHAR Separator>
-	void PathBase<Separator>::Insert(const ConstSegmentIterator& whereSegment, ConstSegmentIterator fromSegment, const ConstSegmentIterator& toSegment)
+	template<TCHAR Separator, typename Rules>
+	void PathBase<Separator, Rules>::Insert(const ConstSegmentIterator& whereSegment, ConstSegmentIterator fromSegment, const ConstSegmentIterator& toSegment)
 	{
 		assert(whereSegment.BelongTo(this)); // 'whereSegment' is not from this path
 		assert(fromSegment <= toSegment); // 'fromSegment' is after 'toSegment' (also check if they are both from the same path)
+		PATH_INSTRUMENT(Insert);
 
 		if (whereSegment == IPath::EndSegment())
 		{
@@ -641,59 +710,74 @@ namespace PathCore
 		else if (fromSegment == toSegment)
 			return; // Nothing to do
 
-		assert(whereSegment.Pos() + (toSegment.Pos() - fromSegment.Pos()) + PATH_SEPARATOR_LENGTH <= MAX_PATH_LENGTH && "Unable to insert 'TODO', path will be too long");
+		// The inserted segments are one run of characters in their path, each one after a separator
+		PathSize sourceStart = fromSegment.Pos();
+		const TCHAR* source = *fromSegment - sourceStart;
+		PathSize sourceEnd = toSegment.Pos();
+		if (toSegment)
+			sourceEnd -= PATH_SEPARATOR_LENGTH; // The separator before toSegment is not inserted
+
+		// Shifted in place from the separator before whereSegment, inserting before the first segment adds one after the inserted ones
+		PathSize gapStart = whereSegment.Pos() > 0 ? whereSegment.Pos() - PATH_SEPARATOR_LENGTH : 0;
+		PathSize gapSize = PATH_SEPARATOR_LENGTH + (sourceEnd - sourceStart) + (whereSegment.Pos() > 0 ? 0 : PATH_SEPARATOR_LENGTH);
+		assert(m_Size + gapSize <= Rules::MaxPathLength && "Unable to insert 'TODO', path will be too long");
 
-		// Use a new buffer to compute the new path, because from and to segments can be from this path
-		PathSize newPathBufferIndex = 0;
-		PathBuffer newPathBuffer;
+		TCHAR* data = m_Path.data();
+		std::memmove(data + gapStart + gapSize, data + gapStart, (m_Size - gapStart + NULL_TERMINATOR_LENGTH) * sizeof(TCHAR));
 
-		// Copy until whereSegment position
-		while (newPathBufferIndex < whereSegment.Pos() - 1)
+		// The segments may come from this path: what was after the gap moved by gapSize, the gap itself is never read
+		data[gapStart] = Separator;
+		for (PathSize index = sourceStart; index < sourceEnd; index++)
 		{
-			newPathBuffer[newPathBufferIndex] = m_Path[newPathBufferIndex];
-			newPathBufferIndex++;
+			TCHAR character = source[index < gapStart || source != data ? index : index + gapSize];
+			data[gapStart + PATH_SEPARATOR_LENGTH + index - sourceStart] = IsSeparator(character) ? Separator : character;
 		}
+		if (whereSegment.Pos() == 0)
+			data[gapSize - PATH_SEPARATOR_LENGTH] = Separator;
 
-		// Copy the data from the insert segment
-		for (; fromSegment != toSegment; ++fromSegment)
-		{
-			newPathBuffer[newPathBufferIndex] = Separator;
-			newPathBufferIndex++;
+		m_Size += gapSize;
+		PATH_INSTRUMENT_BYTES((m_Size - gapStart) * sizeof(TCHAR));
+	}
 
-			SegmentSize segmentSize = fromSegment.Size();
-			for (SegmentSize index = 0; index < segmentSize; index++)
-			{
-				newPathBuffer[newPathBufferIndex] = *fromSegment[index];
-				newPathBufferIndex++;
-			}
-		}
+	template<TCHAR Separator, typename Rules>
+	void PathBase<Separator, Rules>::ReplaceExtension(const TCHAR* extension)
+	{
+		FileNameOffsets offsets = NameOffsets();
+		// Only a Windows path can be a disk alone, the first segment of a relative Posix path is a file name
+		assert((Rules::DiskNameLength == 0 || offsets.Name > 0) && "Cannot replace the extension of a disk");
+		PATH_INSTRUMENT(ReplaceExtension);
 
-		// Add separator
-		newPathBuffer[newPathBufferIndex] = Separator;
-		newPathBufferIndex++;
+		if (extension[0] == TEXT('.'))
+			extension++;
 
-		// Copy the rest of m_Path from where to the end
-		for (PathSize index = whereSegment.Pos(); index < m_Size; index++)
+		// Written over the old extension, the new path always starts where it started
+		PathSize size = offsets.Extension;
+		if (extension[0] != NULL)
 		{
-			newPathBuffer[newPathBufferIndex] = m_Path[index];
-			newPathBufferIndex++;
-		}
-
-		// Copy newPathBuffer to m_Path
-		for (PathSize index = 0; index < newPathBufferIndex; index++)
-			m_Path[index] = newPathBuffer[index];
+			m_Path[size] = TEXT('.');
+			size++;
+			for (PathSize index = 0; extension[index] != NULL; index++)
+			{
+				assert(IsValidNameChar<Rules>(extension[index]) && "Invalid extension char found!");
 
-		// add null terminator
-		m_Path[newPathBufferIndex] = NULL;
+				m_Path[size] = extension[index];
+				size++;
 
-		m_Size = newPathBufferIndex;
+				assert(size <= Rules::MaxPathLength && "Path is too long");
+				assert(size - offsets.Name <= Rules::MaxFileNameLength && "File name is too long");
+			}
+		}
+		m_Path[size] = NULL;
+		PATH_INSTRUMENT_BYTES((size - offsets.Extension) * sizeof(TCHAR));
+		m_Size = size;
 	}
 
-	template<TCHAR Separator>
-	void PathBase<Separator>::Clear()
+	template<TCHAR Separator, typename Rules>
+	void PathBase<Separator, Rules>::Clear()
 	{
+		// Every change writes its null terminator, the characters after it are never read
 		m_Size = 0;
-		m_Path.fill(NULL);
+		m_Path[0] = NULL;
 	}
 
 	///////////////////////////////////////////////////////////////////////////
@@ -702,10 +786,15 @@ namespace PathCore
 
 	template<TCHAR Separator>
 	StaticPathBase::StaticPathBase(const IPath& path)
-		: m_Path(path.Size() + NULL_TERMINATOR_LENGTH)
+		: m_Path()
 	{
+		PATH_INSTRUMENT(StaticPathConstruct);
+		PATH_INSTRUMENT_BYTES(path.Size() * sizeof(TCHAR));
+		// Allocated in the body, so the allocation is part of the timed construction
+		m_Path.resize(path.Size() + NULL_TERMINATOR_LENGTH);
 		for (PathSize index = 0; index < path.Size(); index++)
 			m_Path[index] = path.Data()[index];
+		m_NameOffsets = path.NameOffsets();
 	}
 
 #ifdef DEBUG
@@ -716,10 +805,14 @@ namespace PathCore
 #else
 	template<TCHAR Separator>
 	StaticPathBase::StaticPathBase(const TCHAR* rawPath)
-		: m_Path(std::wcslen(rawPath) + NULL_TERMINATOR_LENGTH)
+		: m_Path()
 	{
+		PATH_INSTRUMENT(StaticPathConstruct);
+		m_Path.resize(std::char_traits<TCHAR>::length(rawPath) + NULL_TERMINATOR_LENGTH);
+		PATH_INSTRUMENT_BYTES((m_Path.size() - NULL_TERMINATOR_LENGTH) * sizeof(TCHAR));
 		for (PathSize index = 0; rawPath[index] != NULL; index++)
 			m_Path[index] = rawPath[index];
+		m_NameOffsets = FindFileNameOffsets(m_Path.data(), Size());
 	}
 #endif
 
@@ -733,12 +826,15 @@ namespace PathCore
 	StaticPathBase::StaticPathBase(const IPath& parent, const TCHAR* rawPath)
 		: m_Path()
 	{
+		PATH_INSTRUMENT(StaticPathConstruct);
 		PathSize rawPathSize = 0;
 		while (rawPath[rawPathSize] != NULL)
 			rawPathSize++;
 
 		PathSize parentSize = parent.Size();
-		m_Path.reserve(parentSize + rawPathSize + PATH_SEPARATOR_LENGTH);
+		// resize, the characters are written by index below and Size() is read from the vector size
+		m_Path.resize(parentSize + PATH_SEPARATOR_LENGTH + rawPathSize + NULL_TERMINATOR_LENGTH);
+		PATH_INSTRUMENT_BYTES((parentSize + PATH_SEPARATOR_LENGTH + rawPathSize) * sizeof(TCHAR));
 
 		// Copy parent path
 		PathSize index = 0;
@@ -758,15 +854,176 @@ namespace PathCore
 			m_Path[index] = rawPath[rawPathIndex];
 			index++;
 		}
+		m_NameOffsets = FindFileNameOffsets(m_Path.data(), Size());
+	}
+#endif
+
+	///////////////////////////////////////////////////////////////////////////
+	// SHARED PATH BASE
+	///////////////////////////////////////////////////////////////////////////
+
+	SharedPathBase::SharedPathBase(const IPath& path)
+		: m_Header(nullptr)
+	{
+		PATH_INSTRUMENT(StaticPathConstruct);
+		PATH_INSTRUMENT_BYTES(path.Size() * sizeof(TCHAR));
+		m_Header = Allocate(path.Data(), path.Size());
+	}
 
+#ifdef DEBUG
+	template<TCHAR Separator>
+	SharedPathBase::SharedPathBase(const TCHAR* rawPath)
+		: SharedPathBase(PathBase<Separator>(rawPath))
+	{}
+#else
+	template<TCHAR Separator>
+	SharedPathBase::SharedPathBase(const TCHAR* rawPath)
+		: m_Header(nullptr)
+	{
+		PATH_INSTRUMENT(StaticPathConstruct);
+		PathSize size = static_cast<PathSize>(std::char_traits<TCHAR>::length(rawPath));
+		PATH_INSTRUMENT_BYTES(size * sizeof(TCHAR));
+		m_Header = Allocate(rawPath, size);
 	}
 #endif
 
+	SharedPathBase::SharedPathBase(const SharedPathBase& other) noexcept
+		: m_Header(other.m_Header)
+	{
+		// Relaxed: the new reference comes from an existing one, nothing to synchronize with
+		if (m_Header)
+			m_Header->References.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	SharedPathBase::SharedPathBase(SharedPathBase&& other) noexcept
+		: m_Header(other.m_Header)
+	{
+		other.m_Header = nullptr;
+	}
+
+	SharedPathBase::~SharedPathBase()
+	{
+		Release();
+	}
+
+	SharedPathBase& SharedPathBase::operator=(const SharedPathBase& other) noexcept
+	{
+		if (m_Header == other.m_Header)
+			return (*this);
+
+		if (other.m_Header)
+			other.m_Header->References.fetch_add(1, std::memory_order_relaxed);
+		Release();
+		m_Header = other.m_Header;
+		return (*this);
+	}
+
+	SharedPathBase& SharedPathBase::operator=(SharedPathBase&& other) noexcept
+	{
+		if (this == &other)
+			return (*this);
+
+		Release();
+		m_Header = other.m_Header;
+		other.m_Header = nullptr;
+		return (*this);
+	}
+
+	const TCHAR* SharedPathBase::Data() const
+	{
+		static const TCHAR EmptyPath[NULL_TERMINATOR_LENGTH] = {};
+		return (m_Header ? Characters() : EmptyPath);
+	}
+
+	uint32_t SharedPathBase::UseCount() const
+	{
+		return (m_Header ? m_Header->References.load(std::memory_order_relaxed) : 0);
+	}
+
+	void SharedPathBase::Assign(const IPath& path)
+	{
+		// path can be this path, or a view over a part of it
+		if (m_Header && path.Data() == Characters() && path.Size() == m_Header->Size)
+			return;
+
+		if (m_Header && path.Size() <= m_Header->Capacity && m_Header->References.load(std::memory_order_acquire) == 1)
+		{
+			std::char_traits<TCHAR>::move(Characters(), path.Data(), path.Size()); // The ranges overlap for a view over this path
+			Characters()[path.Size()] = NULL;
+			m_Header->Size = path.Size();
+			return;
+		}
+
+		Header* header = Allocate(path.Data(), path.Size());
+		Release();
+		m_Header = header;
+	}
+
+	TCHAR* SharedPathBase::MutableData()
+	{
+		if (m_Header && m_Header->References.load(std::memory_order_acquire) > 1)
+		{
+			Header* header = Allocate(Characters(), m_Header->Size);
+			Release();
+			m_Header = header;
+		}
+		return (const_cast<TCHAR*>(Data()));
+	}
+
+	SharedPathBase::Header* SharedPathBase::Allocate(const TCHAR* data, PathSize size)
+	{
+		// The header and the characters in the same block, the characters right after the header
+		static_assert(sizeof(Header) % alignof(TCHAR) == 0, "The characters must be aligned after the header");
+		void* block = ::operator new(sizeof(Header) + (size + NULL_TERMINATOR_LENGTH) * sizeof(TCHAR));
+		Header* header = new (block) Header();
+		header->References.store(1, std::memory_order_relaxed);
+		header->Size = size;
+		header->Capacity = size;
+
+		TCHAR* characters = reinterpret_cast<TCHAR*>(header + 1);
+		std::char_traits<TCHAR>::copy(characters, data, size);
+		characters[size] = NULL;
+		return (header);
+	}
+
+	void SharedPathBase::Release()
+	{
+		if (m_Header == nullptr)
+			return;
+
+		// acq_rel: the last owner must see every write of the others before freeing the block
+		if (m_Header->References.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			m_Header->~Header();
+			::operator delete(m_Header);
+		}
+		m_Header = nullptr;
+	}
+
 	std::ostream& operator<<(std::ostream& os, const IPath& path)
 	{
-		os << path.Data();
+		WriteUtf8(os, path.Data(), path.Size());
 		return (os);
 	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// EXPLICIT INSTANTIATIONS
+	///////////////////////////////////////////////////////////////////////////
+
+	// The templates are defined in this file, instantiate them so the other modules can link against them
+	template class PathBase<WindowsSeparator, WindowsRules>;
+	template class PathBase<UnixSeparator, WindowsRules>;
+	template class PathBase<WindowsSeparator, PosixRules>;
+	template class PathBase<UnixSeparator, PosixRules>;
+#ifdef PLATFORM_MACOS
+	template class PathBase<WindowsSeparator, MacOsRules>;
+	template class PathBase<UnixSeparator, MacOsRules>;
+#endif
+
+	template StaticPathBase::StaticPathBase<OsSeparator>(const IPath& path);
+	template StaticPathBase::StaticPathBase<OsSeparator>(const TCHAR* rawPath);
+	template StaticPathBase::StaticPathBase<OsSeparator>(const IPath& parent, const TCHAR* rawPath);
+	template SharedPathBase::SharedPathBase<OsSeparator>(const TCHAR* rawPath);
 }
 
 void DoWork()
@@ -821,10 +1078,27 @@ void DoWork()
 	cout << "Rename same \"" << path << "\"" << endl;
 }
 
-int main()
+int main(int argc, char** argv)
 {
-	DoWork();
+	if (argc > 1 && std::strcmp(argv[1], "--bench") == 0)
+	{
+		// The benchmarks measure their own allocations with AllocationScope
+		RunBenchmarks();
+		return (0);
+	}
+	if (argc > 1 && std::strcmp(argv[1], "--microbench") == 0)
+		return (RunPathMicroBenchmarks(argc - 2, argv + 2));
 
-	cout << "Total memory allocated: " << ALLOCATED_SIZE << " in " << ALLOCATED_COUNT << endl;
-	cout << "Memory deallocated count " << DEALLOCATED_COUNT << endl;
+	PathCore::EnableAllocationTracking(true);
+	DoWork();
+	PathCore::EnableAllocationTracking(false);
+
+	PathCore::AllocationStats totals = PathCore::GetAllocationTotals();
+	cout << "Total memory allocated: " << totals.AllocatedBytes << " in " << totals.Allocations
+		<< (PATH_ALLOCATION_PROFILER ? "" : " (built without PATH_ALLOCATION_PROFILER)") << endl;
+	cout << "Memory deallocated count " << totals.Deallocations << endl;
+	PathCore::WriteAllocationJson(cout, "DoWork", totals);
+#if PATH_INSTRUMENTATION
+	PathCore::WriteInstrumentationText(cout, PathCore::TakeInstrumentationSnapshot());
+#endif
 }
@@ -3,6 +3,10 @@
 #include <iostream>
 
 #include <assert.h>
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 #include <array>
 
@@ -10,163 +14,305 @@
 //  Redefining useful macros, I dont want to include the whole stdlib.h
 ///////////////////////////////////////////////////////////////////////////////
 
-#define USE_WIDE_CHAR 1
+#ifndef USE_WIDE_CHAR
+# define USE_WIDE_CHAR 1
+#endif
 
-#define PLATFORM_WINDOWS
-// #define PLATFORM_LINUX
-// #define PLATFORM_MACOS
+/**
+ * The platform the code is built for: its system calls, and the rules of Path (OsRules).
+ * Found from the compiler, unless the build defines one of PLATFORM_WINDOWS, PLATFORM_LINUX or PLATFORM_MACOS.
+ * The paths of the other platforms are handled with PathBase<Separator, WindowsRules/PosixRules>.
+ */
+#if !defined(PLATFORM_WINDOWS) && !defined(PLATFORM_LINUX) && !defined(PLATFORM_MACOS)
+# if defined(_WIN32)
+#  define PLATFORM_WINDOWS
+# elif defined(__APPLE__)
+#  define PLATFORM_MACOS
+# elif defined(__linux__)
+#  define PLATFORM_LINUX
+# endif
+#endif
 
 /** Used as a placeholder */
 #define PATH_SEPARATOR_LENGTH 1
 /** Used as a placeholder */
 #define NULL_TERMINATOR_LENGTH 1
 
-#ifdef PLATFORM_WINDOWS
-
 /**
- * @brief The maximum length for a full path
+ * The limits of OsRules, for the code working on the paths of the platform it runs on (see WindowsRules for the details)
  * @example "C:/FolderName1/Foldername2/Image.png" <= MAX_PATH_LENGTH characters
  */
-#define MAX_PATH_LENGTH 259
-
-/**
- * @brief The maximum length for a disk name
- * @note the trailing separator is not counted
- * @example "C:" <= PATH_DISK_NAME_LENGTH characters
- */
-#define PATH_DISK_NAME_LENGTH 2
-
-/**
- * @brief The maximum length for a directory path
- * @details "12" because of backward compatibility with 8.3 file names.
- *          More details here: https://learn.microsoft.com/en-us/windows/win32/fileio/naming-a-file#maximum-path-length-limitation
- *          In the macro calculation we don't add a PATH_TRAILING_NULL_LENGTH because it is already included in MAX_PATH_LENGTH
- * @example "C:/FolderName1/Foldername2" <= MAX_DIRECTORY_PATH_LENGTH characters
- */
-#define MAX_DIRECTORY_PATH_LENGTH (MAX_PATH_LENGTH - 12)
-
-/**
- * @brief The maximum length for a folder name
- * @example "FolderName1" <= PATH_MAX_FOLDER_NAME_LENGTH characters
- */
-#define PATH_MAX_FOLDER_NAME_LENGTH (MAX_DIRECTORY_PATH_LENGTH - (PATH_DISK_NAME_LENGTH + PATH_SEPARATOR_LENGTH))
-#define PATH_MIN_FOLDER_NAME_LENGTH 1
-
-/**
- * @brief The maximum length for a file name
- * @details I added 1 but I dont know what it stand for, I just know that it is needed
- * @example "Image" <= PATH_MAX_FILE_NAME_LENGTH characters
- */
-#define PATH_MAX_FILE_NAME_LENGTH (MAX_PATH_LENGTH - (PATH_DISK_NAME_LENGTH + PATH_SEPARATOR_LENGTH + 1))
-#define PATH_MIN_FILE_NAME_LENGTH 1
-
-/**
- * @brief The maximum length for an file extension
- * @note (Including a leading dot)
- * @example ".png" <= PATH_MAX_EXT_NAME_LENGTH characters
- */
-#define PATH_MAX_EXT_NAME_LENGTH (PATH_MAX_FILE_NAME_LENGTH - 1)
-
-#elif defined(PLATFORM_LINUX)
-
-#define MAX_PATH_LENGTH 4096
-
-#define PATH_DISK_NAME_LENGTH 2
-// TODO: Verify this
-#define MAX_DIRECTORY_PATH_LENGTH MAX_PATH_LENGTH
-
-#define PATH_MAX_FOLDER_NAME_LENGTH 255
-#define PATH_MIN_FOLDER_NAME_LENGTH 1
-
-#define PATH_MAX_FILE_NAME_LENGTH 255
-#define PATH_MIN_FILE_NAME_LENGTH 1
-
-#define PATH_MAX_EXT_NAME_LENGTH (PATH_MAX_FILE_NAME_LENGTH - 1)
-
-#elif defined(PLATFORM_MACOS)
-
-#define MAX_PATH_LENGTH 1024
-
-// TODO: Verify all the value bellow (I just assumed they were the same as Linux)
-
-#define PATH_DISK_NAME_LENGTH 2
-#define MAX_DIRECTORY_PATH_LENGTH MAX_PATH_LENGTH
-
-#define PATH_MAX_FOLDER_NAME_LENGTH 255
+#define MAX_PATH_LENGTH (PathCore::OsRules::MaxPathLength)
+#define PATH_DISK_NAME_LENGTH (PathCore::OsRules::DiskNameLength)
+#define MAX_DIRECTORY_PATH_LENGTH (PathCore::OsRules::MaxDirectoryPathLength)
+#define PATH_MAX_FOLDER_NAME_LENGTH (PathCore::OsRules::MaxFolderNameLength)
 #define PATH_MIN_FOLDER_NAME_LENGTH 1
-
-#define PATH_MAX_FILE_NAME_LENGTH 255
+#define PATH_MAX_FILE_NAME_LENGTH (PathCore::OsRules::MaxFileNameLength)
 #define PATH_MIN_FILE_NAME_LENGTH 1
-
+/** Including the leading dot, eg: ".png" */
 #define PATH_MAX_EXT_NAME_LENGTH (PATH_MAX_FILE_NAME_LENGTH - 1)
 
-#else
-# error "Path limitations not defined for this platform"
-#endif
-
 #if USE_WIDE_CHAR == 1
 # define TEXT(x) L##x
 using TCHAR = wchar_t;
 #else
 # define TEXT(x) x
-using TCHAR = char
+using TCHAR = char;
 #endif
 
 namespace PathCore
 {
 	using SegmentSize = uint8_t;
 	using PathSize = uint16_t;
+	using StringView = std::basic_string_view<TCHAR>;
 
-#ifdef PLATFORM_LINUX
+	constexpr TCHAR WindowsSeparator = TEXT('\\');
+	constexpr TCHAR UnixSeparator = TEXT('/');
+	constexpr TCHAR LinuxSeparator = UnixSeparator;
+	constexpr TCHAR MacOsSeparator = UnixSeparator;
+#if defined(PLATFORM_WINDOWS)
+	constexpr TCHAR OsSeparator = WindowsSeparator;
+#else
+	constexpr TCHAR OsSeparator = UnixSeparator;
+#endif
+
+	constexpr bool IsSeparator(const TCHAR c) { return (c == WindowsSeparator || c == UnixSeparator); }
+
+	///////////////////////////////////////////////////////////////////////////
+	// PLATFORM RULES
+	///////////////////////////////////////////////////////////////////////////
+
+	/**
+	 * The characters of a PathBase on the heap, for the rules with long paths (4096 wchar_t is 16 KB, too big for the stacks
+	 * of the walkers and the recursive code that keep a path per level).
+	 * Never filled: only the characters up to the null terminator are written, and copied.
+	 * Never null either: a moved from buffer gets a new one (construction) or the one it was assigned to (assignment).
+	 */
 	// TODO: Some kind of SSO would be nice
-	class LinuxPathBuffer : public std::vector<TCHAR>
+	template<PathSize Capacity>
+	class HeapPathBuffer
 	{
 	public:
-		LinuxPathBuffer()
+		HeapPathBuffer()
+			: m_Characters(new TCHAR[Capacity + NULL_TERMINATOR_LENGTH])
 		{
-			this->resize(MAX_PATH_LENGTH + NULL_TERMINATOR_LENGTH, NULL);
+			m_Characters[0] = NULL;
+		}
+		HeapPathBuffer(const HeapPathBuffer& other)
+			: HeapPathBuffer()
+		{
+			operator=(other);
+		}
+		HeapPathBuffer(HeapPathBuffer&& other)
+			: m_Characters(std::move(other.m_Characters))
+		{
+			other.m_Characters.reset(new TCHAR[Capacity + NULL_TERMINATOR_LENGTH]);
+			other.m_Characters[0] = NULL;
 		}
 
-		void fill(const TCHAR character)
+		HeapPathBuffer& operator=(const HeapPathBuffer& other)
+		{
+			if (this == &other)
+				return (*this);
+			std::char_traits<TCHAR>::copy(m_Characters.get(), other.data(), std::char_traits<TCHAR>::length(other.data()) + NULL_TERMINATOR_LENGTH);
+			return (*this);
+		}
+		HeapPathBuffer& operator=(HeapPathBuffer&& other) noexcept
 		{
-			this->assign(MAX_PATH_LENGTH + NULL_TERMINATOR_LENGTH, character);
+			m_Characters.swap(other.m_Characters);
+			return (*this);
 		}
 
+	public:
+		TCHAR& operator[](size_t index) { return (m_Characters[index]); }
+		const TCHAR& operator[](size_t index) const { return (m_Characters[index]); }
+		TCHAR* data() { return (m_Characters.get()); }
+		const TCHAR* data() const { return (m_Characters.get()); }
+
+	private:
+		std::unique_ptr<TCHAR[]> m_Characters;
 	};
 
-	using PathBuffer = LinuxPathBuffer;
-#else
-	using PathBuffer = std::array<TCHAR, MAX_PATH_LENGTH + 1>;
-#endif
+	enum class PathRulesKind : uint8_t
+	{
+		Windows,
+		Posix,
+		MacOs
+	};
 
-	constexpr TCHAR WindowsSeparator = TEXT('\\');
-	constexpr TCHAR UnixSeparator = TEXT('/');
-	constexpr TCHAR LinuxSeparator = UnixSeparator;
-	constexpr TCHAR MacOsSeparator = UnixSeparator;
-#if defined(PLATFORM_WINDOWS)
-	constexpr TCHAR OsSeparator = WindowsSeparator;
-#else
-	constexpr TCHAR OsSeparator = UnixSeparator;
-#endif
+	/**
+	 * The naming rules of Windows paths, eg: "C:\FolderName1\Image.png"
+	 * More details here: https://learn.microsoft.com/en-us/windows/win32/fileio/naming-a-file
+	 */
+	struct WindowsRules
+	{
+		static constexpr PathRulesKind Kind = PathRulesKind::Windows;
+
+		/* "C:/FolderName1/Foldername2/Image.png" <= MaxPathLength characters */
+		static constexpr PathSize MaxPathLength = 259;
+		/* "C:", the trailing separator is not counted. Every path starts with a disk */
+		static constexpr PathSize DiskNameLength = 2;
+		/**
+		 * "C:/FolderName1/Foldername2" <= MaxDirectoryPathLength characters
+		 * "12" because of backward compatibility with 8.3 file names, the null terminator is already out of MaxPathLength
+		 */
+		static constexpr PathSize MaxDirectoryPathLength = MaxPathLength - 12;
+		static constexpr PathSize MaxFolderNameLength = MaxDirectoryPathLength - (DiskNameLength + PATH_SEPARATOR_LENGTH);
+		/* I added 1 but I dont know what it stand for, I just know that it is needed */
+		static constexpr PathSize MaxFileNameLength = MaxPathLength - (DiskNameLength + PATH_SEPARATOR_LENGTH + 1);
+
+		/* The characters a segment cannot contain, the separators aside */
+		static constexpr std::array<char, 7> ReservedChars = { ':', '*', '?', '"', '<', '>', '|' };
+
+		using Buffer = std::array<TCHAR, MaxPathLength + NULL_TERMINATOR_LENGTH>;
+	};
 
-#if defined(PLATFORM_WINDOWS)
-	constexpr std::array<TCHAR, 9> InvalidFolderNameChars = {
-		WindowsSeparator, TEXT('/'), TEXT(':'), TEXT('*'), TEXT('?'), TEXT('"'), TEXT('<'), TEXT('>'), TEXT('|')
+	/**
+	 * The naming rules of Linux paths: no disk, absolute paths start with a separator (eg: "/home/Image.png"), the others are relative.
+	 * The limits are PATH_MAX (4096, the null terminator included) and NAME_MAX of <linux/limits.h>.
+	 * The kernel counts bytes: a path of non ASCII characters reaches it before MaxPathLength wide characters.
+	 */
+	struct PosixRules
+	{
+		static constexpr PathRulesKind Kind = PathRulesKind::Posix;
+
+		static constexpr PathSize MaxPathLength = 4095;
+		static constexpr PathSize DiskNameLength = 0;
+		/* No shorter limit for the directories */
+		static constexpr PathSize MaxDirectoryPathLength = MaxPathLength;
+		static constexpr PathSize MaxFolderNameLength = 255;
+		static constexpr PathSize MaxFileNameLength = 255;
+
+		static constexpr std::array<char, 0> ReservedChars = {};
+
+		/* Too big for the stack of every path */
+		using Buffer = HeapPathBuffer<MaxPathLength>;
+	};
+
+	/**
+	 * The rules of MacOS paths, the Posix ones with a shorter limit and ':' reserved by the Finder.
+	 * The limits are PATH_MAX (1024, the null terminator included) and NAME_MAX (255) of <sys/syslimits.h>, there is no disk.
+	 */
+	struct MacOsRules
+	{
+		static constexpr PathRulesKind Kind = PathRulesKind::MacOs;
+
+		static constexpr PathSize MaxPathLength = 1023;
+		static constexpr PathSize DiskNameLength = 0;
+		static constexpr PathSize MaxDirectoryPathLength = MaxPathLength;
+		static constexpr PathSize MaxFolderNameLength = 255;
+		static constexpr PathSize MaxFileNameLength = 255;
+
+		static constexpr std::array<char, 1> ReservedChars = { ':' };
+
+		using Buffer = std::array<TCHAR, MaxPathLength + NULL_TERMINATOR_LENGTH>;
 	};
+
+	/* The rules of the platform the code is built for, the default of every PathBase */
+#if defined(PLATFORM_WINDOWS)
+	using OsRules = WindowsRules;
 #elif defined(PLATFORM_LINUX)
-	constexpr std::array<TCHAR, 1> InvalidFolderNameChars = { UnixSeparator };
+	using OsRules = PosixRules;
 #elif defined(PLATFORM_MACOS)
-	constexpr std::array<TCHAR, 2> InvalidFolderNameChars = { UnixSeparator, TEXT(':') };
+	using OsRules = MacOsRules;
 #else
-# error "Invalid folder name chars not defined for this platform"
+# error "Path rules not defined for this platform"
 #endif
+	constexpr PathRulesKind OsRulesKind = OsRules::Kind;
 
-	constexpr bool IsSeparator(const TCHAR c) { return (c == WindowsSeparator || c == UnixSeparator); }
-	bool IsAValidFolderNameChar(const TCHAR character);
+	/* Longest path of all the rules, for the buffers that can receive a path of any platform */
+	constexpr PathSize MaxPathLengthOfAllRules = PosixRules::MaxPathLength;
+	static_assert(MaxPathLengthOfAllRules >= WindowsRules::MaxPathLength && MaxPathLengthOfAllRules >= MacOsRules::MaxPathLength);
+
+	/**
+	 * @brief One entry per ASCII character, false for the separators and the reserved characters of Rules
+	 * @note Built at compile time, a character is checked with one load instead of a loop over the reserved characters
+	 */
+	template<typename Rules>
+	constexpr std::array<bool, 128> MakeNameCharTable()
+	{
+		std::array<bool, 128> table = {};
+		for (size_t character = 0; character < table.size(); character++)
+			table[character] = IsSeparator(static_cast<TCHAR>(character)) == false;
+		for (char reserved : Rules::ReservedChars)
+			table[static_cast<size_t>(reserved)] = false;
+		return (table);
+	}
+
+	template<typename Rules>
+	inline constexpr std::array<bool, 128> NameCharTable = MakeNameCharTable<Rules>();
+
+	/* Branchless: the units above ASCII are always valid (they are never reserved), the others are looked up */
+	template<typename Rules>
+	constexpr bool IsValidNameChar(const TCHAR character)
+	{
+		auto unit = static_cast<std::make_unsigned_t<TCHAR>>(character);
+		return ((unit > 0x7F) | NameCharTable<Rules>[unit & 0x7F]);
+	}
+
+	/**
+	 * @brief Whether the size characters of name can be a segment, separators are invalid
+	 * @note No early exit, every character is checked the same way so the loop can be vectorized
+	 */
+	template<typename Rules>
+	constexpr bool IsValidName(const TCHAR* name, size_t size)
+	{
+		bool valid = true;
+		for (size_t index = 0; index < size; index++)
+			valid &= IsValidNameChar<Rules>(name[index]);
+		return (valid);
+	}
+
+	/**
+	 * @brief The rules a raw path was written with, found from its root: a disk ("C:/" or "c:/") is Windows,
+	 *        a leading '/' is Posix (MacOs when that is the fallback)
+	 * @return fallback for the relative paths, they can be either
+	 */
+	template<typename CharType>
+	constexpr PathRulesKind DetectPathRules(const CharType* rawPath, size_t size, PathRulesKind fallback)
+	{
+		if (size >= WindowsRules::DiskNameLength && ((rawPath[0] >= 'A' && rawPath[0] <= 'Z') || (rawPath[0] >= 'a' && rawPath[0] <= 'z')) && rawPath[1] == ':'
+			&& (size == WindowsRules::DiskNameLength || rawPath[2] == '/' || rawPath[2] == '\\'))
+			return (PathRulesKind::Windows);
+		if (size > 0 && rawPath[0] == '/')
+			return (fallback == PathRulesKind::MacOs ? PathRulesKind::MacOs : PathRulesKind::Posix);
+		return (fallback);
+	}
+
+	/**
+	 * @brief Call visitor with WindowsRules, PosixRules or MacOsRules, so the code it runs is specialized for the rules picked at runtime
+	 * @example VisitPathRules(kind, [&](auto rules) { return (IsValidName<decltype(rules)>(name, size)); });
+	 */
+	template<typename Visitor>
+	decltype(auto) VisitPathRules(PathRulesKind kind, Visitor&& visitor)
+	{
+		if (kind == PathRulesKind::Windows)
+			return (visitor(WindowsRules()));
+		if (kind == PathRulesKind::MacOs)
+			return (visitor(MacOsRules()));
+		return (visitor(PosixRules()));
+	}
+
+	/* The checks of the platform the code is built for */
+	constexpr bool IsAValidFolderNameChar(const TCHAR character) { return (IsValidNameChar<OsRules>(character)); }
 	SegmentSize IsFolderSegmentValid(const TCHAR* segmentStart);
 	SegmentSize IsFolderSegmentValid(const TCHAR* segmentStart, PathSize size);
 	bool IsDiskNameValid(const TCHAR* segmentStart);
 
+	/**
+	 * Where the file name (last segment) and its extension start in a path.
+	 * eg: "C:/Folder/Image.png" Name is 10 ("Image.png") and Extension is 15 (".png")
+	 */
+	struct FileNameOffsets
+	{
+		PathSize Name;
+		/* The last dot of the file name, the size of the path when there is no extension (eg: "Makefile", ".gitignore") */
+		PathSize Extension;
+	};
+
+	/* Scan the last segment backward, it never reads more than PATH_MAX_FILE_NAME_LENGTH characters */
+	FileNameOffsets FindFileNameOffsets(const TCHAR* data, PathSize size);
+
 	template<TCHAR c>
 	class IsSeparatorClass
 	{
@@ -175,7 +321,8 @@ namespace PathCore
 
 	// Forward declaration for iterators
 	class IPath;
-	template<TCHAR>
+	class IMutablePath;
+	template<TCHAR Separator, typename Rules>
 	class PathBase;
 
 	/**
@@ -360,7 +507,7 @@ namespace PathCore
 		void Rename(const TCHAR* rawPata);
 		void Swap(const SegmentIterator& withSegment);
 
-		template<TCHAR>
+		template<TCHAR, typename>
 		friend class PathBase;
 	};
 
@@ -379,38 +526,90 @@ namespace PathCore
 		ConstSegmentIterator BeginSegment() const { return (ConstSegmentIterator(this, 0)); }
 		ConstSegmentIterator EndSegment() const { return (ConstSegmentIterator(this, Size())); }
 
+	public:
+		/* The last segment, eg: "Image.png" in "C:/Folder/Image.png" */
+		StringView FileName() const
+		{
+			FileNameOffsets offsets = NameOffsets();
+			return (StringView(Data() + offsets.Name, Size() - offsets.Name));
+		}
+		/* The last segment without its extension, eg: "Image" in "C:/Folder/Image.png" */
+		StringView Stem() const
+		{
+			FileNameOffsets offsets = NameOffsets();
+			return (StringView(Data() + offsets.Name, offsets.Extension - offsets.Name));
+		}
+		/* The extension with its dot, eg: ".png" in "C:/Folder/Image.png", empty when there is none */
+		StringView Extension() const
+		{
+			FileNameOffsets offsets = NameOffsets();
+			return (StringView(Data() + offsets.Extension, Size() - offsets.Extension));
+		}
+
 	public:
 		virtual const TCHAR* Data() const = 0;
 		virtual PathSize Size() const = 0;
+		/* Stored by the paths that cannot change (StaticPath), found by scanning the last segment otherwise */
+		virtual FileNameOffsets NameOffsets() const { return (FindFileNameOffsets(Data(), Size())); }
+	};
+
+	/**
+	 * @brief The characters of the root anchor of path, its separator included. The rest of the path is relative to it
+	 * @example "C:/Folder" is 3, "/home" is 1, "src/Main.cpp" is 0 (a relative Posix path has no anchor)
+	 */
+	template<typename Rules = OsRules>
+	PathSize RootAnchorLength(const IPath& path)
+	{
+		if constexpr (Rules::DiskNameLength > 0)
+			return (static_cast<PathSize>(path.BeginSegment().Size() + PATH_SEPARATOR_LENGTH));
+		else
+			return (path.Size() > 0 && IsSeparator(path[0]) ? PATH_SEPARATOR_LENGTH : 0);
+	}
+
+	/**
+	 * The buffer of a PathBase, whatever its separator and rules, for the iterators that change it in place.
+	 */
+	class IMutablePath : public IPath
+	{
+	protected:
+		virtual TCHAR* MutableData() = 0;
+		/* Only the size, the null terminator is written by the caller */
+		virtual void SetSize(PathSize size) = 0;
+
+		friend SegmentIterator;
 	};
 
 	/**
 	 * The base class for all the Path that are meant to be manipulated.
 	 *
 	 * \tparam Separator The separator char that will be used to split the path into segments ('/' or '\\')
+	 * \tparam Rules The platform rules the path is checked against (WindowsRules, PosixRules, ...)
 	 *
 	 * This class will:
-	 * - Create a buffer of MAX_PATH_SIZE. (To allow fast manipulation)
+	 * - Create a buffer of Rules::MaxPathLength. (To allow fast manipulation)
 	 * - Check whether or not your path is valid.
 	 *
 	 * IMPORTANT: Once your path is finished please convert it to a StaticPath for long term storage.
 	 */
-	template<TCHAR Separator = OsSeparator>
-	class PathBase : public IPath, private IsSeparatorClass<Separator>
+	template<TCHAR Separator = OsSeparator, typename Rules = OsRules>
+	class PathBase : public IMutablePath, private IsSeparatorClass<Separator>
 	{
 	public:
 		PathBase()
 		{
 			Clear();
 		}
-		PathBase(const PathBase<Separator>& other)
+		PathBase(const PathBase<Separator, Rules>& other)
 			: m_Path(other.m_Path),
 			m_Size(other.m_Size)
 		{}
-		PathBase(PathBase<Separator>&& other)
+		/* other is left empty */
+		PathBase(PathBase<Separator, Rules>&& other)
 			: m_Path(std::move(other.m_Path)),
-			m_Size(std::move(other.m_Size))
-		{}
+			m_Size(other.m_Size)
+		{
+			other.Clear();
+		}
 		PathBase(const TCHAR* rawPath)
 			: PathBase(nullptr, rawPath)
 		{}
@@ -420,18 +619,18 @@ namespace PathCore
 	public:
 		operator bool() const { return (IsValid()); }
 
-		PathBase<Separator>& operator=(const PathBase<Separator>& other);
-		PathBase<Separator>& operator=(PathBase<Separator>&& other) noexcept;
+		PathBase<Separator, Rules>& operator=(const PathBase<Separator, Rules>& other);
+		PathBase<Separator, Rules>& operator=(PathBase<Separator, Rules>&& other) noexcept;
 
-		PathBase<Separator>& operator+=(const TCHAR* rawPath);
-		PathBase<Separator>& operator+=(const ConstSegmentIterator& segment);
-		PathBase<Separator>& operator/=(const TCHAR* rawPath) { return (operator+=(rawPath)); }
-		PathBase<Separator>& operator/=(const ConstSegmentIterator& segment) { return (operator+=(segment)); }
+		PathBase<Separator, Rules>& operator+=(const TCHAR* rawPath);
+		PathBase<Separator, Rules>& operator+=(const ConstSegmentIterator& segment);
+		PathBase<Separator, Rules>& operator/=(const TCHAR* rawPath) { return (operator+=(rawPath)); }
+		PathBase<Separator, Rules>& operator/=(const ConstSegmentIterator& segment) { return (operator+=(segment)); }
 
-		PathBase<Separator> operator+(const TCHAR* rawPath) const;
-		PathBase<Separator> operator+(const ConstSegmentIterator& segment) const;
-		PathBase<Separator> operator/(const TCHAR* rawPath) const { return (operator+(rawPath)); }
-		PathBase<Separator> operator/(const ConstSegmentIterator& segment) const { return (operator+(segment)); }
+		PathBase<Separator, Rules> operator+(const TCHAR* rawPath) const;
+		PathBase<Separator, Rules> operator+(const ConstSegmentIterator& segment) const;
+		PathBase<Separator, Rules> operator/(const TCHAR* rawPath) const { return (operator+(rawPath)); }
+		PathBase<Separator, Rules> operator/(const ConstSegmentIterator& segment) const { return (operator+(segment)); }
 
 	public:
 		//~ Begin IPath Interface
@@ -439,6 +638,12 @@ namespace PathCore
 		PathSize Size() const override { return (m_Size); }
 		//~ End IPath Interface
 
+	protected:
+		//~ Begin IMutablePath Interface
+		TCHAR* MutableData() override { return (m_Path.data()); }
+		void SetSize(PathSize size) override { m_Size = size; }
+		//~ End IMutablePath Interface
+
 	public:
 		SegmentIterator BeginSegment() { return (SegmentIterator(this, 0)); }
 		SegmentIterator EndSegment() { return (SegmentIterator(this, Size())); }
@@ -457,10 +662,15 @@ namespace PathCore
 			toSegment = EndSegment();
 		}
 		void Insert(const ConstSegmentIterator& whereSegment, ConstSegmentIterator fromSegment, const ConstSegmentIterator& toSegment);
+		/**
+		 * @brief Replace the extension of the last segment, or add one when it has none
+		 * @param extension With or without its dot (".png" or "png"), empty to remove the extension
+		 */
+		void ReplaceExtension(const TCHAR* extension);
 		void Clear();
 
 	private:
-		PathBuffer m_Path;
+		typename Rules::Buffer m_Path;
 		PathSize m_Size;
 
 		friend class StaticPathBase;
@@ -491,11 +701,124 @@ namespace PathCore
 		//~ Begin IPath Interface
 		const TCHAR* Data() const override { return (m_Path.data()); }
 		PathSize Size() const override { return (m_Path.size() - NULL_TERMINATOR_LENGTH); }
+		FileNameOffsets NameOffsets() const override { return (m_NameOffsets); }
 		//~ End IPath Interface
 
 	private:
 		std::vector<TCHAR> m_Path;
+		/* Found once at construction, the characters never change after */
+		FileNameOffsets m_NameOffsets = {};
 	};
+
+	/**
+	 * An immutable path shared between its copies, for the paths that are passed around (queues, caches, results).
+	 *
+	 * This class will:
+	 * - Store a small header (reference count, size) and the characters in one allocation. (on the HEAP)
+	 * - Only bump an atomic reference count on a copy, the characters are never copied again.
+	 * - Copy on write: Assign() and MutableData() never change what the other copies see.
+	 * - Check if the path is valid. (DEBUG only)
+	 *
+	 * The copies can be used and released from any thread, a single SharedPathBase object cannot be written by two threads.
+	 */
+	class SharedPathBase : public IPath
+	{
+	public:
+		SharedPathBase()
+			: m_Header(nullptr)
+		{}
+		SharedPathBase(const IPath& path);
+
+		template<TCHAR Separator = OsSeparator>
+		SharedPathBase(const TCHAR* rawPath);
+
+		SharedPathBase(const SharedPathBase& other) noexcept;
+		SharedPathBase(SharedPathBase&& other) noexcept;
+		~SharedPathBase();
+
+		SharedPathBase& operator=(const SharedPathBase& other) noexcept;
+		SharedPathBase& operator=(SharedPathBase&& other) noexcept;
+
+	public:
+		//~ Begin IPath Interface
+		const TCHAR* Data() const override;
+		PathSize Size() const override { return (m_Header ? m_Header->Size : 0); }
+		//~ End IPath Interface
+
+	public:
+		/* The amount of SharedPathBase sharing the characters, 0 for an empty path */
+		uint32_t UseCount() const;
+
+		/**
+		 * @brief Replace the characters by the ones of path
+		 * @note Written in place when no other copy shares them and they fit, a new allocation otherwise
+		 */
+		void Assign(const IPath& path);
+
+		/**
+		 * @brief The characters, made private to this copy first if they are shared
+		 * @note Only change characters, not the size (eg: swap the separators)
+		 */
+		TCHAR* MutableData();
+
+	private:
+		struct Header
+		{
+			std::atomic<uint32_t> References;
+			PathSize Size;
+			/* Characters the allocation can hold, the null terminator aside */
+			PathSize Capacity;
+		};
+
+		static Header* Allocate(const TCHAR* data, PathSize size);
+		void Release();
+		TCHAR* Characters() const { return (reinterpret_cast<TCHAR*>(m_Header + 1)); }
+
+	private:
+		Header* m_Header;
+	};
+
+	/**
+	 * A read only view over a path owned by someone else (an arena, another path, ...).
+	 *
+	 * This class will:
+	 * - Never allocate, copying a view only copies a pointer and a size.
+	 * - Trust the viewed data, no validity check is done.
+	 *
+	 * IMPORTANT: The viewed data must be null terminated and must outlive the view.
+	 */
+	class PathView : public IPath
+	{
+	public:
+		PathView()
+			: m_Data(nullptr),
+			m_Size(0)
+		{}
+		PathView(const TCHAR* data, PathSize size)
+			: m_Data(data),
+			m_Size(size)
+		{}
+		PathView(const IPath& path)
+			: m_Data(path.Data()),
+			m_Size(path.Size())
+		{}
+
+	public:
+		//~ Begin IPath Interface
+		const TCHAR* Data() const override { return (m_Data); }
+		PathSize Size() const override { return (m_Size); }
+		//~ End IPath Interface
+
+	private:
+		const TCHAR* m_Data;
+		PathSize m_Size;
+	};
+
+	/**
+	 * @brief Write the path as UTF-8
+	 * @note To write many paths, PathWriter buffers and writes them in big blocks
+	 */
+	std::ostream& operator<<(std::ostream& os, const IPath& path);
 }
 
 using Path = PathCore::PathBase<PathCore::OsSeparator>;
@@ -503,8 +826,13 @@ using UnixPath = PathCore::PathBase<PathCore::UnixSeparator>;
 using WindowsPath = PathCore::PathBase<PathCore::WindowsSeparator>;
 using LinuxPath = UnixPath;
 using MacPath = UnixPath;
+/* The paths of a given platform, whatever the platform the code is built for (eg: the lines of a manifest written on another OS) */
+using WindowsRulesPath = PathCore::PathBase<PathCore::WindowsSeparator, PathCore::WindowsRules>;
+using PosixRulesPath = PathCore::PathBase<PathCore::UnixSeparator, PathCore::PosixRules>;
 
 using ConstPathSegmentIterator = PathCore::ConstSegmentIterator;
 using PathSegmentIterator = PathCore::SegmentIterator;
 
 using StaticPath = PathCore::StaticPathBase;
+using SharedPath = PathCore::SharedPathBase;
+using PathView = PathCore::PathView;
@@ -0,0 +1,78 @@
+#include "Benchmarks.h"
+#include "AllocationProfiler.h"
+#include "Path.h"
+
+#include <type_traits>
+
+using namespace PathCore;
+
+namespace
+{
+	/* The buffer of a PathBase is on the heap with the Posix rules (see HeapPathBuffer) */
+	constexpr uint64_t PathBufferAllocations = std::is_same_v<OsRules::Buffer, HeapPathBuffer<OsRules::MaxPathLength>> ? 1 : 0;
+
+	/**
+	 * @brief Run operation in a budget, and write what it allocated as a JSON line
+	 * @note The budget is asserted, an operation that starts allocating more stops the benchmarks in debug
+	 */
+	template<typename Operation>
+	void MeasureOperation(const char* name, uint64_t maxAllocations, Operation&& operation)
+	{
+		AllocationBudget budget(maxAllocations);
+		operation();
+		// Written before the budget is checked, to see what went over
+		AllocationStats stats = budget.Stats();
+		WriteAllocationJson(std::cout, name, stats);
+		std::cout.flush();
+	}
+}
+
+void BenchmarkPathAllocations()
+{
+	std::cout << "PathAllocations: allocations of one call of every PathBase operation"
+		<< (PATH_ALLOCATION_PROFILER ? "" : " (built without PATH_ALLOCATION_PROFILER, nothing is counted)") << std::endl;
+
+	const TCHAR* rawPath = TEXT("C:/Projects/PathClass/Source/Path.cpp");
+	const TCHAR* rawDirectory = TEXT("C:/Projects/PathClass/Intermediate");
+	Path path(rawPath);
+	Path directory(rawDirectory);
+	StaticPath staticPath(path);
+
+	MeasureOperation("Path(const TCHAR*)", PathBufferAllocations, [&]() { Path constructed(rawPath); });
+	MeasureOperation("Path(const Path&)", PathBufferAllocations, [&]() { Path copy(path); });
+	MeasureOperation("Path::operator=(const Path&)", 0, [&]() { directory = path; });
+	MeasureOperation("StaticPath(const IPath&)", 1, [&]() { StaticPath copy(path); });
+	MeasureOperation("SharedPath(const IPath&)", 1, [&]() { SharedPath shared(path); });
+	SharedPath sharedPath(path);
+	MeasureOperation("SharedPath(const SharedPath&)", 0, [&]() { SharedPath copy(sharedPath); });
+
+	MeasureOperation("Path::Append(const TCHAR*)", 0, [&]() { path.Append(TEXT("Backup")); });
+	MeasureOperation("Path::Shrink", 0, [&]()
+	{
+		SegmentIterator last = path.EndSegment();
+		--last;
+		path.Shrink(last);
+	});
+	MeasureOperation("Path::Append(from, to)", 0, [&]()
+	{
+		ConstSegmentIterator from = staticPath.BeginSegment();
+		++from;
+		path.Append(from, staticPath.EndSegment());
+	});
+	MeasureOperation("Path::Insert", 0, [&]()
+	{
+		SegmentIterator where = path.BeginSegment();
+		++where;
+		ConstSegmentIterator from = directory.BeginSegment();
+		++from;
+		path.Insert(where, from, directory.EndSegment());
+	});
+	MeasureOperation("SegmentIterator::Rename", 0, [&]()
+	{
+		SegmentIterator segment = path.BeginSegment();
+		++segment;
+		segment.Rename(TEXT("RenamedFolder"));
+	});
+	MeasureOperation("Path::ReplaceExtension", 0, [&]() { path.ReplaceExtension(TEXT(".bak")); });
+	MeasureOperation("Path::Clear", 0, [&]() { path.Clear(); });
+}
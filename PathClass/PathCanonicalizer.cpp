@@ -0,0 +1,238 @@
+#include "PathCanonicalizer.h"
+
+#ifndef PLATFORM_WINDOWS
+
+#include "PathEncoding.h"
+
+#include <cerrno>
+
+#include <sys/stat.h>
+
+namespace PathCore
+{
+	namespace
+	{
+		bool IsDot(const ConstSegmentIterator& segment)
+		{
+			return (segment.Size() == 1 && (*segment)[0] == TEXT('.'));
+		}
+
+		bool IsDotDot(const ConstSegmentIterator& segment)
+		{
+			return (segment.Size() == 2 && (*segment)[0] == TEXT('.') && (*segment)[1] == TEXT('.'));
+		}
+
+		/* Remove the last segment, the root anchor is never removed ("/.." is "/", "src/.." is empty) */
+		void ShrinkToParent(Path& resolved)
+		{
+			if (resolved.Size() <= RootAnchorLength(resolved))
+				return;
+			SegmentIterator last = resolved.EndSegment();
+			--last;
+			resolved.Shrink(last);
+		}
+
+		/**
+		 * @brief Decode a link target to out
+		 * @return false if the target is not valid UTF-8
+		 */
+		bool DecodeTarget(const char* target, size_t size, TCHAR* out, PathSize& outSize)
+		{
+			size_t written;
+			if (DecodeUtf8(target, size, out, MAX_PATH_LENGTH, written) == false)
+				return (false);
+			out[written] = NULL;
+			outSize = static_cast<PathSize>(written);
+			return (true);
+		}
+	}
+
+	PathCanonicalizer::PathCanonicalizer(const PathCanonicalizerOptions& options)
+		: m_Options(options),
+		m_Directories(options.RootDirectory, options.FdBudget),
+		m_Prefixes(options.Capacity),
+		m_Paths(0),
+		m_PrefixHits(0),
+		m_Lstats(0),
+		m_Readlinks(0),
+		m_Errors(0)
+	{}
+
+	bool PathCanonicalizer::Canonicalize(Path& path)
+	{
+		m_Paths.fetch_add(1, std::memory_order_relaxed);
+		const TCHAR* data = path.Data();
+
+		// Reused by the calls of a thread, a Path is a large buffer
+		thread_local Path resolved;
+		thread_local Path pending;
+		resolved.Clear();
+
+		// Start from the deepest memoized prefix, walking the input from its end
+		PathSize anchorLength = RootAnchorLength(path);
+		ConstSegmentIterator originalNext = path.EndSegment();
+		while (true)
+		{
+			ConstSegmentIterator prefixEnd = originalNext;
+			if (originalNext.Pos() > 0)
+				--prefixEnd;
+			if (originalNext.Pos() == 0 || prefixEnd.Pos() < anchorLength)
+			{
+				// Nothing memoized, start from the root anchor (a relative path has none, its first segment is resolved too)
+				originalNext = path.BeginSegment();
+				if (anchorLength > 0)
+				{
+					resolved.Append(path.BeginSegment());
+					++originalNext;
+				}
+				break;
+			}
+
+			StaticPath cached;
+			PathSize prefixSize = (originalNext == path.Size()) ? path.Size() : originalNext.Pos() - PATH_SEPARATOR_LENGTH;
+			if (m_Prefixes.Find(data, prefixSize, cached))
+			{
+				resolved.Append(cached.BeginSegment(), cached.EndSegment());
+				m_PrefixHits.fetch_add(1, std::memory_order_relaxed);
+				break;
+			}
+			originalNext = prefixEnd;
+		}
+
+		// Segments of link targets still to resolve, they come before the rest of the input (pending starts consumed)
+		ConstSegmentIterator pendingNext = pending.EndSegment();
+		unsigned int followedLinks = 0;
+		TCHAR target[MAX_PATH_LENGTH + NULL_TERMINATOR_LENGTH];
+		char narrowTarget[MaxUtf8Size(MAX_PATH_LENGTH) + NULL_TERMINATOR_LENGTH];
+
+		while (pendingNext || originalNext)
+		{
+			bool fromInput = !pendingNext;
+			ConstSegmentIterator segment = fromInput ? originalNext : pendingNext;
+			if (fromInput)
+				++originalNext;
+			else
+				++pendingNext;
+
+			if (segment.Size() == 0 || IsDot(segment))
+				continue;
+			if (IsDotDot(segment))
+			{
+				ShrinkToParent(resolved);
+				continue;
+			}
+
+			resolved.Append(segment);
+			bool isLast = !pendingNext && !originalNext;
+
+			struct stat status;
+			m_Lstats.fetch_add(1, std::memory_order_relaxed);
+			if (m_Directories.Stat(resolved, status, AT_SYMLINK_NOFOLLOW) != 0)
+			{
+				m_Errors.fetch_add(1, std::memory_order_relaxed);
+				return (false);
+			}
+
+			if (S_ISLNK(status.st_mode))
+			{
+				if (++followedLinks > m_Options.MaxSymlinks)
+				{
+					errno = ELOOP;
+					m_Errors.fetch_add(1, std::memory_order_relaxed);
+					return (false);
+				}
+
+				m_Readlinks.fetch_add(1, std::memory_order_relaxed);
+				ssize_t targetSize = m_Directories.ReadLink(resolved, narrowTarget, sizeof(narrowTarget));
+				PathSize decodedSize;
+				if (targetSize <= 0 || static_cast<size_t>(targetSize) >= sizeof(narrowTarget)
+					|| DecodeTarget(narrowTarget, targetSize, target, decodedSize) == false)
+				{
+					// readlink() set errno, or the target is empty, too long, or not valid UTF-8
+					if (targetSize == 0)
+						errno = EINVAL;
+					else if (targetSize > 0)
+						errno = static_cast<size_t>(targetSize) >= sizeof(narrowTarget) ? ENAMETOOLONG : EILSEQ;
+					m_Errors.fetch_add(1, std::memory_order_relaxed);
+					return (false);
+				}
+
+				if (pending.Size() + PATH_SEPARATOR_LENGTH + decodedSize > MAX_PATH_LENGTH)
+				{
+					errno = ENAMETOOLONG;
+					m_Errors.fetch_add(1, std::memory_order_relaxed);
+					return (false);
+				}
+
+				// The link is replaced by its target, resolved from the link's directory (or from the root anchor)
+				bool absolute = IsSeparator(target[0]);
+				ShrinkToParent(resolved);
+				if (absolute)
+				{
+					// Also from a relative path, the root anchor of the target maps to RootDirectory
+					resolved.Clear();
+					resolved.Append(TEXT("/"));
+				}
+				Splice(pending, pendingNext, PathView(target, decodedSize), absolute);
+				continue;
+			}
+
+			if (isLast == false && S_ISDIR(status.st_mode) == false)
+			{
+				errno = ENOTDIR;
+				m_Errors.fetch_add(1, std::memory_order_relaxed);
+				return (false);
+			}
+
+			// Once the links met on the way are fully resolved, resolved is the canonical form of the input consumed so far:
+			// after an input segment, or after the last segment of a link target (the input prefix that ends at the link)
+			if (!pendingNext && isLast == false)
+				m_Prefixes.Insert(PathView(data, originalNext.Pos() - PATH_SEPARATOR_LENGTH), StaticPath(resolved));
+		}
+
+		path = resolved;
+		return (true);
+	}
+
+	void PathCanonicalizer::Clear()
+	{
+		m_Prefixes.Clear();
+		m_Directories.Clear();
+	}
+
+	PathCanonicalizerStats PathCanonicalizer::Stats() const
+	{
+		PathCanonicalizerStats stats;
+		stats.Paths = m_Paths.load(std::memory_order_relaxed);
+		stats.PrefixHits = m_PrefixHits.load(std::memory_order_relaxed);
+		stats.Lstats = m_Lstats.load(std::memory_order_relaxed);
+		stats.Readlinks = m_Readlinks.load(std::memory_order_relaxed);
+		stats.Errors = m_Errors.load(std::memory_order_relaxed);
+		return (stats);
+	}
+
+	void PathCanonicalizer::Splice(Path& pending, ConstSegmentIterator& pendingNext, const IPath& target, bool absolute)
+	{
+		// The empty segment before the leading separator of an absolute target is not a segment to resolve
+		ConstSegmentIterator targetBegin = target.BeginSegment();
+		if (absolute)
+			++targetBegin;
+
+		if (!pendingNext)
+		{
+			// Nothing left from a previous link, start over
+			pending.Clear();
+			pending.Append(targetBegin, target.EndSegment());
+			pendingNext = pending.BeginSegment();
+			return;
+		}
+
+		// The consumed segments stay in front, the target segments start where the next segment was
+		PathSize targetPos = pendingNext.Pos();
+		pending.Insert(pendingNext, targetBegin, target.EndSegment());
+		pendingNext = pending.BeginSegment();
+		pendingNext = targetPos;
+	}
+}
+
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "DirectoryFdCache.h"
+#include "PathLRU.h"
+
+#ifndef PLATFORM_WINDOWS
+
+#include <atomic>
+
+namespace PathCore
+{
+	struct PathCanonicalizerOptions
+	{
+		/* The directory the root anchor of the paths (the empty segment of "/usr", relative paths have none) maps to, absolute link targets start there too */
+		const char* RootDirectory = "/";
+		/* Amount of resolved directories remembered */
+		size_t Capacity = 64 * 1024;
+		/* Links followed for one path before giving up with ELOOP, the same limit as the kernel */
+		unsigned int MaxSymlinks = 40;
+		/* Directory descriptors kept open to stat and read links relative to their parent */
+		size_t FdBudget = 256;
+	};
+
+	struct PathCanonicalizerStats
+	{
+		uint64_t Paths = 0;
+		/* Paths that started from a memoized prefix */
+		uint64_t PrefixHits = 0;
+		/* Segments that had to be asked to the file system */
+		uint64_t Lstats = 0;
+		uint64_t Readlinks = 0;
+		/* Paths that failed (missing segment, loop, ...) */
+		uint64_t Errors = 0;
+	};
+
+	/**
+	 * Resolve symbolic links, "." and ".." segments, like realpath(), but remember what was resolved.
+	 *
+	 * A path is resolved segment by segment: each segment is appended to the resolved prefix,
+	 * a link is replaced by its target (spliced in front of the segments left to resolve).
+	 * Every directory prefix of the input is memoized with its resolved form, so the paths below
+	 * the same linked directory only pay for the segments after the deepest memoized prefix.
+	 *
+	 * Thread safe. The memoized prefixes are trusted until Clear(), call it when links change.
+	 */
+	class PathCanonicalizer
+	{
+	public:
+		explicit PathCanonicalizer(const PathCanonicalizerOptions& options = PathCanonicalizerOptions());
+
+		PathCanonicalizer(const PathCanonicalizer&) = delete;
+		PathCanonicalizer& operator=(const PathCanonicalizer&) = delete;
+
+	public:
+		/**
+		 * @brief Replace path by its canonical form
+		 * @return false with errno set if a segment doesn't exist (ENOENT), isn't a directory (ENOTDIR),
+		 *         or if too many links were followed (ELOOP), path is left untouched
+		 */
+		bool Canonicalize(Path& path);
+
+		void Clear();
+
+	public:
+		PathCanonicalizerStats Stats() const;
+
+	private:
+		/* Append the segments of a link target in front of the segments left in pending */
+		static void Splice(Path& pending, ConstSegmentIterator& pendingNext, const IPath& target, bool absolute);
+
+	private:
+		PathCanonicalizerOptions m_Options;
+		DirectoryFdCache m_Directories;
+		/* Input prefix -> resolved prefix, directories only */
+		PathLRU<StaticPath> m_Prefixes;
+
+		std::atomic<uint64_t> m_Paths;
+		std::atomic<uint64_t> m_PrefixHits;
+		std::atomic<uint64_t> m_Lstats;
+		std::atomic<uint64_t> m_Readlinks;
+		std::atomic<uint64_t> m_Errors;
+	};
+}
+
+#endif
@@ -0,0 +1,158 @@
+#include "Benchmarks.h"
+#include "PathCanonicalizer.h"
+
+#ifndef PLATFORM_WINDOWS
+
+#include <climits>
+#include <cstdlib>
+#include <string>
+
+#include <fcntl.h>
+#include <ftw.h>
+#include <unistd.h>
+
+using namespace PathCore;
+
+namespace
+{
+	using String = std::basic_string<TCHAR>;
+
+	String ToString(const std::string& narrow) { return (String(narrow.begin(), narrow.end())); }
+
+	int RemoveEntry(const char* path, const struct stat*, int, struct FTW*) { return (remove(path)); }
+
+	struct LinkedTree
+	{
+		/* Absolute narrow paths through the links, what realpath() gets */
+		std::vector<std::string> Absolute;
+		/* The same files below the "/" root anchor */
+		std::vector<StaticPath> Paths;
+	};
+
+	/**
+	 * Real directories, and a directory of links to them (like a package store with versioned folders):
+	 * every file is reached through a link, then a few directories.
+	 * Returns false if the tree could not be created.
+	 */
+	bool CreateTree(const std::string& root, LinkedTree& tree)
+	{
+		const int packageCount = 16;
+		const int directoryCount = 8;
+		const int fileCount = 32;
+
+		if (mkdir((root + "/store").c_str(), 0755) != 0 || mkdir((root + "/links").c_str(), 0755) != 0)
+			return (false);
+
+		for (int package = 0; package < packageCount; package++)
+		{
+			std::string name = "package_" + std::to_string(package);
+			std::string real = "/store/" + name + "-1.0." + std::to_string(package);
+			if (mkdir((root + real).c_str(), 0755) != 0 || symlink(("../store/" + name + "-1.0." + std::to_string(package)).c_str(), (root + "/links/" + name).c_str()) != 0)
+				return (false);
+
+			for (int directory = 0; directory < directoryCount; directory++)
+			{
+				std::string subdirectory = "/source_" + std::to_string(directory);
+				if (mkdir((root + real + subdirectory).c_str(), 0755) != 0)
+					return (false);
+
+				for (int file = 0; file < fileCount; file++)
+				{
+					std::string fileName = subdirectory + "/file_" + std::to_string(file) + ".cpp";
+					int fd = open((root + real + fileName).c_str(), O_CREAT | O_WRONLY, 0644);
+					if (fd < 0)
+						return (false);
+					close(fd);
+
+					// Half of the paths take a detour through "..", realpath() has to resolve it too
+					std::string linked = "/links/" + name + (file % 2 ? "/./source_0/.." : "") + fileName;
+					tree.Absolute.push_back(root + linked);
+					tree.Paths.emplace_back(Path(ToString(linked).c_str()));
+				}
+			}
+		}
+		return (true);
+	}
+}
+
+void BenchmarkPathCanonicalizer()
+{
+	char rootTemplate[] = "/tmp/PathCanonicalizer.XXXXXX";
+	if (mkdtemp(rootTemplate) == nullptr)
+	{
+		std::cout << "PathCanonicalizer: could not create a temporary directory" << std::endl;
+		return;
+	}
+	// realpath() answers with the resolved root, the canonicalizer keeps the root anchor
+	char resolvedRoot[PATH_MAX];
+	std::string root = realpath(rootTemplate, resolvedRoot) ? resolvedRoot : rootTemplate;
+
+	LinkedTree tree;
+	if (CreateTree(root, tree))
+	{
+		const int passes = 5;
+		size_t calls = tree.Paths.size() * passes;
+
+		char resolved[PATH_MAX];
+		size_t realpathFailures = 0;
+		double realpathSeconds = MeasureSeconds([&]()
+		{
+			for (int pass = 0; pass < passes; pass++)
+			{
+				for (const std::string& absolute : tree.Absolute)
+					realpathFailures += (realpath(absolute.c_str(), resolved) == nullptr);
+			}
+		});
+
+		PathCanonicalizerOptions options;
+		options.RootDirectory = root.c_str();
+		PathCanonicalizer canonicalizer(options);
+		size_t failures = 0;
+		Path path;
+		double seconds = MeasureSeconds([&]()
+		{
+			for (int pass = 0; pass < passes; pass++)
+			{
+				for (const StaticPath& input : tree.Paths)
+				{
+					path = Path(input.Data());
+					failures += (canonicalizer.Canonicalize(path) == false);
+				}
+			}
+		});
+		PathCanonicalizerStats stats = canonicalizer.Stats();
+
+		// Both must agree on every path
+		size_t mismatches = 0;
+		for (size_t index = 0; index < tree.Paths.size(); index++)
+		{
+			path = Path(tree.Paths[index].Data());
+			if (canonicalizer.Canonicalize(path) == false || realpath(tree.Absolute[index].c_str(), resolved) == nullptr)
+			{
+				mismatches++;
+				continue;
+			}
+			String expected = ToString(std::string(resolved + root.size()));
+			mismatches += (String(path.Data(), path.Size()) != expected);
+		}
+
+		std::cout << "PathCanonicalizer: " << tree.Paths.size() << " files reached through links, " << passes << " passes" << std::endl;
+		std::cout << "\trealpath():   " << realpathSeconds * 1e9 / calls << " ns/path (" << realpathFailures << " failures)" << std::endl;
+		std::cout << "\tCanonicalize: " << seconds * 1e9 / calls << " ns/path (" << failures << " failures, "
+			<< stats.PrefixHits << " prefix hits, " << stats.Lstats << " lstat, " << stats.Readlinks << " readlink, "
+			<< mismatches << " mismatches with realpath)" << std::endl;
+	}
+	else
+		std::cout << "PathCanonicalizer: could not create the linked tree in " << root << std::endl;
+
+	nftw(root.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+#else
+
+void BenchmarkPathCanonicalizer()
+{
+	std::cout << "PathCanonicalizer: not available on this platform" << std::endl;
+}
+
+#endif
@@ -0,0 +1,391 @@
+#pragma once
+
+#include "Path.h"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+// ASCII runs are transcoded 16 characters at a time, SSE2 is always there on x86-64
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define PATH_ENCODING_SSE2 1
+#else
+# define PATH_ENCODING_SSE2 0
+#endif
+
+namespace PathCore
+{
+	/**
+	 * @brief Decode one UTF-8 code point and advance cursor past it
+	 * @return false if the sequence is malformed (overlong, truncated, surrogate or out of range)
+	 */
+	inline bool DecodeUtf8(const unsigned char*& cursor, const unsigned char* end, uint32_t& codePoint)
+	{
+		unsigned char lead = *cursor++;
+		if (lead < 0x80)
+		{
+			codePoint = lead;
+			return (true);
+		}
+
+		int continuationCount;
+		uint32_t minCodePoint;
+		if ((lead & 0xE0) == 0xC0)
+		{
+			continuationCount = 1;
+			minCodePoint = 0x80;
+			codePoint = lead & 0x1F;
+		}
+		else if ((lead & 0xF0) == 0xE0)
+		{
+			continuationCount = 2;
+			minCodePoint = 0x800;
+			codePoint = lead & 0x0F;
+		}
+		else if ((lead & 0xF8) == 0xF0)
+		{
+			continuationCount = 3;
+			minCodePoint = 0x10000;
+			codePoint = lead & 0x07;
+		}
+		else
+			return (false); // Stray continuation byte or invalid lead byte
+
+		if (end - cursor < continuationCount)
+			return (false);
+		for (int index = 0; index < continuationCount; index++)
+		{
+			if ((cursor[index] & 0xC0) != 0x80)
+				return (false);
+			codePoint = (codePoint << 6) | (cursor[index] & 0x3F);
+		}
+		cursor += continuationCount;
+
+		return (codePoint >= minCodePoint && codePoint <= 0x10FFFF && (codePoint < 0xD800 || codePoint > 0xDFFF));
+	}
+
+	/**
+	 * @brief Write a code point as one or more TCHAR (UTF-8, UTF-16 or UTF-32 depending on its size)
+	 * @return the amount of TCHAR written
+	 */
+	inline int EncodeCodePoint(uint32_t codePoint, TCHAR* out)
+	{
+		if constexpr (sizeof(TCHAR) == 1)
+		{
+			// Narrow paths are stored as UTF-8, the input already was
+			if (codePoint < 0x80)
+			{
+				out[0] = static_cast<TCHAR>(codePoint);
+				return (1);
+			}
+			else if (codePoint < 0x800)
+			{
+				out[0] = static_cast<TCHAR>(0xC0 | (codePoint >> 6));
+				out[1] = static_cast<TCHAR>(0x80 | (codePoint & 0x3F));
+				return (2);
+			}
+			else if (codePoint < 0x10000)
+			{
+				out[0] = static_cast<TCHAR>(0xE0 | (codePoint >> 12));
+				out[1] = static_cast<TCHAR>(0x80 | ((codePoint >> 6) & 0x3F));
+				out[2] = static_cast<TCHAR>(0x80 | (codePoint & 0x3F));
+				return (3);
+			}
+			out[0] = static_cast<TCHAR>(0xF0 | (codePoint >> 18));
+			out[1] = static_cast<TCHAR>(0x80 | ((codePoint >> 12) & 0x3F));
+			out[2] = static_cast<TCHAR>(0x80 | ((codePoint >> 6) & 0x3F));
+			out[3] = static_cast<TCHAR>(0x80 | (codePoint & 0x3F));
+			return (4);
+		}
+		else if constexpr (sizeof(TCHAR) == 2)
+		{
+			// UTF-16, code points outside of the BMP need a surrogate pair
+			if (codePoint < 0x10000)
+			{
+				out[0] = static_cast<TCHAR>(codePoint);
+				return (1);
+			}
+			codePoint -= 0x10000;
+			out[0] = static_cast<TCHAR>(0xD800 | (codePoint >> 10));
+			out[1] = static_cast<TCHAR>(0xDC00 | (codePoint & 0x3FF));
+			return (2);
+		}
+		else
+		{
+			out[0] = static_cast<TCHAR>(codePoint);
+			return (1);
+		}
+	}
+
+	/**
+	 * @brief Index of the first byte that is not ASCII
+	 * @return size if every byte is ASCII
+	 */
+	inline size_t FindNonAscii(const char* data, size_t size)
+	{
+		size_t index = 0;
+#if PATH_ENCODING_SSE2
+		for (; index + 16 <= size; index += 16)
+		{
+			int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index)));
+			if (mask != 0)
+			{
+				while ((mask & 1) == 0)
+				{
+					mask >>= 1;
+					index++;
+				}
+				return (index);
+			}
+		}
+#endif
+		while (index < size && static_cast<unsigned char>(data[index]) < 0x80)
+			index++;
+		return (index);
+	}
+
+	/**
+	 * @brief Check that data is well formed UTF-8, the byte level validation of a narrow path
+	 * @note ASCII runs are skipped 16 bytes at a time, only the other code points are decoded
+	 */
+	inline bool IsValidUtf8(const char* data, size_t size)
+	{
+		const unsigned char* cursor = reinterpret_cast<const unsigned char*>(data);
+		const unsigned char* end = cursor + size;
+		while (cursor < end)
+		{
+			cursor += FindNonAscii(reinterpret_cast<const char*>(cursor), end - cursor);
+			if (cursor == end)
+				break;
+
+			uint32_t codePoint;
+			if (DecodeUtf8(cursor, end, codePoint) == false)
+				return (false);
+		}
+		return (true);
+	}
+
+	/**
+	 * @brief Transcode UTF-8 to wchar_t (UTF-16 on Windows, UTF-32 elsewhere)
+	 * @param capacity The amount of wchar_t out can hold, the transcoding fails instead of going past it
+	 * @return false if data is not valid UTF-8 or does not fit in out
+	 * @note A code point never takes more wchar_t than UTF-8 bytes, size wchar_t are always enough
+	 */
+	inline bool Utf8ToWide(const char* data, size_t size, wchar_t* out, size_t capacity, size_t& outSize)
+	{
+		const unsigned char* cursor = reinterpret_cast<const unsigned char*>(data);
+		const unsigned char* end = cursor + size;
+		size_t written = 0;
+		while (cursor < end)
+		{
+#if PATH_ENCODING_SSE2
+			// Widen 16 bytes at once, zero extended to the size of wchar_t, and keep the ASCII run they start with
+			if (end - cursor >= 16 && written + 16 <= capacity)
+			{
+				__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+				int asciiRun = std::countr_zero(static_cast<unsigned int>(_mm_movemask_epi8(bytes)) | 0x10000u);
+				if (asciiRun > 0)
+				{
+					__m128i zero = _mm_setzero_si128();
+					__m128i low = _mm_unpacklo_epi8(bytes, zero);
+					__m128i high = _mm_unpackhi_epi8(bytes, zero);
+					__m128i* destination = reinterpret_cast<__m128i*>(out + written);
+					if constexpr (sizeof(wchar_t) == 2)
+					{
+						_mm_storeu_si128(destination, low);
+						_mm_storeu_si128(destination + 1, high);
+					}
+					else
+					{
+						_mm_storeu_si128(destination, _mm_unpacklo_epi16(low, zero));
+						_mm_storeu_si128(destination + 1, _mm_unpackhi_epi16(low, zero));
+						_mm_storeu_si128(destination + 2, _mm_unpacklo_epi16(high, zero));
+						_mm_storeu_si128(destination + 3, _mm_unpackhi_epi16(high, zero));
+					}
+					cursor += asciiRun;
+					written += asciiRun;
+					continue;
+				}
+			}
+#endif
+			if (*cursor < 0x80)
+			{
+				if (written == capacity)
+					return (false);
+				out[written++] = static_cast<wchar_t>(*cursor++);
+				continue;
+			}
+
+			uint32_t codePoint;
+			if (DecodeUtf8(cursor, end, codePoint) == false)
+				return (false);
+			if constexpr (sizeof(wchar_t) == 2)
+			{
+				if (codePoint >= 0x10000)
+				{
+					if (written + 2 > capacity)
+						return (false);
+					codePoint -= 0x10000;
+					out[written++] = static_cast<wchar_t>(0xD800 | (codePoint >> 10));
+					out[written++] = static_cast<wchar_t>(0xDC00 | (codePoint & 0x3FF));
+					continue;
+				}
+			}
+			if (written == capacity)
+				return (false);
+			out[written++] = static_cast<wchar_t>(codePoint);
+		}
+		outSize = written;
+		return (true);
+	}
+
+	/**
+	 * @brief The most bytes EncodeUtf8 can write for size characters (a code point never takes more than 4 bytes)
+	 */
+	constexpr size_t MaxUtf8Size(size_t size) { return (size * 4); }
+
+	/**
+	 * @brief Transcode wchar_t (UTF-16 on Windows, UTF-32 elsewhere) to UTF-8
+	 * @param out Must hold at least MaxUtf8Size(size) bytes, no null terminator is written
+	 * @return The number of bytes written
+	 * @note Lone UTF-16 surrogates are encoded as is, so a bad name still reaches the system untouched
+	 */
+	inline size_t WideToUtf8(const wchar_t* data, size_t size, char* out)
+	{
+		size_t written = 0;
+		size_t index = 0;
+		while (index < size)
+		{
+#if PATH_ENCODING_SSE2
+			// Narrow 16 characters at once and keep the ASCII run they start with, the packs are exact below 0x80.
+			// out has room for the 16 bytes: MaxUtf8Size(size) is never less than written + 4 bytes per character left
+			if (size - index >= 16)
+			{
+				const __m128i* source = reinterpret_cast<const __m128i*>(data + index);
+				__m128i zero = _mm_setzero_si128();
+				__m128i packed;
+				__m128i isAscii;
+				if constexpr (sizeof(wchar_t) == 2)
+				{
+					__m128i low = _mm_loadu_si128(source);
+					__m128i high = _mm_loadu_si128(source + 1);
+					__m128i mask = _mm_set1_epi16(static_cast<short>(0xFF80));
+					isAscii = _mm_packs_epi16(_mm_cmpeq_epi16(_mm_and_si128(low, mask), zero), _mm_cmpeq_epi16(_mm_and_si128(high, mask), zero));
+					packed = _mm_packus_epi16(low, high);
+				}
+				else
+				{
+					__m128i first = _mm_loadu_si128(source);
+					__m128i second = _mm_loadu_si128(source + 1);
+					__m128i third = _mm_loadu_si128(source + 2);
+					__m128i fourth = _mm_loadu_si128(source + 3);
+					__m128i mask = _mm_set1_epi32(~0x7F);
+					__m128i firstHalf = _mm_packs_epi32(_mm_cmpeq_epi32(_mm_and_si128(first, mask), zero), _mm_cmpeq_epi32(_mm_and_si128(second, mask), zero));
+					__m128i secondHalf = _mm_packs_epi32(_mm_cmpeq_epi32(_mm_and_si128(third, mask), zero), _mm_cmpeq_epi32(_mm_and_si128(fourth, mask), zero));
+					isAscii = _mm_packs_epi16(firstHalf, secondHalf);
+					packed = _mm_packus_epi16(_mm_packs_epi32(first, second), _mm_packs_epi32(third, fourth));
+				}
+				unsigned int nonAscii = ~static_cast<unsigned int>(_mm_movemask_epi8(isAscii)) & 0xFFFFu;
+				int asciiRun = std::countr_zero(nonAscii | 0x10000u);
+				if (asciiRun > 0)
+				{
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(out + written), packed);
+					index += asciiRun;
+					written += asciiRun;
+					continue;
+				}
+			}
+#endif
+			uint32_t codePoint = static_cast<uint32_t>(data[index++]);
+			if constexpr (sizeof(wchar_t) == 2)
+			{
+				if (codePoint >= 0xD800 && codePoint < 0xDC00 && index < size)
+				{
+					uint32_t low = static_cast<uint32_t>(data[index]);
+					if (low >= 0xDC00 && low < 0xE000)
+					{
+						codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+						index++;
+					}
+				}
+			}
+
+			if (codePoint < 0x80)
+				out[written++] = static_cast<char>(codePoint);
+			else if (codePoint < 0x800)
+			{
+				out[written++] = static_cast<char>(0xC0 | (codePoint >> 6));
+				out[written++] = static_cast<char>(0x80 | (codePoint & 0x3F));
+			}
+			else if (codePoint < 0x10000)
+			{
+				out[written++] = static_cast<char>(0xE0 | (codePoint >> 12));
+				out[written++] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+				out[written++] = static_cast<char>(0x80 | (codePoint & 0x3F));
+			}
+			else
+			{
+				out[written++] = static_cast<char>(0xF0 | (codePoint >> 18));
+				out[written++] = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+				out[written++] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+				out[written++] = static_cast<char>(0x80 | (codePoint & 0x3F));
+			}
+		}
+		return (written);
+	}
+
+	/**
+	 * @brief Encode characters to UTF-8, what the POSIX system calls expect
+	 * @param out Must hold at least MaxUtf8Size(size) bytes, no null terminator is written
+	 * @return The number of bytes written
+	 * @note Narrow paths already are UTF-8 and are copied as is
+	 */
+	inline size_t EncodeUtf8(const TCHAR* data, size_t size, char* out)
+	{
+		if constexpr (sizeof(TCHAR) == 1)
+		{
+			std::memcpy(out, data, size);
+			return (size);
+		}
+		else
+			return (WideToUtf8(reinterpret_cast<const wchar_t*>(data), size, out));
+	}
+
+	/**
+	 * @brief Decode UTF-8 to characters, what the POSIX system calls return
+	 * @param capacity The amount of TCHAR out can hold, no null terminator is written
+	 * @return false if data is not valid UTF-8 or does not fit in out
+	 * @note Narrow paths are validated and copied as is
+	 */
+	inline bool DecodeUtf8(const char* data, size_t size, TCHAR* out, size_t capacity, size_t& outSize)
+	{
+		if constexpr (sizeof(TCHAR) == 1)
+		{
+			if (size > capacity || IsValidUtf8(data, size) == false)
+				return (false);
+			std::memcpy(out, data, size);
+			outSize = size;
+			return (true);
+		}
+		else
+			return (Utf8ToWide(data, size, reinterpret_cast<wchar_t*>(out), capacity, outSize));
+	}
+
+	/**
+	 * @brief Encode a path, or a part of it, to what the POSIX system calls expect: UTF-8 with '/' between segments
+	 * @param out Must hold at least MaxUtf8Size(size) + NULL_TERMINATOR_LENGTH bytes, it is null terminated
+	 * @return The number of bytes written, the null terminator aside
+	 */
+	inline size_t EncodePosixPath(const TCHAR* data, size_t size, char* out)
+	{
+		size_t written = EncodeUtf8(data, size, out);
+		for (size_t index = 0; index < written; index++)
+		{
+			if (out[index] == '\\')
+				out[index] = '/'; // Never part of a multi byte sequence
+		}
+		out[written] = '\0';
+		return (written);
+	}
+}
@@ -0,0 +1,137 @@
+#include "Benchmarks.h"
+#include "PathEncoding.h"
+
+#include <string>
+#include <vector>
+
+using namespace PathCore;
+
+namespace
+{
+	/* One code point at a time, what the decoders did before the ASCII runs were transcoded in blocks */
+	bool ScalarUtf8ToWide(const char* data, size_t size, wchar_t* out, size_t& outSize)
+	{
+		const unsigned char* cursor = reinterpret_cast<const unsigned char*>(data);
+		const unsigned char* end = cursor + size;
+		size_t written = 0;
+		while (cursor < end)
+		{
+			uint32_t codePoint;
+			if (DecodeUtf8(cursor, end, codePoint) == false)
+				return (false);
+			if (sizeof(wchar_t) == 2 && codePoint >= 0x10000)
+			{
+				codePoint -= 0x10000;
+				out[written++] = static_cast<wchar_t>(0xD800 | (codePoint >> 10));
+				out[written++] = static_cast<wchar_t>(0xDC00 | (codePoint & 0x3FF));
+			}
+			else
+				out[written++] = static_cast<wchar_t>(codePoint);
+		}
+		outSize = written;
+		return (true);
+	}
+
+	size_t ScalarWideToUtf8(const wchar_t* data, size_t size, char* out)
+	{
+		size_t written = 0;
+		for (size_t index = 0; index < size; index++)
+		{
+			uint32_t codePoint = static_cast<uint32_t>(data[index]);
+			if (codePoint < 0x80)
+				out[written++] = static_cast<char>(codePoint);
+			else if (codePoint < 0x800)
+			{
+				out[written++] = static_cast<char>(0xC0 | (codePoint >> 6));
+				out[written++] = static_cast<char>(0x80 | (codePoint & 0x3F));
+			}
+			else
+			{
+				out[written++] = static_cast<char>(0xE0 | (codePoint >> 12));
+				out[written++] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+				out[written++] = static_cast<char>(0x80 | (codePoint & 0x3F));
+			}
+		}
+		return (written);
+	}
+
+	/* Paths shaped like a source tree, every nameEvery-th folder name has an accented character */
+	std::vector<std::string> GeneratePaths(size_t count, size_t nameEvery)
+	{
+		std::vector<std::string> paths;
+		paths.reserve(count);
+		for (size_t index = 0; index < count; index++)
+		{
+			std::string path = "C:/Projects/PathClass/Source";
+			for (size_t depth = 0; depth < 4; depth++)
+			{
+				path += "/Module_" + std::to_string((index >> (depth * 3)) & 7);
+				if (nameEvery != 0 && (index + depth) % nameEvery == 0)
+					path += "_\xC3\xA9t\xC3\xA9";
+			}
+			path += "/File_" + std::to_string(index) + ".cpp";
+			paths.push_back(std::move(path));
+		}
+		return (paths);
+	}
+
+	template<typename Decode, typename Encode>
+	double RoundTrip(const std::vector<std::string>& paths, int passes, Decode&& decode, Encode&& encode, size_t& checksum)
+	{
+		std::vector<wchar_t> wide(MAX_PATH_LENGTH * 4);
+		std::vector<char> narrow(MaxUtf8Size(wide.size()));
+		return (MeasureSeconds([&]()
+		{
+			for (int pass = 0; pass < passes; pass++)
+			{
+				for (const std::string& path : paths)
+				{
+					size_t wideSize = 0;
+					decode(path.data(), path.size(), wide.data(), wideSize);
+					checksum += encode(wide.data(), wideSize, narrow.data());
+				}
+			}
+		}));
+	}
+}
+
+void BenchmarkPathEncoding()
+{
+	std::cout << "PathEncoding: " << sizeof(TCHAR) << " byte(s) per path character (" << (USE_WIDE_CHAR ? "wide" : "narrow UTF-8")
+		<< " mode), a Path buffer is " << (MAX_PATH_LENGTH + NULL_TERMINATOR_LENGTH) * sizeof(TCHAR) << " bytes"
+		<< (PATH_ENCODING_SSE2 ? ", SSE2 transcoding" : ", scalar transcoding") << std::endl;
+
+	const int passes = 20;
+	struct Dataset { const char* Name; size_t NameEvery; };
+	for (const Dataset& dataset : { Dataset{ "ASCII", 0 }, Dataset{ "1 accented folder in 3", 3 } })
+	{
+		std::vector<std::string> paths = GeneratePaths(50000, dataset.NameEvery);
+		size_t bytes = 0;
+		for (const std::string& path : paths)
+			bytes += path.size();
+
+		size_t scalarChecksum = 0;
+		size_t fastChecksum = 0;
+		double scalarSeconds = RoundTrip(paths, passes,
+			[](const char* data, size_t size, wchar_t* out, size_t& outSize) { ScalarUtf8ToWide(data, size, out, outSize); },
+			ScalarWideToUtf8, scalarChecksum);
+		double fastSeconds = RoundTrip(paths, passes,
+			[](const char* data, size_t size, wchar_t* out, size_t& outSize) { Utf8ToWide(data, size, out, size, outSize); },
+			WideToUtf8, fastChecksum);
+		size_t validPaths = 0;
+		double validateSeconds = MeasureSeconds([&]()
+		{
+			for (int pass = 0; pass < passes; pass++)
+			{
+				for (const std::string& path : paths)
+					validPaths += IsValidUtf8(path.data(), path.size());
+			}
+		});
+
+		double megabytes = static_cast<double>(bytes) * passes / (1024.0 * 1024.0);
+		std::cout << "\t" << dataset.Name << ", " << paths.size() << " paths" << (scalarChecksum == fastChecksum && validPaths == paths.size() * passes ? "" : " (MISMATCH)") << std::endl;
+		std::cout << "\t\tUTF-8 -> wchar_t -> UTF-8, per code point: " << megabytes / scalarSeconds << " MB/s" << std::endl;
+		std::cout << "\t\tUTF-8 -> wchar_t -> UTF-8, blocks:         " << megabytes / fastSeconds << " MB/s" << std::endl;
+		std::cout << "\t\tIsValidUtf8 (narrow path check):         " << megabytes / validateSeconds << " MB/s" << std::endl;
+	}
+}
@@ -0,0 +1,298 @@
+#include "PathFilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace PathCore
+{
+	namespace
+	{
+		/* A Bloom block is a cache line */
+		constexpr size_t BloomBlockWords = 8;
+		constexpr uint32_t BloomBlockBits = BloomBlockWords * 64;
+		constexpr uint32_t MaxBloomHashCount = 16;
+		/* Odd, each multiplication gives the bit of the next hash in its top 9 bits */
+		constexpr uint64_t BloomBitMultiplier = 0x9E3779B97F4A7C15ull;
+		constexpr uint32_t BloomBitShift = 64 - 9;
+		static_assert(BloomBlockBits == 1u << (64 - BloomBitShift), "A bit of the block per top bits value");
+
+		/* Cells per key of an xor filter, under that the peeling fails most of the time */
+		constexpr double XorCellsPerKey = 1.23;
+		constexpr uint32_t XorExtraCells = 32;
+		/* Seeds tried before giving up, a seed fails with a probability well under 1% */
+		constexpr uint32_t MaxXorAttempts = 64;
+
+		/**
+		 * @brief The false positive rate of a blocked Bloom filter, each block is a Bloom filter of its own
+		 * The keys per block follow a Poisson law: the crowded blocks answer "maybe" much more often than the average one,
+		 * which the optimal Bloom filter formula ignores (it grows wrong as the asked rate gets lower)
+		 */
+		double BlockedBloomFalsePositiveRate(double bitsPerKey, uint32_t hashCount)
+		{
+			double keysPerBlock = BloomBlockBits / bitsPerKey;
+			double spread = 10.0 * std::sqrt(keysPerBlock) + 10.0;
+			double rate = 0.0;
+			for (double keys = std::floor(std::max(0.0, keysPerBlock - spread)); keys <= keysPerBlock + spread; keys++)
+			{
+				// In logarithms, the probability of a block holding keys keys underflows far from the mean
+				double probability = std::exp(keys * std::log(keysPerBlock) - keysPerBlock - std::lgamma(keys + 1.0));
+				rate += probability * std::pow(1.0 - std::pow(1.0 - 1.0 / BloomBlockBits, keys * hashCount), hashCount);
+			}
+			return (rate);
+		}
+
+		/* Map a 32 bits value to [0, range) without a division */
+		uint32_t FastRange(uint32_t value, uint32_t range)
+		{
+			return (static_cast<uint32_t>((static_cast<uint64_t>(value) * range) >> 32));
+		}
+
+		uint64_t RotateLeft(uint64_t value, uint32_t shift)
+		{
+			return ((value << shift) | (value >> ((64 - shift) & 63)));
+		}
+
+		/* The cell of the mixed hash in the block index of an xor filter */
+		uint32_t XorCell(uint64_t mixed, uint32_t index, uint32_t blockLength)
+		{
+			return (FastRange(static_cast<uint32_t>(RotateLeft(mixed, index * 21)), blockLength) + index * blockLength);
+		}
+
+		uint64_t XorFingerprint(uint64_t mixed)
+		{
+			return (mixed ^ (mixed >> 32));
+		}
+
+		/**
+		 * @brief Order the keys of an xor filter so every key has a cell no key after it uses (peeling)
+		 * @return false if the keys could not all be peeled with this seed
+		 */
+		bool PeelXorKeys(const std::vector<uint64_t>& hashes, uint64_t seed, uint32_t blockLength, std::vector<std::pair<uint64_t, uint32_t>>& order)
+		{
+			size_t cellCount = static_cast<size_t>(blockLength) * 3;
+			std::vector<uint32_t> counts(cellCount, 0);
+			std::vector<uint64_t> xors(cellCount, 0);
+			for (uint64_t hash : hashes)
+			{
+				uint64_t mixed = MixHash(hash + seed);
+				for (uint32_t index = 0; index < 3; index++)
+				{
+					uint32_t cell = XorCell(mixed, index, blockLength);
+					counts[cell]++;
+					xors[cell] ^= mixed;
+				}
+			}
+
+			// A cell used by a single key gives that key, removing it can leave other cells with a single key
+			std::vector<uint32_t> queue;
+			for (uint32_t cell = 0; cell < cellCount; cell++)
+			{
+				if (counts[cell] == 1)
+					queue.push_back(cell);
+			}
+
+			order.clear();
+			while (queue.empty() == false)
+			{
+				uint32_t cell = queue.back();
+				queue.pop_back();
+				if (counts[cell] != 1)
+					continue;
+
+				uint64_t mixed = xors[cell];
+				order.emplace_back(mixed, cell);
+				for (uint32_t index = 0; index < 3; index++)
+				{
+					uint32_t other = XorCell(mixed, index, blockLength);
+					counts[other]--;
+					xors[other] ^= mixed;
+					if (counts[other] == 1)
+						queue.push_back(other);
+				}
+			}
+			return (order.size() == hashes.size());
+		}
+
+		/* Assign the fingerprints in the reverse peeling order, so every key is set by the last one written to its cells */
+		template<typename Fingerprint>
+		void AssignXorFingerprints(const std::vector<std::pair<uint64_t, uint32_t>>& order, uint32_t blockLength, std::vector<Fingerprint>& fingerprints)
+		{
+			fingerprints.assign(static_cast<size_t>(blockLength) * 3, 0);
+			for (size_t index = order.size(); index > 0; index--)
+			{
+				uint64_t mixed = order[index - 1].first;
+				uint32_t cell = order[index - 1].second;
+				fingerprints[cell] = 0;
+				fingerprints[cell] = static_cast<Fingerprint>(XorFingerprint(mixed) ^ fingerprints[XorCell(mixed, 0, blockLength)]
+					^ fingerprints[XorCell(mixed, 1, blockLength)] ^ fingerprints[XorCell(mixed, 2, blockLength)]);
+			}
+		}
+
+		template<typename Fingerprint>
+		bool MatchXorFingerprint(const std::vector<Fingerprint>& fingerprints, uint64_t mixed, uint32_t blockLength)
+		{
+			Fingerprint stored = fingerprints[XorCell(mixed, 0, blockLength)] ^ fingerprints[XorCell(mixed, 1, blockLength)]
+				^ fingerprints[XorCell(mixed, 2, blockLength)];
+			return (stored == static_cast<Fingerprint>(XorFingerprint(mixed)));
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// HASH FILTER
+
+	void HashFilter::Build(std::vector<uint64_t>& hashes, PathFilterKind kind, double falsePositiveRate)
+	{
+		assert(falsePositiveRate > 0.0 && falsePositiveRate < 1.0 && "The false positive rate must be between 0 and 1");
+
+		Clear();
+		std::sort(hashes.begin(), hashes.end());
+		hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+		assert(hashes.size() < UINT32_MAX / 2 && "Too many keys for 32 bits cells");
+
+		m_Kind = kind;
+		m_KeyCount = hashes.size();
+		if (kind == PathFilterKind::BlockedBloom)
+			BuildBloom(hashes, falsePositiveRate);
+		else
+			BuildXor(hashes, falsePositiveRate);
+	}
+
+	void HashFilter::Clear()
+	{
+		m_KeyCount = 0;
+		m_Blocks.clear();
+		m_HashCount = 0;
+		m_Fingerprints8.clear();
+		m_Fingerprints16.clear();
+		m_BlockLength = 0;
+		m_Seed = 0;
+	}
+
+	bool HashFilter::MayContain(uint64_t hash) const
+	{
+		if (m_KeyCount == 0)
+			return (false);
+		return (m_Kind == PathFilterKind::BlockedBloom ? MayContainBloom(hash) : MayContainXor(hash));
+	}
+
+	size_t HashFilter::ByteSize() const
+	{
+		return (m_Blocks.size() * sizeof(uint64_t) + m_Fingerprints8.size() * sizeof(uint8_t) + m_Fingerprints16.size() * sizeof(uint16_t));
+	}
+
+	void HashFilter::BuildBloom(const std::vector<uint64_t>& hashes, double falsePositiveRate)
+	{
+		// The hash count of the optimal Bloom filter, then the bits the blocks need to reach the asked rate
+		double bitsPerKey = -std::log(falsePositiveRate) / (std::log(2.0) * std::log(2.0));
+		m_HashCount = static_cast<uint32_t>(std::clamp(std::lround(bitsPerKey * std::log(2.0)), 1l, static_cast<long>(MaxBloomHashCount)));
+		while (BlockedBloomFalsePositiveRate(bitsPerKey, m_HashCount) > falsePositiveRate)
+			bitsPerKey *= 1.01;
+		size_t blockCount = std::max<size_t>(1, static_cast<size_t>(std::ceil(hashes.size() * bitsPerKey / BloomBlockBits)));
+		m_Blocks.assign(blockCount * BloomBlockWords, 0);
+
+		for (uint64_t hash : hashes)
+		{
+			uint64_t* block = m_Blocks.data() + FastRange(static_cast<uint32_t>(hash >> 32), static_cast<uint32_t>(blockCount)) * BloomBlockWords;
+			// Every bit from new top bits: double hashing (a start and a step) only gives a few thousand patterns per block
+			uint64_t bits = hash;
+			for (uint32_t index = 0; index < m_HashCount; index++)
+			{
+				bits *= BloomBitMultiplier;
+				uint32_t bit = static_cast<uint32_t>(bits >> BloomBitShift);
+				block[bit / 64] |= 1ull << (bit % 64);
+			}
+		}
+	}
+
+	bool HashFilter::MayContainBloom(uint64_t hash) const
+	{
+		uint32_t blockCount = static_cast<uint32_t>(m_Blocks.size() / BloomBlockWords);
+		const uint64_t* block = m_Blocks.data() + FastRange(static_cast<uint32_t>(hash >> 32), blockCount) * BloomBlockWords;
+		// No early exit, the bits are all in the same cache line
+		uint64_t bits = hash;
+		uint64_t missing = 0;
+		for (uint32_t index = 0; index < m_HashCount; index++)
+		{
+			bits *= BloomBitMultiplier;
+			uint32_t bit = static_cast<uint32_t>(bits >> BloomBitShift);
+			missing |= ~block[bit / 64] & (1ull << (bit % 64));
+		}
+		return (missing == 0);
+	}
+
+	void HashFilter::BuildXor(const std::vector<uint64_t>& hashes, double falsePositiveRate)
+	{
+		m_BlockLength = static_cast<uint32_t>((XorExtraCells + std::ceil(XorCellsPerKey * hashes.size())) / 3) + 1;
+
+		std::vector<std::pair<uint64_t, uint32_t>> order;
+		order.reserve(hashes.size());
+		bool peeled = false;
+		for (uint32_t attempt = 0; attempt < MaxXorAttempts && peeled == false; attempt++)
+		{
+			m_Seed = MixHash(PathHashSeed + attempt);
+			peeled = PeelXorKeys(hashes, m_Seed, m_BlockLength, order);
+		}
+		assert(peeled && "Could not build the xor filter, are the hashes distinct?");
+
+		// 8 bits fingerprints answer "maybe" to 1 absent key in 256
+		if (falsePositiveRate >= 1.0 / 256)
+			AssignXorFingerprints(order, m_BlockLength, m_Fingerprints8);
+		else
+			AssignXorFingerprints(order, m_BlockLength, m_Fingerprints16);
+	}
+
+	bool HashFilter::MayContainXor(uint64_t hash) const
+	{
+		uint64_t mixed = MixHash(hash + m_Seed);
+		if (m_Fingerprints8.empty() == false)
+			return (MatchXorFingerprint(m_Fingerprints8, mixed, m_BlockLength));
+		return (MatchXorFingerprint(m_Fingerprints16, mixed, m_BlockLength));
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// PATH FILTER
+
+	void PathFilter::Clear()
+	{
+		m_Paths.Clear();
+		m_Folders.Clear();
+		m_HasFolders = false;
+	}
+
+	bool PathFilter::MayContainUnder(const IPath& folder) const
+	{
+		if (m_HasFolders == false)
+			return (true);
+
+		size_t size = folder.Size();
+		if (size == PATH_SEPARATOR_LENGTH && IsSeparator(folder.Data()[0]))
+			return (m_Paths.KeyCount() > 0); // The Posix root, it has no prefix hash of its own
+		while (size > 1 && IsSeparator(folder.Data()[size - 1]))
+			size--;
+		return (m_Folders.MayContain(HashPath(folder.Data(), size)));
+	}
+
+	void PathFilter::Build(size_t count, const std::function<const IPath&(size_t)>& pathAt, const PathFilterOptions& options)
+	{
+		std::vector<uint64_t> hashes(count);
+		std::vector<uint64_t> folderHashes;
+		if (options.FolderPrefixes)
+			folderHashes.reserve(count);
+
+		for (size_t index = 0; index < count; index++)
+		{
+			const IPath& path = pathAt(index);
+			if (options.FolderPrefixes)
+				hashes[index] = HashPathPrefixes(path.Data(), path.Size(), [&folderHashes](uint64_t prefixHash) { folderHashes.push_back(prefixHash); });
+			else
+				hashes[index] = HashPath(path);
+		}
+
+		m_Paths.Build(hashes, options.Kind, options.FalsePositiveRate);
+		if (options.FolderPrefixes)
+			m_Folders.Build(folderHashes, options.Kind, options.FalsePositiveRate);
+		else
+			m_Folders.Clear();
+		m_HasFolders = options.FolderPrefixes;
+	}
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Path.h"
+#include "PathHash.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace PathCore
+{
+	enum class PathFilterKind : uint8_t
+	{
+		/**
+		 * Every key sets its bits in one 64 bytes block, so a query reads one cache line.
+		 * About 1.5x the bits per entry of an xor filter for the same false positive rate, any rate can be asked for.
+		 */
+		BlockedBloom,
+		/**
+		 * A fingerprint per key spread over 3 cells (xor filter), 1.23 cells per key and exactly 3 reads per query.
+		 * The fingerprints are 8 or 16 bits, so the false positive rate is rounded down to 1/256 or 1/65536.
+		 */
+		Xor
+	};
+
+	struct PathFilterOptions
+	{
+		PathFilterKind Kind = PathFilterKind::Xor;
+		/* The rate of queries for an absent key answering "maybe", between 0 and 1 */
+		double FalsePositiveRate = 0.01;
+		/* Build the folder filter of PathFilter::MayContainUnder too */
+		bool FolderPrefixes = true;
+	};
+
+	/**
+	 * A static filter over a set of 64 bits hashes: "no" is always right, "maybe" is wrong at the false positive rate.
+	 */
+	class HashFilter
+	{
+	public:
+		/**
+		 * @brief Build the filter, the previous content is dropped
+		 * @note hashes is sorted and deduplicated in place
+		 */
+		void Build(std::vector<uint64_t>& hashes, PathFilterKind kind, double falsePositiveRate);
+		void Clear();
+
+		bool MayContain(uint64_t hash) const;
+
+		PathFilterKind Kind() const { return (m_Kind); }
+		/* Distinct hashes in the filter */
+		size_t KeyCount() const { return (m_KeyCount); }
+		size_t ByteSize() const;
+		double BitsPerKey() const { return (m_KeyCount > 0 ? ByteSize() * 8.0 / m_KeyCount : 0.0); }
+
+	private:
+		void BuildBloom(const std::vector<uint64_t>& hashes, double falsePositiveRate);
+		void BuildXor(const std::vector<uint64_t>& hashes, double falsePositiveRate);
+		bool MayContainBloom(uint64_t hash) const;
+		bool MayContainXor(uint64_t hash) const;
+
+	private:
+		PathFilterKind m_Kind = PathFilterKind::Xor;
+		size_t m_KeyCount = 0;
+
+		/* Blocked Bloom filter: 8 words per block */
+		std::vector<uint64_t> m_Blocks;
+		uint32_t m_HashCount = 0;
+
+		/* Xor filter: 3 blocks of m_BlockLength cells, 8 or 16 bits fingerprints */
+		std::vector<uint8_t> m_Fingerprints8;
+		std::vector<uint16_t> m_Fingerprints16;
+		uint32_t m_BlockLength = 0;
+		uint64_t m_Seed = 0;
+	};
+
+	/**
+	 * A static existence prefilter over a path collection, answers most "is this path in the set?" misses
+	 * without touching the set itself.
+	 *
+	 * The queries hash the path in place with HashPath (both separators are equal), nothing is copied.
+	 * The folder filter holds every folder prefix of the paths (eg: "C:" and "C:/Assets" for "C:/Assets/A.png"),
+	 * to answer "does anything exist under this folder?".
+	 */
+	class PathFilter
+	{
+	public:
+		/* Build from paths (StaticPath, SharedPath, PathView, ...), the previous content is dropped */
+		template<typename PathType>
+		void Build(const std::vector<PathType>& paths, const PathFilterOptions& options = PathFilterOptions())
+		{
+			Build(paths.size(), [&paths](size_t index) -> const IPath& { return (paths[index]); }, options);
+		}
+		void Clear();
+
+		bool MayContain(const IPath& path) const { return (m_Paths.MayContain(HashPath(path))); }
+		/* For the callers that already have the HashPath of the path */
+		bool MayContainHash(uint64_t hash) const { return (m_Paths.MayContain(hash)); }
+		/**
+		 * @brief Whether a path of the set may be under folder, a trailing separator is ignored
+		 * @note Always true when the filter was built without FolderPrefixes
+		 */
+		bool MayContainUnder(const IPath& folder) const;
+
+		const HashFilter& Paths() const { return (m_Paths); }
+		const HashFilter& Folders() const { return (m_Folders); }
+		size_t ByteSize() const { return (m_Paths.ByteSize() + m_Folders.ByteSize()); }
+
+	private:
+		void Build(size_t count, const std::function<const IPath&(size_t)>& pathAt, const PathFilterOptions& options);
+
+	private:
+		HashFilter m_Paths;
+		HashFilter m_Folders;
+		bool m_HasFolders = false;
+	};
+}
@@ -0,0 +1,113 @@
+#include "Benchmarks.h"
+#include "PathFilter.h"
+#include "PathHash.h"
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace PathCore;
+
+namespace
+{
+	using String = std::basic_string<TCHAR>;
+
+	struct PathViewHash
+	{
+		size_t operator()(const PathView& path) const { return (static_cast<size_t>(HashPath(path))); }
+	};
+	struct PathViewEqual
+	{
+		bool operator()(const PathView& path, const PathView& other) const { return (ArePathsEqual(path, other)); }
+	};
+
+	/* The folder of path, a view without its file name */
+	PathView Folder(const IPath& path)
+	{
+		PathSize size = path.Size();
+		while (size > 0 && IsSeparator(path.Data()[size - 1]) == false)
+			size--;
+		return (PathView(path.Data(), size));
+	}
+
+	struct FilterCase
+	{
+		const char* Name;
+		PathFilterKind Kind;
+		double FalsePositiveRate;
+	};
+}
+
+void BenchmarkPathFilter()
+{
+	const size_t pathCount = 1000000;
+	std::vector<StaticPath> paths = GenerateNumberedPaths(pathCount, TEXT("C:/Assets/Library"), TEXT("Pack_"), TEXT("Texture_"), { TEXT(".png") });
+	// The same names in another root, none of them is in the set
+	std::vector<StaticPath> absents = GenerateNumberedPaths(pathCount, TEXT("C:/Assets/Missing"), TEXT("Pack_"), TEXT("Texture_"), { TEXT(".png") });
+
+	std::unordered_set<PathView, PathViewHash, PathViewEqual> set(paths.begin(), paths.end());
+	uint64_t setFound = 0;
+	double setSeconds = MeasureSeconds([&]()
+	{
+		for (const StaticPath& absent : absents)
+			setFound += set.count(PathView(absent));
+	});
+
+	std::cout << "PathFilter: " << pathCount << " paths, " << pathCount << " absent paths queried" << std::endl;
+	std::cout << "\tstd::unordered_set probe: " << setSeconds * 1e9 / pathCount << " ns per miss" << (setFound == 0 ? "" : " (MISMATCH)") << std::endl;
+
+	const FilterCase cases[] = {
+		{ "Blocked Bloom 1%", PathFilterKind::BlockedBloom, 0.01 },
+		{ "Blocked Bloom 0.1%", PathFilterKind::BlockedBloom, 0.001 },
+		{ "Xor 8 bits", PathFilterKind::Xor, 0.01 },
+		{ "Xor 16 bits", PathFilterKind::Xor, 0.0001 },
+	};
+	for (const FilterCase& filterCase : cases)
+	{
+		PathFilterOptions options;
+		options.Kind = filterCase.Kind;
+		options.FalsePositiveRate = filterCase.FalsePositiveRate;
+
+		PathFilter filter;
+		double buildSeconds = MeasureSeconds([&]() { filter.Build(paths, options); });
+
+		// "No" is never wrong: every path and every folder of the set is found
+		bool same = true;
+		for (size_t index = 0; index < pathCount; index += 13)
+			same = same && filter.MayContain(paths[index]) && filter.MayContainUnder(Folder(paths[index]));
+		same = same && filter.MayContainUnder(Path(TEXT("C:/Assets/"))) && filter.MayContainUnder(Path(TEXT("C:\\Assets\\Library")));
+
+		uint64_t falsePositives = 0;
+		double querySeconds = MeasureSeconds([&]()
+		{
+			for (const StaticPath& absent : absents)
+				falsePositives += filter.MayContain(absent);
+		});
+		int queryAllocations = CountAllocations([&]()
+		{
+			for (size_t index = 0; index < pathCount; index += 101)
+				filter.MayContain(absents[index]);
+		});
+
+		uint64_t folderFalsePositives = 0;
+		for (char letter = 'A'; letter <= 'Z'; letter++)
+		{
+			for (size_t index = 0; index < 1000; index++)
+			{
+				String folder = TEXT("C:/Assets/Missing/Pack_");
+				folder += static_cast<TCHAR>(letter);
+				folder += static_cast<TCHAR>(TEXT('0') + index % 10);
+				folder += static_cast<TCHAR>(TEXT('0') + index / 10 % 10);
+				folder += static_cast<TCHAR>(TEXT('0') + index / 100);
+				folderFalsePositives += filter.MayContainUnder(Path(folder.c_str()));
+			}
+		}
+
+		std::cout << "\t" << filterCase.Name << ": build " << buildSeconds * 1e3 << " ms, "
+			<< filter.Paths().BitsPerKey() / 8 << " bytes per path, " << filter.Folders().KeyCount() << " folders in "
+			<< filter.Folders().ByteSize() << " bytes" << (same ? "" : " (MISMATCH)") << std::endl;
+		std::cout << "\t\tAsked " << filterCase.FalsePositiveRate * 100 << "% false positives, measured "
+			<< falsePositives * 100.0 / pathCount << "% on paths, " << folderFalsePositives * 100.0 / 26000 << "% on folders" << std::endl;
+		std::cout << "\t\tQuery: " << querySeconds * 1e9 / pathCount << " ns per miss (" << queryAllocations << " allocations)" << std::endl;
+	}
+}
@@ -0,0 +1,450 @@
+#include "PathFuzzyFinder.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+// The masks and the query characters are compared 16 bytes at a time, SSE2 is always there on x86-64
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define PATH_FUZZY_SSE2 1
+#else
+# define PATH_FUZZY_SSE2 0
+#endif
+
+namespace PathCore
+{
+	namespace
+	{
+		constexpr int32_t MatchScore = 16;
+		/* The character after a separator, or the first one of the path */
+		constexpr int32_t SegmentStartBonus = 10;
+		/* The character after '_', '-', '.' or ' ', or an upper case letter after a lower case one */
+		constexpr int32_t WordStartBonus = 8;
+		/* The bonus of a character right after the previous match, at least */
+		constexpr int32_t ConsecutiveBonus = 6;
+		/* Every character matched in the file name */
+		constexpr int32_t NameBonus = 4;
+		/* The bonus of the first query character counts twice */
+		constexpr int32_t FirstCharacterMultiplier = 2;
+		constexpr int32_t GapStartPenalty = -3;
+		constexpr int32_t GapExtensionPenalty = -1;
+
+		/* Paths scanned by a job of the pool */
+		constexpr size_t ScanBlockSize = 16 * 1024;
+		/* Bytes readable past the last path of m_Folded */
+		constexpr size_t FoldedPadding = 16;
+
+		/* 'A' to 'Z' folded, both separators are '/' */
+		TCHAR FoldCharacter(TCHAR character)
+		{
+			if (character >= TEXT('A') && character <= TEXT('Z'))
+				return (static_cast<TCHAR>(character - TEXT('A') + TEXT('a')));
+			return (IsSeparator(character) ? UnixSeparator : character);
+		}
+
+		/* FoldCharacter on one byte, the characters out of ASCII keep their low 7 bits */
+		uint8_t FoldByte(TCHAR character)
+		{
+			TCHAR folded = FoldCharacter(character);
+			if (static_cast<uint32_t>(folded) < 0x80)
+				return (static_cast<uint8_t>(folded));
+			return (static_cast<uint8_t>(0x80 | (static_cast<uint32_t>(folded) & 0x7F)));
+		}
+
+		/* The bit of a folded byte in a character mask: a letter or a digit has its own, the other bytes share the last 28 */
+		uint64_t CharacterBit(uint8_t byte)
+		{
+			if (byte >= 'a' && byte <= 'z')
+				return (1ull << (byte - 'a'));
+			if (byte >= '0' && byte <= '9')
+				return (1ull << (26 + byte - '0'));
+			return (1ull << (36 + byte % 28));
+		}
+
+		/* The first position of byte in [from, size) of text, size if there is none. text must be readable 16 bytes past size */
+		PathSize FindByte(const uint8_t* text, PathSize from, PathSize size, uint8_t byte)
+		{
+#if PATH_FUZZY_SSE2
+			__m128i needle = _mm_set1_epi8(static_cast<char>(byte));
+			for (PathSize position = from; position < size; position += 16)
+			{
+				__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + position));
+				unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, needle)));
+				if (mask != 0)
+					return (static_cast<PathSize>(std::min<size_t>(position + std::countr_zero(mask), size)));
+			}
+			return (size);
+#else
+			for (PathSize position = from; position < size; position++)
+			{
+				if (text[position] == byte)
+					return (position);
+			}
+			return (size);
+#endif
+		}
+
+		bool IsWordDelimiter(uint8_t byte)
+		{
+			return (byte == '_' || byte == '-' || byte == '.' || byte == ' ');
+		}
+
+		/**
+		 * @brief What ScoreWindow can give at most to the window [start, end] matching queryCount characters:
+		 *        every character at a segment start, in the file name when the window reaches it, every other character a gap
+		 */
+		int32_t MaxWindowScore(size_t queryCount, PathSize start, PathSize end, PathSize name)
+		{
+			int32_t count = static_cast<int32_t>(queryCount);
+			int32_t namePositions = end >= name ? static_cast<int32_t>(end + 1 - std::max(start, name)) : 0;
+			int32_t best = count * (MatchScore + SegmentStartBonus) + SegmentStartBonus * (FirstCharacterMultiplier - 1)
+				+ std::min(count, namePositions) * NameBonus;
+			return (best + (static_cast<int32_t>(end + 1 - start) - count) * GapExtensionPenalty);
+		}
+
+		bool IsLowerCase(TCHAR character) { return (character >= TEXT('a') && character <= TEXT('z')); }
+		bool IsUpperCase(TCHAR character) { return (character >= TEXT('A') && character <= TEXT('Z')); }
+	}
+
+	struct PathFuzzyFinder::Query
+	{
+		explicit Query(StringView query)
+		{
+			Characters.reserve(query.size());
+			Bytes.reserve(query.size());
+			for (TCHAR character : query)
+			{
+				Characters.push_back(FoldCharacter(character));
+				Bytes.push_back(FoldByte(character));
+				Mask |= CharacterBit(Bytes.back());
+				IsAscii = IsAscii && static_cast<uint32_t>(character) < 0x80;
+			}
+		}
+
+		/* The folded characters, to check the matches when some are out of ASCII */
+		std::basic_string<TCHAR> Characters;
+		std::vector<uint8_t> Bytes;
+		uint64_t Mask = 0;
+		bool IsAscii = true;
+	};
+
+	///////////////////////////////////////////////////////////////////////////////
+	// PATH FUZZY FINDER
+
+	void PathFuzzyFinder::Clear()
+	{
+		m_Characters.clear();
+		m_Folded.clear();
+		m_Humps.clear();
+		m_Entries.clear();
+		m_Masks.clear();
+	}
+
+	std::vector<FuzzyMatch> PathFuzzyFinder::Search(StringView query, const FuzzySearchOptions& options) const
+	{
+		FuzzySearch search(*this, options);
+		return (search.Update(query));
+	}
+
+	void PathFuzzyFinder::Build(size_t count, const std::function<const IPath&(size_t)>& pathAt)
+	{
+		Clear();
+		size_t characterCount = 0;
+		for (size_t index = 0; index < count; index++)
+			characterCount += pathAt(index).Size() + 1;
+		assert(count < UINT32_MAX && characterCount < UINT32_MAX && "Too many paths for 32 bits offsets");
+
+		m_Characters.resize(characterCount);
+		m_Folded.assign(characterCount + FoldedPadding, 0);
+		m_Humps.assign((characterCount + 63) / 64, 0);
+		m_Entries.resize(count);
+		m_Masks.resize(count);
+
+		uint32_t offset = 0;
+		for (size_t index = 0; index < count; index++)
+		{
+			const IPath& path = pathAt(index);
+			const TCHAR* data = path.Data();
+			m_Entries[index] = { offset, path.Size(), path.NameOffsets().Name };
+
+			TCHAR* characters = m_Characters.data() + offset;
+			uint8_t* folded = m_Folded.data() + offset;
+			uint64_t mask = 0;
+			for (PathSize position = 0; position < path.Size(); position++)
+			{
+				characters[position] = data[position];
+				folded[position] = FoldByte(data[position]);
+				mask |= CharacterBit(folded[position]);
+				if (position > 0 && IsLowerCase(data[position - 1]) && IsUpperCase(data[position]))
+					m_Humps[(offset + position) / 64] |= 1ull << ((offset + position) % 64);
+			}
+			characters[path.Size()] = NULL;
+			m_Masks[index] = mask;
+			offset += path.Size() + 1;
+		}
+	}
+
+	void PathFuzzyFinder::Scan(const Query& query, const uint32_t* candidates, size_t count, const FuzzySearchOptions& options,
+		std::vector<uint32_t>& matches, std::vector<FuzzyMatch>& results) const
+	{
+		struct Block
+		{
+			std::vector<uint32_t> Matches;
+			/* The best matches of the block, the worst one in front (bounded heap) */
+			std::vector<FuzzyMatch> Best;
+		};
+		std::vector<Block> blocks(std::max<size_t>(1, (count + ScanBlockSize - 1) / ScanBlockSize));
+
+		auto isBetter = [this](const FuzzyMatch& match, const FuzzyMatch& other) { return (IsBetter(match, other)); };
+		auto scanBlock = [&](size_t blockIndex)
+		{
+			Block& block = blocks[blockIndex];
+			size_t first = blockIndex * ScanBlockSize;
+			size_t last = std::min(first + ScanBlockSize, count);
+
+			auto scorePath = [&](uint32_t path)
+			{
+				// Once the block has its best matches, a path has to beat the worst of them
+				int32_t minScore = INT32_MIN;
+				if (options.MaxResults == 0)
+					minScore = INT32_MAX;
+				else if (block.Best.size() == options.MaxResults)
+					minScore = block.Best.front().Score;
+
+				int32_t score = 0;
+				if (ScorePath(path, query, minScore, score) == false)
+					return;
+
+				block.Matches.push_back(path);
+				FuzzyMatch match = { path, score };
+				if (block.Best.size() < options.MaxResults)
+				{
+					block.Best.push_back(match);
+					std::push_heap(block.Best.begin(), block.Best.end(), isBetter);
+				}
+				else if (options.MaxResults > 0 && IsBetter(match, block.Best.front()))
+				{
+					std::pop_heap(block.Best.begin(), block.Best.end(), isBetter);
+					block.Best.back() = match;
+					std::push_heap(block.Best.begin(), block.Best.end(), isBetter);
+				}
+			};
+
+			if (candidates != nullptr)
+			{
+				// The candidates matched a shorter query, their masks almost always pass
+				for (size_t index = first; index < last; index++)
+				{
+					if ((m_Masks[candidates[index]] & query.Mask) == query.Mask)
+						scorePath(candidates[index]);
+				}
+				return;
+			}
+
+			size_t index = first;
+#if PATH_FUZZY_SSE2
+			// The masks of 2 paths per compare, a path passes when both of its 32 bits halves hold the query ones
+			__m128i queryMask = _mm_set1_epi64x(static_cast<long long>(query.Mask));
+			for (; index + 2 <= last; index += 2)
+			{
+				__m128i masks = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_Masks.data() + index));
+				unsigned int passed = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(masks, queryMask), queryMask)));
+				if ((passed & 0xFFu) == 0xFFu)
+					scorePath(static_cast<uint32_t>(index));
+				if ((passed >> 8) == 0xFFu)
+					scorePath(static_cast<uint32_t>(index + 1));
+			}
+#endif
+			for (; index < last; index++)
+			{
+				if ((m_Masks[index] & query.Mask) == query.Mask)
+					scorePath(static_cast<uint32_t>(index));
+			}
+		};
+
+		if (options.Pool != nullptr && blocks.size() > 1)
+			options.Pool->ParallelFor(blocks.size(), scanBlock);
+		else
+		{
+			for (size_t blockIndex = 0; blockIndex < blocks.size(); blockIndex++)
+				scanBlock(blockIndex);
+		}
+
+		// The blocks are in path order, so are the matches
+		size_t matchCount = 0;
+		for (const Block& block : blocks)
+			matchCount += block.Matches.size();
+		matches.clear();
+		matches.reserve(matchCount);
+		results.clear();
+		for (const Block& block : blocks)
+		{
+			matches.insert(matches.end(), block.Matches.begin(), block.Matches.end());
+			results.insert(results.end(), block.Best.begin(), block.Best.end());
+		}
+
+		size_t resultCount = std::min(results.size(), options.MaxResults);
+		std::partial_sort(results.begin(), results.begin() + resultCount, results.end(), isBetter);
+		results.resize(resultCount);
+	}
+
+	bool PathFuzzyFinder::ScorePath(uint32_t path, const Query& query, int32_t minScore, int32_t& score) const
+	{
+		const Entry& entry = m_Entries[path];
+		const uint8_t* text = m_Folded.data() + entry.Offset;
+
+		// The earliest end of a match, every query character found after the previous one
+		PathSize end = 0;
+		for (uint8_t byte : query.Bytes)
+		{
+			end = FindByte(text, end, entry.Size, byte);
+			if (end == entry.Size)
+				return (false);
+			end++;
+		}
+		end--;
+
+		if (query.IsAscii == false)
+		{
+			// The bytes only hold the low bits of the other characters
+			const TCHAR* characters = m_Characters.data() + entry.Offset;
+			size_t found = 0;
+			for (PathSize position = 0; position < entry.Size && found < query.Characters.size(); position++)
+				found += FoldCharacter(characters[position]) == query.Characters[found];
+			if (found < query.Characters.size())
+				return (false);
+		}
+
+		// The shortest match ending there, found backward
+		PathSize start = end;
+		for (size_t remaining = query.Bytes.size(); remaining > 0; start--)
+		{
+			if (text[start] == query.Bytes[remaining - 1] && --remaining == 0)
+				break;
+		}
+		// A window that cannot reach minScore is not scored, its bound is below minScore too
+		score = MaxWindowScore(query.Bytes.size(), start, end, entry.Name);
+		if (score >= minScore)
+			score = ScoreWindow(path, query, start, end);
+
+		// The whole query may also be in the file name, where it scores better
+		if (start < entry.Name)
+		{
+			PathSize nameEnd = entry.Name;
+			for (uint8_t byte : query.Bytes)
+			{
+				nameEnd = FindByte(text, nameEnd, entry.Size, byte);
+				if (nameEnd == entry.Size)
+					return (true);
+				nameEnd++;
+			}
+			int32_t nameBound = MaxWindowScore(query.Bytes.size(), entry.Name, nameEnd - 1, entry.Name);
+			if (nameBound >= minScore && nameBound > score)
+				score = std::max(score, ScoreWindow(path, query, entry.Name, nameEnd - 1));
+		}
+		return (true);
+	}
+
+	int32_t PathFuzzyFinder::ScoreWindow(uint32_t path, const Query& query, PathSize start, PathSize end) const
+	{
+		const Entry& entry = m_Entries[path];
+		const uint8_t* text = m_Folded.data() + entry.Offset;
+
+		int32_t score = 0;
+		size_t matched = 0;
+		bool previousMatched = false;
+		for (PathSize position = start; position <= end && matched < query.Bytes.size(); position++)
+		{
+			if (text[position] != query.Bytes[matched])
+			{
+				score += previousMatched ? GapStartPenalty : GapExtensionPenalty;
+				previousMatched = false;
+				continue;
+			}
+
+			int32_t bonus = 0;
+			if (position == 0 || text[position - 1] == UnixSeparator)
+				bonus = SegmentStartBonus;
+			else if (IsWordDelimiter(text[position - 1]) || IsHump(entry.Offset + position))
+				bonus = WordStartBonus;
+			if (previousMatched)
+				bonus = std::max(bonus, ConsecutiveBonus);
+
+			score += MatchScore + (matched == 0 ? bonus * FirstCharacterMultiplier : bonus) + (position >= entry.Name ? NameBonus : 0);
+			previousMatched = true;
+			matched++;
+		}
+		return (score);
+	}
+
+	bool PathFuzzyFinder::IsBetter(const FuzzyMatch& match, const FuzzyMatch& other) const
+	{
+		if (match.Score != other.Score)
+			return (match.Score > other.Score);
+		if (m_Entries[match.Path].Size != m_Entries[other.Path].Size)
+			return (m_Entries[match.Path].Size < m_Entries[other.Path].Size);
+		return (match.Path < other.Path);
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// FUZZY SEARCH
+
+	FuzzySearch::FuzzySearch(const PathFuzzyFinder& finder, const FuzzySearchOptions& options)
+		: m_Finder(finder),
+		m_Options(options)
+	{}
+
+	const std::vector<FuzzyMatch>& FuzzySearch::Update(StringView query)
+	{
+		PathFuzzyFinder::Query folded(query);
+
+		if (folded.Bytes.empty())
+		{
+			// Every path matches, the first ones are shown
+			m_Results.clear();
+			for (uint32_t path = 0; path < m_Finder.Size() && m_Results.size() < m_Options.MaxResults; path++)
+				m_Results.push_back({ path, 0 });
+			m_Matches.clear();
+			m_MatchesAll = true;
+			m_ScannedCount = 0;
+		}
+		else
+		{
+			// A path matching the new query matches any subsequence of it, the previous query included
+			size_t found = 0;
+			for (size_t index = 0; index < folded.Characters.size() && found < m_Query.size(); index++)
+				found += folded.Characters[index] == m_Query[found];
+			// Past half of the paths the full scan is cheaper: it reads the masks in order, 2 per SSE2 compare, the candidates gather them one by one
+			bool refine = m_HasQuery && m_MatchesAll == false && found == m_Query.size() && m_Matches.size() <= m_Finder.Size() / 2;
+
+			if (refine)
+			{
+				std::vector<uint32_t> candidates = std::move(m_Matches);
+				m_ScannedCount = candidates.size();
+				m_Finder.Scan(folded, candidates.data(), candidates.size(), m_Options, m_Matches, m_Results);
+			}
+			else
+			{
+				m_ScannedCount = m_Finder.Size();
+				m_Finder.Scan(folded, nullptr, m_Finder.Size(), m_Options, m_Matches, m_Results);
+			}
+			m_MatchesAll = false;
+		}
+
+		m_Query = std::move(folded.Characters);
+		m_HasQuery = true;
+		return (m_Results);
+	}
+
+	void FuzzySearch::Reset()
+	{
+		m_Query.clear();
+		m_HasQuery = false;
+		m_MatchesAll = false;
+		m_Matches.clear();
+		m_Results.clear();
+		m_ScannedCount = 0;
+	}
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "Path.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace PathCore
+{
+	class ThreadPool;
+
+	struct FuzzyMatch
+	{
+		/* The index of the path in the finder */
+		uint32_t Path;
+		/* Higher is better, only comparable between the matches of the same query */
+		int32_t Score;
+	};
+
+	struct FuzzySearchOptions
+	{
+		/* The amount of best matches kept, the others are only counted */
+		size_t MaxResults = 50;
+		/* Pool scanning the paths in parallel, when null the scan runs on the calling thread */
+		ThreadPool* Pool = nullptr;
+	};
+
+	/**
+	 * The paths of a fuzzy finder ("tmat" finds "Textures/Material.png"), stored back to back for the scans.
+	 *
+	 * A query matches a path when its characters are found in order in the path, 'A' to 'Z' are folded and both separators are equal.
+	 * The score rewards the characters matched at the start of a segment (the positions of ConstSegmentIterator) or of a word
+	 * ("_", "-", ".", camelCase), the consecutive characters and the characters of the file name, and charges the gaps.
+	 *
+	 * A scan rejects most paths with a 64 bits mask of the characters they hold (2 paths per SSE2 compare),
+	 * then looks for every query character 16 characters at a time, and only scores the paths that match.
+	 *
+	 * @note The characters out of ASCII are compared by their low 7 bits in the scan, then checked one by one on the matches.
+	 * @example PathFuzzyFinder finder; finder.Build(paths); FuzzySearch search(finder); for (FuzzyMatch match : search.Update(TEXT("tmat"))) Show(finder[match.Path]);
+	 */
+	class PathFuzzyFinder
+	{
+	public:
+		/* Copy paths (StaticPath, SharedPath, PathView, ...), replacing what the finder held */
+		template<typename PathType>
+		void Build(const std::vector<PathType>& paths)
+		{
+			Build(paths.size(), [&paths](size_t index) -> const IPath& { return (paths[index]); });
+		}
+		void Clear();
+
+		size_t Size() const { return (m_Entries.size()); }
+		/* The path at index, a view over the finder */
+		PathView operator[](size_t index) const
+		{
+			return (PathView(m_Characters.data() + m_Entries[index].Offset, m_Entries[index].Size));
+		}
+
+		/**
+		 * @brief The best matches of query, best first (then the shortest path, then the first one)
+		 * @note Use a FuzzySearch when the query is typed, it only rescans the previous matches when the query grows
+		 */
+		std::vector<FuzzyMatch> Search(StringView query, const FuzzySearchOptions& options = FuzzySearchOptions()) const;
+
+	private:
+		struct Query;
+
+		void Build(size_t count, const std::function<const IPath&(size_t)>& pathAt);
+		/**
+		 * @brief Score every path (candidates is null) or the candidates, keep the indices of the matches and the best ones
+		 * @note The matches are in the order of the scanned paths
+		 */
+		void Scan(const Query& query, const uint32_t* candidates, size_t count, const FuzzySearchOptions& options,
+			std::vector<uint32_t>& matches, std::vector<FuzzyMatch>& results) const;
+		/**
+		 * @brief false if the path doesn't match query
+		 * @param score Set to the score of the path when it reaches minScore, to a bound below minScore otherwise (it was not scored)
+		 */
+		bool ScorePath(uint32_t path, const Query& query, int32_t minScore, int32_t& score) const;
+		int32_t ScoreWindow(uint32_t path, const Query& query, PathSize start, PathSize end) const;
+		bool IsHump(size_t offset) const { return ((m_Humps[offset / 64] >> (offset % 64)) & 1); }
+		/* Whether match is ranked before other */
+		bool IsBetter(const FuzzyMatch& match, const FuzzyMatch& other) const;
+
+	private:
+		struct Entry
+		{
+			/* Where the path starts in m_Characters and m_Folded */
+			uint32_t Offset;
+			PathSize Size;
+			/* Where the file name starts in the path */
+			PathSize Name;
+		};
+
+		/* The paths, each one null terminated */
+		std::vector<TCHAR> m_Characters;
+		/* The paths folded to one byte per character (same offsets), with 16 bytes of padding so a scan can read past the end */
+		std::vector<uint8_t> m_Folded;
+		std::vector<Entry> m_Entries;
+		/* A bit per character of m_Folded, set on an upper case letter after a lower case one (camelCase), the case is folded away */
+		std::vector<uint64_t> m_Humps;
+		/* The characters held by every path, see CharacterBit */
+		std::vector<uint64_t> m_Masks;
+
+		friend class FuzzySearch;
+	};
+
+	/**
+	 * The search of a query typed one character at a time.
+	 *
+	 * Update() keeps the indices of the paths that matched: when the previous query is a subsequence of the new one
+	 * (a character typed at the end, or anywhere else), only those paths are scanned again, unless they are more than half of the paths.
+	 *
+	 * A match is only scored when a bound of its score (its window size, its characters in the file name) can enter the best ones.
+	 * Measured by the benchmark on one thread with 1M paths: 35 to 90 ms per keystroke while most paths match
+	 * (finding the query characters in every path), 17 ms with 76000 paths left to scan, 10 ms with 17000.
+	 * Keeping every keystroke within 16 ms takes a Pool of about 6 threads, the scan is split evenly between them.
+	 *
+	 * IMPORTANT: The finder must outlive the search and not be rebuilt while it is used, Reset() after a rebuild.
+	 */
+	class FuzzySearch
+	{
+	public:
+		explicit FuzzySearch(const PathFuzzyFinder& finder, const FuzzySearchOptions& options = FuzzySearchOptions());
+
+	public:
+		/* The best matches of query, best first */
+		const std::vector<FuzzyMatch>& Update(StringView query);
+		/* Forget the previous query, the next Update() scans every path */
+		void Reset();
+
+		const std::vector<FuzzyMatch>& Results() const { return (m_Results); }
+		/* The amount of paths matching the last query */
+		size_t MatchCount() const { return (m_MatchesAll ? m_Finder.Size() : m_Matches.size()); }
+		/* The amount of paths the last Update() scanned */
+		size_t ScannedCount() const { return (m_ScannedCount); }
+
+	private:
+		const PathFuzzyFinder& m_Finder;
+		FuzzySearchOptions m_Options;
+		std::basic_string<TCHAR> m_Query;
+		bool m_HasQuery = false;
+		/* The empty query matches every path, they are not listed */
+		bool m_MatchesAll = false;
+		std::vector<uint32_t> m_Matches;
+		std::vector<FuzzyMatch> m_Results;
+		size_t m_ScannedCount = 0;
+	};
+}
@@ -0,0 +1,136 @@
+#include "Benchmarks.h"
+#include "PathEncoding.h"
+#include "PathFuzzyFinder.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace PathCore;
+
+namespace
+{
+	using String = std::basic_string<TCHAR>;
+
+	/* A game project: a few folder levels picked from common names, then a file name made of two words */
+	std::vector<StaticPath> GeneratePaths(size_t count)
+	{
+		const TCHAR* folders[] = { TEXT("Characters"), TEXT("Environment"), TEXT("Props"), TEXT("Weapons"), TEXT("Vehicles"), TEXT("UI"),
+			TEXT("Audio"), TEXT("Effects"), TEXT("Shared"), TEXT("Levels"), TEXT("Cinematics"), TEXT("Prototype") };
+		const TCHAR* kinds[] = { TEXT("Textures"), TEXT("Materials"), TEXT("Meshes"), TEXT("Animations"), TEXT("Blueprints"), TEXT("Sounds") };
+		const TCHAR* words[] = { TEXT("Rock"), TEXT("Tree"), TEXT("Hero"), TEXT("Door"), TEXT("Crate"), TEXT("Metal"), TEXT("Wood"),
+			TEXT("Glass"), TEXT("Water"), TEXT("Fire"), TEXT("Smoke"), TEXT("Cloth"), TEXT("Skin"), TEXT("Hair"), TEXT("Lamp"), TEXT("Wall") };
+		const TCHAR* extensions[] = { TEXT(".uasset"), TEXT(".png"), TEXT(".fbx"), TEXT(".wav"), TEXT(".json") };
+
+		std::vector<StaticPath> paths;
+		paths.reserve(count);
+		for (size_t index = 0; index < count; index++)
+		{
+			String path = TEXT("C:/Projects/Game/Content/");
+			path += folders[index % 12];
+			path += TEXT("/");
+			path += kinds[(index / 12) % 6];
+			path += TEXT("/Set_");
+			AppendDigits(path, index / 72 % 1000);
+			path += TEXT("/");
+			path += words[(index * 7) % 16];
+			path += words[(index * 13 / 5) % 16];
+			path += TEXT("_");
+			AppendDigits(path, index);
+			path += extensions[(index / 3) % 5];
+			paths.emplace_back(path.c_str());
+		}
+		return (paths);
+	}
+
+	TCHAR Fold(TCHAR character)
+	{
+		if (character >= TEXT('A') && character <= TEXT('Z'))
+			return (static_cast<TCHAR>(character - TEXT('A') + TEXT('a')));
+		return (IsSeparator(character) ? UnixSeparator : character);
+	}
+
+	/* What the tools did before: fold and compare every character of every path, then sort the matches by size */
+	size_t NaiveSearch(const std::vector<StaticPath>& paths, const String& query, size_t maxResults, std::vector<size_t>& results)
+	{
+		std::vector<size_t> matches;
+		for (size_t index = 0; index < paths.size(); index++)
+		{
+			const StaticPath& path = paths[index];
+			size_t found = 0;
+			for (PathSize position = 0; position < path.Size() && found < query.size(); position++)
+				found += Fold(path[position]) == Fold(query[found]);
+			if (found == query.size())
+				matches.push_back(index);
+		}
+		size_t resultCount = std::min(matches.size(), maxResults);
+		std::partial_sort(matches.begin(), matches.begin() + resultCount, matches.end(),
+			[&paths](size_t path, size_t other) { return (paths[path].Size() < paths[other].Size()); });
+		results.assign(matches.begin(), matches.begin() + resultCount);
+		return (matches.size());
+	}
+
+	bool AreSame(const std::vector<FuzzyMatch>& results, const std::vector<FuzzyMatch>& others)
+	{
+		return (std::equal(results.begin(), results.end(), others.begin(), others.end(),
+			[](const FuzzyMatch& match, const FuzzyMatch& other) { return (match.Path == other.Path && match.Score == other.Score); }));
+	}
+}
+
+void BenchmarkPathFuzzyFinder()
+{
+	const size_t pathCount = 1000000;
+	const double keystrokeBudget = 16e-3;
+	std::vector<StaticPath> paths = GeneratePaths(pathCount);
+
+	PathFuzzyFinder finder;
+	double buildSeconds = MeasureSeconds([&]() { finder.Build(paths); });
+
+	ThreadPool pool;
+	FuzzySearchOptions options;
+	options.MaxResults = 20;
+	options.Pool = &pool;
+	FuzzySearch search(finder, options);
+
+	std::cout << "PathFuzzyFinder: " << pathCount << " paths, top " << options.MaxResults << ", " << pool.ThreadCount() << " threads, build "
+		<< buildSeconds * 1e3 << " ms" << std::endl;
+
+	// "the wood doors of the materials folder", typed one character at a time
+	const std::string typed = "matwooddoor";
+	double slowestKeystroke = 0.0;
+	double naiveTotal = 0.0;
+	double incrementalTotal = 0.0;
+	bool same = true;
+	for (size_t length = 1; length <= typed.size(); length++)
+	{
+		String query(typed.begin(), typed.begin() + length);
+
+		std::vector<FuzzyMatch> full;
+		double fullSeconds = MeasureSeconds([&]() { full = finder.Search(query, options); });
+		double incrementalSeconds = MeasureSeconds([&]() { search.Update(query); });
+		std::vector<size_t> naive;
+		size_t naiveCount = 0;
+		double naiveSeconds = MeasureSeconds([&]() { naiveCount = NaiveSearch(paths, query, options.MaxResults, naive); });
+
+		same = same && AreSame(full, search.Results()) && naiveCount == search.MatchCount();
+		slowestKeystroke = std::max(slowestKeystroke, incrementalSeconds);
+		naiveTotal += naiveSeconds;
+		incrementalTotal += incrementalSeconds;
+
+		std::cout << "\t\"" << typed.substr(0, length) << "\": " << search.MatchCount() << " matches, full scan "
+			<< fullSeconds * 1e3 << " ms, incremental " << incrementalSeconds * 1e3 << " ms (" << search.ScannedCount() << " scanned), naive "
+			<< naiveSeconds * 1e3 << " ms" << std::endl;
+	}
+
+	std::cout << "\tSlowest keystroke " << slowestKeystroke * 1e3 << " ms (" << (slowestKeystroke <= keystrokeBudget ? "within" : "over")
+		<< " the " << keystrokeBudget * 1e3 << " ms budget with " << pool.ThreadCount() << " threads), whole query " << incrementalTotal * 1e3 << " ms against "
+		<< naiveTotal * 1e3 << " ms naive" << (same ? "" : " (MISMATCH)") << std::endl;
+	if (search.Results().empty() == false)
+	{
+		PathView best = finder[search.Results().front().Path];
+		std::string bytes(MaxUtf8Size(best.Size()), '\0');
+		bytes.resize(EncodeUtf8(best.Data(), best.Size(), bytes.data()));
+		std::cout << "\tBest match: " << bytes << " (score " << search.Results().front().Score << ")" << std::endl;
+	}
+}
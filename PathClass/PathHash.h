@@ -0,0 +1,119 @@
+#pragma once
+
+#include "Path.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+namespace PathCore
+{
+	constexpr uint64_t PathHashSeed = 14695981039346656037ull;
+
+	/**
+	 * @brief FNV-1a hash of a run of characters
+	 * @param seed The hash to continue from, to hash several runs as one
+	 */
+	inline uint64_t HashCharacters(const TCHAR* data, size_t size, uint64_t seed = PathHashSeed)
+	{
+		uint64_t hash = seed;
+		for (size_t index = 0; index < size; index++)
+		{
+			hash ^= static_cast<uint64_t>(data[index]);
+			hash *= 1099511628211ull;
+		}
+		return (hash);
+	}
+
+	/**
+	 * @brief Spread every bit of hash on the whole word (FNV-1a alone leaves the high bits weak for short differences)
+	 */
+	inline uint64_t MixHash(uint64_t hash)
+	{
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
+		hash *= 0xC4CEB9FE1A85EC53ull;
+		hash ^= hash >> 33;
+		return (hash);
+	}
+
+	/**
+	 * @brief HashPath() of a path, and of every folder prefix on the way in the same pass
+	 * @param onPrefix Called with HashPath() of the part before each separator, shortest first (a leading separator has no prefix)
+	 * @example HashPathPrefixes(TEXT("C:/A/b.txt"), 10, onPrefix) calls onPrefix(HashPath("C:")) then onPrefix(HashPath("C:/A"))
+	 */
+	template<typename Function>
+	inline uint64_t HashPathPrefixes(const TCHAR* data, size_t size, Function&& onPrefix)
+	{
+		uint64_t hash = PathHashSeed;
+		for (size_t index = 0; index < size; index++)
+		{
+			bool isSeparator = IsSeparator(data[index]);
+			if (isSeparator && index > 0)
+				onPrefix(MixHash(hash));
+			hash ^= static_cast<uint64_t>(isSeparator ? UnixSeparator : data[index]);
+			hash *= 1099511628211ull;
+		}
+		return (MixHash(hash));
+	}
+
+	/**
+	 * @brief Hash a whole path, both separators hash the same so "C:/A" and "C:\A" collide on purpose
+	 */
+	inline uint64_t HashPath(const TCHAR* data, size_t size)
+	{
+		return (HashPathPrefixes(data, size, [](uint64_t) {}));
+	}
+	inline uint64_t HashPath(const IPath& path) { return (HashPath(path.Data(), path.Size())); }
+
+	/**
+	 * @brief Compare two paths, a separator is equal to any other separator
+	 */
+	inline bool ArePathsEqual(const TCHAR* data, size_t size, const TCHAR* otherData, size_t otherSize)
+	{
+		if (size != otherSize)
+			return (false);
+		for (size_t index = 0; index < size; index++)
+		{
+			if (data[index] != otherData[index] && (IsSeparator(data[index]) == false || IsSeparator(otherData[index]) == false))
+				return (false);
+		}
+		return (true);
+	}
+	inline bool ArePathsEqual(const IPath& path, const IPath& other) { return (ArePathsEqual(path.Data(), path.Size(), other.Data(), other.Size())); }
+
+	/**
+	 * @brief Order two paths segment by segment: a separator is equal to any other separator and comes before any character
+	 * @details A folder is followed by everything it contains ("C:/A", "C:/A/B", "C:/A-B"), the order of a sorted snapshot.
+	 * @return Negative, zero or positive like memcmp
+	 */
+	inline int ComparePaths(const TCHAR* data, size_t size, const TCHAR* otherData, size_t otherSize)
+	{
+		using Unsigned = std::make_unsigned_t<TCHAR>;
+
+		size_t commonSize = std::min(size, otherSize);
+		size_t index = 0;
+		for (;;)
+		{
+			index = static_cast<size_t>(std::mismatch(data + index, data + commonSize, otherData + index).first - data);
+			if (index == commonSize)
+				break;
+			bool separator = IsSeparator(data[index]);
+			bool otherSeparator = IsSeparator(otherData[index]);
+			if (separator != otherSeparator)
+				return (separator ? -1 : 1);
+			if (separator == false)
+				return (static_cast<Unsigned>(data[index]) < static_cast<Unsigned>(otherData[index]) ? -1 : 1);
+			index++;
+		}
+		return (size < otherSize ? -1 : (size > otherSize ? 1 : 0));
+	}
+	inline int ComparePaths(const IPath& path, const IPath& other) { return (ComparePaths(path.Data(), path.Size(), other.Data(), other.Size())); }
+
+	/* ComparePaths as a less than, to sort a snapshot (eg: std::sort(paths.begin(), paths.end(), PathLess())) */
+	struct PathLess
+	{
+		bool operator()(const IPath& path, const IPath& other) const { return (ComparePaths(path, other) < 0); }
+	};
+}
@@ -0,0 +1,272 @@
+#include "PathInstrumentation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+namespace PathCore
+{
+	namespace
+	{
+		constexpr size_t OperationCount = static_cast<size_t>(PathOperation::Count);
+
+		/* Upper bound of a latency bucket */
+		uint64_t BucketLimit(size_t bucket)
+		{
+			return (uint64_t(1) << (bucket + 1));
+		}
+	}
+
+	const char* ToString(PathOperation operation)
+	{
+		switch (operation)
+		{
+		case PathOperation::Append: return ("Append");
+		case PathOperation::Insert: return ("Insert");
+		case PathOperation::Shrink: return ("Shrink");
+		case PathOperation::Rename: return ("Rename");
+		case PathOperation::SegmentJump: return ("SegmentJump");
+		case PathOperation::StaticPathConstruct: return ("StaticPathConstruct");
+		case PathOperation::ReplaceExtension: return ("ReplaceExtension");
+		default: return ("Unknown");
+		}
+	}
+
+	uint64_t OperationStats::PercentileNanoseconds(double percentile) const
+	{
+		if (Calls == 0)
+			return (0);
+
+		// Rank of the call the percentile falls on, rounded up so p99 of a few calls is the slowest one
+		uint64_t rank = static_cast<uint64_t>(std::ceil(percentile * Calls));
+		if (rank == 0)
+			rank = 1;
+		uint64_t seen = 0;
+		for (size_t bucket = 0; bucket < LatencyBucketCount; bucket++)
+		{
+			seen += LatencyBuckets[bucket];
+			if (seen >= rank)
+				return (std::min(BucketLimit(bucket), MaxNanoseconds));
+		}
+		return (MaxNanoseconds);
+	}
+
+	void WriteInstrumentationJson(std::ostream& stream, const InstrumentationSnapshot& snapshot)
+	{
+		stream << "{\"threads\":" << snapshot.Threads << ",\"operations\":[";
+		bool first = true;
+		for (size_t index = 0; index < OperationCount; index++)
+		{
+			const OperationStats& stats = snapshot.Operations[index];
+			if (stats.Calls == 0)
+				continue;
+
+			size_t usedBuckets = LatencyBucketCount;
+			while (usedBuckets > 0 && stats.LatencyBuckets[usedBuckets - 1] == 0)
+				usedBuckets--;
+
+			stream << (first ? "" : ",")
+				<< "{\"operation\":\"" << ToString(static_cast<PathOperation>(index))
+				<< "\",\"calls\":" << stats.Calls
+				<< ",\"bytes_moved\":" << stats.BytesMoved
+				<< ",\"total_ns\":" << stats.TotalNanoseconds
+				<< ",\"max_ns\":" << stats.MaxNanoseconds
+				<< ",\"p50_ns\":" << stats.PercentileNanoseconds(0.5)
+				<< ",\"p99_ns\":" << stats.PercentileNanoseconds(0.99)
+				<< ",\"buckets\":[";
+			for (size_t bucket = 0; bucket < usedBuckets; bucket++)
+				stream << (bucket == 0 ? "" : ",") << stats.LatencyBuckets[bucket];
+			stream << "]}";
+			first = false;
+		}
+		stream << "]}\n";
+	}
+
+	void WriteInstrumentationText(std::ostream& stream, const InstrumentationSnapshot& snapshot)
+	{
+		bool empty = true;
+		for (size_t index = 0; index < OperationCount; index++)
+		{
+			const OperationStats& stats = snapshot.Operations[index];
+			if (stats.Calls == 0)
+				continue;
+			empty = false;
+
+			stream << ToString(static_cast<PathOperation>(index)) << ": " << stats.Calls << " calls, "
+				<< stats.BytesMoved << " bytes moved, mean " << stats.TotalNanoseconds / stats.Calls << " ns, p50 <= "
+				<< stats.PercentileNanoseconds(0.5) << " ns, p99 <= " << stats.PercentileNanoseconds(0.99) << " ns, max "
+				<< stats.MaxNanoseconds << " ns\n";
+		}
+		if (empty)
+			stream << "No instrumented operation recorded" << (PATH_INSTRUMENTATION ? "" : " (built without PATH_INSTRUMENTATION)") << "\n";
+	}
+
+#if PATH_INSTRUMENTATION
+
+	namespace
+	{
+		/**
+		 * The counters of one thread.
+		 * Only the owner thread writes them, with plain loads and stores (no locked instruction on the hot path),
+		 * they are atomics so a snapshot can read them at any time.
+		 */
+		struct ThreadOperationStats
+		{
+			std::atomic<uint64_t> Calls;
+			std::atomic<uint64_t> BytesMoved;
+			std::atomic<uint64_t> TotalNanoseconds;
+			std::atomic<uint64_t> MaxNanoseconds;
+			std::array<std::atomic<uint64_t>, LatencyBucketCount> LatencyBuckets;
+		};
+
+		struct ThreadStats
+		{
+			std::array<ThreadOperationStats, OperationCount> Operations = {};
+		};
+
+		void Add(std::atomic<uint64_t>& counter, uint64_t value)
+		{
+			counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+		}
+
+		OperationStats Load(const ThreadOperationStats& stats)
+		{
+			OperationStats loaded;
+			loaded.Calls = stats.Calls.load(std::memory_order_relaxed);
+			loaded.BytesMoved = stats.BytesMoved.load(std::memory_order_relaxed);
+			loaded.TotalNanoseconds = stats.TotalNanoseconds.load(std::memory_order_relaxed);
+			loaded.MaxNanoseconds = stats.MaxNanoseconds.load(std::memory_order_relaxed);
+			for (size_t bucket = 0; bucket < LatencyBucketCount; bucket++)
+				loaded.LatencyBuckets[bucket] = stats.LatencyBuckets[bucket].load(std::memory_order_relaxed);
+			return (loaded);
+		}
+
+		void Merge(OperationStats& into, const OperationStats& stats)
+		{
+			into.Calls += stats.Calls;
+			into.BytesMoved += stats.BytesMoved;
+			into.TotalNanoseconds += stats.TotalNanoseconds;
+			into.MaxNanoseconds = std::max(into.MaxNanoseconds, stats.MaxNanoseconds);
+			for (size_t bucket = 0; bucket < LatencyBucketCount; bucket++)
+				into.LatencyBuckets[bucket] += stats.LatencyBuckets[bucket];
+		}
+
+		struct Registry
+		{
+			std::mutex Mutex;
+			std::vector<ThreadStats*> Threads;
+			/* The counters of the threads that exited */
+			InstrumentationSnapshot Exited;
+		};
+
+		/* Never destroyed, a thread can exit after the static destructors ran */
+		Registry& GetRegistry()
+		{
+			static Registry* registry = new Registry();
+			return (*registry);
+		}
+
+		/* Registers the counters of its thread on first use, and moves them to Registry::Exited when the thread exits */
+		struct ThreadSlot
+		{
+			ThreadStats* Stats = nullptr;
+
+			~ThreadSlot()
+			{
+				if (Stats == nullptr)
+					return;
+
+				Registry& registry = GetRegistry();
+				std::lock_guard<std::mutex> lock(registry.Mutex);
+				for (size_t index = 0; index < OperationCount; index++)
+					Merge(registry.Exited.Operations[index], Load(Stats->Operations[index]));
+				registry.Exited.Threads++;
+				registry.Threads.erase(std::find(registry.Threads.begin(), registry.Threads.end(), Stats));
+				delete Stats;
+			}
+		};
+
+		thread_local ThreadSlot Slot;
+
+		ThreadStats& CurrentThreadStats()
+		{
+			if (Slot.Stats == nullptr)
+			{
+				Slot.Stats = new ThreadStats();
+				Registry& registry = GetRegistry();
+				std::lock_guard<std::mutex> lock(registry.Mutex);
+				registry.Threads.push_back(Slot.Stats);
+			}
+			return (*Slot.Stats);
+		}
+	}
+
+	namespace Instrumentation
+	{
+		thread_local uint32_t Depth = 0;
+
+		void Record(PathOperation operation, uint64_t nanoseconds, uint64_t bytesMoved)
+		{
+			ThreadOperationStats& stats = CurrentThreadStats().Operations[static_cast<size_t>(operation)];
+			Add(stats.Calls, 1);
+			Add(stats.BytesMoved, bytesMoved);
+			Add(stats.TotalNanoseconds, nanoseconds);
+			if (nanoseconds > stats.MaxNanoseconds.load(std::memory_order_relaxed))
+				stats.MaxNanoseconds.store(nanoseconds, std::memory_order_relaxed);
+
+			size_t bucket = nanoseconds == 0 ? 0 : std::bit_width(nanoseconds) - 1;
+			Add(stats.LatencyBuckets[std::min(bucket, LatencyBucketCount - 1)], 1);
+		}
+	}
+
+	InstrumentationSnapshot TakeInstrumentationSnapshot()
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.Mutex);
+
+		InstrumentationSnapshot snapshot = registry.Exited;
+		for (ThreadStats* thread : registry.Threads)
+		{
+			for (size_t index = 0; index < OperationCount; index++)
+				Merge(snapshot.Operations[index], Load(thread->Operations[index]));
+		}
+		snapshot.Threads += static_cast<uint32_t>(registry.Threads.size());
+		return (snapshot);
+	}
+
+	void ResetInstrumentation()
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.Mutex);
+
+		registry.Exited = InstrumentationSnapshot();
+		// A call recorded by its thread while it is reset can survive the reset, the counters are never locked by their thread
+		for (ThreadStats* thread : registry.Threads)
+		{
+			for (ThreadOperationStats& stats : thread->Operations)
+			{
+				stats.Calls.store(0, std::memory_order_relaxed);
+				stats.BytesMoved.store(0, std::memory_order_relaxed);
+				stats.TotalNanoseconds.store(0, std::memory_order_relaxed);
+				stats.MaxNanoseconds.store(0, std::memory_order_relaxed);
+				for (std::atomic<uint64_t>& bucket : stats.LatencyBuckets)
+					bucket.store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+
+#else
+
+	InstrumentationSnapshot TakeInstrumentationSnapshot()
+	{
+		return (InstrumentationSnapshot());
+	}
+
+	void ResetInstrumentation()
+	{}
+
+#endif
+}
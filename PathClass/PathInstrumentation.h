@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+///////////////////////////////////////////////////////////////////////////////
+//  Counters and latency histograms of the PathBase hot paths.
+//  Define PATH_INSTRUMENTATION to 1 in the build to record them, the PATH_INSTRUMENT macros compile to nothing otherwise.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef PATH_INSTRUMENTATION
+# define PATH_INSTRUMENTATION 0
+#endif
+
+namespace PathCore
+{
+	enum class PathOperation : uint8_t
+	{
+		Append,
+		Insert,
+		Shrink,
+		Rename,
+		/* ConstSegmentIterator +, +=, -, -= and = index */
+		SegmentJump,
+		StaticPathConstruct,
+		ReplaceExtension,
+
+		Count
+	};
+
+	const char* ToString(PathOperation operation);
+
+	/* Bucket i counts the calls that took [2^i, 2^(i+1)) nanoseconds, bucket 0 also counts the calls under 1ns */
+	constexpr size_t LatencyBucketCount = 40;
+
+	struct OperationStats
+	{
+		uint64_t Calls = 0;
+		/* Characters read or written by the calls, in bytes */
+		uint64_t BytesMoved = 0;
+		uint64_t TotalNanoseconds = 0;
+		uint64_t MaxNanoseconds = 0;
+		std::array<uint64_t, LatencyBucketCount> LatencyBuckets = {};
+
+		/**
+		 * @brief Upper bound of the bucket the percentile falls in
+		 * @param percentile Between 0 and 1
+		 */
+		uint64_t PercentileNanoseconds(double percentile) const;
+	};
+
+	struct InstrumentationSnapshot
+	{
+		std::array<OperationStats, static_cast<size_t>(PathOperation::Count)> Operations;
+		/* Threads that recorded at least one operation, exited ones included */
+		uint32_t Threads = 0;
+
+		const OperationStats& operator[](PathOperation operation) const { return (Operations[static_cast<size_t>(operation)]); }
+	};
+
+	/**
+	 * @brief Merge the counters of every thread, the threads keep recording while the snapshot is taken
+	 * @note Always empty when PATH_INSTRUMENTATION is 0
+	 */
+	InstrumentationSnapshot TakeInstrumentationSnapshot();
+	/* Zero the counters of every thread */
+	void ResetInstrumentation();
+
+	/**
+	 * @brief Write the operations that were called as one JSON object
+	 * @example {"threads":1,"operations":[{"operation":"Append","calls":2,"bytes_moved":96,"total_ns":180,"max_ns":120,"p50_ns":64,"p99_ns":128,"buckets":[0,0,0,0,0,0,1,1]}]}
+	 * @note "buckets" stops at the last bucket that is not empty
+	 */
+	void WriteInstrumentationJson(std::ostream& stream, const InstrumentationSnapshot& snapshot);
+	/* One line per operation that was called, for humans */
+	void WriteInstrumentationText(std::ostream& stream, const InstrumentationSnapshot& snapshot);
+
+#if PATH_INSTRUMENTATION
+	namespace Instrumentation
+	{
+		/* Add a call to the counters of the calling thread */
+		void Record(PathOperation operation, uint64_t nanoseconds, uint64_t bytesMoved);
+
+		/* Operations running on the calling thread, only the outermost one is recorded */
+		extern thread_local uint32_t Depth;
+
+		/**
+		 * Time the enclosing scope and record it when it ends.
+		 *
+		 * An operation called by another one (the Append of an Insert at the end, the PathBase built by a StaticPath in DEBUG)
+		 * is part of the outer operation, it is not recorded on its own.
+		 */
+		class ScopedOperation
+		{
+		public:
+			explicit ScopedOperation(PathOperation operation)
+				: m_Operation(operation),
+				m_Outermost(Depth++ == 0),
+				m_BytesMoved(0),
+				m_Start(m_Outermost ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point())
+			{}
+			~ScopedOperation()
+			{
+				Depth--;
+				if (m_Outermost)
+				{
+					auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_Start);
+					Record(m_Operation, static_cast<uint64_t>(elapsed.count()), m_BytesMoved);
+				}
+			}
+
+			ScopedOperation(const ScopedOperation&) = delete;
+			ScopedOperation& operator=(const ScopedOperation&) = delete;
+
+		public:
+			void AddBytes(uint64_t bytes) { m_BytesMoved += bytes; }
+
+		private:
+			PathOperation m_Operation;
+			bool m_Outermost;
+			uint64_t m_BytesMoved;
+			std::chrono::steady_clock::time_point m_Start;
+		};
+	}
+#endif
+}
+
+#if PATH_INSTRUMENTATION
+/* Time the rest of the enclosing scope as one call of PathOperation::operation */
+# define PATH_INSTRUMENT(operation) ::PathCore::Instrumentation::ScopedOperation pathInstrumentationScope(::PathCore::PathOperation::operation)
+/* Count bytes moved by the call timed with PATH_INSTRUMENT in the same scope, bytes is not evaluated when disabled */
+# define PATH_INSTRUMENT_BYTES(bytes) pathInstrumentationScope.AddBytes(static_cast<uint64_t>(bytes))
+#else
+# define PATH_INSTRUMENT(operation) ((void)0)
+# define PATH_INSTRUMENT_BYTES(bytes) ((void)0)
+#endif
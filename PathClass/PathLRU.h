@@ -0,0 +1,377 @@
+#pragma once
+
+#include "Path.h"
+#include "PathHash.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+namespace PathCore
+{
+	enum class PathCacheEviction : uint8_t
+	{
+		Lru,	// Evict the least recently used entry, a hit moves the entry to the front of a list
+		Clock	// Second chance, a hit only sets a flag (cheaper hits, approximated LRU)
+	};
+
+	struct PathCacheStats
+	{
+		uint64_t Hits = 0;
+		uint64_t Misses = 0;
+		uint64_t Insertions = 0;
+		uint64_t Evictions = 0;
+	};
+
+	/**
+	 * A bounded cache of per path values, keyed by StaticPath.
+	 *
+	 * Lookups accept any IPath (PathBase, StaticPath, PathView, ...) or a raw null terminated string
+	 * and never build a key: the probe is hashed and compared in place. Only an insertion copies the path.
+	 * Both separators are considered equal, so "C:/A" and "C:\A" are the same entry.
+	 *
+	 * The cache is split into shards, each with its own lock, table and eviction state,
+	 * the capacity is spread evenly between the shards.
+	 */
+	template<typename T>
+	class PathLRU
+	{
+	public:
+		/**
+		 * @param capacity The maximum amount of entries (rounded up to a multiple of the shard count)
+		 * @param shardCount Rounded up to a power of two, use 1 for a strict global LRU
+		 */
+		explicit PathLRU(size_t capacity, PathCacheEviction eviction = PathCacheEviction::Lru, size_t shardCount = 16);
+
+		PathLRU(const PathLRU&) = delete;
+		PathLRU& operator=(const PathLRU&) = delete;
+
+	public:
+		/**
+		 * @brief Copy the value cached for path into outValue
+		 * @return false on a miss
+		 */
+		bool Find(const IPath& path, T& outValue) { return (Find(path.Data(), path.Size(), outValue)); }
+		bool Find(const TCHAR* rawPath, T& outValue) { return (Find(rawPath, RawLength(rawPath), outValue)); }
+		bool Find(const TCHAR* data, size_t size, T& outValue) { return (Find(data, size, HashPath(data, size), outValue)); }
+		/* hash must be HashPath(data, size), for the callers that hash several prefixes of a path in one pass (HashPathPrefixes) */
+		bool Find(const TCHAR* data, size_t size, uint64_t hash, T& outValue);
+
+		/* Add or replace the value of path, evicting an entry if the shard is full */
+		void Insert(const IPath& path, T value);
+
+		bool Erase(const IPath& path) { return (Erase(path.Data(), path.Size())); }
+		bool Erase(const TCHAR* rawPath) { return (Erase(rawPath, RawLength(rawPath))); }
+		bool Erase(const TCHAR* data, size_t size);
+
+		void Clear();
+
+	public:
+		size_t Size() const;
+		size_t Capacity() const { return (m_ShardCapacity * m_Shards.size()); }
+		PathCacheStats Stats() const;
+
+	private:
+		static constexpr uint32_t InvalidSlot = std::numeric_limits<uint32_t>::max();
+
+		struct Slot
+		{
+			StaticPath Key;
+			T Value;
+			uint64_t Hash = 0;
+			/* Next slot with the same bucket, or next free slot */
+			uint32_t NextInBucket = InvalidSlot;
+			/* LRU list, the head is the most recently used */
+			uint32_t Previous = InvalidSlot;
+			uint32_t Next = InvalidSlot;
+			/* CLOCK reference bit */
+			bool Referenced = false;
+			bool Used = false;
+		};
+
+		struct Shard
+		{
+			std::mutex Mutex;
+			std::vector<Slot> Slots;
+			std::vector<uint32_t> Buckets;
+			uint32_t Head = InvalidSlot;
+			uint32_t Tail = InvalidSlot;
+			uint32_t ClockHand = 0;
+			uint32_t FreeHead = InvalidSlot;
+			uint32_t UsedCount = 0;
+			PathCacheStats Stats;
+		};
+
+	private:
+		static size_t RawLength(const TCHAR* rawPath);
+
+		Shard& ShardOf(uint64_t hash) { return (*m_Shards[(hash >> 32) & (m_Shards.size() - 1)]); }
+		uint32_t FindSlot(Shard& shard, const TCHAR* data, size_t size, uint64_t hash) const;
+		uint32_t TakeSlot(Shard& shard);
+		void Evict(Shard& shard);
+		void RemoveSlot(Shard& shard, uint32_t slot);
+
+		void Unlink(Shard& shard, uint32_t slot);
+		void PushFront(Shard& shard, uint32_t slot);
+
+	private:
+		std::vector<std::unique_ptr<Shard>> m_Shards;
+		size_t m_ShardCapacity;
+		PathCacheEviction m_Eviction;
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// PATH LRU
+	///////////////////////////////////////////////////////////////////////////
+
+	template<typename T>
+	PathLRU<T>::PathLRU(size_t capacity, PathCacheEviction eviction, size_t shardCount)
+		: m_Eviction(eviction)
+	{
+		size_t roundedShardCount = 1;
+		while (roundedShardCount < shardCount)
+			roundedShardCount *= 2;
+
+		m_ShardCapacity = std::max<size_t>(1, (capacity + roundedShardCount - 1) / roundedShardCount);
+
+		// Twice as many buckets as slots, the chains stay very short
+		size_t bucketCount = 1;
+		while (bucketCount < m_ShardCapacity * 2)
+			bucketCount *= 2;
+
+		m_Shards.reserve(roundedShardCount);
+		for (size_t index = 0; index < roundedShardCount; index++)
+		{
+			m_Shards.emplace_back(new Shard());
+			Shard& shard = *m_Shards.back();
+			shard.Slots.resize(m_ShardCapacity);
+			shard.Buckets.assign(bucketCount, InvalidSlot);
+
+			// Every slot starts in the free list
+			for (uint32_t slot = 0; slot < m_ShardCapacity; slot++)
+				shard.Slots[slot].NextInBucket = (slot + 1 < m_ShardCapacity) ? slot + 1 : InvalidSlot;
+			shard.FreeHead = 0;
+		}
+	}
+
+	template<typename T>
+	bool PathLRU<T>::Find(const TCHAR* data, size_t size, uint64_t hash, T& outValue)
+	{
+		Shard& shard = ShardOf(hash);
+		std::lock_guard<std::mutex> lock(shard.Mutex);
+
+		uint32_t slot = FindSlot(shard, data, size, hash);
+		if (slot == InvalidSlot)
+		{
+			shard.Stats.Misses++;
+			return (false);
+		}
+
+		shard.Stats.Hits++;
+		if (m_Eviction == PathCacheEviction::Lru)
+		{
+			Unlink(shard, slot);
+			PushFront(shard, slot);
+		}
+		else
+			shard.Slots[slot].Referenced = true;
+
+		outValue = shard.Slots[slot].Value;
+		return (true);
+	}
+
+	template<typename T>
+	void PathLRU<T>::Insert(const IPath& path, T value)
+	{
+		uint64_t hash = HashPath(path);
+		Shard& shard = ShardOf(hash);
+		std::lock_guard<std::mutex> lock(shard.Mutex);
+
+		uint32_t slot = FindSlot(shard, path.Data(), path.Size(), hash);
+		if (slot != InvalidSlot)
+		{
+			shard.Slots[slot].Value = std::move(value);
+			return;
+		}
+
+		slot = TakeSlot(shard);
+		Slot& newSlot = shard.Slots[slot];
+		newSlot.Key = StaticPath(path);
+		newSlot.Value = std::move(value);
+		newSlot.Hash = hash;
+		newSlot.Referenced = false;
+		newSlot.Used = true;
+		shard.UsedCount++;
+		shard.Stats.Insertions++;
+
+		uint32_t& bucket = shard.Buckets[hash & (shard.Buckets.size() - 1)];
+		newSlot.NextInBucket = bucket;
+		bucket = slot;
+
+		if (m_Eviction == PathCacheEviction::Lru)
+			PushFront(shard, slot);
+	}
+
+	template<typename T>
+	bool PathLRU<T>::Erase(const TCHAR* data, size_t size)
+	{
+		uint64_t hash = HashPath(data, size);
+		Shard& shard = ShardOf(hash);
+		std::lock_guard<std::mutex> lock(shard.Mutex);
+
+		uint32_t slot = FindSlot(shard, data, size, hash);
+		if (slot == InvalidSlot)
+			return (false);
+
+		RemoveSlot(shard, slot);
+		return (true);
+	}
+
+	template<typename T>
+	void PathLRU<T>::Clear()
+	{
+		for (std::unique_ptr<Shard>& shard : m_Shards)
+		{
+			std::lock_guard<std::mutex> lock(shard->Mutex);
+			for (uint32_t slot = 0; slot < shard->Slots.size(); slot++)
+			{
+				if (shard->Slots[slot].Used)
+					RemoveSlot(*shard, slot);
+			}
+		}
+	}
+
+	template<typename T>
+	size_t PathLRU<T>::Size() const
+	{
+		size_t size = 0;
+		for (const std::unique_ptr<Shard>& shard : m_Shards)
+		{
+			std::lock_guard<std::mutex> lock(shard->Mutex);
+			size += shard->UsedCount;
+		}
+		return (size);
+	}
+
+	template<typename T>
+	PathCacheStats PathLRU<T>::Stats() const
+	{
+		PathCacheStats stats;
+		for (const std::unique_ptr<Shard>& shard : m_Shards)
+		{
+			std::lock_guard<std::mutex> lock(shard->Mutex);
+			stats.Hits += shard->Stats.Hits;
+			stats.Misses += shard->Stats.Misses;
+			stats.Insertions += shard->Stats.Insertions;
+			stats.Evictions += shard->Stats.Evictions;
+		}
+		return (stats);
+	}
+
+	template<typename T>
+	size_t PathLRU<T>::RawLength(const TCHAR* rawPath)
+	{
+		size_t size = 0;
+		while (rawPath[size] != NULL)
+			size++;
+		return (size);
+	}
+
+	template<typename T>
+	uint32_t PathLRU<T>::FindSlot(Shard& shard, const TCHAR* data, size_t size, uint64_t hash) const
+	{
+		for (uint32_t slot = shard.Buckets[hash & (shard.Buckets.size() - 1)]; slot != InvalidSlot; slot = shard.Slots[slot].NextInBucket)
+		{
+			const Slot& candidate = shard.Slots[slot];
+			if (candidate.Hash == hash && ArePathsEqual(candidate.Key.Data(), candidate.Key.Size(), data, size))
+				return (slot);
+		}
+		return (InvalidSlot);
+	}
+
+	template<typename T>
+	uint32_t PathLRU<T>::TakeSlot(Shard& shard)
+	{
+		if (shard.FreeHead == InvalidSlot)
+			Evict(shard);
+
+		uint32_t slot = shard.FreeHead;
+		shard.FreeHead = shard.Slots[slot].NextInBucket;
+		return (slot);
+	}
+
+	template<typename T>
+	void PathLRU<T>::Evict(Shard& shard)
+	{
+		uint32_t victim;
+		if (m_Eviction == PathCacheEviction::Lru)
+			victim = shard.Tail;
+		else
+		{
+			// Give a second chance to every referenced slot on the way
+			while (shard.Slots[shard.ClockHand].Referenced)
+			{
+				shard.Slots[shard.ClockHand].Referenced = false;
+				shard.ClockHand = (shard.ClockHand + 1) % shard.Slots.size();
+			}
+			victim = shard.ClockHand;
+			shard.ClockHand = (shard.ClockHand + 1) % shard.Slots.size();
+		}
+
+		RemoveSlot(shard, victim);
+		shard.Stats.Evictions++;
+	}
+
+	template<typename T>
+	void PathLRU<T>::RemoveSlot(Shard& shard, uint32_t slot)
+	{
+		Slot& removed = shard.Slots[slot];
+
+		uint32_t* link = &shard.Buckets[removed.Hash & (shard.Buckets.size() - 1)];
+		while (*link != slot)
+			link = &shard.Slots[*link].NextInBucket;
+		*link = removed.NextInBucket;
+
+		if (m_Eviction == PathCacheEviction::Lru)
+			Unlink(shard, slot);
+
+		// The key stays allocated until Insert() reuses the slot, it is then replaced by a new StaticPath (one allocation per insertion)
+		removed.Value = T();
+		removed.Used = false;
+		removed.NextInBucket = shard.FreeHead;
+		shard.FreeHead = slot;
+		shard.UsedCount--;
+	}
+
+	template<typename T>
+	void PathLRU<T>::Unlink(Shard& shard, uint32_t slot)
+	{
+		Slot& unlinked = shard.Slots[slot];
+		if (unlinked.Previous != InvalidSlot)
+			shard.Slots[unlinked.Previous].Next = unlinked.Next;
+		else
+			shard.Head = unlinked.Next;
+		if (unlinked.Next != InvalidSlot)
+			shard.Slots[unlinked.Next].Previous = unlinked.Previous;
+		else
+			shard.Tail = unlinked.Previous;
+
+		unlinked.Previous = InvalidSlot;
+		unlinked.Next = InvalidSlot;
+	}
+
+	template<typename T>
+	void PathLRU<T>::PushFront(Shard& shard, uint32_t slot)
+	{
+		Slot& pushed = shard.Slots[slot];
+		pushed.Previous = InvalidSlot;
+		pushed.Next = shard.Head;
+		if (shard.Head != InvalidSlot)
+			shard.Slots[shard.Head].Previous = slot;
+		shard.Head = slot;
+		if (shard.Tail == InvalidSlot)
+			shard.Tail = slot;
+	}
+}
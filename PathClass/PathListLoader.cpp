@@ -0,0 +1,299 @@
+#include "PathListLoader.h"
+#include "MappedFile.h"
+#include "PathEncoding.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace PathCore
+{
+	namespace
+	{
+		/* Smallest chunk handed to a worker, under that the scheduling cost is bigger than the parsing */
+		constexpr size_t MinChunkSize = 64 * 1024;
+		/* Amount of chunks per worker, so a slow chunk doesn't leave the other workers idle */
+		constexpr size_t ChunksPerThread = 4;
+
+		struct ChunkEntry
+		{
+			size_t Offset;
+			PathSize Size;
+		};
+
+		/**
+		 * Everything a worker produce for one chunk.
+		 * Line numbers are relative to the chunk until the chunks are merged.
+		 */
+		struct ChunkResult
+		{
+			const char* Begin;
+			const char* End;
+			std::unique_ptr<TCHAR[]> Arena;
+			std::vector<ChunkEntry> Entries;
+			std::vector<PathListIssue> Issues;
+			uint64_t LineCount = 0;
+		};
+
+		/**
+		 * @brief Validate one line and write it to out, following the same rules as PathBase<Separator, Rules>::Append
+		 * @note out must have room for (end - begin) + NULL_TERMINATOR_LENGTH characters, a valid path never needs more
+		 * @return true if the line is a valid path, otherwise issue is set
+		 */
+		template<typename Rules>
+		bool ParseLine(const char* begin, const char* end, TCHAR separator, TCHAR* out, PathSize& outSize, PathListIssueType& issue)
+		{
+			const unsigned char* cursor = reinterpret_cast<const unsigned char*>(begin);
+			const unsigned char* lineEnd = reinterpret_cast<const unsigned char*>(end);
+			size_t size = 0;
+
+			if constexpr (Rules::DiskNameLength > 0)
+			{
+				// Disk segment, eg: "C:", a lower case letter is stored upper case like the paths expect it
+				unsigned char letter = lineEnd - cursor < Rules::DiskNameLength ? 0 : cursor[0];
+				if (letter >= 'a' && letter <= 'z')
+					letter = static_cast<unsigned char>(letter - 'a' + 'A');
+				if (letter < 'A' || letter > 'Z' || cursor[1] != ':')
+				{
+					issue = PathListIssueType::InvalidDiskName;
+					return (false);
+				}
+				out[size++] = static_cast<TCHAR>(letter);
+				out[size++] = static_cast<TCHAR>(cursor[1]);
+				cursor += Rules::DiskNameLength;
+
+				if (cursor < lineEnd && IsSeparator(static_cast<TCHAR>(*cursor)) == false)
+				{
+					issue = PathListIssueType::InvalidDiskName;
+					return (false);
+				}
+			}
+			else if (lineEnd - cursor == PATH_SEPARATOR_LENGTH && IsSeparator(static_cast<TCHAR>(*cursor)))
+			{
+				// Only a root, the loop below would drop it as a trailing separator
+				out[size++] = separator;
+				cursor++;
+			}
+
+			// Folder segments, each one is written with its leading separator
+			size_t segmentSize = 0;
+			while (cursor < lineEnd)
+			{
+				if (IsSeparator(static_cast<TCHAR>(*cursor)))
+				{
+					cursor++;
+					if (cursor == lineEnd)
+						break; // A single trailing separator is tolerated, like in Append
+					if (IsSeparator(static_cast<TCHAR>(*cursor)))
+					{
+						issue = PathListIssueType::EmptySegment;
+						return (false);
+					}
+
+					out[size++] = separator;
+					segmentSize = 0;
+					continue;
+				}
+
+				uint32_t codePoint;
+				if (DecodeUtf8(cursor, lineEnd, codePoint) == false)
+				{
+					issue = PathListIssueType::InvalidEncoding;
+					return (false);
+				}
+				if (codePoint < 0x20 || (codePoint <= 0x7F && IsValidNameChar<Rules>(static_cast<TCHAR>(codePoint)) == false))
+				{
+					issue = PathListIssueType::InvalidCharacter;
+					return (false);
+				}
+
+				// MaxFolderNameLength counts TCHARs, a code point can take several
+				int written = EncodeCodePoint(codePoint, out + size);
+				size += written;
+				segmentSize += written;
+				if (segmentSize > Rules::MaxFolderNameLength)
+				{
+					issue = PathListIssueType::SegmentTooLong;
+					return (false);
+				}
+				if (size > Rules::MaxPathLength)
+				{
+					issue = PathListIssueType::PathTooLong;
+					return (false);
+				}
+			}
+
+			out[size] = NULL;
+			outSize = static_cast<PathSize>(size);
+			return (true);
+		}
+
+		/* parseLine(begin, end, out, outSize, issue) is ParseLine with the rules and separator already picked */
+		template<typename LineParser>
+		void ParseLines(ChunkResult& chunk, const LineParser& parseLine)
+		{
+			size_t chunkSize = chunk.End - chunk.Begin;
+
+			// Every line is at most as many characters as bytes, and its line break leaves room for the null terminator
+			chunk.Arena.reset(new TCHAR[chunkSize + NULL_TERMINATOR_LENGTH]);
+			size_t arenaSize = 0;
+
+			const char* lineBegin = chunk.Begin;
+			while (lineBegin < chunk.End)
+			{
+				const char* lineBreak = static_cast<const char*>(std::memchr(lineBegin, '\n', chunk.End - lineBegin));
+				const char* lineEnd = lineBreak ? lineBreak : chunk.End;
+				const char* nextLine = lineBreak ? lineBreak + 1 : chunk.End;
+
+				if (lineEnd > lineBegin && lineEnd[-1] == '\r')
+					lineEnd--;
+
+				if (lineEnd > lineBegin) // Empty lines are skipped silently
+				{
+					PathSize pathSize = 0;
+					PathListIssueType issue;
+					if (parseLine(lineBegin, lineEnd, chunk.Arena.get() + arenaSize, pathSize, issue))
+					{
+						chunk.Entries.push_back({ arenaSize, pathSize });
+						arenaSize += pathSize + NULL_TERMINATOR_LENGTH;
+					}
+					else
+						chunk.Issues.push_back({ chunk.LineCount, issue });
+				}
+
+				chunk.LineCount++;
+				lineBegin = nextLine;
+			}
+		}
+
+		void ParseChunk(ChunkResult& chunk, const PathListLoaderOptions& options)
+		{
+			TCHAR separator = options.Separator;
+			if (options.DetectRules)
+			{
+				// Picked per line, the parsing of the line itself is still specialized for its rules
+				ParseLines(chunk, [&options, separator](const char* begin, const char* end, TCHAR* out, PathSize& outSize, PathListIssueType& issue)
+				{
+					PathRulesKind kind = DetectPathRules(begin, static_cast<size_t>(end - begin), options.Rules);
+					return (VisitPathRules(kind, [&](auto rules) { return (ParseLine<decltype(rules)>(begin, end, separator, out, outSize, issue)); }));
+				});
+				return;
+			}
+
+			// Picked once for the whole chunk
+			VisitPathRules(options.Rules, [&](auto rules)
+			{
+				ParseLines(chunk, [separator](const char* begin, const char* end, TCHAR* out, PathSize& outSize, PathListIssueType& issue)
+				{
+					return (ParseLine<decltype(rules)>(begin, end, separator, out, outSize, issue));
+				});
+			});
+		}
+	}
+
+	const char* ToString(PathListIssueType type)
+	{
+		switch (type)
+		{
+		case PathListIssueType::InvalidEncoding: return ("Invalid UTF-8 sequence");
+		case PathListIssueType::InvalidDiskName: return ("Invalid disk name");
+		case PathListIssueType::InvalidCharacter: return ("Invalid folder name character");
+		case PathListIssueType::EmptySegment: return ("Empty segment");
+		case PathListIssueType::SegmentTooLong: return ("Segment is too long");
+		case PathListIssueType::PathTooLong: return ("Path is too long");
+		}
+		return ("Unknown issue");
+	}
+
+	std::vector<StaticPath> PathList::ToStaticPaths() const
+	{
+		std::vector<StaticPath> staticPaths;
+		staticPaths.reserve(m_Entries.size());
+		for (const PathView& entry : m_Entries)
+			staticPaths.emplace_back(entry);
+		return (staticPaths);
+	}
+
+	PathList LoadPathList(const char* data, size_t size, const PathListLoaderOptions& options)
+	{
+		PathList list;
+		if (data == nullptr || size == 0)
+			return (list);
+
+		std::unique_ptr<ThreadPool> ownedPool;
+		ThreadPool* pool = options.Pool;
+		if (pool == nullptr)
+		{
+			ownedPool.reset(new ThreadPool());
+			pool = ownedPool.get();
+		}
+
+		// Smaller chunks than requested when the input is small, so every worker has something to do
+		size_t chunkSize = std::min(options.ChunkSize, size / (pool->ThreadCount() * ChunksPerThread));
+		chunkSize = std::max(chunkSize, MinChunkSize);
+
+		// Cut the input right after a line break, so a line is never split between two chunks
+		std::vector<ChunkResult> chunks;
+		const char* chunkBegin = data;
+		const char* dataEnd = data + size;
+		while (chunkBegin < dataEnd)
+		{
+			const char* chunkEnd = chunkBegin + std::min<size_t>(chunkSize, dataEnd - chunkBegin);
+			if (chunkEnd < dataEnd)
+			{
+				const char* lineBreak = static_cast<const char*>(std::memchr(chunkEnd, '\n', dataEnd - chunkEnd));
+				chunkEnd = lineBreak ? lineBreak + 1 : dataEnd;
+			}
+
+			chunks.emplace_back();
+			chunks.back().Begin = chunkBegin;
+			chunks.back().End = chunkEnd;
+			chunkBegin = chunkEnd;
+		}
+
+		pool->ParallelFor(chunks.size(), [&chunks, &options](size_t index)
+		{
+			ParseChunk(chunks[index], options);
+		});
+
+		// Merge the chunks in input order
+		std::vector<size_t> firstEntryIndices(chunks.size());
+		size_t entryCount = 0;
+		uint64_t lineOffset = 1; // Line numbers start at 1
+		for (size_t index = 0; index < chunks.size(); index++)
+		{
+			firstEntryIndices[index] = entryCount;
+			entryCount += chunks[index].Entries.size();
+
+			for (PathListIssue& issue : chunks[index].Issues)
+			{
+				issue.Line += lineOffset;
+				list.m_Issues.push_back(issue);
+			}
+			lineOffset += chunks[index].LineCount;
+		}
+
+		list.m_Entries.resize(entryCount);
+		pool->ParallelFor(chunks.size(), [&chunks, &list, &firstEntryIndices](size_t index)
+		{
+			const ChunkResult& chunk = chunks[index];
+			PathView* out = list.m_Entries.data() + firstEntryIndices[index];
+			for (const ChunkEntry& entry : chunk.Entries)
+				*out++ = PathView(chunk.Arena.get() + entry.Offset, entry.Size);
+		});
+
+		list.m_Arenas.reserve(chunks.size());
+		for (ChunkResult& chunk : chunks)
+			list.m_Arenas.push_back(std::move(chunk.Arena));
+
+		return (list);
+	}
+
+	PathList LoadPathListFile(const char* fileName, const PathListLoaderOptions& options)
+	{
+		MappedFile file(fileName);
+		if (file.IsValid() == false)
+			return (PathList());
+		return (LoadPathList(file.Data(), file.Size(), options));
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Path.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace PathCore
+{
+	class ThreadPool;
+
+	/**
+	 * Why a line of a path list was rejected.
+	 */
+	enum class PathListIssueType : uint8_t
+	{
+		InvalidEncoding,	// The line is not valid UTF-8
+		InvalidDiskName,	// The line doesn't start with a valid disk segment (eg: "C:"), with the Windows rules
+		InvalidCharacter,	// A segment contains a character forbidden by the rules
+		EmptySegment,		// Two separators in a row
+		SegmentTooLong,		// A segment is longer than the MaxFolderNameLength of the rules
+		PathTooLong			// The whole path is longer than the MaxPathLength of the rules
+	};
+
+	const char* ToString(PathListIssueType type);
+
+	/**
+	 * A malformed line found while loading a path list.
+	 */
+	struct PathListIssue
+	{
+		/* The line number in the input, starting at 1 */
+		uint64_t Line;
+		PathListIssueType Type;
+	};
+
+	struct PathListLoaderOptions
+	{
+		/* The separator written between segments, whatever was used in the input */
+		TCHAR Separator = OsSeparator;
+		/* The rules the lines are checked against */
+		PathRulesKind Rules = OsRulesKind;
+		/**
+		 * Pick the rules of every line from its root (see DetectPathRules), for the lists mixing the paths of several platforms.
+		 * Rules is kept for the relative paths.
+		 */
+		bool DetectRules = false;
+		/* Pool used to parse the chunks, when null a temporary pool is created for the load */
+		ThreadPool* Pool = nullptr;
+		/* Amount of bytes each parsing job works on (the input is cut at the next line break) */
+		size_t ChunkSize = 4 * 1024 * 1024;
+	};
+
+	/**
+	 * The paths loaded from a newline separated list, in input order.
+	 *
+	 * The paths are stored in a few big arenas (one per parsed chunk) and exposed as PathView,
+	 * so a load costs one allocation per chunk instead of one per path.
+	 */
+	class PathList
+	{
+	public:
+		PathList() = default;
+		PathList(PathList&&) noexcept = default;
+		PathList& operator=(PathList&&) noexcept = default;
+
+		PathList(const PathList&) = delete;
+		PathList& operator=(const PathList&) = delete;
+
+	public:
+		const PathView& operator[](size_t index) const { return (m_Entries[index]); }
+
+		std::vector<PathView>::const_iterator begin() const { return (m_Entries.begin()); }
+		std::vector<PathView>::const_iterator end() const { return (m_Entries.end()); }
+
+	public:
+		size_t Size() const { return (m_Entries.size()); }
+		bool Empty() const { return (m_Entries.empty()); }
+
+		/* The malformed lines, sorted by line number */
+		const std::vector<PathListIssue>& Issues() const { return (m_Issues); }
+
+		/**
+		 * @brief Copy every path into its own StaticPath
+		 * @note Only use this when the paths must outlive the list, otherwise prefer the views
+		 */
+		std::vector<StaticPath> ToStaticPaths() const;
+
+	private:
+		std::vector<std::unique_ptr<TCHAR[]>> m_Arenas;
+		std::vector<PathView> m_Entries;
+		std::vector<PathListIssue> m_Issues;
+
+		friend PathList LoadPathList(const char* data, size_t size, const PathListLoaderOptions& options);
+	};
+
+	/**
+	 * @brief Parse a newline separated (LF or CRLF) UTF-8 list of paths
+	 * @details The input is cut into chunks at line boundaries, and every chunk is validated and parsed in parallel.
+	 *          Empty lines are skipped, malformed lines are reported in PathList::Issues() and don't stop the load.
+	 */
+	PathList LoadPathList(const char* data, size_t size, const PathListLoaderOptions& options = PathListLoaderOptions());
+
+	/**
+	 * @brief Memory map fileName and parse it with LoadPathList
+	 * @return An empty list if the file cannot be opened or is empty
+	 */
+	PathList LoadPathListFile(const char* fileName, const PathListLoaderOptions& options = PathListLoaderOptions());
+}
@@ -0,0 +1,355 @@
+#include "Benchmarks.h"
+#include "AllocationProfiler.h"
+#include "Path.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace PathCore;
+
+namespace
+{
+	using String = std::basic_string<TCHAR>;
+	using FilesystemPath = std::filesystem::path;
+
+	struct MicroBenchmarkShape
+	{
+		/* Segments after the root anchor */
+		int Depth;
+		int SegmentLength;
+	};
+
+	/* Path lengths from a short project path to a deep generated tree */
+	const MicroBenchmarkShape DefaultShapes[] = { { 4, 8 }, { 8, 16 }, { 16, 8 }, { 32, 24 } };
+
+	struct MicroBenchmarkResult
+	{
+		const char* Operation;
+		const char* Implementation;
+		MicroBenchmarkShape Shape;
+		size_t PathLength;
+		double NanosecondsPerOperation;
+		double BytesPerOperation;
+		double AllocationsPerOperation;
+	};
+
+	/* Written by every operation, so the compiler cannot drop the measured work */
+	volatile size_t Sink;
+
+	void Consume(const IPath& path) { Sink = Sink + path.Size() + static_cast<size_t>(path.Data()[0]); }
+	void Consume(const FilesystemPath& path) { Sink = Sink + path.native().size(); }
+
+	/* A different name for every index, all the same length, so renaming doesn't move the rest of the path */
+	String MakeSegment(int index, int length)
+	{
+		String segment(length, TEXT('a'));
+		for (int position = 0; position < length && index > 0; position++, index /= 26)
+			segment[position] = static_cast<TCHAR>(TEXT('a') + index % 26);
+		return (segment);
+	}
+
+	FilesystemPath ToFilesystemPath(const String& path)
+	{
+		// Converted once here, so the baseline is measured on its native string like PathBase is
+		return (FilesystemPath(path));
+	}
+
+	class MicroBenchmark
+	{
+	public:
+		MicroBenchmark(size_t iterations, std::vector<MicroBenchmarkResult>& outResults)
+			: m_Iterations(iterations),
+			m_Results(outResults)
+		{}
+
+	public:
+		/**
+		 * @brief Time operation, then count what it allocates in a second run (the counting is not timed)
+		 */
+		template<typename Operation>
+		void Run(const char* name, const char* implementation, const MicroBenchmarkShape& shape, size_t pathLength, Operation&& operation)
+		{
+			for (size_t iteration = 0; iteration < m_Iterations / 10 + 1; iteration++)
+				operation();
+
+			double seconds = MeasureSeconds([&]()
+			{
+				for (size_t iteration = 0; iteration < m_Iterations; iteration++)
+					operation();
+			});
+
+			AllocationStats stats;
+			{
+				AllocationScope scope;
+				for (size_t iteration = 0; iteration < m_Iterations; iteration++)
+					operation();
+				stats = scope.Stats();
+			}
+
+			double iterations = static_cast<double>(m_Iterations);
+			m_Results.push_back({ name, implementation, shape, pathLength, seconds * 1e9 / iterations,
+				stats.AllocatedBytes / iterations, stats.Allocations / iterations });
+		}
+
+	private:
+		size_t m_Iterations;
+		std::vector<MicroBenchmarkResult>& m_Results;
+	};
+
+	void RunShape(const MicroBenchmarkShape& shape, size_t iterations, std::vector<MicroBenchmarkResult>& outResults)
+	{
+		// "C:/aaaa/baaa/..." and the same path split in two halves, for Insert
+		String raw = TEXT("C:");
+		String head = TEXT("C:");
+		String headSegments;
+		String tail;
+		std::vector<String> segments;
+		for (int index = 0; index < shape.Depth; index++)
+		{
+			segments.push_back(MakeSegment(index, shape.SegmentLength));
+			raw += TEXT("/") + segments.back();
+			if (index < shape.Depth / 2)
+			{
+				head += TEXT("/") + segments.back();
+				headSegments += (headSegments.empty() ? TEXT("") : TEXT("/")) + segments.back();
+			}
+			else
+				tail += (tail.empty() ? TEXT("") : TEXT("/")) + segments.back();
+		}
+		String extraSegment = MakeSegment(shape.Depth + 1, shape.SegmentLength);
+		String renamedSegments[] = { MakeSegment(shape.Depth + 2, shape.SegmentLength), MakeSegment(shape.Depth + 3, shape.SegmentLength) };
+		size_t length = raw.size();
+
+		MicroBenchmark benchmark(iterations, outResults);
+		const char* pathBase = "PathBase";
+		const char* staticPath = "StaticPath";
+		const char* filesystem = "std::filesystem::path";
+
+		Path path(raw.c_str());
+		Path other(raw.c_str());
+		Path tailPath((TEXT("C:/") + tail).c_str());
+		StaticPath stored(path);
+		FilesystemPath filesystemPath = ToFilesystemPath(raw);
+		FilesystemPath filesystemOther = filesystemPath;
+		FilesystemPath filesystemHead = ToFilesystemPath(head);
+		FilesystemPath filesystemAnchor = ToFilesystemPath(TEXT("C:"));
+		FilesystemPath filesystemHeadSegments = ToFilesystemPath(headSegments);
+		FilesystemPath filesystemTail = ToFilesystemPath(tail);
+		FilesystemPath filesystemExtra = ToFilesystemPath(extraSegment);
+		FilesystemPath filesystemRenamed[] = { ToFilesystemPath(renamedSegments[0]), ToFilesystemPath(renamedSegments[1]) };
+		FilesystemPath::string_type filesystemRaw = filesystemPath.native();
+
+		// Construction
+		benchmark.Run("Construct", pathBase, shape, length, [&]() { Path constructed(raw.c_str()); Consume(constructed); });
+		benchmark.Run("Construct", filesystem, shape, length, [&]() { FilesystemPath constructed(filesystemRaw); Consume(constructed); });
+
+		// Copy and move
+		benchmark.Run("Copy", pathBase, shape, length, [&]() { Path copy(path); Consume(copy); });
+		benchmark.Run("Copy", staticPath, shape, length, [&]() { StaticPath copy(stored); Consume(copy); });
+		benchmark.Run("Copy", filesystem, shape, length, [&]() { FilesystemPath copy(filesystemPath); Consume(copy); });
+		benchmark.Run("CopyAssign", pathBase, shape, length, [&]() { other = path; Consume(other); });
+		benchmark.Run("CopyAssign", filesystem, shape, length, [&]() { filesystemOther = filesystemPath; Consume(filesystemOther); });
+		benchmark.Run("Move", pathBase, shape, length, [&]() { Path moved(std::move(path)); path = std::move(moved); Consume(path); });
+		benchmark.Run("Move", staticPath, shape, length, [&]() { StaticPath moved(std::move(stored)); stored = std::move(moved); Consume(stored); });
+		benchmark.Run("Move", filesystem, shape, length, [&]() { FilesystemPath moved(std::move(filesystemPath)); filesystemPath = std::move(moved); Consume(filesystemPath); });
+
+		// StaticPath conversion
+		benchmark.Run("ToStaticPath", pathBase, shape, length, [&]() { StaticPath converted(path); Consume(converted); });
+		benchmark.Run("ToStaticPath", filesystem, shape, length, [&]() { FilesystemPath::string_type converted(filesystemPath.native()); Sink = Sink + converted.size(); });
+
+		// Append then remove a segment, the path is back to its shape after every operation
+		benchmark.Run("Append(raw)+Shrink", pathBase, shape, length, [&]()
+		{
+			path.Append(extraSegment.c_str());
+			Consume(path);
+			SegmentIterator last = path.EndSegment();
+			--last;
+			path.Shrink(last);
+		});
+		benchmark.Run("Append(segment)+Shrink", pathBase, shape, length, [&]()
+		{
+			ConstSegmentIterator segment = stored.EndSegment();
+			--segment;
+			path.Append(segment);
+			Consume(path);
+			SegmentIterator last = path.EndSegment();
+			--last;
+			path.Shrink(last);
+		});
+		benchmark.Run("Append(raw)+Shrink", filesystem, shape, length, [&]()
+		{
+			filesystemPath /= filesystemExtra;
+			Consume(filesystemPath);
+			// Leaves the trailing separator, the next /= reuses it
+			filesystemPath.remove_filename();
+		});
+
+		// Shrink to half the depth, then append the other half back from a stored path
+		benchmark.Run("Shrink(half)+Append(range)", pathBase, shape, length, [&]()
+		{
+			SegmentIterator middle = path.BeginSegment() + (shape.Depth / 2 + 1);
+			path.Shrink(middle);
+			Consume(path);
+			path.Append(stored.BeginSegment() + (shape.Depth / 2 + 1), stored.EndSegment());
+		});
+		benchmark.Run("Shrink(half)+Append(range)", filesystem, shape, length, [&]()
+		{
+			filesystemPath = filesystemHead;
+			Consume(filesystemPath);
+			filesystemPath /= filesystemTail;
+		});
+
+		// Insert the second half in a path that only has the root anchor and the first half
+		Path headPath(head.c_str());
+		benchmark.Run("CopyAssign+Insert", pathBase, shape, length, [&]()
+		{
+			other = headPath;
+			SegmentIterator where = other.BeginSegment() + 1;
+			ConstSegmentIterator from = tailPath.BeginSegment() + 1;
+			other.Insert(where, from, tailPath.EndSegment());
+			Consume(other);
+		});
+		benchmark.Run("CopyAssign+Insert", filesystem, shape, length, [&]()
+		{
+			// No insertion in std::filesystem::path, the path is rebuilt around the inserted segments
+			filesystemOther = filesystemAnchor;
+			filesystemOther /= filesystemTail;
+			filesystemOther /= filesystemHeadSegments;
+			Consume(filesystemOther);
+		});
+
+		// Rename a segment in the middle (PathBase) or the file name (std::filesystem::path has nothing else)
+		int renameIndex = 0;
+		benchmark.Run("Rename", pathBase, shape, length, [&]()
+		{
+			SegmentIterator middle = path.BeginSegment() + (shape.Depth / 2);
+			middle.Rename(renamedSegments[renameIndex ^= 1].c_str());
+			Consume(path);
+		});
+		benchmark.Run("Rename", filesystem, shape, length, [&]()
+		{
+			filesystemPath.replace_filename(filesystemRenamed[renameIndex ^= 1]);
+			Consume(filesystemPath);
+		});
+
+		// Extensions, swapped back and forth so the path keeps its length
+		const TCHAR* extensions[] = { TEXT(".bak"), TEXT(".tmp") };
+		FilesystemPath filesystemExtensions[] = { ToFilesystemPath(extensions[0]), ToFilesystemPath(extensions[1]) };
+		int extensionIndex = 0;
+		benchmark.Run("ReplaceExtension", pathBase, shape, length, [&]()
+		{
+			path.ReplaceExtension(extensions[extensionIndex ^= 1]);
+			Consume(path);
+		});
+		benchmark.Run("ReplaceExtension", filesystem, shape, length, [&]()
+		{
+			filesystemPath.replace_extension(filesystemExtensions[extensionIndex ^= 1]);
+			Consume(filesystemPath);
+		});
+		benchmark.Run("Extension", staticPath, shape, length, [&]() { Sink = Sink + stored.Extension().size() + stored.Stem().size(); });
+		benchmark.Run("Extension", filesystem, shape, length, [&]()
+		{
+			Sink = Sink + filesystemPath.extension().native().size() + filesystemPath.stem().native().size();
+		});
+
+		// Segment iteration
+		benchmark.Run("IterateSegments", pathBase, shape, length, [&]()
+		{
+			size_t total = 0;
+			for (ConstSegmentIterator segment = stored.BeginSegment(); segment; ++segment)
+				total += segment.Size();
+			Sink = Sink + total;
+		});
+		benchmark.Run("IterateSegments", filesystem, shape, length, [&]()
+		{
+			size_t total = 0;
+			for (const FilesystemPath& segment : filesystemPath)
+				total += segment.native().size();
+			Sink = Sink + total;
+		});
+	}
+
+	/* Allocation counts are null when the profiler is compiled out, nothing was counted (0 would read as "no allocation") */
+	void WriteAllocationCount(std::ostream& stream, double count)
+	{
+		if (PATH_ALLOCATION_PROFILER)
+			stream << count;
+		else
+			stream << "null";
+	}
+
+	void WriteJson(std::ostream& stream, const std::vector<MicroBenchmarkResult>& results)
+	{
+		stream << "[\n";
+		for (size_t index = 0; index < results.size(); index++)
+		{
+			const MicroBenchmarkResult& result = results[index];
+			stream << "\t{\"operation\":\"" << result.Operation << "\",\"implementation\":\"" << result.Implementation
+				<< "\",\"depth\":" << result.Shape.Depth << ",\"segment_length\":" << result.Shape.SegmentLength
+				<< ",\"path_length\":" << result.PathLength << ",\"ns_per_op\":" << result.NanosecondsPerOperation
+				<< ",\"bytes_per_op\":";
+			WriteAllocationCount(stream, result.BytesPerOperation);
+			stream << ",\"allocs_per_op\":";
+			WriteAllocationCount(stream, result.AllocationsPerOperation);
+			stream << "}" << (index + 1 < results.size() ? "," : "") << "\n";
+		}
+		stream << "]\n";
+	}
+}
+
+int RunPathMicroBenchmarks(int argc, char** argv)
+{
+	std::vector<MicroBenchmarkShape> shapes;
+	MicroBenchmarkShape shape = { 0, 0 };
+	size_t iterations = 100000;
+	const char* outputFile = nullptr;
+	for (int index = 0; index < argc; index++)
+	{
+		bool hasValue = index + 1 < argc;
+		if (std::strcmp(argv[index], "--depth") == 0 && hasValue)
+			shape.Depth = std::atoi(argv[++index]);
+		else if (std::strcmp(argv[index], "--segment-length") == 0 && hasValue)
+			shape.SegmentLength = std::atoi(argv[++index]);
+		else if (std::strcmp(argv[index], "--iterations") == 0 && hasValue)
+			iterations = std::strtoull(argv[++index], nullptr, 10);
+		else if (std::strcmp(argv[index], "--output") == 0 && hasValue)
+			outputFile = argv[++index];
+		else
+		{
+			std::cerr << "Usage: --microbench [--depth N] [--segment-length N] [--iterations N] [--output file.json]" << std::endl;
+			return (1);
+		}
+	}
+
+	if (shape.Depth > 0 || shape.SegmentLength > 0)
+		shapes.push_back({ shape.Depth > 0 ? shape.Depth : 8, shape.SegmentLength > 0 ? shape.SegmentLength : 16 });
+	else
+		shapes.assign(std::begin(DefaultShapes), std::end(DefaultShapes));
+
+	std::vector<MicroBenchmarkResult> results;
+	for (const MicroBenchmarkShape& current : shapes)
+	{
+		// The paths start with "C:" on every platform, it is a folder name for the Posix rules
+		size_t length = WindowsRules::DiskNameLength + static_cast<size_t>(current.Depth) * (current.SegmentLength + PATH_SEPARATOR_LENGTH);
+		if (current.Depth < 2 || current.SegmentLength < PATH_MIN_FOLDER_NAME_LENGTH || current.SegmentLength > PATH_MAX_FOLDER_NAME_LENGTH
+			|| length + PATH_SEPARATOR_LENGTH + current.SegmentLength > MAX_PATH_LENGTH)
+		{
+			std::cerr << "Skipped depth " << current.Depth << " segment length " << current.SegmentLength << ": not a valid path on this platform" << std::endl;
+			continue;
+		}
+		RunShape(current, iterations, results);
+	}
+
+	if (outputFile)
+	{
+		std::ofstream output(outputFile);
+		WriteJson(output, results);
+	}
+	else
+		WriteJson(std::cout, results);
+	return (0);
+}
@@ -0,0 +1,286 @@
+#pragma once
+
+#include "Path.h"
+#include "PathHash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace PathCore
+{
+	/**
+	 * Map path prefixes (mount points, ownership roots, quota domains, ...) to a value,
+	 * and find the deepest configured prefix of any path.
+	 *
+	 * The prefixes are stored in a segment trie, so a lookup walks at most the depth of the path
+	 * and a prefix only matches whole segments ("C:/Data" is a prefix of "C:/Data/A", not of "C:/Database").
+	 *
+	 * Read-copy-update: the trie is immutable once published, readers use the current snapshot without locking,
+	 * and writers copy it, edit the copy then publish it. Updates are expected to be rare.
+	 * Pin a snapshot with Read() to do many lookups for the cost of one atomic load.
+	 */
+	template<typename T>
+	class PathPrefixMap
+	{
+	public:
+		class Snapshot
+		{
+		public:
+			Snapshot();
+
+		public:
+			/**
+			 * @brief Find the value of the deepest prefix of path
+			 * @param matchedSize If not null, set to the size of the matched prefix in path
+			 * @return nullptr if no prefix of path is in the map
+			 */
+			const T* FindLongestPrefix(const IPath& path, PathSize* matchedSize = nullptr) const;
+			/* Exact lookup */
+			const T* Find(const IPath& prefix) const;
+
+			size_t Size() const { return (m_ValueCount); }
+
+			/* Add or replace the value of prefix */
+			void Insert(const IPath& prefix, T value);
+			/* @return false if prefix wasn't in the map */
+			bool Erase(const IPath& prefix);
+
+		private:
+			static constexpr uint32_t InvalidNode = std::numeric_limits<uint32_t>::max();
+			static constexpr uint32_t RootNode = 0;
+
+			struct Node
+			{
+				std::optional<T> Value;
+			};
+
+			/* An edge of the trie, stored in one open addressing table keyed by (parent, segment) */
+			struct Edge
+			{
+				uint64_t Hash;
+				uint32_t Parent;
+				uint32_t Child;
+				uint32_t TextOffset;
+				SegmentSize TextSize;
+			};
+
+		private:
+			static uint64_t HashEdge(uint32_t parent, const TCHAR* segment, SegmentSize size);
+			uint32_t FindChild(uint32_t parent, const TCHAR* segment, SegmentSize size) const;
+			uint32_t FindOrAddChild(uint32_t parent, const TCHAR* segment, SegmentSize size);
+			uint32_t FindNode(const IPath& prefix) const;
+			void Grow();
+
+		private:
+			std::vector<Node> m_Nodes;
+			std::vector<Edge> m_Edges;
+			size_t m_EdgeCount;
+			/* The text of every segment in the trie */
+			std::vector<TCHAR> m_Characters;
+			size_t m_ValueCount;
+		};
+
+	public:
+		PathPrefixMap()
+			: m_Snapshot(std::make_shared<const Snapshot>())
+		{}
+
+	public:
+		/* Pin the current snapshot, it stays valid (and unchanged) as long as it is referenced */
+		std::shared_ptr<const Snapshot> Read() const { return (std::atomic_load(&m_Snapshot)); }
+
+		/**
+		 * @brief Copy the value of the deepest prefix of path into outValue
+		 * @return false if no prefix of path is in the map
+		 */
+		bool FindLongestPrefix(const IPath& path, T& outValue, PathSize* matchedSize = nullptr) const
+		{
+			std::shared_ptr<const Snapshot> snapshot = Read();
+			const T* value = snapshot->FindLongestPrefix(path, matchedSize);
+			if (value)
+				outValue = *value;
+			return (value != nullptr);
+		}
+
+		void Insert(const IPath& prefix, T value)
+		{
+			Update([&prefix, &value](Snapshot& snapshot) { snapshot.Insert(prefix, std::move(value)); });
+		}
+		bool Erase(const IPath& prefix)
+		{
+			bool erased = false;
+			Update([&prefix, &erased](Snapshot& snapshot) { erased = snapshot.Erase(prefix); });
+			return (erased);
+		}
+
+		/**
+		 * @brief Apply several edits and publish them at once
+		 * @param edit Called with a private copy of the current snapshot, as Snapshot&
+		 */
+		template<typename Function>
+		void Update(Function&& edit)
+		{
+			std::lock_guard<std::mutex> lock(m_WriteMutex);
+
+			std::shared_ptr<Snapshot> copy = std::make_shared<Snapshot>(*Read());
+			edit(*copy);
+			std::atomic_store(&m_Snapshot, std::shared_ptr<const Snapshot>(std::move(copy)));
+		}
+
+	private:
+		std::shared_ptr<const Snapshot> m_Snapshot;
+		/* Serialize the writers, readers never take it */
+		std::mutex m_WriteMutex;
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// PATH PREFIX MAP SNAPSHOT
+	///////////////////////////////////////////////////////////////////////////
+
+	template<typename T>
+	PathPrefixMap<T>::Snapshot::Snapshot()
+		: m_Nodes(1), // The root, the parent of the disk segments
+		m_Edges(16, Edge{ 0, InvalidNode, InvalidNode, 0, 0 }),
+		m_EdgeCount(0),
+		m_ValueCount(0)
+	{}
+
+	template<typename T>
+	const T* PathPrefixMap<T>::Snapshot::FindLongestPrefix(const IPath& path, PathSize* matchedSize) const
+	{
+		const T* bestValue = nullptr;
+		uint32_t node = RootNode;
+		for (ConstSegmentIterator segment = path.BeginSegment(); segment; ++segment)
+		{
+			SegmentSize segmentSize = segment.Size();
+			node = FindChild(node, *segment, segmentSize);
+			if (node == InvalidNode)
+				break;
+
+			if (m_Nodes[node].Value)
+			{
+				bestValue = &*m_Nodes[node].Value;
+				// The empty first segment of "/usr" is the root "/", its separator is the matched prefix
+				if (matchedSize)
+					*matchedSize = (segmentSize == 0 && segment.Pos() == 0) ? PATH_SEPARATOR_LENGTH : segment.Pos() + segmentSize;
+			}
+		}
+		return (bestValue);
+	}
+
+	template<typename T>
+	const T* PathPrefixMap<T>::Snapshot::Find(const IPath& prefix) const
+	{
+		uint32_t node = FindNode(prefix);
+		if (node == InvalidNode || m_Nodes[node].Value.has_value() == false)
+			return (nullptr);
+		return (&*m_Nodes[node].Value);
+	}
+
+	template<typename T>
+	void PathPrefixMap<T>::Snapshot::Insert(const IPath& prefix, T value)
+	{
+		uint32_t node = RootNode;
+		for (ConstSegmentIterator segment = prefix.BeginSegment(); segment; ++segment)
+			node = FindOrAddChild(node, *segment, segment.Size());
+
+		if (m_Nodes[node].Value.has_value() == false)
+			m_ValueCount++;
+		m_Nodes[node].Value = std::move(value);
+	}
+
+	template<typename T>
+	bool PathPrefixMap<T>::Snapshot::Erase(const IPath& prefix)
+	{
+		// The nodes are kept, they are reused if the prefix is added back
+		uint32_t node = FindNode(prefix);
+		if (node == InvalidNode || m_Nodes[node].Value.has_value() == false)
+			return (false);
+
+		m_Nodes[node].Value.reset();
+		m_ValueCount--;
+		return (true);
+	}
+
+	template<typename T>
+	uint64_t PathPrefixMap<T>::Snapshot::HashEdge(uint32_t parent, const TCHAR* segment, SegmentSize size)
+	{
+		uint64_t hash = PathHashSeed ^ (static_cast<uint64_t>(parent) * 0x9E3779B97F4A7C15ull);
+		return (HashCharacters(segment, size, hash));
+	}
+
+	template<typename T>
+	uint32_t PathPrefixMap<T>::Snapshot::FindChild(uint32_t parent, const TCHAR* segment, SegmentSize size) const
+	{
+		uint64_t hash = HashEdge(parent, segment, size);
+		size_t mask = m_Edges.size() - 1;
+		for (size_t slot = hash & mask; ; slot = (slot + 1) & mask)
+		{
+			const Edge& edge = m_Edges[slot];
+			if (edge.Child == InvalidNode)
+				return (InvalidNode);
+			if (edge.Hash == hash && edge.Parent == parent && edge.TextSize == size
+				&& std::equal(segment, segment + size, m_Characters.data() + edge.TextOffset))
+				return (edge.Child);
+		}
+	}
+
+	template<typename T>
+	uint32_t PathPrefixMap<T>::Snapshot::FindOrAddChild(uint32_t parent, const TCHAR* segment, SegmentSize size)
+	{
+		uint32_t child = FindChild(parent, segment, size);
+		if (child != InvalidNode)
+			return (child);
+
+		// Keep the table at most half full
+		if ((m_EdgeCount + 1) * 2 > m_Edges.size())
+			Grow();
+
+		child = static_cast<uint32_t>(m_Nodes.size());
+		m_Nodes.emplace_back();
+
+		Edge edge = { HashEdge(parent, segment, size), parent, child, static_cast<uint32_t>(m_Characters.size()), size };
+		m_Characters.insert(m_Characters.end(), segment, segment + size);
+
+		size_t mask = m_Edges.size() - 1;
+		size_t slot = edge.Hash & mask;
+		while (m_Edges[slot].Child != InvalidNode)
+			slot = (slot + 1) & mask;
+		m_Edges[slot] = edge;
+		m_EdgeCount++;
+
+		return (child);
+	}
+
+	template<typename T>
+	uint32_t PathPrefixMap<T>::Snapshot::FindNode(const IPath& prefix) const
+	{
+		uint32_t node = RootNode;
+		for (ConstSegmentIterator segment = prefix.BeginSegment(); segment && node != InvalidNode; ++segment)
+			node = FindChild(node, *segment, segment.Size());
+		return (node);
+	}
+
+	template<typename T>
+	void PathPrefixMap<T>::Snapshot::Grow()
+	{
+		std::vector<Edge> oldEdges(m_Edges.size() * 2, Edge{ 0, InvalidNode, InvalidNode, 0, 0 });
+		oldEdges.swap(m_Edges);
+
+		size_t mask = m_Edges.size() - 1;
+		for (const Edge& edge : oldEdges)
+		{
+			if (edge.Child == InvalidNode)
+				continue;
+
+			size_t slot = edge.Hash & mask;
+			while (m_Edges[slot].Child != InvalidNode)
+				slot = (slot + 1) & mask;
+			m_Edges[slot] = edge;
+		}
+	}
+}
@@ -0,0 +1,126 @@
+#include "PathQueue.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+
+namespace PathCore
+{
+	namespace
+	{
+		/* The record only fills the end of the ring, the next one starts at its beginning */
+		constexpr uint32_t PaddingFlag = 1u << 31;
+		/* Header (uint32), path size (uint16) and 2 unused bytes before the characters */
+		constexpr size_t RecordHeaderSize = 8;
+		constexpr size_t RecordAlignment = 8;
+	}
+
+	PathQueue::PathQueue(size_t capacity)
+		: m_Capacity(std::bit_ceil(std::max(capacity, RecordSize(MaxPathLengthOfAllRules)))),
+		m_Buffer(new uint64_t[m_Capacity / sizeof(uint64_t)]()),
+		m_Head(0),
+		m_Tail(0),
+		m_ReadPosition(0),
+		m_WaitCount(0)
+	{}
+
+	size_t PathQueue::RecordSize(PathSize size)
+	{
+		return ((RecordHeaderSize + (size + 1) * sizeof(TCHAR) + RecordAlignment - 1) & ~(RecordAlignment - 1));
+	}
+
+	std::atomic_ref<uint32_t> PathQueue::HeaderAt(uint64_t position) const
+	{
+		uint8_t* bytes = reinterpret_cast<uint8_t*>(m_Buffer.get());
+		return (std::atomic_ref<uint32_t>(*reinterpret_cast<uint32_t*>(bytes + (position & (m_Capacity - 1)))));
+	}
+
+	bool PathQueue::TryPush(const IPath& path)
+	{
+		size_t recordSize = RecordSize(path.Size());
+		assert(recordSize <= m_Capacity && "The path is longer than the queue can hold");
+
+		// Reserve the record, and the end of the ring before it when the record doesn't fit there
+		uint64_t head = m_Head.load(std::memory_order_relaxed);
+		size_t padding = 0;
+		do
+		{
+			size_t offset = static_cast<size_t>(head & (m_Capacity - 1));
+			padding = offset + recordSize > m_Capacity ? m_Capacity - offset : 0;
+			// Not head - tail: head can be stale and behind a tail the consumer moved since, the compare exchange catches it
+			if (head + padding + recordSize > m_Tail.load(std::memory_order_acquire) + m_Capacity)
+				return (false);
+		}
+		while (m_Head.compare_exchange_weak(head, head + padding + recordSize, std::memory_order_relaxed) == false);
+
+		if (padding > 0)
+		{
+			HeaderAt(head).store(static_cast<uint32_t>(padding) | PaddingFlag, std::memory_order_release);
+			head += padding;
+		}
+
+		// The room was zeroed by Release(), the header stays 0 until the characters are written
+		uint8_t* record = reinterpret_cast<uint8_t*>(m_Buffer.get()) + (head & (m_Capacity - 1));
+		PathSize size = path.Size();
+		std::memcpy(record + sizeof(uint32_t), &size, sizeof(PathSize));
+		std::memcpy(record + RecordHeaderSize, path.Data(), size * sizeof(TCHAR));
+		reinterpret_cast<TCHAR*>(record + RecordHeaderSize)[size] = NULL;
+		HeaderAt(head).store(static_cast<uint32_t>(recordSize), std::memory_order_release);
+		return (true);
+	}
+
+	void PathQueue::Push(const IPath& path)
+	{
+		while (TryPush(path) == false)
+		{
+			uint64_t tail = m_Tail.load(std::memory_order_acquire);
+			if (TryPush(path))
+				return;
+			m_WaitCount.fetch_add(1, std::memory_order_relaxed);
+			m_Tail.wait(tail, std::memory_order_acquire);
+		}
+	}
+
+	size_t PathQueue::Pop(std::vector<PathView>& paths, size_t maxCount)
+	{
+		size_t popped = 0;
+		// Popped but not released yet, a full ring would read them again after the wrap
+		uint64_t end = m_Tail.load(std::memory_order_relaxed) + m_Capacity;
+		while (popped < maxCount && m_ReadPosition < end)
+		{
+			uint32_t header = HeaderAt(m_ReadPosition).load(std::memory_order_acquire);
+			if (header == 0)
+				break; // Not published yet, the next ones wait for it to keep the order
+
+			uint8_t* record = reinterpret_cast<uint8_t*>(m_Buffer.get()) + (m_ReadPosition & (m_Capacity - 1));
+			m_ReadPosition += header & ~PaddingFlag;
+			if (header & PaddingFlag)
+				continue;
+
+			PathSize size;
+			std::memcpy(&size, record + sizeof(uint32_t), sizeof(PathSize));
+			paths.emplace_back(reinterpret_cast<const TCHAR*>(record + RecordHeaderSize), size);
+			popped++;
+		}
+		return (popped);
+	}
+
+	void PathQueue::Release()
+	{
+		uint64_t tail = m_Tail.load(std::memory_order_relaxed);
+		if (tail == m_ReadPosition)
+			return;
+
+		// A header can land anywhere in the released room, it must read 0 until its record is published
+		uint8_t* bytes = reinterpret_cast<uint8_t*>(m_Buffer.get());
+		size_t from = static_cast<size_t>(tail & (m_Capacity - 1));
+		size_t size = static_cast<size_t>(m_ReadPosition - tail);
+		size_t firstPart = std::min(size, m_Capacity - from);
+		std::memset(bytes + from, 0, firstPart);
+		std::memset(bytes, 0, size - firstPart);
+
+		m_Tail.store(m_ReadPosition, std::memory_order_release);
+		m_Tail.notify_all();
+	}
+}
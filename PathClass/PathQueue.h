@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Path.h"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace PathCore
+{
+	/**
+	 * A bounded queue of paths from many producer threads to one consumer thread (MPSC), without lock and without allocation.
+	 *
+	 * A producer reserves the room of its path in a ring of bytes with a single compare exchange, copies the characters
+	 * in place as a record (size, characters, null terminator) and publishes it by storing its header last.
+	 * The consumer reads the records in place as PathView, in reservation order, and gives their room back in batches.
+	 *
+	 * When the ring is full, TryPush() fails and Push() waits for the consumer to release room (backpressure).
+	 *
+	 * @example Producers: queue.Push(path); Consumer: while (queue.Pop(paths, 256) > 0) { Process(paths); paths.clear(); queue.Release(); }
+	 */
+	class PathQueue
+	{
+	public:
+		/**
+		 * @param capacity The bytes of the ring, rounded up to a power of 2. It must hold a record of the longest path
+		 */
+		explicit PathQueue(size_t capacity);
+
+		PathQueue(const PathQueue&) = delete;
+		PathQueue& operator=(const PathQueue&) = delete;
+
+	public:
+		/* PRODUCERS, any thread */
+
+		/* Copy path in the ring, false if there is no room for it */
+		bool TryPush(const IPath& path);
+		/* Copy path in the ring, wait for the consumer to release room when it is full */
+		void Push(const IPath& path);
+
+		/* CONSUMER, a single thread */
+
+		/**
+		 * @brief Append up to maxCount published paths to paths, in the order they were reserved
+		 * @return The amount of paths appended, 0 when none is published yet
+		 * @note The views stay valid until Release()
+		 */
+		size_t Pop(std::vector<PathView>& paths, size_t maxCount = std::numeric_limits<size_t>::max());
+		/* Give the room of every popped path back to the producers */
+		void Release();
+
+	public:
+		size_t Capacity() const { return (m_Capacity); }
+		/* The bytes a path of size characters takes in the ring */
+		static size_t RecordSize(PathSize size);
+		/* How many times Push() had to wait for room */
+		uint64_t WaitCount() const { return (m_WaitCount.load(std::memory_order_relaxed)); }
+
+	private:
+		/* The header of the record at position, 0 until the record is published */
+		std::atomic_ref<uint32_t> HeaderAt(uint64_t position) const;
+
+	private:
+		size_t m_Capacity;
+		std::unique_ptr<uint64_t[]> m_Buffer;
+		/* Where the next record is reserved, moved by the producers */
+		alignas(64) std::atomic<uint64_t> m_Head;
+		/* Everything before is released (and zeroed), moved by the consumer */
+		alignas(64) std::atomic<uint64_t> m_Tail;
+		/* Where the consumer reads the next record, consumer only */
+		alignas(64) uint64_t m_ReadPosition;
+		std::atomic<uint64_t> m_WaitCount;
+	};
+}
@@ -0,0 +1,160 @@
+#include "Benchmarks.h"
+#include "PathHash.h"
+#include "PathQueue.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace PathCore;
+
+namespace
+{
+	/* What the scanners did before: a StaticPath per hand off, through a bounded queue behind a mutex */
+	class LockedPathQueue
+	{
+	public:
+		explicit LockedPathQueue(size_t capacity)
+			: m_Capacity(capacity)
+		{}
+
+	public:
+		void Push(const IPath& path)
+		{
+			StaticPath copy(path);
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_NotFull.wait(lock, [this]() { return (m_Paths.size() < m_Capacity); });
+			m_Paths.push_back(std::move(copy));
+			m_NotEmpty.notify_one();
+		}
+
+		/* Move up to maxCount paths to paths, wait for one when the queue is empty */
+		size_t Pop(std::vector<StaticPath>& paths, size_t maxCount)
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_NotEmpty.wait(lock, [this]() { return (m_Paths.empty() == false); });
+			size_t count = std::min(maxCount, m_Paths.size());
+			for (size_t index = 0; index < count; index++)
+			{
+				paths.push_back(std::move(m_Paths.front()));
+				m_Paths.pop_front();
+			}
+			m_NotFull.notify_all();
+			return (count);
+		}
+
+	private:
+		size_t m_Capacity;
+		std::deque<StaticPath> m_Paths;
+		std::mutex m_Mutex;
+		std::condition_variable m_NotFull;
+		std::condition_variable m_NotEmpty;
+	};
+
+	/* Every producer pushes its share of paths, the consumer sums their sizes */
+	template<typename PushFunction, typename ConsumeFunction>
+	double RunProducers(const std::vector<StaticPath>& paths, int producerCount, PushFunction&& push, ConsumeFunction&& consume)
+	{
+		return (MeasureSeconds([&]()
+		{
+			std::thread consumer(consume);
+			std::vector<std::thread> producers;
+			for (int producer = 0; producer < producerCount; producer++)
+			{
+				producers.emplace_back([&paths, &push, producer, producerCount]()
+				{
+					for (size_t index = producer; index < paths.size(); index += producerCount)
+						push(paths[index]);
+				});
+			}
+			for (std::thread& producer : producers)
+				producer.join();
+			consumer.join();
+		}));
+	}
+}
+
+void BenchmarkPathQueue()
+{
+	const size_t pathCount = 1000000;
+	const size_t batchSize = 256;
+	const size_t queueBytes = 1024 * 1024;
+	std::vector<StaticPath> paths = GenerateNumberedPaths(pathCount, TEXT("C:/Projects/Game/Content/Textures"), TEXT("Set_"), TEXT("Texture_"), { TEXT(".png") });
+	uint64_t expected = 0;
+	for (const StaticPath& path : paths)
+		expected += path.Size();
+
+	std::cout << "PathQueue: " << pathCount << " paths, " << queueBytes / 1024 << " KB ring, batches of " << batchSize << std::endl;
+	for (int producerCount : { 1, 2, 4, 8, 16, 32, 64 })
+	{
+		LockedPathQueue locked(queueBytes / PathQueue::RecordSize(paths.back().Size()));
+		uint64_t lockedChecksum = 0;
+		double lockedSeconds = RunProducers(paths, producerCount, [&locked](const IPath& path) { locked.Push(path); }, [&]()
+		{
+			std::vector<StaticPath> received;
+			for (size_t count = 0; count < pathCount;)
+			{
+				count += locked.Pop(received, batchSize);
+				for (const StaticPath& path : received)
+					lockedChecksum += path.Size();
+				received.clear();
+			}
+		});
+
+		PathQueue queue(queueBytes);
+		uint64_t queueChecksum = 0;
+		double queueSeconds = RunProducers(paths, producerCount, [&queue](const IPath& path) { queue.Push(path); }, [&]()
+		{
+			std::vector<PathView> received;
+			received.reserve(batchSize);
+			for (size_t count = 0; count < pathCount;)
+			{
+				size_t popped = queue.Pop(received, batchSize);
+				if (popped == 0)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+				for (const PathView& path : received)
+					queueChecksum += path.Size();
+				received.clear();
+				queue.Release();
+				count += popped;
+			}
+		});
+
+		std::cout << "\t" << producerCount << " producers: mutex and StaticPath " << pathCount / lockedSeconds / 1e6 << " M paths/s, PathQueue "
+			<< pathCount / queueSeconds / 1e6 << " M paths/s (" << queue.WaitCount() << " waits for room)"
+			<< (lockedChecksum == expected && queueChecksum == expected ? "" : " (MISMATCH)") << std::endl;
+	}
+
+	// No room left: TryPush fails until the consumer releases
+	PathQueue small(PathQueue::RecordSize(MaxPathLengthOfAllRules));
+	std::vector<PathView> received;
+	size_t pushed = 0;
+	while (small.TryPush(paths[pushed]))
+		pushed++;
+	bool backpressure = pushed > 0 && small.Pop(received) == pushed && small.TryPush(paths[0]) == false;
+	received.clear();
+	small.Release();
+	backpressure = backpressure && small.TryPush(paths[0]) && small.Pop(received) == 1 && ArePathsEqual(received[0], paths[0]);
+	received.clear();
+	small.Release();
+
+	// Exactly full: records of 64 bytes fill the whole ring, Pop stops at its end instead of reading them again
+	StaticPath record(std::basic_string<TCHAR>((64 - 8) / sizeof(TCHAR) - 1, TEXT('x')).c_str());
+	PathQueue exact(PathQueue::RecordSize(MaxPathLengthOfAllRules));
+	size_t fitting = exact.Capacity() / PathQueue::RecordSize(record.Size());
+	bool exactlyFull = PathQueue::RecordSize(record.Size()) == 64;
+	for (size_t index = 0; index < fitting; index++)
+		exactlyFull = exactlyFull && exact.TryPush(record);
+	exactlyFull = exactlyFull && exact.TryPush(record) == false && exact.Pop(received) == fitting && exact.Pop(received) == 0;
+	received.clear();
+	exact.Release();
+	exactlyFull = exactlyFull && exact.TryPush(record) && exact.Pop(received, 2) == 1;
+	backpressure = backpressure && exactlyFull;
+	std::cout << "\tBackpressure: " << pushed << " paths fill a " << small.Capacity() << " bytes ring" << (backpressure ? "" : " (MISMATCH)") << std::endl;
+}
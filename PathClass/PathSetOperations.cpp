@@ -0,0 +1,333 @@
+#include "PathSetOperations.h"
+#include "PathEncoding.h"
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace PathCore
+{
+	namespace
+	{
+		using String = std::basic_string<TCHAR>;
+
+		/* Partitions per thread of the pool, so a partition holding a big folder doesn't leave the others idle */
+		constexpr uint32_t PartitionsPerThread = 4;
+
+		/**
+		 * @brief Decode a line of a snapshot (its line break already removed) to a null terminated path
+		 * @param out Must hold MaxPathLengthOfAllRules + NULL_TERMINATOR_LENGTH characters, a snapshot can come from any platform
+		 * @return false for an empty line, or a line that is not valid UTF-8 or too long
+		 */
+		bool DecodeLine(const char* line, size_t size, TCHAR* out, PathSize& outSize)
+		{
+			if (size > 0 && line[size - 1] == '\r')
+				size--;
+			size_t decodedSize = 0;
+			if (size == 0 || DecodeUtf8(line, size, out, MaxPathLengthOfAllRules, decodedSize) == false)
+				return (false);
+			out[decodedSize] = NULL;
+			outSize = static_cast<PathSize>(decodedSize);
+			return (true);
+		}
+
+		class FileReader : public SortedPathReader
+		{
+		public:
+			FileReader(const char* data, uint64_t begin, uint64_t end)
+				: m_Data(data),
+				m_Position(begin),
+				m_End(end),
+				m_Buffer(MaxPathLengthOfAllRules + NULL_TERMINATOR_LENGTH)
+			{}
+
+			bool Next(PathView& path) override
+			{
+				while (m_Position < m_End)
+				{
+					// The end of a range is always the start of a line, or the end of the file
+					const char* line = m_Data + m_Position;
+					const char* lineBreak = static_cast<const char*>(std::memchr(line, '\n', m_End - m_Position));
+					size_t size = lineBreak ? static_cast<size_t>(lineBreak - line) : static_cast<size_t>(m_End - m_Position);
+					m_Position += size + (lineBreak ? 1 : 0);
+
+					PathSize pathSize;
+					if (DecodeLine(line, size, m_Buffer.data(), pathSize))
+					{
+						path = PathView(m_Buffer.data(), pathSize);
+						return (true);
+					}
+				}
+				return (false);
+			}
+
+		private:
+			const char* m_Data;
+			uint64_t m_Position;
+			uint64_t m_End;
+			std::vector<TCHAR> m_Buffer;
+		};
+
+		PathView ViewOf(const String& path)
+		{
+			return (PathView(path.c_str(), static_cast<PathSize>(path.size())));
+		}
+
+		/* Walk the two ranges side by side */
+		void MergeRange(PathSetOperation operation, SortedPathReader& first, SortedPathReader& second, uint32_t partition,
+			const PathMergeCallback& callback, PathMergeStats& stats)
+		{
+			bool keepOnlyInFirst = operation != PathSetOperation::Intersection;
+			bool keepOnlyInSecond = operation == PathSetOperation::Union || operation == PathSetOperation::Diff;
+			bool keepInBoth = operation == PathSetOperation::Union || operation == PathSetOperation::Intersection;
+
+			PathMergeEntry entry = { PathView(), PathMergeSide::InBoth, partition };
+			PathView path;
+			PathView otherPath;
+			bool hasPath = first.Next(path);
+			bool hasOtherPath = second.Next(otherPath);
+			while (hasPath && hasOtherPath)
+			{
+				int order = ComparePaths(path, otherPath);
+				if (order < 0)
+				{
+					stats.OnlyInFirst++;
+					if (keepOnlyInFirst)
+					{
+						entry.Path = path;
+						entry.Side = PathMergeSide::OnlyInFirst;
+						callback(entry);
+					}
+					hasPath = first.Next(path);
+				}
+				else if (order > 0)
+				{
+					stats.OnlyInSecond++;
+					if (keepOnlyInSecond)
+					{
+						entry.Path = otherPath;
+						entry.Side = PathMergeSide::OnlyInSecond;
+						callback(entry);
+					}
+					hasOtherPath = second.Next(otherPath);
+				}
+				else
+				{
+					stats.InBoth++;
+					if (keepInBoth)
+					{
+						entry.Path = path;
+						entry.Side = PathMergeSide::InBoth;
+						callback(entry);
+					}
+					hasPath = first.Next(path);
+					hasOtherPath = second.Next(otherPath);
+				}
+			}
+
+			// One source is over, what is left of the other one is only in it
+			if (keepOnlyInFirst)
+			{
+				entry.Side = PathMergeSide::OnlyInFirst;
+				for (; hasPath; hasPath = first.Next(path))
+				{
+					stats.OnlyInFirst++;
+					entry.Path = path;
+					callback(entry);
+				}
+			}
+			if (keepOnlyInSecond)
+			{
+				entry.Side = PathMergeSide::OnlyInSecond;
+				for (; hasOtherPath; hasOtherPath = second.Next(otherPath))
+				{
+					stats.OnlyInSecond++;
+					entry.Path = otherPath;
+					callback(entry);
+				}
+			}
+		}
+
+		/**
+		 * @brief The paths the sources are cut on: a partition goes from a bound (included) to the next one (not included)
+		 * @details Every bound is the shortest folder prefix of a sample that is after the previous bound,
+		 *          so a folder and what it contains are in the same partition unless it alone is bigger than a partition.
+		 */
+		std::vector<String> FindPartitionBounds(const SortedPathSource& source, uint32_t partitionCount)
+		{
+			std::vector<String> bounds;
+			String previous;
+			if (source.PathAt(0, previous) == false)
+				return (bounds);
+
+			String sample;
+			for (uint32_t partition = 1; partition < partitionCount; partition++)
+			{
+				if (source.PathAt(source.EndPosition() * partition / partitionCount, sample) == false)
+					break;
+
+				// Add a segment at a time until the prefix is after the previous bound, the whole sample always is unless it is the same path
+				String prefix;
+				size_t prefixSize = 0;
+				do
+				{
+					prefixSize++;
+					while (prefixSize < sample.size() && IsSeparator(sample[prefixSize]) == false)
+						prefixSize++;
+					prefix.assign(sample, 0, prefixSize);
+				} while (prefixSize < sample.size() && ComparePaths(ViewOf(prefix), ViewOf(previous)) <= 0);
+
+				if (ComparePaths(ViewOf(prefix), ViewOf(previous)) <= 0)
+					continue; // The sample is the previous bound, or in the same big folder
+				bounds.push_back(prefix);
+				previous = std::move(prefix);
+			}
+			return (bounds);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// SORTED PATH FILE
+
+	SortedPathFile::SortedPathFile(const char* fileName)
+		: m_File(fileName),
+		m_Valid(m_File.IsValid())
+	{
+		// An empty file cannot be mapped, but it is a valid empty snapshot
+		if (m_Valid == false)
+		{
+			FILE* file = std::fopen(fileName, "rb");
+			m_Valid = file != nullptr;
+			if (file)
+				std::fclose(file);
+		}
+	}
+
+	uint64_t SortedPathFile::LowerBound(const IPath& bound) const
+	{
+		std::vector<TCHAR> buffer(MaxPathLengthOfAllRules + NULL_TERMINATOR_LENGTH);
+		// -1 for a skipped line, 1 if the line is before bound, 0 otherwise
+		auto classify = [&](uint64_t position)
+		{
+			uint64_t end = LineEnd(position);
+			size_t lineSize = static_cast<size_t>(end - position);
+			if (lineSize > 0 && m_File.Data()[end - 1] == '\n')
+				lineSize--;
+			PathSize size;
+			if (DecodeLine(m_File.Data() + position, lineSize, buffer.data(), size) == false)
+				return (-1);
+			return (ComparePaths(buffer.data(), size, bound.Data(), bound.Size()) < 0 ? 1 : 0);
+		};
+
+		// Every line before low is before bound (or skipped), every line starting at high or after is not
+		uint64_t low = 0;
+		uint64_t high = EndPosition();
+		while (low < high)
+		{
+			uint64_t probe = LineStart(low + (high - low) / 2);
+			int state = -1;
+			while (probe < high && (state = classify(probe)) < 0)
+				probe = LineEnd(probe);
+
+			if (probe >= high)
+			{
+				// No line to look at between the middle and high, decide on the line at low
+				if (classify(low) != 0)
+					low = LineEnd(low);
+				else
+					high = low;
+			}
+			else if (state == 1)
+				low = LineEnd(probe);
+			else
+				high = probe;
+		}
+		return (low);
+	}
+
+	bool SortedPathFile::PathAt(uint64_t position, std::basic_string<TCHAR>& path) const
+	{
+		std::unique_ptr<SortedPathReader> reader = Read(LineStart(position), EndPosition());
+		PathView view;
+		if (reader->Next(view) == false)
+			return (false);
+		path.assign(view.Data(), view.Size());
+		return (true);
+	}
+
+	std::unique_ptr<SortedPathReader> SortedPathFile::Read(uint64_t begin, uint64_t end) const
+	{
+		return (std::make_unique<FileReader>(m_File.Data(), begin, end));
+	}
+
+	uint64_t SortedPathFile::LineStart(uint64_t position) const
+	{
+		if (position == 0 || position >= EndPosition())
+			return (std::min(position, EndPosition()));
+		// The line starts at position if the character before is a line break
+		const char* lineBreak = static_cast<const char*>(std::memchr(m_File.Data() + position - 1, '\n', EndPosition() - position + 1));
+		return (lineBreak ? static_cast<uint64_t>(lineBreak - m_File.Data()) + 1 : EndPosition());
+	}
+
+	uint64_t SortedPathFile::LineEnd(uint64_t position) const
+	{
+		const char* lineBreak = static_cast<const char*>(std::memchr(m_File.Data() + position, '\n', EndPosition() - position));
+		return (lineBreak ? static_cast<uint64_t>(lineBreak - m_File.Data()) + 1 : EndPosition());
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// MERGE
+
+	PathMergeStats MergeSortedPaths(PathSetOperation operation, const SortedPathSource& first, const SortedPathSource& second,
+		const PathMergeCallback& callback, const PathMergeOptions& options)
+	{
+		uint32_t partitionCount = options.PartitionCount;
+		if (partitionCount == 0)
+			partitionCount = options.Pool ? options.Pool->ThreadCount() * PartitionsPerThread : 1;
+
+		std::vector<String> bounds;
+		if (options.Pool && partitionCount > 1)
+			bounds = FindPartitionBounds(first.EndPosition() > 0 ? first : second, partitionCount);
+
+		PathMergeStats stats;
+		if (bounds.empty())
+		{
+			std::unique_ptr<SortedPathReader> firstReader = first.Read(0, first.EndPosition());
+			std::unique_ptr<SortedPathReader> secondReader = second.Read(0, second.EndPosition());
+			MergeRange(operation, *firstReader, *secondReader, 0, callback, stats);
+			stats.Partitions = 1;
+			return (stats);
+		}
+
+		// Where every partition starts in both sources, plus where the last one ends
+		size_t rangeCount = bounds.size() + 1;
+		std::vector<uint64_t> firstStarts(rangeCount + 1);
+		std::vector<uint64_t> secondStarts(rangeCount + 1);
+		firstStarts.front() = 0;
+		secondStarts.front() = 0;
+		for (size_t index = 0; index < bounds.size(); index++)
+		{
+			firstStarts[index + 1] = first.LowerBound(ViewOf(bounds[index]));
+			secondStarts[index + 1] = second.LowerBound(ViewOf(bounds[index]));
+		}
+		firstStarts.back() = first.EndPosition();
+		secondStarts.back() = second.EndPosition();
+
+		std::vector<PathMergeStats> partitionStats(rangeCount);
+		options.Pool->ParallelFor(rangeCount, [&](size_t partition)
+		{
+			std::unique_ptr<SortedPathReader> firstReader = first.Read(firstStarts[partition], firstStarts[partition + 1]);
+			std::unique_ptr<SortedPathReader> secondReader = second.Read(secondStarts[partition], secondStarts[partition + 1]);
+			MergeRange(operation, *firstReader, *secondReader, static_cast<uint32_t>(partition), callback, partitionStats[partition]);
+		});
+
+		for (const PathMergeStats& partition : partitionStats)
+		{
+			stats.OnlyInFirst += partition.OnlyInFirst;
+			stats.OnlyInSecond += partition.OnlyInSecond;
+			stats.InBoth += partition.InBoth;
+		}
+		stats.Partitions = static_cast<uint32_t>(rangeCount);
+		return (stats);
+	}
+}
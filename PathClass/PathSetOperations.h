@@ -0,0 +1,230 @@
+#pragma once
+
+#include "Path.h"
+#include "MappedFile.h"
+#include "PathHash.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace PathCore
+{
+	class ThreadPool;
+
+	/**
+	 * Reads the paths of one range of a SortedPathSource, in order.
+	 */
+	class SortedPathReader
+	{
+	public:
+		virtual ~SortedPathReader() = default;
+
+		/**
+		 * @brief Move to the next path of the range
+		 * @return false once the range is over. path stays valid until the next call
+		 */
+		virtual bool Next(PathView& path) = 0;
+	};
+
+	/**
+	 * A sequence of paths sorted with ComparePaths (PathLess), without duplicates.
+	 *
+	 * A path is found by its position, which only means something to its source (an index, a byte offset, ...).
+	 * Positions are ordered like the paths, so a source can be cut in ranges merged in parallel.
+	 */
+	class SortedPathSource
+	{
+	public:
+		virtual ~SortedPathSource() = default;
+
+		/* The position after the last path */
+		virtual uint64_t EndPosition() const = 0;
+		/* The position of the first path that is not ordered before bound, EndPosition() if there is none */
+		virtual uint64_t LowerBound(const IPath& bound) const = 0;
+		/* Copy the first path at or after position, false if there is none */
+		virtual bool PathAt(uint64_t position, std::basic_string<TCHAR>& path) const = 0;
+		/* Read the paths from position begin (included) to end (not included) */
+		virtual std::unique_ptr<SortedPathReader> Read(uint64_t begin, uint64_t end) const = 0;
+	};
+
+	/**
+	 * A sorted path collection in memory (StaticPath, SharedPath, PathView, ...), the positions are indices.
+	 * The collection must outlive the source.
+	 */
+	template<typename PathType>
+	class SortedPathVector : public SortedPathSource
+	{
+	public:
+		explicit SortedPathVector(const std::vector<PathType>& paths)
+			: m_Paths(paths)
+		{}
+
+	public:
+		uint64_t EndPosition() const override { return (m_Paths.size()); }
+
+		uint64_t LowerBound(const IPath& bound) const override
+		{
+			return (static_cast<uint64_t>(std::lower_bound(m_Paths.begin(), m_Paths.end(), bound, PathLess()) - m_Paths.begin()));
+		}
+
+		bool PathAt(uint64_t position, std::basic_string<TCHAR>& path) const override
+		{
+			if (position >= m_Paths.size())
+				return (false);
+			path.assign(m_Paths[position].Data(), m_Paths[position].Size());
+			return (true);
+		}
+
+		std::unique_ptr<SortedPathReader> Read(uint64_t begin, uint64_t end) const override
+		{
+			return (std::make_unique<Reader>(m_Paths, begin, end));
+		}
+
+	private:
+		class Reader : public SortedPathReader
+		{
+		public:
+			Reader(const std::vector<PathType>& paths, uint64_t begin, uint64_t end)
+				: m_Paths(paths),
+				m_Position(begin),
+				m_End(end)
+			{}
+
+			bool Next(PathView& path) override
+			{
+				if (m_Position >= m_End)
+					return (false);
+				path = PathView(m_Paths[m_Position]);
+				m_Position++;
+				return (true);
+			}
+
+		private:
+			const std::vector<PathType>& m_Paths;
+			uint64_t m_Position;
+			uint64_t m_End;
+		};
+
+	private:
+		const std::vector<PathType>& m_Paths;
+	};
+
+	/**
+	 * A sorted snapshot on disk: one UTF-8 path per line (LF or CRLF), what PathWriter writes. The positions are byte offsets.
+	 *
+	 * The file is memory mapped and decoded one line at a time, so reading it never allocates more than one line
+	 * and the pages already read can be dropped by the system.
+	 * Empty lines and lines that are not valid UTF-8 (or too long) are skipped.
+	 */
+	class SortedPathFile : public SortedPathSource
+	{
+	public:
+		explicit SortedPathFile(const char* fileName);
+
+	public:
+		/* false if the file could not be mapped, an empty file is valid */
+		bool IsValid() const { return (m_Valid); }
+
+		uint64_t EndPosition() const override { return (m_File.Size()); }
+		uint64_t LowerBound(const IPath& bound) const override;
+		bool PathAt(uint64_t position, std::basic_string<TCHAR>& path) const override;
+		std::unique_ptr<SortedPathReader> Read(uint64_t begin, uint64_t end) const override;
+
+	private:
+		/* The position of the first line starting at or after position */
+		uint64_t LineStart(uint64_t position) const;
+		/* The position after the line starting at position (line break included) */
+		uint64_t LineEnd(uint64_t position) const;
+
+	private:
+		MappedFile m_File;
+		bool m_Valid;
+	};
+
+	enum class PathSetOperation : uint8_t
+	{
+		/* Every path of both sources */
+		Union,
+		/* The paths in both sources */
+		Intersection,
+		/* The paths of the first source that are not in the second one */
+		Difference,
+		/* The paths in only one of the sources: removed (only in the first) and added (only in the second) */
+		Diff
+	};
+
+	enum class PathMergeSide : uint8_t
+	{
+		OnlyInFirst,
+		OnlyInSecond,
+		InBoth
+	};
+
+	/**
+	 * A path given to the merge callback.
+	 */
+	struct PathMergeEntry
+	{
+		PathView Path;
+		PathMergeSide Side;
+		/* The partition the path was found in, the partitions are numbered in path order */
+		uint32_t Partition;
+	};
+
+	struct PathMergeOptions
+	{
+		/**
+		 * Pool the partitions are merged on, when null everything is merged on the calling thread.
+		 * IMPORTANT: With a pool the callback is called from several threads at once, in path order only inside a partition.
+		 */
+		ThreadPool* Pool = nullptr;
+		/* Amount of ranges the sources are cut in, 0 means 4 per thread of the pool */
+		uint32_t PartitionCount = 0;
+	};
+
+	struct PathMergeStats
+	{
+		uint64_t OnlyInFirst = 0;
+		uint64_t OnlyInSecond = 0;
+		uint64_t InBoth = 0;
+		uint32_t Partitions = 0;
+	};
+
+	using PathMergeCallback = std::function<void(const PathMergeEntry& entry)>;
+
+	/**
+	 * @brief Walk two sorted sources side by side, and give the paths the operation keeps to callback, in order
+	 * @details Each path is read once and compared with the current path of the other source, no path is stored.
+	 *          To merge in parallel, the first source is sampled and both sources are cut on the shortest folder prefixes
+	 *          of the samples, so a partition holds whole folders and the merges don't depend on each other.
+	 * @note The stats only count the paths the operation reads (eg: Intersection stops at the end of the shortest source)
+	 */
+	PathMergeStats MergeSortedPaths(PathSetOperation operation, const SortedPathSource& first, const SortedPathSource& second,
+		const PathMergeCallback& callback, const PathMergeOptions& options = PathMergeOptions());
+
+	inline PathMergeStats UnionPaths(const SortedPathSource& first, const SortedPathSource& second,
+		const PathMergeCallback& callback, const PathMergeOptions& options = PathMergeOptions())
+	{
+		return (MergeSortedPaths(PathSetOperation::Union, first, second, callback, options));
+	}
+	inline PathMergeStats IntersectPaths(const SortedPathSource& first, const SortedPathSource& second,
+		const PathMergeCallback& callback, const PathMergeOptions& options = PathMergeOptions())
+	{
+		return (MergeSortedPaths(PathSetOperation::Intersection, first, second, callback, options));
+	}
+	inline PathMergeStats SubtractPaths(const SortedPathSource& first, const SortedPathSource& second,
+		const PathMergeCallback& callback, const PathMergeOptions& options = PathMergeOptions())
+	{
+		return (MergeSortedPaths(PathSetOperation::Difference, first, second, callback, options));
+	}
+	/* OnlyInFirst are the removed paths, OnlyInSecond the added ones (eg: first is yesterday's snapshot, second today's) */
+	inline PathMergeStats DiffPaths(const SortedPathSource& first, const SortedPathSource& second,
+		const PathMergeCallback& callback, const PathMergeOptions& options = PathMergeOptions())
+	{
+		return (MergeSortedPaths(PathSetOperation::Diff, first, second, callback, options));
+	}
+}
@@ -0,0 +1,137 @@
+#include "Benchmarks.h"
+#include "PathSetOperations.h"
+#include "PathWriter.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace PathCore;
+
+namespace
+{
+	using String = std::basic_string<TCHAR>;
+
+	void AppendNumber(String& name, size_t value, int width)
+	{
+		String digits;
+		for (int index = 0; index < width; index++, value /= 10)
+			digits.insert(digits.begin(), static_cast<TCHAR>(TEXT('0') + value % 10));
+		name += digits;
+	}
+
+	/**
+	 * Two snapshots of the same tree, already sorted (fixed width numbers):
+	 * today lost one file in 97 and got one new file in 89.
+	 */
+	void GenerateSnapshots(size_t fileCount, std::vector<StaticPath>& yesterday, std::vector<StaticPath>& today)
+	{
+		yesterday.reserve(fileCount);
+		today.reserve(fileCount + fileCount / 89);
+		for (size_t index = 0; index < fileCount; index++)
+		{
+			String path = TEXT("C:/Tree/Dir_");
+			AppendNumber(path, index / 10000, 4);
+			path += TEXT("/Sub_");
+			AppendNumber(path, (index / 100) % 100, 2);
+			path += TEXT("/File_");
+			AppendNumber(path, index, 7);
+
+			String file = path + TEXT(".dat");
+			yesterday.emplace_back(file.c_str());
+			if (index % 97 != 0)
+				today.emplace_back(file.c_str());
+			if (index % 89 == 0)
+				today.emplace_back((path + TEXT("_new.dat")).c_str());
+		}
+	}
+
+	struct PathViewHash
+	{
+		size_t operator()(const PathView& path) const { return (static_cast<size_t>(HashPath(path))); }
+	};
+	struct PathViewEqual
+	{
+		bool operator()(const PathView& path, const PathView& other) const { return (ArePathsEqual(path, other)); }
+	};
+
+	/* What the nightly diff did: a hash set of each snapshot, and a lookup of every path in the other one */
+	void DiffWithHashSets(const std::vector<StaticPath>& yesterday, const std::vector<StaticPath>& today, uint64_t& removed, uint64_t& added)
+	{
+		std::unordered_set<PathView, PathViewHash, PathViewEqual> yesterdaySet(yesterday.begin(), yesterday.end());
+		std::unordered_set<PathView, PathViewHash, PathViewEqual> todaySet(today.begin(), today.end());
+		for (const StaticPath& path : yesterday)
+			removed += todaySet.count(path) == 0;
+		for (const StaticPath& path : today)
+			added += yesterdaySet.count(path) == 0;
+	}
+
+	void WriteSnapshot(const std::string& fileName, const std::vector<StaticPath>& paths)
+	{
+		PathWriter writer(fileName.c_str());
+		for (const StaticPath& path : paths)
+			writer.Write(path);
+	}
+}
+
+void BenchmarkPathSetOperations()
+{
+	const size_t fileCount = 1000000;
+	std::vector<StaticPath> yesterday;
+	std::vector<StaticPath> today;
+	GenerateSnapshots(fileCount, yesterday, today);
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path();
+	std::string yesterdayFile = (directory / "PathSetYesterday.txt").string();
+	std::string todayFile = (directory / "PathSetToday.txt").string();
+	WriteSnapshot(yesterdayFile, yesterday);
+	WriteSnapshot(todayFile, today);
+
+	uint64_t hashRemoved = 0;
+	uint64_t hashAdded = 0;
+	double hashSeconds = MeasureSeconds([&]() { DiffWithHashSets(yesterday, today, hashRemoved, hashAdded); });
+	int hashAllocations = CountAllocations([&]() { uint64_t removed = 0, added = 0; DiffWithHashSets(yesterday, today, removed, added); });
+
+	// The callback counts, the stats are checked against it
+	std::atomic<uint64_t> reported = 0;
+	PathMergeCallback count = [&reported](const PathMergeEntry&) { reported.fetch_add(1, std::memory_order_relaxed); };
+
+	SortedPathVector<StaticPath> yesterdayVector(yesterday);
+	SortedPathVector<StaticPath> todayVector(today);
+	PathMergeStats memoryStats;
+	double memorySeconds = MeasureSeconds([&]() { memoryStats = DiffPaths(yesterdayVector, todayVector, count); });
+	int memoryAllocations = CountAllocations([&]() { DiffPaths(yesterdayVector, todayVector, count); });
+
+	SortedPathFile yesterdaySnapshot(yesterdayFile.c_str());
+	SortedPathFile todaySnapshot(todayFile.c_str());
+	PathMergeStats fileStats;
+	double fileSeconds = MeasureSeconds([&]() { fileStats = DiffPaths(yesterdaySnapshot, todaySnapshot, count); });
+	int fileAllocations = CountAllocations([&]() { DiffPaths(yesterdaySnapshot, todaySnapshot, count); });
+
+	ThreadPool pool;
+	PathMergeOptions parallel;
+	parallel.Pool = &pool;
+	PathMergeStats parallelStats;
+	double parallelSeconds = MeasureSeconds([&]() { parallelStats = DiffPaths(yesterdaySnapshot, todaySnapshot, count, parallel); });
+
+	PathMergeStats unionStats = UnionPaths(yesterdaySnapshot, todaySnapshot, count, parallel);
+	bool same = hashRemoved == memoryStats.OnlyInFirst && hashAdded == memoryStats.OnlyInSecond
+		&& fileStats.OnlyInFirst == hashRemoved && fileStats.OnlyInSecond == hashAdded
+		&& parallelStats.OnlyInFirst == hashRemoved && parallelStats.OnlyInSecond == hashAdded
+		&& unionStats.InBoth + unionStats.OnlyInFirst == yesterday.size() && unionStats.InBoth + unionStats.OnlyInSecond == today.size();
+
+	std::cout << "PathSetOperations: diff of " << yesterday.size() << " and " << today.size() << " paths, " << hashRemoved << " removed, "
+		<< hashAdded << " added" << (same ? "" : " (MISMATCH)") << std::endl;
+	std::cout << "\tHash sets of both snapshots:  " << hashSeconds * 1e3 << " ms (" << hashAllocations << " allocations)" << std::endl;
+	std::cout << "\tMerge, in memory:             " << memorySeconds * 1e3 << " ms (" << memoryAllocations << " allocations)" << std::endl;
+	std::cout << "\tMerge, snapshot files:        " << fileSeconds * 1e3 << " ms (" << fileAllocations << " allocations)" << std::endl;
+	std::cout << "\tMerge, snapshot files, " << parallelStats.Partitions << " partitions on " << pool.ThreadCount() << " threads: "
+		<< parallelSeconds * 1e3 << " ms" << std::endl;
+
+	std::remove(yesterdayFile.c_str());
+	std::remove(todayFile.c_str());
+}
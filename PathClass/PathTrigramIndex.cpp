@@ -0,0 +1,470 @@
+#include "PathTrigramIndex.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+namespace PathCore
+{
+	namespace
+	{
+		constexpr uint32_t IndexMagic = 0x58495450; // "PTIX"
+		constexpr uint32_t IndexVersion = 1;
+		/* The lists are rewritten once the removed ids are a quarter of the paths, and at least that many */
+		constexpr size_t MinStaleCount = 4096;
+
+		struct IndexHeader
+		{
+			uint32_t Magic;
+			uint32_t Version;
+			uint32_t CharacterSize;
+			uint32_t IgnoreCase;
+			uint64_t EntryCount;
+			uint64_t CharacterCount;
+			uint64_t ListCount;
+			uint64_t RemovedCount;
+			uint64_t StaleCount;
+		};
+
+		struct SerializedEntry
+		{
+			uint32_t Offset;
+			uint16_t Size;
+			uint16_t Removed;
+		};
+
+		/* Followed by ByteCount bytes of ids */
+		struct SerializedList
+		{
+			uint64_t Key;
+			uint32_t Count;
+			uint32_t Last;
+			uint64_t ByteCount;
+		};
+
+		/* A trigram of folded characters, 21 bits each (any Unicode code point) */
+		uint64_t TrigramKey(TCHAR first, TCHAR second, TCHAR third)
+		{
+			constexpr uint64_t Mask = (1ull << 21) - 1;
+			return (((static_cast<uint64_t>(first) & Mask) << 42) | ((static_cast<uint64_t>(second) & Mask) << 21)
+				| (static_cast<uint64_t>(third) & Mask));
+		}
+
+		void AppendVarint(std::vector<uint8_t>& bytes, uint32_t value)
+		{
+			while (value >= 0x80)
+			{
+				bytes.push_back(static_cast<uint8_t>(value | 0x80));
+				value >>= 7;
+			}
+			bytes.push_back(static_cast<uint8_t>(value));
+		}
+
+		/* Reads the ids of a posting list in order */
+		class PostingCursor
+		{
+		public:
+			PostingCursor(const std::vector<uint8_t>& bytes)
+				: m_Cursor(bytes.data()),
+				m_End(bytes.data() + bytes.size())
+			{}
+
+		public:
+			/* false at the end of the list, or at a varint cut by the end or longer than 32 bits (IsValid() tells) */
+			bool Next()
+			{
+				if (m_Cursor == m_End)
+					return (false);
+
+				uint32_t value = 0;
+				for (uint32_t shift = 0; ; shift += 7)
+				{
+					if (m_Cursor == m_End || shift > 28)
+					{
+						m_Valid = false;
+						m_Cursor = m_End;
+						return (false);
+					}
+					uint8_t byte = *m_Cursor++;
+					value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+					if (byte < 0x80)
+						break;
+				}
+				m_Id = m_Started ? m_Id + value : value;
+				m_Started = true;
+				return (true);
+			}
+			uint32_t Id() const { return (m_Id); }
+			bool IsValid() const { return (m_Valid); }
+
+		private:
+			const uint8_t* m_Cursor;
+			const uint8_t* m_End;
+			uint32_t m_Id = 0;
+			bool m_Started = false;
+			bool m_Valid = true;
+		};
+
+		template<typename T>
+		void AppendValue(std::vector<uint8_t>& bytes, const T& value)
+		{
+			const uint8_t* data = reinterpret_cast<const uint8_t*>(&value);
+			bytes.insert(bytes.end(), data, data + sizeof(T));
+		}
+
+		/* Reads a serialized index, every read is checked against the end */
+		class ByteReader
+		{
+		public:
+			ByteReader(const uint8_t* data, size_t size)
+				: m_Cursor(data),
+				m_End(data + size)
+			{}
+
+		public:
+			bool Read(void* out, size_t size)
+			{
+				if (static_cast<size_t>(m_End - m_Cursor) < size)
+					return (false);
+				std::memcpy(out, m_Cursor, size);
+				m_Cursor += size;
+				return (true);
+			}
+			template<typename T>
+			bool Read(T& value) { return (Read(&value, sizeof(T))); }
+
+			bool AtEnd() const { return (m_Cursor == m_End); }
+
+		private:
+			const uint8_t* m_Cursor;
+			const uint8_t* m_End;
+		};
+	}
+
+	PathTrigramIndex::PathTrigramIndex(bool ignoreCase)
+		: m_IgnoreCase(ignoreCase)
+	{}
+
+	void PathTrigramIndex::Clear()
+	{
+		m_Characters.clear();
+		m_Entries.clear();
+		m_Postings.clear();
+		m_RemovedCount = 0;
+		m_StaleCount = 0;
+	}
+
+	uint32_t PathTrigramIndex::Add(const IPath& path)
+	{
+		std::vector<uint64_t> trigrams;
+		return (Add(path, trigrams));
+	}
+
+	uint32_t PathTrigramIndex::Add(const IPath& path, std::vector<uint64_t>& trigrams)
+	{
+		assert(m_Entries.size() < InvalidId && m_Characters.size() + path.Size() + 1 < UINT32_MAX && "Too many paths for 32 bits ids");
+
+		uint32_t id = NextId();
+		m_Entries.push_back({ static_cast<uint32_t>(m_Characters.size()), path.Size(), false });
+		m_Characters.insert(m_Characters.end(), path.Data(), path.Data() + path.Size());
+		m_Characters.push_back(NULL);
+
+		CollectTrigrams(path.Data(), path.Size(), trigrams);
+		for (uint64_t trigram : trigrams)
+		{
+			PostingList& list = m_Postings[trigram];
+			AppendVarint(list.Bytes, list.Count == 0 ? id : id - list.Last);
+			list.Last = id;
+			list.Count++;
+		}
+		return (id);
+	}
+
+	bool PathTrigramIndex::Remove(uint32_t id)
+	{
+		if (Contains(id) == false)
+			return (false);
+
+		m_Entries[id].Removed = true;
+		m_RemovedCount++;
+		m_StaleCount++;
+		if (m_StaleCount >= MinStaleCount && m_StaleCount * 4 >= Size())
+			Compact();
+		return (true);
+	}
+
+	void PathTrigramIndex::Compact()
+	{
+		for (auto it = m_Postings.begin(); it != m_Postings.end();)
+		{
+			PostingList& list = it->second;
+			PostingList compacted;
+			PostingCursor cursor(list.Bytes);
+			while (cursor.Next())
+			{
+				if (m_Entries[cursor.Id()].Removed)
+					continue;
+				AppendVarint(compacted.Bytes, compacted.Count == 0 ? cursor.Id() : cursor.Id() - compacted.Last);
+				compacted.Last = cursor.Id();
+				compacted.Count++;
+			}
+
+			if (compacted.Count == 0)
+				it = m_Postings.erase(it);
+			else
+			{
+				compacted.Bytes.shrink_to_fit();
+				list = std::move(compacted);
+				++it;
+			}
+		}
+
+		// The removed paths keep their entry (the ids don't move), with an empty path
+		std::vector<TCHAR> characters;
+		characters.reserve(m_Characters.size());
+		characters.push_back(NULL);
+		for (Entry& entry : m_Entries)
+		{
+			if (entry.Removed)
+			{
+				entry = { 0, 0, true };
+				continue;
+			}
+			uint32_t offset = static_cast<uint32_t>(characters.size());
+			characters.insert(characters.end(), m_Characters.begin() + entry.Offset, m_Characters.begin() + entry.Offset + entry.Size + 1);
+			entry.Offset = offset;
+		}
+		m_Characters = std::move(characters);
+		m_StaleCount = 0;
+	}
+
+	TrigramQueryStats PathTrigramIndex::Find(StringView text, std::vector<uint32_t>& ids) const
+	{
+		TrigramQueryStats stats;
+		ids.clear();
+
+		std::basic_string<TCHAR> folded;
+		folded.reserve(text.size());
+		for (TCHAR character : text)
+			folded.push_back(Fold(character));
+
+		std::vector<uint64_t> trigrams;
+		CollectTrigrams(folded.data(), folded.size(), trigrams);
+		stats.Trigrams = static_cast<uint32_t>(trigrams.size());
+
+		std::vector<uint32_t> candidates;
+		if (trigrams.empty())
+		{
+			// Nothing to intersect ("a", "/a/"), every path is a candidate
+			candidates.reserve(Size());
+			for (uint32_t id = 0; id < m_Entries.size(); id++)
+				candidates.push_back(id);
+		}
+		else
+		{
+			std::vector<const PostingList*> lists;
+			lists.reserve(trigrams.size());
+			for (uint64_t trigram : trigrams)
+			{
+				auto found = m_Postings.find(trigram);
+				if (found == m_Postings.end())
+					return (stats);
+				lists.push_back(&found->second);
+			}
+			std::sort(lists.begin(), lists.end(), [](const PostingList* list, const PostingList* other) { return (list->Count < other->Count); });
+
+			candidates.reserve(lists.front()->Count);
+			PostingCursor first(lists.front()->Bytes);
+			while (first.Next())
+				candidates.push_back(first.Id());
+
+			// Every other list only keeps the candidates it holds too, the candidates only get fewer
+			for (size_t index = 1; index < lists.size() && candidates.empty() == false; index++)
+			{
+				PostingCursor cursor(lists[index]->Bytes);
+				bool hasId = cursor.Next();
+				size_t kept = 0;
+				for (uint32_t candidate : candidates)
+				{
+					while (hasId && cursor.Id() < candidate)
+						hasId = cursor.Next();
+					if (hasId == false)
+						break;
+					if (cursor.Id() == candidate)
+						candidates[kept++] = candidate;
+				}
+				candidates.resize(kept);
+			}
+		}
+
+		for (uint32_t id : candidates)
+		{
+			if (m_Entries[id].Removed)
+				continue;
+			stats.Candidates++;
+			if (ContainsText(id, folded))
+				ids.push_back(id);
+		}
+		stats.Matches = ids.size();
+		return (stats);
+	}
+
+	size_t PathTrigramIndex::PostingBytes() const
+	{
+		size_t bytes = 0;
+		for (const auto& [trigram, list] : m_Postings)
+			bytes += list.Bytes.size();
+		return (bytes);
+	}
+
+	void PathTrigramIndex::Serialize(std::vector<uint8_t>& bytes) const
+	{
+		IndexHeader header = { IndexMagic, IndexVersion, static_cast<uint32_t>(sizeof(TCHAR)), m_IgnoreCase ? 1u : 0u, m_Entries.size(), m_Characters.size(),
+			m_Postings.size(), m_RemovedCount, m_StaleCount };
+		AppendValue(bytes, header);
+		for (const Entry& entry : m_Entries)
+			AppendValue(bytes, SerializedEntry{ entry.Offset, entry.Size, entry.Removed ? uint16_t(1) : uint16_t(0) });
+		const uint8_t* characters = reinterpret_cast<const uint8_t*>(m_Characters.data());
+		bytes.insert(bytes.end(), characters, characters + m_Characters.size() * sizeof(TCHAR));
+
+		// Sorted by trigram, the same index always gives the same bytes
+		std::vector<uint64_t> trigrams;
+		trigrams.reserve(m_Postings.size());
+		for (const auto& [trigram, list] : m_Postings)
+			trigrams.push_back(trigram);
+		std::sort(trigrams.begin(), trigrams.end());
+		for (uint64_t trigram : trigrams)
+		{
+			const PostingList& list = m_Postings.at(trigram);
+			AppendValue(bytes, SerializedList{ trigram, list.Count, list.Last, list.Bytes.size() });
+			bytes.insert(bytes.end(), list.Bytes.begin(), list.Bytes.end());
+		}
+	}
+
+	bool PathTrigramIndex::Deserialize(const uint8_t* data, size_t size)
+	{
+		Clear();
+		ByteReader reader(data, size);
+		IndexHeader header;
+		if (reader.Read(header) == false || header.Magic != IndexMagic || header.Version != IndexVersion || header.CharacterSize != sizeof(TCHAR)
+			|| header.EntryCount >= InvalidId || header.CharacterCount >= UINT32_MAX || header.EntryCount * sizeof(SerializedEntry) > size)
+			return (false);
+
+		m_IgnoreCase = header.IgnoreCase != 0;
+		m_Entries.reserve(header.EntryCount);
+		for (uint64_t index = 0; index < header.EntryCount; index++)
+		{
+			SerializedEntry entry;
+			if (reader.Read(entry) == false || entry.Offset + static_cast<uint64_t>(entry.Size) >= header.CharacterCount)
+			{
+				Clear();
+				return (false);
+			}
+			m_Entries.push_back({ entry.Offset, entry.Size, entry.Removed != 0 });
+		}
+
+		m_Characters.resize(header.CharacterCount);
+		bool valid = header.CharacterCount * sizeof(TCHAR) <= size && reader.Read(m_Characters.data(), m_Characters.size() * sizeof(TCHAR));
+		for (uint64_t index = 0; index < header.ListCount && valid; index++)
+		{
+			SerializedList serialized;
+			valid = reader.Read(serialized) && serialized.ByteCount <= size;
+			if (valid == false)
+				break;
+			PostingList& list = m_Postings[serialized.Key];
+			list.Count = serialized.Count;
+			list.Last = serialized.Last;
+			list.Bytes.resize(serialized.ByteCount);
+			valid = reader.Read(list.Bytes.data(), list.Bytes.size()) && list.Last < header.EntryCount;
+
+			// Every id must name an entry, in increasing order: Find() indexes m_Entries with them unchecked
+			PostingCursor cursor(list.Bytes);
+			uint32_t count = 0;
+			uint32_t previous = 0;
+			while (valid && cursor.Next())
+			{
+				valid = cursor.Id() < header.EntryCount && (count == 0 || cursor.Id() > previous);
+				previous = cursor.Id();
+				count++;
+			}
+			valid = valid && cursor.IsValid() && count == list.Count && (count == 0 || previous == list.Last);
+		}
+		if (valid == false || reader.AtEnd() == false)
+		{
+			Clear();
+			return (false);
+		}
+		m_RemovedCount = header.RemovedCount;
+		m_StaleCount = header.StaleCount;
+		return (true);
+	}
+
+	bool PathTrigramIndex::Save(const char* fileName) const
+	{
+		std::vector<uint8_t> bytes;
+		Serialize(bytes);
+		FILE* file = std::fopen(fileName, "wb");
+		if (file == nullptr)
+			return (false);
+		bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+		return (std::fclose(file) == 0 && written);
+	}
+
+	bool PathTrigramIndex::Load(const char* fileName)
+	{
+		MappedFile file(fileName);
+		if (file.IsValid() == false)
+		{
+			Clear();
+			return (false);
+		}
+		return (Deserialize(reinterpret_cast<const uint8_t*>(file.Data()), file.Size()));
+	}
+
+	void PathTrigramIndex::Build(size_t count, const std::function<const IPath&(size_t)>& pathAt)
+	{
+		Clear();
+		size_t characterCount = 0;
+		for (size_t index = 0; index < count; index++)
+			characterCount += pathAt(index).Size() + 1;
+		m_Characters.reserve(characterCount);
+		m_Entries.reserve(count);
+
+		std::vector<uint64_t> trigrams;
+		for (size_t index = 0; index < count; index++)
+			Add(pathAt(index), trigrams);
+	}
+
+	TCHAR PathTrigramIndex::Fold(TCHAR character) const
+	{
+		if (IsSeparator(character))
+			return (UnixSeparator);
+		if (m_IgnoreCase && character >= TEXT('A') && character <= TEXT('Z'))
+			return (static_cast<TCHAR>(character - TEXT('A') + TEXT('a')));
+		return (character);
+	}
+
+	void PathTrigramIndex::CollectTrigrams(const TCHAR* data, size_t size, std::vector<uint64_t>& trigrams) const
+	{
+		trigrams.clear();
+		for (size_t position = 0; position + 2 < size; position++)
+		{
+			TCHAR first = Fold(data[position]);
+			TCHAR second = Fold(data[position + 1]);
+			TCHAR third = Fold(data[position + 2]);
+			if (first != UnixSeparator && second != UnixSeparator && third != UnixSeparator)
+				trigrams.push_back(TrigramKey(first, second, third));
+		}
+		std::sort(trigrams.begin(), trigrams.end());
+		trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+	}
+
+	bool PathTrigramIndex::ContainsText(uint32_t id, const std::basic_string<TCHAR>& folded) const
+	{
+		const TCHAR* data = m_Characters.data() + m_Entries[id].Offset;
+		const TCHAR* end = data + m_Entries[id].Size;
+		return (std::search(data, end, folded.begin(), folded.end(), [this](TCHAR character, TCHAR other) { return (Fold(character) == other); }) != end);
+	}
+}
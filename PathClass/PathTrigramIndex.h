@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Path.h"
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace PathCore
+{
+	struct TrigramQueryStats
+	{
+		/* The distinct trigrams of the query, 0 when it has none (every path is verified) */
+		uint32_t Trigrams = 0;
+		/* The paths left after intersecting the posting lists, the ones that were verified */
+		uint64_t Candidates = 0;
+		uint64_t Matches = 0;
+	};
+
+	/**
+	 * A substring index over a path collection: "every path containing cache" without reading every path.
+	 *
+	 * Every trigram (3 characters) of every segment lists the ids of the paths holding it, the ids are delta encoded
+	 * in variable length bytes (1 byte for most of them). A query intersects the lists of its trigrams, shortest first,
+	 * then verifies the candidates: the trigrams don't say where they are in the path.
+	 *
+	 * The ids are given in the order the paths are added and never reused. A removed path stays in the lists
+	 * until enough of them are removed, then the lists are rewritten (Compact()).
+	 *
+	 * @note The queries can hold separators, a trigram is only taken inside a segment
+	 * @example PathTrigramIndex index; index.Build(paths); std::vector<uint32_t> ids; index.Find(TEXT("cache"), ids);
+	 */
+	class PathTrigramIndex
+	{
+	public:
+		static constexpr uint32_t InvalidId = std::numeric_limits<uint32_t>::max();
+
+	public:
+		/**
+		 * @param ignoreCase "Cache" and "cache" are the same, 'A' to 'Z' are folded (the other letters are not)
+		 */
+		explicit PathTrigramIndex(bool ignoreCase = true);
+
+	public:
+		/* Index paths (StaticPath, SharedPath, PathView, ...) with the ids 0 to paths.size() - 1, replacing what the index held */
+		template<typename PathType>
+		void Build(const std::vector<PathType>& paths)
+		{
+			Build(paths.size(), [&paths](size_t index) -> const IPath& { return (paths[index]); });
+		}
+		void Clear();
+
+		/* Copy and index path, return its id */
+		uint32_t Add(const IPath& path);
+		/* false if id is not in the index (never given, or already removed) */
+		bool Remove(uint32_t id);
+		/* Rewrite the posting lists without the removed ids, and the characters without the removed paths */
+		void Compact();
+
+		/* The ids of the paths containing text, in increasing order */
+		TrigramQueryStats Find(StringView text, std::vector<uint32_t>& ids) const;
+
+		bool Contains(uint32_t id) const { return (id < m_Entries.size() && m_Entries[id].Removed == false); }
+		/* The path of id, a view over the index. id must be in the index */
+		PathView operator[](uint32_t id) const { return (PathView(m_Characters.data() + m_Entries[id].Offset, m_Entries[id].Size)); }
+
+		/* The paths in the index */
+		size_t Size() const { return (m_Entries.size() - m_RemovedCount); }
+		/* The next id given by Add() */
+		uint32_t NextId() const { return (static_cast<uint32_t>(m_Entries.size())); }
+		size_t TrigramCount() const { return (m_Postings.size()); }
+		/* The bytes of the encoded posting lists */
+		size_t PostingBytes() const;
+
+		/* Append the index to bytes, Deserialize() reads it back */
+		void Serialize(std::vector<uint8_t>& bytes) const;
+		/* false if data is not an index written by a build with the same TCHAR, the index is then empty */
+		bool Deserialize(const uint8_t* data, size_t size);
+		bool Save(const char* fileName) const;
+		bool Load(const char* fileName);
+
+	private:
+		void Build(size_t count, const std::function<const IPath&(size_t)>& pathAt);
+		/* Add() with a buffer for the trigrams, reused by Build() */
+		uint32_t Add(const IPath& path, std::vector<uint64_t>& trigrams);
+		TCHAR Fold(TCHAR character) const;
+		/* The distinct trigrams of the segments of characters, sorted */
+		void CollectTrigrams(const TCHAR* data, size_t size, std::vector<uint64_t>& trigrams) const;
+		/* Whether the path of id contains the folded text */
+		bool ContainsText(uint32_t id, const std::basic_string<TCHAR>& folded) const;
+
+	private:
+		struct Entry
+		{
+			/* Where the path starts in m_Characters */
+			uint32_t Offset;
+			PathSize Size;
+			bool Removed;
+		};
+
+		struct PostingList
+		{
+			/* The ids, each one as the difference with the previous one, 7 bits per byte */
+			std::vector<uint8_t> Bytes;
+			uint32_t Count = 0;
+			/* The last id added, the next one is written as a difference with it */
+			uint32_t Last = 0;
+		};
+
+		bool m_IgnoreCase;
+		/* The paths, each one null terminated */
+		std::vector<TCHAR> m_Characters;
+		std::vector<Entry> m_Entries;
+		std::unordered_map<uint64_t, PostingList> m_Postings;
+		size_t m_RemovedCount = 0;
+		/* The removed ids still in the posting lists */
+		size_t m_StaleCount = 0;
+	};
+}
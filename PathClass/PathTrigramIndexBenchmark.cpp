@@ -0,0 +1,151 @@
+#include "Benchmarks.h"
+#include "PathTrigramIndex.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace PathCore;
+
+namespace
+{
+	using String = std::basic_string<TCHAR>;
+
+	/* A build machine: sources, intermediate files and a few caches */
+	std::vector<StaticPath> GeneratePaths(size_t count)
+	{
+		const TCHAR* roots[] = { TEXT("C:/Projects/Game/Source"), TEXT("C:/Projects/Game/Intermediate/Build"), TEXT("C:/Projects/Game/Content"),
+			TEXT("C:/Projects/Game/Saved/ShaderCache"), TEXT("C:/Projects/Game/DerivedDataCache"), TEXT("C:/Projects/Engine/Plugins") };
+		const TCHAR* words[] = { TEXT("Render"), TEXT("Physics"), TEXT("Audio"), TEXT("Network"), TEXT("Input"), TEXT("Animation"),
+			TEXT("Texture"), TEXT("Material"), TEXT("Landscape"), TEXT("Foliage"), TEXT("Navigation"), TEXT("Streaming") };
+		const TCHAR* extensions[] = { TEXT(".cpp"), TEXT(".h"), TEXT(".obj"), TEXT(".uasset"), TEXT(".ddc"), TEXT(".json") };
+
+		std::vector<StaticPath> paths;
+		paths.reserve(count);
+		for (size_t index = 0; index < count; index++)
+		{
+			String path = roots[(index * 7) % 6];
+			path += TEXT("/");
+			path += words[index % 12];
+			path += TEXT("/");
+			path += words[(index / 12) % 12];
+			path += words[(index * 5 / 7) % 12];
+			path += TEXT("_");
+			AppendDigits(path, index);
+			path += extensions[(index / 5) % 6];
+			paths.emplace_back(path.c_str());
+		}
+		return (paths);
+	}
+
+	TCHAR Fold(TCHAR character)
+	{
+		if (character >= TEXT('A') && character <= TEXT('Z'))
+			return (static_cast<TCHAR>(character - TEXT('A') + TEXT('a')));
+		return (IsSeparator(character) ? UnixSeparator : character);
+	}
+
+	/* What the tools did before: fold and search every path */
+	void LinearFind(const std::vector<StaticPath>& paths, const std::vector<bool>& removed, const String& text, std::vector<uint32_t>& ids)
+	{
+		String folded;
+		for (TCHAR character : text)
+			folded.push_back(Fold(character));
+		ids.clear();
+		for (size_t index = 0; index < paths.size(); index++)
+		{
+			const TCHAR* data = paths[index].Data();
+			const TCHAR* end = data + paths[index].Size();
+			if (removed[index] == false && std::search(data, end, folded.begin(), folded.end(),
+				[](TCHAR character, TCHAR other) { return (Fold(character) == other); }) != end)
+				ids.push_back(static_cast<uint32_t>(index));
+		}
+	}
+}
+
+void BenchmarkPathTrigramIndex()
+{
+	const size_t pathCount = 1000000;
+	std::vector<StaticPath> paths = GeneratePaths(pathCount);
+	std::vector<bool> removed(pathCount, false);
+
+	PathTrigramIndex index;
+	double buildSeconds = MeasureSeconds([&]() { index.Build(paths); });
+	size_t characterBytes = 0;
+	for (const StaticPath& path : paths)
+		characterBytes += (path.Size() + 1) * sizeof(TCHAR);
+
+	std::cout << "PathTrigramIndex: " << pathCount << " paths, build " << buildSeconds * 1e3 << " ms, " << index.TrigramCount() << " trigrams, "
+		<< index.PostingBytes() / (1024 * 1024) << " MB of posting lists (" << index.PostingBytes() * 8.0 / pathCount << " bits per path) for "
+		<< characterBytes / (1024 * 1024) << " MB of paths" << std::endl;
+
+	const TCHAR* queries[] = { TEXT("cache"), TEXT("ShaderCache/Network"), TEXT("_4242"), TEXT("landscapefoliage_99"), TEXT("Missing"), TEXT(".h") };
+	const char* names[] = { "cache", "ShaderCache/Network", "_4242", "landscapefoliage_99", "Missing", ".h" };
+	bool same = true;
+	std::vector<uint32_t> ids;
+	std::vector<uint32_t> expected;
+	for (size_t query = 0; query < 6; query++)
+	{
+		TrigramQueryStats stats;
+		double indexSeconds = MeasureSeconds([&]() { stats = index.Find(queries[query], ids); });
+		double linearSeconds = MeasureSeconds([&]() { LinearFind(paths, removed, queries[query], expected); });
+		same = same && ids == expected;
+		std::cout << "\t\"" << names[query] << "\": " << stats.Matches << " matches, " << stats.Trigrams << " trigrams, " << stats.Candidates
+			<< " candidates, index " << indexSeconds * 1e3 << " ms against " << linearSeconds * 1e3 << " ms linear" << std::endl;
+	}
+
+	// A fifth of the paths removed (the lists are compacted on the way), and some added
+	double removeSeconds = MeasureSeconds([&]()
+	{
+		for (uint32_t id = 0; id < pathCount; id += 5)
+		{
+			index.Remove(id);
+			removed[id] = true;
+		}
+	});
+	std::vector<StaticPath> added = GeneratePaths(1000);
+	double addSeconds = MeasureSeconds([&]()
+	{
+		for (const StaticPath& path : added)
+			index.Add(path);
+	});
+	paths.insert(paths.end(), added.begin(), added.end());
+	removed.resize(paths.size(), false);
+
+	index.Find(TEXT("cache"), ids);
+	LinearFind(paths, removed, TEXT("cache"), expected);
+	bool updated = ids == expected && index.Size() == pathCount - pathCount / 5 + added.size() && index.Remove(0) == false;
+
+	std::string fileName = (std::filesystem::temp_directory_path() / "PathTrigramIndex.bin").string();
+	bool saved = false;
+	double saveSeconds = MeasureSeconds([&]() { saved = index.Save(fileName.c_str()); });
+	PathTrigramIndex loaded;
+	bool reloaded = false;
+	double loadSeconds = MeasureSeconds([&]() { reloaded = loaded.Load(fileName.c_str()); });
+	std::vector<uint32_t> loadedIds;
+	loaded.Find(TEXT("_4242"), loadedIds);
+	index.Find(TEXT("_4242"), ids);
+	bool roundTrip = saved && reloaded && loadedIds == ids && loaded.Size() == index.Size() && loaded.PostingBytes() == index.PostingBytes();
+
+	// A damaged file is refused: the last id of the last list cut in the middle of its varint, then pointing past the paths
+	PathTrigramIndex small;
+	small.Add(paths[1]);
+	small.Add(paths[2]);
+	std::vector<uint8_t> bytes;
+	small.Serialize(bytes);
+	PathTrigramIndex damaged;
+	bytes.back() = 0x80;
+	bool refused = damaged.Deserialize(bytes.data(), bytes.size()) == false && damaged.Size() == 0;
+	bytes.back() = 0x7F;
+	refused = refused && damaged.Deserialize(bytes.data(), bytes.size()) == false;
+	roundTrip = roundTrip && refused;
+	uintmax_t fileSize = roundTrip ? std::filesystem::file_size(fileName) : 0;
+	std::remove(fileName.c_str());
+
+	std::cout << "\tRemove " << pathCount / 5 << " paths " << removeSeconds * 1e3 << " ms, add " << added.size() << " paths "
+		<< addSeconds * 1e3 << " ms" << (same && updated ? "" : " (MISMATCH)") << std::endl;
+	std::cout << "\tSave " << saveSeconds * 1e3 << " ms, load " << loadSeconds * 1e3 << " ms, " << fileSize / (1024 * 1024) << " MB"
+		<< (roundTrip ? "" : " (MISMATCH)") << std::endl;
+}
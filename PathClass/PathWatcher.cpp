@@ -0,0 +1,398 @@
+#include "PathWatcher.h"
+
+#ifdef PLATFORM_LINUX
+
+#include "LinuxDirectory.h"
+#include "PathEncoding.h"
+#include "PathHash.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace PathCore
+{
+	namespace
+	{
+		constexpr uint32_t WatchMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB
+			| IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+		/* Room for a few hundred events per read() */
+		constexpr size_t EventBufferSize = 64 * 1024;
+		/* Bytes asked to getdents64 per call, when a new directory is watched */
+		constexpr size_t DirectoryBufferSize = 32 * 1024;
+
+		/* "C:/" is watched as "C:", so the event names are appended after one separator */
+		PathView WithoutTrailingSeparators(const IPath& directory)
+		{
+			PathView view(directory.Data(), directory.Size());
+			while (view.Size() > 0 && IsSeparator(view[view.Size() - 1]))
+				view = PathView(view.Data(), view.Size() - 1);
+			return (view);
+		}
+	}
+
+	PathWatcher::PathWatcher(const PathWatcherOptions& options)
+		: m_Options(options),
+		m_Fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+		m_BufferWatch(-1),
+		m_NarrowPath(options.RootDirectory),
+		m_EventBuffer(EventBufferSize),
+		m_DirectoryBuffer(DirectoryBufferSize)
+	{
+		if (m_NarrowPath.empty() || m_NarrowPath.back() != '/')
+			m_NarrowPath += '/';
+		m_NarrowRootSize = m_NarrowPath.size();
+		m_NarrowPath.resize(m_NarrowRootSize + MaxUtf8Size(MAX_PATH_LENGTH) + NULL_TERMINATOR_LENGTH);
+	}
+
+	PathWatcher::~PathWatcher()
+	{
+		if (m_Fd >= 0)
+			close(m_Fd);
+	}
+
+	bool PathWatcher::Watch(const IPath& directory)
+	{
+		if (IsValid() == false)
+			return (false);
+
+		PathView root = WithoutTrailingSeparators(directory);
+		m_Roots.emplace_back(root);
+		MoveBufferTo(root);
+		m_BufferWatch = -1;
+		return (AddWatch(false));
+	}
+
+	void PathWatcher::Unwatch(const IPath& rawDirectory)
+	{
+		PathView directory = WithoutTrailingSeparators(rawDirectory);
+		RemoveWatches(directory, true);
+		m_Roots.erase(std::remove_if(m_Roots.begin(), m_Roots.end(), [&directory](const StaticPath& root)
+		{
+			return (ArePathsEqual(root, directory));
+		}), m_Roots.end());
+	}
+
+	size_t PathWatcher::Poll(std::vector<PathChange>& outChanges, std::chrono::milliseconds timeout)
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point deadline = now + timeout;
+		while (true)
+		{
+			std::chrono::steady_clock::time_point wakeUp = deadline;
+			if (m_Pending.empty() == false)
+			{
+				std::chrono::steady_clock::time_point ready = std::min(m_LastEvent + m_Options.CoalesceWindow, m_FirstEvent + m_Options.MaxDelay);
+				if (now >= ready)
+				{
+					size_t count = m_Pending.size();
+					Deliver(outChanges);
+					return (count);
+				}
+				wakeUp = std::min(wakeUp, ready);
+			}
+			if (now >= deadline)
+				return (0);
+
+			// Rounded up, a 0 ms poll() before the window ends would spin
+			auto wait = std::chrono::ceil<std::chrono::milliseconds>(wakeUp - now);
+			struct pollfd descriptor = { m_Fd, POLLIN, 0 };
+			int ready = poll(&descriptor, 1, static_cast<int>(wait.count()));
+			if (ready > 0)
+				ReadEvents();
+			else if (ready < 0 && errno != EINTR)
+				return (0);
+			now = std::chrono::steady_clock::now();
+		}
+	}
+
+	bool PathWatcher::AddWatch(bool reportEntries)
+	{
+		if (m_Options.MaxWatches != 0 && m_Watches.size() >= m_Options.MaxWatches)
+		{
+			m_Stats.WatchLimitHits++;
+			Record(m_Buffer).Rescan = true;
+			errno = ENOSPC;
+			return (false);
+		}
+
+		const char* narrow = BufferToNarrow();
+		int watch = inotify_add_watch(m_Fd, narrow, WatchMask);
+		if (watch < 0)
+		{
+			if (errno == ENOSPC)
+			{
+				// fs.inotify.max_user_watches reached: the caller falls back to scanning this directory
+				m_Stats.WatchLimitHits++;
+				Record(m_Buffer).Rescan = true;
+				errno = ENOSPC;
+			}
+			return (false);
+		}
+		m_Watches[watch] = StaticPath(m_Buffer);
+		if (m_Options.Recursive == false)
+			return (true);
+
+		int fd = open(narrow, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0)
+			return (errno == ENOENT);
+
+		// Read the whole directory first: the descriptor is closed before going deeper, and m_DirectoryBuffer is reused there
+		std::vector<TCHAR> subdirectoryNames;
+		std::vector<SegmentSize> subdirectorySizes;
+		while (true)
+		{
+			long read = ReadDirectoryEntries(fd, m_DirectoryBuffer.data(), m_DirectoryBuffer.size());
+			if (read <= 0)
+				break;
+
+			for (long offset = 0; offset < read; )
+			{
+				const LinuxDirent64* record = reinterpret_cast<const LinuxDirent64*>(m_DirectoryBuffer.data() + offset);
+				offset += record->RecordLength;
+				if (IsDotOrDotDot(record->Name))
+					continue;
+
+				WalkEntryType type;
+				TCHAR name[PATH_MAX_FOLDER_NAME_LENGTH + NULL_TERMINATOR_LENGTH];
+				SegmentSize nameSize;
+				if (ReadEntryType(fd, *record, type) == false)
+					continue; // Removed in between
+				if (DecodeEntryName(record->Name, name, nameSize) == false || m_Buffer.Size() + PATH_SEPARATOR_LENGTH + nameSize > MAX_PATH_LENGTH)
+				{
+					m_Stats.SkippedNames++;
+					continue;
+				}
+
+				if (reportEntries)
+				{
+					m_Buffer.Append(name);
+					PathChange& change = Record(m_Buffer);
+					change.Created = true;
+					change.IsDirectory = (type == WalkEntryType::Directory);
+					ConstSegmentIterator last = m_Buffer.EndSegment();
+					--last;
+					m_Buffer.Shrink(last);
+				}
+				if (type == WalkEntryType::Directory)
+				{
+					subdirectoryNames.insert(subdirectoryNames.end(), name, name + nameSize + NULL_TERMINATOR_LENGTH);
+					subdirectorySizes.push_back(nameSize);
+				}
+			}
+		}
+		close(fd);
+
+		bool watched = true;
+		const TCHAR* name = subdirectoryNames.data();
+		for (SegmentSize nameSize : subdirectorySizes)
+		{
+			m_Buffer.Append(name);
+			// A subdirectory removed in between has nothing left to watch
+			watched &= (AddWatch(reportEntries) || errno == ENOENT);
+			ConstSegmentIterator last = m_Buffer.EndSegment();
+			--last;
+			m_Buffer.Shrink(last);
+			name += nameSize + NULL_TERMINATOR_LENGTH;
+		}
+		return (watched);
+	}
+
+	void PathWatcher::RemoveWatches(const IPath& directory, bool removeFromKernel)
+	{
+		for (auto watch = m_Watches.begin(); watch != m_Watches.end(); )
+		{
+			const StaticPath& watched = watch->second;
+			bool isBelow = watched.Size() >= directory.Size()
+				&& ArePathsEqual(watched.Data(), directory.Size(), directory.Data(), directory.Size())
+				&& (watched.Size() == directory.Size() || IsSeparator(watched[directory.Size()]));
+			if (isBelow == false)
+			{
+				++watch;
+				continue;
+			}
+
+			if (removeFromKernel)
+				inotify_rm_watch(m_Fd, watch->first);
+			if (m_BufferWatch == watch->first)
+				m_BufferWatch = -1;
+			watch = m_Watches.erase(watch);
+		}
+	}
+
+	void PathWatcher::RemoveRoot(const IPath& directory, bool moved)
+	{
+		auto root = std::find_if(m_Roots.begin(), m_Roots.end(), [&directory](const StaticPath& root)
+		{
+			return (ArePathsEqual(root, directory));
+		});
+		if (root == m_Roots.end())
+			return;
+
+		PathChange& change = Record(*root);
+		change.Removed = true;
+		change.IsDirectory = true;
+		// A deleted directory's watches are dropped by the kernel, a moved one keeps them under a path unknown here
+		RemoveWatches(*root, moved);
+		m_Roots.erase(root);
+	}
+
+	void PathWatcher::MoveBufferTo(const IPath& path)
+	{
+		SegmentIterator bufferSegment = m_Buffer.BeginSegment();
+		ConstSegmentIterator pathSegment = path.BeginSegment();
+		while (bufferSegment && pathSegment && bufferSegment.Size() == pathSegment.Size()
+			&& std::equal(*pathSegment, *pathSegment + pathSegment.Size(), *bufferSegment))
+		{
+			++bufferSegment;
+			++pathSegment;
+		}
+		m_Buffer.Shrink(bufferSegment);
+		m_Buffer.Append(pathSegment, path.EndSegment());
+	}
+
+	const char* PathWatcher::BufferToNarrow()
+	{
+		// The root anchor maps to RootDirectory, the rest is relative to it
+		PathSize relativeStart = RootAnchorLength(m_Buffer);
+		char* relative = &m_NarrowPath[m_NarrowRootSize];
+		if (relativeStart >= m_Buffer.Size())
+			std::strcpy(relative, ".");
+		else
+			EncodePosixPath(m_Buffer.Data() + relativeStart, m_Buffer.Size() - relativeStart, relative);
+		return (m_NarrowPath.c_str());
+	}
+
+	void PathWatcher::ReadEvents()
+	{
+		while (true)
+		{
+			ssize_t size = read(m_Fd, m_EventBuffer.data(), m_EventBuffer.size());
+			if (size <= 0)
+				return;
+
+			for (ssize_t offset = 0; offset < size; )
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(m_EventBuffer.data() + offset);
+				offset += sizeof(inotify_event) + event->len;
+				m_Stats.Events++;
+
+				if (event->mask & IN_Q_OVERFLOW)
+				{
+					// Events were lost, nothing below the roots can be trusted
+					m_Stats.Overflows++;
+					for (const StaticPath& root : m_Roots)
+						Record(root).Rescan = true;
+					continue;
+				}
+
+				auto watch = m_Watches.find(event->wd);
+				if (watch == m_Watches.end())
+					continue; // Removed, its last events are still queued
+				if (event->mask & IN_IGNORED)
+				{
+					if (m_BufferWatch == event->wd)
+						m_BufferWatch = -1;
+					m_Watches.erase(watch);
+					continue;
+				}
+				if (event->len == 0)
+				{
+					// The directory itself, its parent reports it unless it is a root
+					if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+						RemoveRoot(watch->second, (event->mask & IN_MOVE_SELF) != 0);
+					continue;
+				}
+
+				TCHAR name[PATH_MAX_FOLDER_NAME_LENGTH + NULL_TERMINATOR_LENGTH];
+				SegmentSize nameSize;
+				if (DecodeEntryName(event->name, name, nameSize) == false)
+				{
+					m_Stats.SkippedNames++;
+					continue;
+				}
+
+				if (m_BufferWatch != event->wd)
+				{
+					MoveBufferTo(watch->second);
+					m_BufferWatch = event->wd;
+				}
+				if (m_Buffer.Size() + PATH_SEPARATOR_LENGTH + nameSize > MAX_PATH_LENGTH)
+				{
+					m_Stats.SkippedNames++;
+					continue;
+				}
+				m_Buffer.Append(name);
+
+				bool isDirectory = (event->mask & IN_ISDIR) != 0;
+				bool created = (event->mask & (IN_CREATE | IN_MOVED_TO)) != 0;
+				bool removed = (event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0;
+				PathChange& change = Record(m_Buffer);
+				change.Created |= created;
+				change.Modified |= (event->mask & (IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB)) != 0;
+				change.Removed |= removed;
+				change.IsDirectory |= isDirectory;
+
+				if (isDirectory && m_Options.Recursive)
+				{
+					// A deleted directory's watches are dropped by the kernel, a moved one keeps them under its old path
+					if (removed)
+						RemoveWatches(m_Buffer, (event->mask & IN_MOVED_FROM) != 0);
+					else if (created)
+						AddWatch(true);
+				}
+
+				ConstSegmentIterator last = m_Buffer.EndSegment();
+				--last;
+				m_Buffer.Shrink(last);
+			}
+		}
+	}
+
+	PathChange& PathWatcher::Record(const IPath& path)
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		m_LastEvent = now;
+
+		uint64_t hash = HashPath(path);
+		auto found = m_PendingIndex.find(hash);
+		uint32_t next = NoPendingChange;
+		if (found != m_PendingIndex.end())
+		{
+			for (uint32_t index = found->second; index != NoPendingChange; index = m_Pending[index].Next)
+			{
+				if (ArePathsEqual(m_Pending[index].Change.Path, path))
+				{
+					m_Stats.Coalesced++;
+					return (m_Pending[index].Change);
+				}
+			}
+			next = found->second;
+		}
+
+		if (m_Pending.empty())
+			m_FirstEvent = now;
+		m_PendingIndex[hash] = static_cast<uint32_t>(m_Pending.size());
+		m_Pending.push_back({ PathChange(), next });
+		m_Pending.back().Change.Path = StaticPath(path);
+		return (m_Pending.back().Change);
+	}
+
+	void PathWatcher::Deliver(std::vector<PathChange>& outChanges)
+	{
+		outChanges.reserve(outChanges.size() + m_Pending.size());
+		for (PendingChange& pending : m_Pending)
+			outChanges.push_back(std::move(pending.Change));
+		m_Stats.Changes += m_Pending.size();
+		m_Pending.clear();
+		m_PendingIndex.clear();
+	}
+}
+
+#endif
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "Path.h"
+
+#ifdef PLATFORM_LINUX
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace PathCore
+{
+	/**
+	 * What happened to a path during a coalescing window.
+	 * Every event of the window is merged in one change: a file created then written has Created and Modified,
+	 * a file created then removed has Created and Removed (check the file system if it matters).
+	 */
+	struct PathChange
+	{
+		StaticPath Path;
+		bool Created = false;
+		bool Modified = false;
+		bool Removed = false;
+		bool IsDirectory = false;
+		/* The changes below Path are unknown (event queue overflow, watch limit reached), scan it again */
+		bool Rescan = false;
+	};
+
+	struct PathWatcherOptions
+	{
+		/* The directory the root anchor of the paths (the empty segment of "/usr", relative paths have none) maps to */
+		const char* RootDirectory = "/";
+		/* Watch the subdirectories too, including the ones created later */
+		bool Recursive = true;
+		/* A batch is delivered once no event came for this long */
+		std::chrono::milliseconds CoalesceWindow = std::chrono::milliseconds(50);
+		/* ... or once its first event is this old, so a directory that never stays quiet is still reported */
+		std::chrono::milliseconds MaxDelay = std::chrono::milliseconds(500);
+		/* Stop adding watches past this count (0: only the kernel limit, fs.inotify.max_user_watches) */
+		size_t MaxWatches = 0;
+	};
+
+	struct PathWatcherStats
+	{
+		/* inotify events read */
+		uint64_t Events = 0;
+		/* Changes delivered, after coalescing */
+		uint64_t Changes = 0;
+		/* Events merged into a change already pending for the same path */
+		uint64_t Coalesced = 0;
+		/* Directories that could not be watched because of the watch limit, reported with Rescan */
+		uint64_t WatchLimitHits = 0;
+		/* Event queue overflows, every watched root is then reported with Rescan */
+		uint64_t Overflows = 0;
+		/* Event names that cannot be a segment (not UTF-8, too long, forbidden character) */
+		uint64_t SkippedNames = 0;
+	};
+
+	/**
+	 * Track the changes below directories with inotify, instead of scanning them again.
+	 *
+	 * Each watch descriptor maps to the StaticPath of its directory, stored once.
+	 * An event path is rebuilt in one reused PathBase: the buffer is moved to the directory of the event
+	 * (Shrink to the shared prefix, Append the rest, nothing to do for consecutive events of one directory),
+	 * then the event name is appended with one Append.
+	 *
+	 * Events are coalesced per path until the directory is quiet for CoalesceWindow,
+	 * then delivered as one batch of deduplicated changes, in the order the paths first changed.
+	 *
+	 * A new directory below a recursive watch is watched at once, and its entries are reported as created
+	 * (they may have been created before the watch was added).
+	 * When the watch limit is reached, the directory that could not be watched is reported with Rescan
+	 * and the watcher keeps working for the directories already watched.
+	 * A directory given to Watch() that is removed or moved away is reported as Removed, and is no longer watched.
+	 *
+	 * Not thread safe, meant to be polled from one thread.
+	 */
+	class PathWatcher
+	{
+	public:
+		explicit PathWatcher(const PathWatcherOptions& options = PathWatcherOptions());
+		~PathWatcher();
+
+		PathWatcher(const PathWatcher&) = delete;
+		PathWatcher& operator=(const PathWatcher&) = delete;
+
+	public:
+		bool IsValid() const { return (m_Fd >= 0); }
+
+		/**
+		 * @brief Watch directory (and its subdirectories if recursive)
+		 * @return false if directory or one of its subdirectories could not be watched
+		 *         (a missing subdirectory is ignored, a watch limit is reported by the next Poll() with Rescan)
+		 */
+		bool Watch(const IPath& directory);
+		/* Stop watching directory and its subdirectories */
+		void Unwatch(const IPath& directory);
+
+		/**
+		 * @brief Wait for a batch of changes
+		 * @param timeout Give up after this long, the pending changes are kept for the next call
+		 * @return The amount of changes appended to outChanges
+		 */
+		size_t Poll(std::vector<PathChange>& outChanges, std::chrono::milliseconds timeout);
+
+		/* Readable when events are waiting, to poll the watcher with other descriptors */
+		int FileDescriptor() const { return (m_Fd); }
+
+	public:
+		size_t WatchCount() const { return (m_Watches.size()); }
+		PathWatcherStats Stats() const { return (m_Stats); }
+
+	private:
+		struct PendingChange
+		{
+			PathChange Change;
+			/* Next change with the same hash, or NoPendingChange */
+			uint32_t Next;
+		};
+
+		static constexpr uint32_t NoPendingChange = UINT32_MAX;
+
+	private:
+		/* Watch the directory in m_Buffer and below, m_Buffer is left unchanged */
+		bool AddWatch(bool reportEntries);
+		/* Forget the watches of directory and below */
+		void RemoveWatches(const IPath& directory, bool removeFromKernel);
+		/* Report directory as removed and forget it, if it was given to Watch() */
+		void RemoveRoot(const IPath& directory, bool moved);
+		/* Move m_Buffer to path, keeping the segments they share */
+		void MoveBufferTo(const IPath& path);
+		/* Absolute narrow path of m_Buffer, for the system calls */
+		const char* BufferToNarrow();
+
+		void ReadEvents();
+		/* The pending change of path, created if needed */
+		PathChange& Record(const IPath& path);
+		void Deliver(std::vector<PathChange>& outChanges);
+
+	private:
+		PathWatcherOptions m_Options;
+		int m_Fd;
+
+		/* Watch descriptor -> watched directory */
+		std::unordered_map<int, StaticPath> m_Watches;
+		/* The directories given to Watch(), rescanned after an overflow */
+		std::vector<StaticPath> m_Roots;
+
+		/* Rebuilds the event paths, and the directory being watched by AddWatch() */
+		Path m_Buffer;
+		/* The watch whose directory is in m_Buffer, -1 if none */
+		int m_BufferWatch;
+		/* RootDirectory followed by the encoded path of m_Buffer */
+		std::string m_NarrowPath;
+		size_t m_NarrowRootSize;
+		std::vector<char> m_EventBuffer;
+		std::vector<char> m_DirectoryBuffer;
+
+		std::vector<PendingChange> m_Pending;
+		/* Hash of the path -> first pending change with that hash */
+		std::unordered_map<uint64_t, uint32_t> m_PendingIndex;
+		std::chrono::steady_clock::time_point m_FirstEvent;
+		std::chrono::steady_clock::time_point m_LastEvent;
+
+		PathWatcherStats m_Stats;
+	};
+}
+
+#endif
@@ -0,0 +1,174 @@
+#include "Benchmarks.h"
+#include "DirectoryWalker.h"
+#include "PathHash.h"
+#include "PathWatcher.h"
+
+#ifdef PLATFORM_LINUX
+
+#include <string>
+
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace PathCore;
+
+namespace
+{
+	int RemoveEntry(const char* path, const struct stat*, int, struct FTW*) { return (remove(path)); }
+
+	/* fanout^depth directories, files in every directory, returns the amount of entries created */
+	size_t CreateTree(const std::string& directory, int depth, int fanout, int fileCount)
+	{
+		size_t created = 0;
+		for (int file = 0; file < fileCount; file++)
+		{
+			int fd = open((directory + "/file_" + std::to_string(file) + ".txt").c_str(), O_CREAT | O_WRONLY, 0644);
+			if (fd >= 0)
+			{
+				close(fd);
+				created++;
+			}
+		}
+		if (depth == 0)
+			return (created);
+
+		for (int child = 0; child < fanout; child++)
+		{
+			std::string childDirectory = directory + "/directory_" + std::to_string(child);
+			if (mkdir(childDirectory.c_str(), 0755) == 0)
+				created += 1 + CreateTree(childDirectory, depth - 1, fanout, fileCount);
+		}
+		return (created);
+	}
+
+	/* Poll until a change of path comes, or nothing comes for a second */
+	const PathChange* PollFor(PathWatcher& watcher, const IPath& path, std::vector<PathChange>& outChanges)
+	{
+		while (true)
+		{
+			for (const PathChange& change : outChanges)
+			{
+				if (ArePathsEqual(change.Path, path))
+					return (&change);
+			}
+			if (watcher.Poll(outChanges, std::chrono::milliseconds(1000)) == 0)
+				return (nullptr);
+		}
+	}
+
+	/* Append to a file several times, like an editor saving or a build writing its output in chunks */
+	void WriteBurst(const std::string& file, int writes)
+	{
+		for (int write = 0; write < writes; write++)
+		{
+			int fd = open(file.c_str(), O_CREAT | O_WRONLY | O_APPEND, 0644);
+			if (fd < 0)
+				return;
+			::write(fd, "data", 4);
+			close(fd);
+		}
+	}
+}
+
+void BenchmarkPathWatcher()
+{
+	char rootTemplate[] = "/tmp/PathWatcher.XXXXXX";
+	if (mkdtemp(rootTemplate) == nullptr)
+	{
+		std::cout << "PathWatcher: could not create a temporary directory" << std::endl;
+		return;
+	}
+	std::string root = rootTemplate;
+	size_t created = CreateTree(root, 3, 10, 8);
+
+	// The whole temporary tree is the root anchor
+	Path watchedRoot(TEXT("/"));
+	DirectoryWalkerOptions walkerOptions;
+	walkerOptions.RootDirectory = root.c_str();
+	size_t scanned = 0;
+	double scanSeconds = MeasureSeconds([&]()
+	{
+		scanned = CollectDirectory(watchedRoot, walkerOptions).size();
+	});
+
+	PathWatcherOptions options;
+	options.RootDirectory = root.c_str();
+	options.CoalesceWindow = std::chrono::milliseconds(20);
+	PathWatcher watcher(options);
+	bool watched = false;
+	double watchSeconds = MeasureSeconds([&]()
+	{
+		watched = watcher.Watch(watchedRoot);
+	});
+
+	// A burst: a few files written many times, spread over the tree
+	const int fileCount = 50;
+	const int writes = 20;
+	std::vector<PathChange> changes;
+	double detectSeconds = MeasureSeconds([&]()
+	{
+		for (int file = 0; file < fileCount; file++)
+			WriteBurst(root + "/directory_" + std::to_string(file % 10) + "/directory_" + std::to_string(file / 10) + "/burst.log", writes);
+		while (watcher.Poll(changes, std::chrono::milliseconds(1000)) > 0 && changes.size() < fileCount)
+			;
+	});
+	PathWatcherStats stats = watcher.Stats();
+	// One change per file, created then written
+	bool burstMatches = changes.size() == fileCount;
+	for (const PathChange& change : changes)
+		burstMatches &= change.Created && change.Modified && change.Removed == false && change.IsDirectory == false && change.Rescan == false;
+
+	// The same tree with a watch limit far below its directory count
+	PathWatcherOptions limitedOptions = options;
+	limitedOptions.MaxWatches = 16;
+	PathWatcher limited(limitedOptions);
+	limited.Watch(watchedRoot);
+	std::vector<PathChange> rescans;
+	limited.Poll(rescans, std::chrono::milliseconds(1000));
+	// Every directory that was not watched is reported once, to be rescanned
+	bool limitMatches = limited.WatchCount() == limitedOptions.MaxWatches && rescans.empty() == false
+		&& rescans.size() == limited.Stats().WatchLimitHits;
+	for (const PathChange& change : rescans)
+		limitMatches &= change.Rescan;
+
+	// Watched directories of their own that go away: a temporary directory removed, and one moved out of sight
+	std::string removedDirectory = root + "/removed";
+	std::string movedDirectory = root + "/moved";
+	mkdir(removedDirectory.c_str(), 0755);
+	mkdir(movedDirectory.c_str(), 0755);
+	CreateTree(removedDirectory, 1, 2, 2);
+	Path removedRoot(TEXT("/removed"));
+	Path movedRoot(TEXT("/moved"));
+	PathWatcher temporary(options);
+	bool gone = temporary.Watch(removedRoot) && temporary.Watch(movedRoot) && temporary.WatchCount() == 4;
+	nftw(removedDirectory.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+	rename(movedDirectory.c_str(), (root + "/moved_away").c_str());
+	std::vector<PathChange> goneChanges;
+	const PathChange* removedChange = PollFor(temporary, removedRoot, goneChanges);
+	gone = gone && removedChange != nullptr && removedChange->Removed && removedChange->IsDirectory;
+	const PathChange* movedChange = PollFor(temporary, movedRoot, goneChanges);
+	gone = gone && movedChange != nullptr && movedChange->Removed && movedChange->IsDirectory && temporary.WatchCount() == 0;
+
+	std::cout << "PathWatcher: " << created << " entries, " << watcher.WatchCount() << " directories watched" << (watched ? "" : " (some could not be watched)") << std::endl;
+	std::cout << "\tFull scan:     " << scanSeconds * 1e3 << " ms (" << scanned << " entries)" << std::endl;
+	std::cout << "\tWatch setup:   " << watchSeconds * 1e3 << " ms" << std::endl;
+	std::cout << "\tBurst:         " << fileCount * writes << " writes to " << fileCount << " files, " << stats.Events << " events -> "
+		<< changes.size() << " changes (" << stats.Coalesced << " coalesced) in " << detectSeconds * 1e3 << " ms, window included"
+		<< (burstMatches ? "" : " (MISMATCH)") << std::endl;
+	std::cout << "\tWatch limit:   " << limited.WatchCount() << " watches, " << rescans.size() << " directories to rescan"
+		<< (limitMatches ? "" : " (MISMATCH)") << std::endl;
+	std::cout << "\tRoots gone:    removed and moved away directories reported" << (gone ? "" : " (MISMATCH)") << std::endl;
+
+	nftw(root.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+#else
+
+void BenchmarkPathWatcher()
+{
+	std::cout << "PathWatcher: not available on this platform" << std::endl;
+}
+
+#endif
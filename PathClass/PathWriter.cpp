@@ -0,0 +1,270 @@
+#include "PathWriter.h"
+#include "PathEncoding.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef PLATFORM_WINDOWS
+# define WIN32_LEAN_AND_MEAN
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+namespace PathCore
+{
+	namespace
+	{
+		/* The encoded size of a path or a delimiter never goes past it, in both encodings */
+		constexpr size_t MinBufferSize = MaxUtf8Size(MAX_PATH_LENGTH) + 2 * sizeof(char16_t);
+
+		/**
+		 * @brief Encode characters to UTF-16
+		 * @param out Must hold at least 2 * size units (a UTF-32 character can take a surrogate pair)
+		 * @return The amount of units written
+		 */
+		size_t EncodeUtf16(const TCHAR* data, size_t size, char16_t* out)
+		{
+			if constexpr (sizeof(TCHAR) == 2)
+			{
+				std::memcpy(out, data, size * sizeof(char16_t));
+				return (size);
+			}
+
+			size_t written = 0;
+			if constexpr (sizeof(TCHAR) == 1)
+			{
+				// Narrow paths are UTF-8, a malformed sequence becomes U+FFFD instead of stopping the output
+				const unsigned char* cursor = reinterpret_cast<const unsigned char*>(data);
+				const unsigned char* end = cursor + size;
+				while (cursor < end)
+				{
+					uint32_t codePoint;
+					if (DecodeUtf8(cursor, end, codePoint) == false)
+						codePoint = 0xFFFD;
+					if (codePoint >= 0x10000)
+					{
+						codePoint -= 0x10000;
+						out[written++] = static_cast<char16_t>(0xD800 | (codePoint >> 10));
+						out[written++] = static_cast<char16_t>(0xDC00 | (codePoint & 0x3FF));
+					}
+					else
+						out[written++] = static_cast<char16_t>(codePoint);
+				}
+			}
+			else
+			{
+				for (size_t index = 0; index < size; index++)
+				{
+					uint32_t codePoint = static_cast<uint32_t>(data[index]);
+					if (codePoint >= 0x10000)
+					{
+						codePoint -= 0x10000;
+						out[written++] = static_cast<char16_t>(0xD800 | (codePoint >> 10));
+						out[written++] = static_cast<char16_t>(0xDC00 | (codePoint & 0x3FF));
+					}
+					else
+						out[written++] = static_cast<char16_t>(codePoint);
+				}
+			}
+			return (written);
+		}
+
+		/* Separators are ASCII, so they can be replaced after the encoding: no unit of a multi unit character is one */
+		template<typename Unit>
+		void ReplaceSeparators(Unit* data, size_t size, Unit separator)
+		{
+			// Always stored, so the loop is vectorized
+			for (size_t index = 0; index < size; index++)
+			{
+				Unit unit = data[index];
+				data[index] = (unit == Unit('/') || unit == Unit('\\')) ? separator : unit;
+			}
+		}
+	}
+
+	PathWriter::PathWriter(const char* fileName, const PathWriterOptions& options)
+		: PathWriter(static_cast<std::ostream*>(nullptr), options)
+	{
+#ifdef PLATFORM_WINDOWS
+		HANDLE file = CreateFileA(fileName, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file != INVALID_HANDLE_VALUE)
+			m_FileHandle = file;
+		m_Failed = m_FileHandle == nullptr;
+#else
+		m_Fd = open(fileName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		m_Failed = m_Fd < 0;
+#endif
+	}
+
+	PathWriter::PathWriter(std::ostream& stream, const PathWriterOptions& options)
+		: PathWriter(&stream, options)
+	{}
+
+	PathWriter::PathWriter(std::ostream* stream, const PathWriterOptions& options)
+		: m_Options(options),
+		m_Buffer(std::max(options.BufferSize, MinBufferSize)),
+		m_Used(0),
+		m_Stream(stream),
+#ifdef PLATFORM_WINDOWS
+		m_FileHandle(nullptr),
+#else
+		m_Fd(-1),
+#endif
+		m_Failed(false),
+		m_PathsWritten(0),
+		m_BytesWritten(0)
+	{
+		assert((options.Separator == 0 || IsSeparator(options.Separator)) && "The separator must be '/' or '\\'");
+	}
+
+	PathWriter::~PathWriter()
+	{
+		Flush();
+		Close();
+	}
+
+	void PathWriter::Write(const IPath& path)
+	{
+		Encode(path.Data(), path.Size(), m_Options.Separator != 0);
+		WriteDelimiter();
+		m_PathsWritten++;
+	}
+
+	void PathWriter::Write(ConstSegmentIterator fromSegment, const ConstSegmentIterator& toSegment)
+	{
+		assert(fromSegment <= toSegment); // 'fromSegment' is after 'toSegment' (also check if they are both from the same path)
+
+		bool first = true;
+		for (; fromSegment != toSegment; ++fromSegment)
+		{
+			// The segments of a path are contiguous, the separator is the character before the segment
+			if (first == false)
+			{
+				TCHAR separator = m_Options.Separator != 0 ? m_Options.Separator : (*fromSegment)[-1];
+				Encode(&separator, 1, false);
+			}
+			Encode(*fromSegment, fromSegment.Size(), false);
+			first = false;
+		}
+		WriteDelimiter();
+		m_PathsWritten++;
+	}
+
+	void PathWriter::WriteCharacters(const TCHAR* data, size_t size)
+	{
+		// Cut in pieces the buffer can always hold
+		while (size > 0)
+		{
+			size_t pieceSize = std::min<size_t>(size, MAX_PATH_LENGTH);
+			Encode(data, pieceSize, false);
+			data += pieceSize;
+			size -= pieceSize;
+		}
+	}
+
+	void PathWriter::WriteDelimiter()
+	{
+		if (m_Options.Encoding == PathWriterEncoding::Utf8)
+			*Reserve(1) = m_Options.Delimiter;
+		else
+		{
+			char16_t delimiter = static_cast<unsigned char>(m_Options.Delimiter);
+			std::memcpy(Reserve(sizeof(delimiter)), &delimiter, sizeof(delimiter));
+		}
+	}
+
+	bool PathWriter::Flush()
+	{
+		const char* data = m_Buffer.data();
+		size_t size = m_Used;
+		m_BytesWritten += m_Used;
+		m_Used = 0;
+		if (m_Failed)
+			return (false);
+
+		if (m_Stream)
+		{
+			m_Stream->write(data, size);
+			m_Failed = m_Stream->fail();
+			return (m_Failed == false);
+		}
+
+#ifdef PLATFORM_WINDOWS
+		while (size > 0)
+		{
+			DWORD written = 0;
+			DWORD pieceSize = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+			if (WriteFile(m_FileHandle, data, pieceSize, &written, nullptr) == FALSE)
+			{
+				m_Failed = true;
+				break;
+			}
+			data += written;
+			size -= written;
+		}
+#else
+		while (size > 0)
+		{
+			ssize_t written = write(m_Fd, data, size);
+			if (written < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				m_Failed = true;
+				break;
+			}
+			data += written;
+			size -= static_cast<size_t>(written);
+		}
+#endif
+		return (m_Failed == false);
+	}
+
+	char* PathWriter::Reserve(size_t size)
+	{
+		if (m_Used + size > m_Buffer.size())
+			Flush();
+		char* reserved = m_Buffer.data() + m_Used;
+		m_Used += size;
+		return (reserved);
+	}
+
+	void PathWriter::Encode(const TCHAR* data, size_t size, bool replaceSeparators)
+	{
+		// Reserve the worst case (4 bytes per character in both encodings), then give back what was not used
+		char* out = Reserve(MaxUtf8Size(size));
+		size_t written;
+		if (m_Options.Encoding == PathWriterEncoding::Utf8)
+		{
+			written = EncodeUtf8(data, size, out);
+			if (replaceSeparators)
+				ReplaceSeparators(out, written, static_cast<char>(m_Options.Separator));
+		}
+		else
+		{
+			// The buffer only ever holds UTF-16 units here, out stays aligned on them
+			char16_t* units = reinterpret_cast<char16_t*>(out);
+			size_t unitCount = EncodeUtf16(data, size, units);
+			if (replaceSeparators)
+				ReplaceSeparators(units, unitCount, static_cast<char16_t>(m_Options.Separator));
+			written = unitCount * sizeof(char16_t);
+		}
+		m_Used -= MaxUtf8Size(size) - written;
+	}
+
+	void PathWriter::Close()
+	{
+#ifdef PLATFORM_WINDOWS
+		if (m_FileHandle)
+			CloseHandle(m_FileHandle);
+		m_FileHandle = nullptr;
+#else
+		if (m_Fd >= 0)
+			close(m_Fd);
+		m_Fd = -1;
+#endif
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Path.h"
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace PathCore
+{
+	enum class PathWriterEncoding : uint8_t
+	{
+		Utf8,
+		/* In the byte order of the machine, without byte order mark */
+		Utf16
+	};
+
+	struct PathWriterOptions
+	{
+		PathWriterEncoding Encoding = PathWriterEncoding::Utf8;
+		/* Written between the segments ('/' or '\\'), 0 keeps the separators of the paths as they are */
+		TCHAR Separator = 0;
+		/* Written after every path, '\n' for a manifest, '\0' for the tools reading NUL separated lists (xargs -0) */
+		char Delimiter = '\n';
+		/* Bytes encoded before they are written, it never goes below what the longest path needs */
+		size_t BufferSize = 1024 * 1024;
+	};
+
+	/**
+	 * Write paths to a file or a stream, one after the other.
+	 *
+	 * Each path is encoded in one go into a big buffer, which is written with one call
+	 * when it is full (or on Flush() and when the writer is destroyed).
+	 *
+	 * @example PathWriter manifest("manifest.txt"); for (const StaticPath& path : paths) manifest.Write(path);
+	 */
+	class PathWriter
+	{
+	public:
+		/* Create fileName, or truncate it */
+		explicit PathWriter(const char* fileName, const PathWriterOptions& options = PathWriterOptions());
+		/* Write to stream (eg: std::cout), the stream must outlive the writer */
+		explicit PathWriter(std::ostream& stream, const PathWriterOptions& options = PathWriterOptions());
+		/* Flush what is left, and close the file */
+		~PathWriter();
+
+		PathWriter(const PathWriter&) = delete;
+		PathWriter& operator=(const PathWriter&) = delete;
+
+	public:
+		operator bool() const { return (IsValid()); }
+
+	public:
+		/* false if the file could not be created, or once a write failed */
+		bool IsValid() const { return (m_Failed == false); }
+
+		/* Write the path, then the delimiter */
+		void Write(const IPath& path);
+		/* Write the segments from fromSegment (included) to toSegment (not included), then the delimiter */
+		void Write(ConstSegmentIterator fromSegment, const ConstSegmentIterator& toSegment);
+		/* Write characters as they are, no delimiter is added and the separators are not replaced */
+		void WriteCharacters(const TCHAR* data, size_t size);
+		void WriteDelimiter();
+
+		/**
+		 * @brief Write the buffered bytes
+		 * @return false if a write failed, later writes are dropped
+		 */
+		bool Flush();
+
+		uint64_t PathsWritten() const { return (m_PathsWritten); }
+		/* Encoded bytes, the ones still buffered included */
+		uint64_t BytesWritten() const { return (m_BytesWritten + m_Used); }
+
+	private:
+		/* Shared by the public constructors, a null stream means a file */
+		PathWriter(std::ostream* stream, const PathWriterOptions& options);
+
+		/* Make room for size bytes, writing the buffer if needed */
+		char* Reserve(size_t size);
+		/* Encode the characters at the end of the buffer, and replace the separators */
+		void Encode(const TCHAR* data, size_t size, bool replaceSeparators);
+		void Close();
+
+	private:
+		PathWriterOptions m_Options;
+		std::vector<char> m_Buffer;
+		size_t m_Used;
+		std::ostream* m_Stream;
+#ifdef PLATFORM_WINDOWS
+		void* m_FileHandle;
+#else
+		int m_Fd;
+#endif
+		bool m_Failed;
+		uint64_t m_PathsWritten;
+		uint64_t m_BytesWritten;
+	};
+}
@@ -0,0 +1,106 @@
+#include "Benchmarks.h"
+#include "PathWriter.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace PathCore;
+
+namespace
+{
+	/* Paths shaped like a build manifest, stored back to back in one arena */
+	std::vector<PathView> GeneratePaths(size_t count, std::vector<TCHAR>& arena)
+	{
+		std::vector<PathView> views;
+		std::vector<size_t> offsets;
+		for (size_t index = 0; index < count; index++)
+		{
+			std::basic_string<TCHAR> path = TEXT("C:/Projects/PathClass/Intermediate/Module_");
+			path += static_cast<TCHAR>(TEXT('A') + index % 26);
+			path += TEXT("/Folder_");
+			path += static_cast<TCHAR>(TEXT('a') + (index / 26) % 26);
+			path += TEXT("/Object_");
+			for (size_t digits = index; digits > 0 || path.back() == TEXT('_'); digits /= 10)
+				path += static_cast<TCHAR>(TEXT('0') + digits % 10);
+			path += TEXT(".obj");
+
+			offsets.push_back(arena.size());
+			arena.insert(arena.end(), path.begin(), path.end());
+			arena.push_back(NULL);
+		}
+		// Views are made once the arena stopped moving
+		for (size_t index = 0; index < count; index++)
+		{
+			size_t end = index + 1 < count ? offsets[index + 1] - NULL_TERMINATOR_LENGTH : arena.size() - NULL_TERMINATOR_LENGTH;
+			views.emplace_back(arena.data() + offsets[index], static_cast<PathSize>(end - offsets[index]));
+		}
+		return (views);
+	}
+
+	/* What printing a path used to do: one insertion per character */
+	void WritePerCharacter(const char* fileName, const std::vector<PathView>& paths, int passes)
+	{
+		std::ofstream stream(fileName, std::ios::binary);
+		for (int pass = 0; pass < passes; pass++)
+		{
+			for (const PathView& path : paths)
+			{
+				for (PathSize index = 0; index < path.Size(); index++)
+					stream << static_cast<unsigned char>(path[index]);
+				stream << '\n';
+			}
+		}
+	}
+
+	uint64_t WriteWithPathWriter(const char* fileName, const std::vector<PathView>& paths, int passes, const PathWriterOptions& options)
+	{
+		PathWriter writer(fileName, options);
+		for (int pass = 0; pass < passes; pass++)
+		{
+			for (const PathView& path : paths)
+				writer.Write(path);
+		}
+		writer.Flush();
+		return (writer.BytesWritten());
+	}
+}
+
+void BenchmarkPathWriter()
+{
+	std::string fileName = (std::filesystem::temp_directory_path() / "PathWriterBenchmark.txt").string();
+
+	const size_t pathCount = 200000;
+	const int passes = 5;
+	std::vector<TCHAR> arena;
+	std::vector<PathView> paths;
+	double generateSeconds = MeasureSeconds([&]() { paths = GeneratePaths(pathCount, arena); });
+
+	double perCharacterSeconds = MeasureSeconds([&]() { WritePerCharacter(fileName.c_str(), paths, passes); });
+
+	uint64_t utf8Bytes = 0;
+	double utf8Seconds = MeasureSeconds([&]() { utf8Bytes = WriteWithPathWriter(fileName.c_str(), paths, passes, PathWriterOptions()); });
+
+	PathWriterOptions nulOptions;
+	nulOptions.Delimiter = '\0';
+	nulOptions.Separator = WindowsSeparator;
+	double nulSeconds = MeasureSeconds([&]() { WriteWithPathWriter(fileName.c_str(), paths, passes, nulOptions); });
+
+	PathWriterOptions utf16Options;
+	utf16Options.Encoding = PathWriterEncoding::Utf16;
+	uint64_t utf16Bytes = 0;
+	double utf16Seconds = MeasureSeconds([&]() { utf16Bytes = WriteWithPathWriter(fileName.c_str(), paths, passes, utf16Options); });
+
+	double pathsWritten = static_cast<double>(pathCount) * passes;
+	std::cout << "PathWriter: " << pathCount * passes << " paths written, " << pathCount << " generated in " << generateSeconds * 1e3 << " ms" << std::endl;
+	std::cout << "\tPer character ostream:  " << perCharacterSeconds * 1e3 << " ms (" << perCharacterSeconds * 1e9 / pathsWritten << " ns per path)" << std::endl;
+	std::cout << "\tPathWriter UTF-8:       " << utf8Seconds * 1e3 << " ms (" << utf8Seconds * 1e9 / pathsWritten << " ns per path, "
+		<< utf8Bytes / (1024.0 * 1024.0) / utf8Seconds << " MB/s)" << std::endl;
+	std::cout << "\tPathWriter '\\' + NUL:   " << nulSeconds * 1e3 << " ms (" << nulSeconds * 1e9 / pathsWritten << " ns per path)" << std::endl;
+	std::cout << "\tPathWriter UTF-16:      " << utf16Seconds * 1e3 << " ms (" << utf16Seconds * 1e9 / pathsWritten << " ns per path, "
+		<< utf16Bytes / (1024.0 * 1024.0) / utf16Seconds << " MB/s)" << std::endl;
+
+	std::remove(fileName.c_str());
+}
@@ -0,0 +1,66 @@
+#include "Benchmarks.h"
+#include "Path.h"
+#include "PathHash.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace PathCore;
+
+namespace
+{
+	/**
+	 * What a pipeline does with its paths: each stage copies the paths it receives into its own output,
+	 * and the last stage hands them to another thread.
+	 */
+	template<typename PathType>
+	void RunPipeline(const std::vector<PathType>& input, int stageCount, size_t& checksum)
+	{
+		std::vector<PathType> stage(input);
+		for (int index = 1; index < stageCount; index++)
+		{
+			std::vector<PathType> next;
+			next.reserve(stage.size());
+			for (const PathType& path : stage)
+				next.push_back(path);
+			stage = std::move(next);
+		}
+
+		std::thread consumer([&]()
+		{
+			std::vector<PathType> received(stage);
+			for (const PathType& path : received)
+				checksum += path.Size();
+		});
+		consumer.join();
+	}
+}
+
+void BenchmarkSharedPath()
+{
+	const size_t pathCount = 100000;
+	const int stageCount = 8;
+	std::vector<StaticPath> staticPaths = GenerateNumberedPaths(pathCount, TEXT("C:/Projects/PathClass/Intermediate"), nullptr, TEXT("Object_"), { TEXT(".obj") });
+	std::vector<SharedPath> sharedPaths(staticPaths.begin(), staticPaths.end());
+
+	size_t staticChecksum = 0;
+	size_t sharedChecksum = 0;
+	int staticAllocations = 0;
+	int sharedAllocations = 0;
+	double staticSeconds = MeasureSeconds([&]() { staticAllocations = CountAllocations([&]() { RunPipeline(staticPaths, stageCount, staticChecksum); }); });
+	double sharedSeconds = MeasureSeconds([&]() { sharedAllocations = CountAllocations([&]() { RunPipeline(sharedPaths, stageCount, sharedChecksum); }); });
+
+	// Assigned a part of itself: the prefix, then a view starting inside it (the ranges overlap)
+	SharedPath shared(TEXT("/usr/lib/libc.so"));
+	shared.Assign(PathView(shared.Data(), 8));
+	bool assigned = ArePathsEqual(shared, Path(TEXT("/usr/lib")));
+	shared.Assign(PathView(shared.Data() + 4, 4));
+	assigned = assigned && ArePathsEqual(shared, PathView(TEXT("/lib"), 4)) && shared.Data()[shared.Size()] == NULL;
+
+	std::cout << "SharedPath: " << pathCount << " paths copied through " << stageCount << " stages and one thread hand off"
+		<< (staticChecksum == sharedChecksum && assigned ? "" : " (MISMATCH)") << std::endl;
+	std::cout << "\tsizeof: StaticPath " << sizeof(StaticPath) << " bytes, SharedPath " << sizeof(SharedPath) << " bytes" << std::endl;
+	std::cout << "\tStaticPath: " << staticSeconds * 1e3 << " ms, " << staticAllocations << " allocations (on the calling thread)" << std::endl;
+	std::cout << "\tSharedPath: " << sharedSeconds * 1e3 << " ms, " << sharedAllocations << " allocations (on the calling thread)" << std::endl;
+}
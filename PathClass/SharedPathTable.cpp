@@ -0,0 +1,439 @@
+#include "SharedPathTable.h"
+#include "PathHash.h"
+
+#include <atomic>
+#include <cstring>
+#include <new>
+
+#ifdef PLATFORM_WINDOWS
+# define WIN32_LEAN_AND_MEAN
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+namespace PathCore
+{
+	namespace
+	{
+		constexpr uint64_t ControlMagic = 0x4C52544E4F435056ull; // "VPCONTRL"
+		constexpr uint64_t TableMagic = 0x3142415448545056ull; // "VPTHTAB1"
+		/* Smallest amount of hash slots, the table is never more than half full */
+		constexpr uint64_t MinSlotCount = 16;
+
+		/**
+		 * The control segment: which snapshot is the current one.
+		 * Lock free, so it works the same in every process whatever the address it is mapped at.
+		 */
+		struct ControlBlock
+		{
+			uint64_t Magic;
+			std::atomic<uint64_t> Generation;
+		};
+		static_assert(std::atomic<uint64_t>::is_always_lock_free, "The generation is shared between processes");
+
+		/**
+		 * The start of a snapshot segment. Every position is an offset from the start of the segment,
+		 * then come the entries, the hash slots and the characters.
+		 */
+		struct TableHeader
+		{
+			uint64_t Magic;
+			/* sizeof(TCHAR) of the build that wrote the table */
+			uint32_t CharacterSize;
+			uint32_t Reserved;
+			uint64_t PathCount;
+			/* A power of 2 */
+			uint64_t SlotCount;
+			uint64_t EntriesOffset;
+			uint64_t SlotsOffset;
+			uint64_t CharactersOffset;
+			uint64_t TotalSize;
+		};
+
+		struct TableEntry
+		{
+			/* Bytes from CharactersOffset, the characters are null terminated */
+			uint64_t Offset;
+			/* The high half of the path hash (the low half picks the slot), most mismatches stop on it */
+			uint32_t HashTag;
+			PathSize Size;
+			uint16_t Reserved;
+		};
+
+		constexpr uint64_t AlignUp(uint64_t value, uint64_t alignment)
+		{
+			return ((value + alignment - 1) / alignment * alignment);
+		}
+
+		/* The names of the segments, a leading '/' is what shm_open expects */
+		std::string SegmentName(const std::string& name, const char* suffix)
+		{
+#ifdef PLATFORM_WINDOWS
+			return ("Local\\" + name + suffix);
+#else
+			return ("/" + name + suffix);
+#endif
+		}
+		std::string ControlName(const std::string& name) { return (SegmentName(name, ".control")); }
+		std::string SnapshotName(const std::string& name, uint64_t generation) { return (SegmentName(name, ("." + std::to_string(generation)).c_str())); }
+
+		const ControlBlock* Control(const SharedMemory& memory) { return (reinterpret_cast<const ControlBlock*>(memory.Data())); }
+		const TableHeader* Header(const SharedMemory& memory) { return (reinterpret_cast<const TableHeader*>(memory.Data())); }
+		const TableEntry* Entries(const SharedMemory& memory) { return (reinterpret_cast<const TableEntry*>(memory.Data() + Header(memory)->EntriesOffset)); }
+		const uint32_t* Slots(const SharedMemory& memory) { return (reinterpret_cast<const uint32_t*>(memory.Data() + Header(memory)->SlotsOffset)); }
+		const TCHAR* Characters(const SharedMemory& memory, const TableEntry& entry)
+		{
+			return (reinterpret_cast<const TCHAR*>(memory.Data() + Header(memory)->CharactersOffset + entry.Offset));
+		}
+
+		/* A segment written by another build, or another program, must not be read as a table */
+		bool IsTableValid(const SharedMemory& memory)
+		{
+			if (memory.Size() < sizeof(TableHeader))
+				return (false);
+			const TableHeader* header = Header(memory);
+			return (header->Magic == TableMagic && header->CharacterSize == sizeof(TCHAR) && header->TotalSize <= memory.Size()
+				&& header->SlotCount >= MinSlotCount && (header->SlotCount & (header->SlotCount - 1)) == 0);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// SHARED MEMORY
+
+#ifdef PLATFORM_WINDOWS
+
+	bool SharedMemory::Create(const std::string& name, size_t size)
+	{
+		Close();
+		uint64_t size64 = size;
+		m_MappingHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+			static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64), name.c_str());
+		if (m_MappingHandle == nullptr)
+			return (false);
+
+		m_Data = static_cast<char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, size));
+		if (m_Data == nullptr)
+		{
+			Close();
+			return (false);
+		}
+		m_Size = size;
+		return (true);
+	}
+
+	bool SharedMemory::Open(const std::string& name)
+	{
+		Close();
+		m_MappingHandle = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+		if (m_MappingHandle == nullptr)
+			return (false);
+
+		m_Data = static_cast<char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+		MEMORY_BASIC_INFORMATION info;
+		if (m_Data == nullptr || VirtualQuery(m_Data, &info, sizeof(info)) == 0)
+		{
+			Close();
+			return (false);
+		}
+		m_Size = info.RegionSize;
+		return (true);
+	}
+
+	void SharedMemory::Unlink(const std::string&)
+	{}
+
+	void SharedMemory::Close()
+	{
+		if (m_Data)
+			UnmapViewOfFile(m_Data);
+		if (m_MappingHandle)
+			CloseHandle(m_MappingHandle);
+
+		m_Data = nullptr;
+		m_Size = 0;
+		m_MappingHandle = nullptr;
+	}
+
+#else
+
+	bool SharedMemory::Create(const std::string& name, size_t size)
+	{
+		Close();
+		// A new object, never the old one truncated under the processes that still map it
+		shm_unlink(name.c_str());
+		int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+		if (fd < 0)
+			return (false);
+
+		if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+		{
+			close(fd);
+			shm_unlink(name.c_str());
+			return (false);
+		}
+
+		void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd); // The mapping keeps its own reference on the object
+		if (data == MAP_FAILED)
+		{
+			shm_unlink(name.c_str());
+			return (false);
+		}
+		m_Data = static_cast<char*>(data);
+		m_Size = size;
+		return (true);
+	}
+
+	bool SharedMemory::Open(const std::string& name)
+	{
+		Close();
+		int fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+		if (fd < 0)
+			return (false);
+
+		struct stat objectStat;
+		if (fstat(fd, &objectStat) != 0 || objectStat.st_size == 0)
+		{
+			close(fd);
+			return (false);
+		}
+
+		void* data = mmap(nullptr, static_cast<size_t>(objectStat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED)
+			return (false);
+		m_Data = static_cast<char*>(data);
+		m_Size = static_cast<size_t>(objectStat.st_size);
+		return (true);
+	}
+
+	void SharedMemory::Unlink(const std::string& name)
+	{
+		shm_unlink(name.c_str());
+	}
+
+	void SharedMemory::Close()
+	{
+		if (m_Data)
+			munmap(m_Data, m_Size);
+
+		m_Data = nullptr;
+		m_Size = 0;
+	}
+
+#endif
+
+	SharedMemory::~SharedMemory()
+	{
+		Close();
+	}
+
+	SharedMemory::SharedMemory(SharedMemory&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	SharedMemory& SharedMemory::operator=(SharedMemory&& other) noexcept
+	{
+		if (this == &other)
+			return (*this);
+
+		Close();
+		std::swap(m_Data, other.m_Data);
+		std::swap(m_Size, other.m_Size);
+#ifdef PLATFORM_WINDOWS
+		std::swap(m_MappingHandle, other.m_MappingHandle);
+#endif
+		return (*this);
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// SHARED PATH TABLE
+
+	bool SharedPathTable::Open(const char* name)
+	{
+		Close();
+		m_Name = name;
+		if (m_Control.Open(ControlName(m_Name)) == false || m_Control.Size() < sizeof(ControlBlock) || Control(m_Control)->Magic != ControlMagic)
+		{
+			Close();
+			return (false);
+		}
+		Refresh();
+		return (IsValid());
+	}
+
+	bool SharedPathTable::Refresh()
+	{
+		if (m_Control.IsValid() == false)
+			return (false);
+
+		uint64_t previous = m_Generation;
+		uint64_t generation = Control(m_Control)->Generation.load(std::memory_order_acquire);
+		// The publisher unlinks a snapshot right after the next one is published, try again with the newer one
+		while (generation != 0 && generation != m_Generation && MapGeneration(generation) == false)
+		{
+			uint64_t latest = Control(m_Control)->Generation.load(std::memory_order_acquire);
+			if (latest == generation)
+				return (false);
+			generation = latest;
+		}
+		return (m_Generation != previous && IsValid());
+	}
+
+	void SharedPathTable::Close()
+	{
+		m_Snapshot.Close();
+		m_Control.Close();
+		m_Generation = 0;
+	}
+
+	size_t SharedPathTable::Size() const
+	{
+		return (IsValid() ? static_cast<size_t>(Header(m_Snapshot)->PathCount) : 0);
+	}
+
+	PathView SharedPathTable::operator[](size_t index) const
+	{
+		assert(index < Size() && "Index out of the table");
+		const TableEntry& entry = Entries(m_Snapshot)[index];
+		return (PathView(Characters(m_Snapshot, entry), entry.Size));
+	}
+
+	size_t SharedPathTable::Find(const IPath& path) const
+	{
+		if (IsValid() == false)
+			return (InvalidIndex);
+
+		uint64_t hash = HashPath(path);
+		uint32_t tag = static_cast<uint32_t>(hash >> 32);
+		const TableEntry* entries = Entries(m_Snapshot);
+		const uint32_t* slots = Slots(m_Snapshot);
+		uint64_t mask = Header(m_Snapshot)->SlotCount - 1;
+		for (uint64_t slot = hash & mask; slots[slot] != 0; slot = (slot + 1) & mask)
+		{
+			const TableEntry& entry = entries[slots[slot] - 1];
+			if (entry.HashTag == tag && entry.Size == path.Size() && ArePathsEqual(Characters(m_Snapshot, entry), entry.Size, path.Data(), path.Size()))
+				return (slots[slot] - 1);
+		}
+		return (InvalidIndex);
+	}
+
+	bool SharedPathTable::MapGeneration(uint64_t generation)
+	{
+		SharedMemory snapshot;
+		if (snapshot.Open(SnapshotName(m_Name, generation)) == false || IsTableValid(snapshot) == false)
+			return (false);
+		m_Snapshot = std::move(snapshot);
+		m_Generation = generation;
+		return (true);
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// SHARED PATH TABLE PUBLISHER
+
+	SharedPathTablePublisher::SharedPathTablePublisher(const char* name)
+		: m_Name(name)
+	{
+		if (m_Control.Create(ControlName(m_Name), sizeof(ControlBlock)) == false)
+			return;
+		ControlBlock* control = new (m_Control.Data()) ControlBlock();
+		control->Generation.store(0, std::memory_order_relaxed);
+		// Release: a reader that sees the magic sees the generation too
+		std::atomic_thread_fence(std::memory_order_release);
+		control->Magic = ControlMagic;
+	}
+
+	SharedPathTablePublisher::~SharedPathTablePublisher()
+	{
+		if (IsValid() == false)
+			return;
+		uint64_t generation = Generation();
+		m_Snapshot.Close();
+		m_Control.Close();
+		if (generation > 0)
+			SharedMemory::Unlink(SnapshotName(m_Name, generation));
+		SharedMemory::Unlink(ControlName(m_Name));
+	}
+
+	uint64_t SharedPathTablePublisher::Generation() const
+	{
+		return (IsValid() ? Control(m_Control)->Generation.load(std::memory_order_acquire) : 0);
+	}
+
+	bool SharedPathTablePublisher::Publish(size_t count, const std::function<const IPath&(size_t)>& pathAt)
+	{
+		assert(count < UINT32_MAX && "Too many paths for 32 bits slots");
+		if (IsValid() == false)
+			return (false);
+
+		uint64_t characterBytes = 0;
+		for (size_t index = 0; index < count; index++)
+			characterBytes += (pathAt(index).Size() + NULL_TERMINATOR_LENGTH) * sizeof(TCHAR);
+		uint64_t slotCount = MinSlotCount;
+		while (slotCount < count * 2)
+			slotCount *= 2;
+
+		TableHeader header = {};
+		header.Magic = TableMagic;
+		header.CharacterSize = sizeof(TCHAR);
+		header.PathCount = count;
+		header.SlotCount = slotCount;
+		header.EntriesOffset = AlignUp(sizeof(TableHeader), alignof(TableEntry));
+		header.SlotsOffset = header.EntriesOffset + count * sizeof(TableEntry);
+		header.CharactersOffset = AlignUp(header.SlotsOffset + slotCount * sizeof(uint32_t), alignof(TCHAR));
+		header.TotalSize = header.CharactersOffset + characterBytes;
+
+		uint64_t generation = Generation() + 1;
+		SharedMemory snapshot;
+		if (snapshot.Create(SnapshotName(m_Name, generation), static_cast<size_t>(header.TotalSize)) == false)
+			return (false);
+
+		char* data = snapshot.Data();
+		std::memcpy(data, &header, sizeof(header));
+		TableEntry* entries = reinterpret_cast<TableEntry*>(data + header.EntriesOffset);
+		uint32_t* slots = reinterpret_cast<uint32_t*>(data + header.SlotsOffset);
+		TCHAR* characters = reinterpret_cast<TCHAR*>(data + header.CharactersOffset);
+		std::memset(slots, 0, slotCount * sizeof(uint32_t));
+
+		uint64_t mask = slotCount - 1;
+		size_t characterIndex = 0;
+		for (size_t index = 0; index < count; index++)
+		{
+			const IPath& path = pathAt(index);
+			TableEntry& entry = entries[index];
+			entry.Offset = characterIndex * sizeof(TCHAR);
+			entry.Size = path.Size();
+			entry.Reserved = 0;
+			std::char_traits<TCHAR>::copy(characters + characterIndex, path.Data(), path.Size());
+			characters[characterIndex + path.Size()] = NULL;
+			characterIndex += path.Size() + NULL_TERMINATOR_LENGTH;
+
+			uint64_t hash = HashPath(path);
+			entry.HashTag = static_cast<uint32_t>(hash >> 32);
+			uint64_t slot = hash & mask;
+			bool duplicate = false;
+			for (; slots[slot] != 0 && duplicate == false; slot = (slot + 1) & mask)
+			{
+				const TableEntry& other = entries[slots[slot] - 1];
+				duplicate = other.HashTag == entry.HashTag && other.Size == entry.Size
+					&& ArePathsEqual(characters + other.Offset / sizeof(TCHAR), other.Size, path.Data(), path.Size());
+			}
+			if (duplicate == false)
+				slots[slot] = static_cast<uint32_t>(index + 1);
+		}
+
+		// The snapshot is complete before its generation is visible, the readers map it only after
+		std::atomic<uint64_t>& current = reinterpret_cast<ControlBlock*>(m_Control.Data())->Generation;
+		current.store(generation, std::memory_order_release);
+
+		if (generation > 1)
+			SharedMemory::Unlink(SnapshotName(m_Name, generation - 1));
+		m_Snapshot = std::move(snapshot);
+		return (true);
+	}
+}
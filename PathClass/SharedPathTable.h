@@ -0,0 +1,149 @@
+#pragma once
+
+#include "Path.h"
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace PathCore
+{
+	/**
+	 * A named shared memory segment, mapped in this process.
+	 * Shared memory objects on Linux (shm_open), named file mappings on Windows.
+	 */
+	class SharedMemory
+	{
+	public:
+		SharedMemory() = default;
+		~SharedMemory();
+
+		SharedMemory(const SharedMemory&) = delete;
+		SharedMemory& operator=(const SharedMemory&) = delete;
+		SharedMemory(SharedMemory&& other) noexcept;
+		SharedMemory& operator=(SharedMemory&& other) noexcept;
+
+	public:
+		/* Create (or replace) the segment name with size bytes, mapped read write */
+		bool Create(const std::string& name, size_t size);
+		/* Map the existing segment name read only, false if there is none */
+		bool Open(const std::string& name);
+		/**
+		 * @brief Remove the name, the processes that already mapped the segment keep it until they close it
+		 * @note Nothing to do on Windows, a mapping lives as long as a process holds it
+		 */
+		static void Unlink(const std::string& name);
+
+		bool IsValid() const { return (m_Data != nullptr); }
+		char* Data() const { return (m_Data); }
+		size_t Size() const { return (m_Size); }
+
+		void Close();
+
+	private:
+		char* m_Data = nullptr;
+		size_t m_Size = 0;
+#ifdef PLATFORM_WINDOWS
+		void* m_MappingHandle = nullptr;
+#endif
+	};
+
+	/**
+	 * A read only path table in shared memory, built once and mapped by every worker process of the box.
+	 *
+	 * The table only stores offsets, so every process can map it anywhere: the paths are read in place as PathView,
+	 * found in O(1) by index and by a hash lookup (HashPath, so both separators match).
+	 * A publisher (SharedPathTablePublisher) swaps the snapshots: a table keeps the snapshot it mapped until Refresh().
+	 *
+	 * IMPORTANT: The paths are stored with TCHAR, a narrow and a wide build cannot share a table.
+	 */
+	class SharedPathTable
+	{
+	public:
+		static constexpr size_t InvalidIndex = std::numeric_limits<size_t>::max();
+
+	public:
+		SharedPathTable() = default;
+		SharedPathTable(SharedPathTable&&) noexcept = default;
+		SharedPathTable& operator=(SharedPathTable&&) noexcept = default;
+
+	public:
+		/* Map the last snapshot published under name, false if there is none (or it is not a table of this build) */
+		bool Open(const char* name);
+		/**
+		 * @brief Map the last snapshot if a newer one was published since Open()
+		 * @return true if the snapshot changed. The views of the previous snapshot are invalid after that
+		 */
+		bool Refresh();
+		void Close();
+
+		bool IsValid() const { return (m_Snapshot.IsValid()); }
+		/* The generation of the mapped snapshot, 1 for the first one published */
+		uint64_t Generation() const { return (m_Generation); }
+
+		size_t Size() const;
+		/* The path at index, a view over the shared memory */
+		PathView operator[](size_t index) const;
+		/* The index of path, InvalidIndex if it is not in the table */
+		size_t Find(const IPath& path) const;
+		bool Contains(const IPath& path) const { return (Find(path) != InvalidIndex); }
+
+	private:
+		bool MapGeneration(uint64_t generation);
+
+	private:
+		std::string m_Name;
+		SharedMemory m_Control;
+		SharedMemory m_Snapshot;
+		uint64_t m_Generation = 0;
+	};
+
+	/**
+	 * Builds the snapshots of a SharedPathTable and publishes them under a name.
+	 *
+	 * A snapshot is written in its own segment, then a single atomic store of its generation in the control segment
+	 * makes it the current one: a process opening the table sees the previous snapshot or the new one, never half of one.
+	 * The previous snapshot is unlinked, the processes still mapping it keep it until they refresh.
+	 *
+	 * The name and the current snapshot are unlinked when the publisher is destroyed.
+	 * A new publisher under the same name starts a new control segment, the tables opened before must be opened again.
+	 */
+	class SharedPathTablePublisher
+	{
+	public:
+		/* name is a simple name (eg: "VideoReferences.paths"), without separator */
+		explicit SharedPathTablePublisher(const char* name);
+		~SharedPathTablePublisher();
+
+		SharedPathTablePublisher(const SharedPathTablePublisher&) = delete;
+		SharedPathTablePublisher& operator=(const SharedPathTablePublisher&) = delete;
+
+	public:
+		/* false if the control segment could not be created */
+		bool IsValid() const { return (m_Control.IsValid()); }
+		/* The generation of the last published snapshot, 0 before the first one */
+		uint64_t Generation() const;
+
+		/**
+		 * @brief Write paths (StaticPath, SharedPath, PathView, ...) to a new snapshot and make it the current one
+		 * @note The duplicates are kept at their index, Find() gives the first one
+		 * @return false if the snapshot could not be created, the current one stays
+		 */
+		template<typename PathType>
+		bool Publish(const std::vector<PathType>& paths)
+		{
+			return (Publish(paths.size(), [&paths](size_t index) -> const IPath& { return (paths[index]); }));
+		}
+
+	private:
+		bool Publish(size_t count, const std::function<const IPath&(size_t)>& pathAt);
+
+	private:
+		std::string m_Name;
+		SharedMemory m_Control;
+		/* Kept mapped, on Windows the segment would be gone with its last handle */
+		SharedMemory m_Snapshot;
+	};
+}
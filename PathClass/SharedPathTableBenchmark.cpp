@@ -0,0 +1,180 @@
+#include "Benchmarks.h"
+#include "PathHash.h"
+#include "PathListLoader.h"
+#include "PathWriter.h"
+#include "SharedPathTable.h"
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef PLATFORM_WINDOWS
+# include <sys/wait.h>
+# include <unistd.h>
+#endif
+
+using namespace PathCore;
+
+namespace
+{
+	using String = std::basic_string<TCHAR>;
+
+	struct PathViewHash
+	{
+		size_t operator()(const PathView& path) const { return (static_cast<size_t>(HashPath(path))); }
+	};
+	struct PathViewEqual
+	{
+		bool operator()(const PathView& path, const PathView& other) const { return (ArePathsEqual(path, other)); }
+	};
+
+	/* What every worker did at startup: load the manifest, copy the paths and index them */
+	struct PrivateCopy
+	{
+		std::vector<StaticPath> Paths;
+		std::unordered_map<PathView, size_t, PathViewHash, PathViewEqual> Index;
+	};
+
+	void LoadPrivateCopy(const std::string& manifest, ThreadPool& pool, PrivateCopy& copy)
+	{
+		PathListLoaderOptions options;
+		options.Pool = &pool;
+		copy.Paths = LoadPathListFile(manifest.c_str(), options).ToStaticPaths();
+		copy.Index.reserve(copy.Paths.size());
+		for (size_t index = 0; index < copy.Paths.size(); index++)
+			copy.Index.emplace(copy.Paths[index], index);
+	}
+
+	/* The lookups of a worker: one path in 7 of the set, and as many paths that are not in it */
+	template<typename FindFunction>
+	uint64_t RunLookups(const std::vector<StaticPath>& paths, FindFunction&& find)
+	{
+		uint64_t found = 0;
+		Path missing(TEXT("C:/Assets/Missing/Texture.png"));
+		for (size_t index = 0; index < paths.size(); index += 7)
+		{
+			found += find(paths[index]) == index;
+			found += find(missing) == SharedPathTable::InvalidIndex;
+		}
+		return (found);
+	}
+
+#ifndef PLATFORM_WINDOWS
+	/**
+	 * @brief Run work in workerCount child processes, and wait for them
+	 * @return false if a worker failed (work returned false, or the process crashed)
+	 */
+	template<typename Work>
+	bool RunWorkers(int workerCount, Work&& work)
+	{
+		std::vector<pid_t> workers;
+		for (int index = 0; index < workerCount; index++)
+		{
+			pid_t pid = fork();
+			if (pid == 0)
+				_exit(work() ? 0 : 1);
+			if (pid > 0)
+				workers.push_back(pid);
+		}
+
+		bool succeeded = static_cast<int>(workers.size()) == workerCount;
+		for (pid_t pid : workers)
+		{
+			int status = 0;
+			waitpid(pid, &status, 0);
+			succeeded = succeeded && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+		}
+		return (succeeded);
+	}
+#endif
+}
+
+void BenchmarkSharedPathTable()
+{
+	const size_t pathCount = 1000000;
+	const int workerCount = 4;
+	std::vector<StaticPath> paths = GenerateNumberedPaths(pathCount, TEXT("C:/Assets/Library"), TEXT("Pack_"), TEXT("Texture_"), { TEXT(".png") });
+	uint64_t expected = 2 * ((pathCount + 6) / 7);
+
+	std::string manifest = (std::filesystem::temp_directory_path() / "SharedPathTableManifest.txt").string();
+	{
+		PathWriter writer(manifest.c_str());
+		for (const StaticPath& path : paths)
+			writer.Write(path);
+	}
+
+	ThreadPool pool;
+	PrivateCopy copy;
+	double loadSeconds = MeasureSeconds([&]() { LoadPrivateCopy(manifest, pool, copy); });
+	uint64_t copyFound = 0;
+	double copyLookupSeconds = MeasureSeconds([&]()
+	{
+		copyFound = RunLookups(paths, [&copy](const IPath& path)
+		{
+			auto found = copy.Index.find(PathView(path));
+			return (found != copy.Index.end() ? found->second : SharedPathTable::InvalidIndex);
+		});
+	});
+
+	std::string name = "VideoReferences.Benchmark." + std::to_string(pathCount);
+	SharedPathTablePublisher publisher(name.c_str());
+	bool published = false;
+	double publishSeconds = MeasureSeconds([&]() { published = publisher.Publish(paths); });
+
+	SharedPathTable table;
+	bool opened = false;
+	double openSeconds = MeasureSeconds([&]() { opened = table.Open(name.c_str()); });
+	uint64_t tableFound = 0;
+	double tableLookupSeconds = MeasureSeconds([&]() { tableFound = RunLookups(paths, [&table](const IPath& path) { return (table.Find(path)); }); });
+	int tableAllocations = CountAllocations([&]() { RunLookups(paths, [&table](const IPath& path) { return (table.Find(path)); }); });
+
+	bool same = published && opened && copyFound == expected && tableFound == expected && table.Size() == pathCount
+		&& ArePathsEqual(table[pathCount / 2], paths[pathCount / 2]);
+
+	// A new snapshot: the table keeps the old one until it refreshes
+	std::vector<StaticPath> updated(paths.begin(), paths.begin() + pathCount / 2);
+	updated.emplace_back(TEXT("C:/Assets/Library/New.png"));
+	bool swapped = table.Refresh() == false && publisher.Publish(updated) && table.Size() == pathCount && table.Refresh() && table.Size() == updated.size()
+		&& table.Generation() == 2 && table.Contains(updated.back()) && table.Contains(paths.back()) == false;
+	swapped = swapped && table.Refresh() == false && table.Generation() == 2; // Nothing newer
+
+	std::cout << "SharedPathTable: " << pathCount << " paths, " << workerCount << " worker processes"
+		<< (same && swapped ? "" : " (MISMATCH)") << std::endl;
+	std::cout << "\tPrivate copy per worker: load " << loadSeconds * 1e3 << " ms, lookups " << copyLookupSeconds * 1e3 << " ms" << std::endl;
+	std::cout << "\tShared table: publish " << publishSeconds * 1e3 << " ms, open " << openSeconds * 1e6 << " us, lookups "
+		<< tableLookupSeconds * 1e3 << " ms (" << tableAllocations << " allocations)" << std::endl;
+
+#ifndef PLATFORM_WINDOWS
+	// The startup of every worker of the box, each one in its own process
+	publisher.Publish(paths);
+	bool copyWorkers = false;
+	double copyWorkersSeconds = MeasureSeconds([&]()
+	{
+		copyWorkers = RunWorkers(workerCount, [&]()
+		{
+			ThreadPool workerPool;
+			PrivateCopy workerCopy;
+			LoadPrivateCopy(manifest, workerPool, workerCopy);
+			return (workerCopy.Paths.size() == pathCount);
+		});
+	});
+	bool tableWorkers = false;
+	double tableWorkersSeconds = MeasureSeconds([&]()
+	{
+		tableWorkers = RunWorkers(workerCount, [&]()
+		{
+			SharedPathTable workerTable;
+			return (workerTable.Open(name.c_str()) && RunLookups(paths, [&workerTable](const IPath& path) { return (workerTable.Find(path)); }) == expected);
+		});
+	});
+	std::cout << "\t" << workerCount << " processes loading their own copy: " << copyWorkersSeconds * 1e3 << " ms"
+		<< (copyWorkers ? "" : " (MISMATCH)") << std::endl;
+	std::cout << "\t" << workerCount << " processes opening the table and looking up: " << tableWorkersSeconds * 1e3 << " ms"
+		<< (tableWorkers ? "" : " (MISMATCH)") << std::endl;
+#endif
+
+	std::remove(manifest.c_str());
+}
@@ -0,0 +1,115 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace PathCore
+{
+	ThreadPool::ThreadPool(unsigned int threadCount)
+		: m_RunningJobs(0),
+		m_Stopping(false)
+	{
+		if (threadCount == 0)
+			threadCount = std::thread::hardware_concurrency();
+		if (threadCount == 0)
+			threadCount = 1; // hardware_concurrency is allowed to return 0 when unknown
+
+		m_Workers.reserve(threadCount);
+		for (unsigned int index = 0; index < threadCount; index++)
+			m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stopping = true;
+		}
+		m_JobAvailable.notify_all();
+
+		for (std::thread& worker : m_Workers)
+			worker.join();
+	}
+
+	void ThreadPool::Enqueue(Job job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Jobs.push_back(std::move(job));
+		}
+		m_JobAvailable.notify_one();
+	}
+
+	void ThreadPool::Wait()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_AllDone.wait(lock, [this]() { return (m_Jobs.empty() && m_RunningJobs == 0); });
+	}
+
+	void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& func)
+	{
+		if (count == 0)
+			return;
+
+		// One job per worker pulling indices from a shared counter, instead of one job per index.
+		// The state outlives the call: a job that starts once every index is taken only reads the counter
+		struct Loop
+		{
+			std::atomic<size_t> NextIndex{ 0 };
+			/* Indices not finished yet, the call returns when it reaches 0 */
+			std::atomic<size_t> Remaining;
+			const std::function<void(size_t)>* Func;
+		};
+		std::shared_ptr<Loop> loop = std::make_shared<Loop>();
+		loop->Remaining.store(count, std::memory_order_relaxed);
+		loop->Func = &func;
+
+		auto run = [count](Loop& state)
+		{
+			for (size_t index = state.NextIndex++; index < count; index = state.NextIndex++)
+			{
+				(*state.Func)(index);
+				if (state.Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+					state.Remaining.notify_all();
+			}
+		};
+
+		// The calling thread takes indices too, so a call from a job of this pool never waits on workers that are all busy
+		size_t jobCount = std::min<size_t>(count - 1, m_Workers.size());
+		for (size_t job = 0; job < jobCount; job++)
+			Enqueue([loop, run]() { run(*loop); });
+		run(*loop);
+
+		// Only this call's indices: the other jobs of the pool are not waited for
+		for (size_t remaining = loop->Remaining.load(std::memory_order_acquire); remaining != 0; remaining = loop->Remaining.load(std::memory_order_acquire))
+			loop->Remaining.wait(remaining, std::memory_order_acquire);
+	}
+
+	void ThreadPool::WorkerLoop()
+	{
+		while (true)
+		{
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_JobAvailable.wait(lock, [this]() { return (m_Stopping || m_Jobs.empty() == false); });
+				if (m_Jobs.empty())
+					return; // Stopping and nothing left to do
+
+				job = std::move(m_Jobs.front());
+				m_Jobs.pop_front();
+				m_RunningJobs++;
+			}
+
+			job();
+
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_RunningJobs--;
+				if (m_RunningJobs == 0 && m_Jobs.empty())
+					m_AllDone.notify_all();
+			}
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace PathCore
+{
+	/**
+	 * A fixed size pool of worker threads.
+	 *
+	 * Jobs are executed in FIFO order by the first available worker.
+	 * Use Wait() to block until every enqueued job is finished.
+	 */
+	class ThreadPool
+	{
+	public:
+		using Job = std::function<void()>;
+
+	public:
+		/**
+		 * @param threadCount The amount of worker threads, 0 means one per hardware thread
+		 */
+		explicit ThreadPool(unsigned int threadCount = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+	public:
+		void Enqueue(Job job);
+		void Wait();
+
+		/**
+		 * @brief Call func(index) for every index in [0, count) and wait for all of them
+		 * @note Indices are handed out one by one, so uneven jobs are balanced between workers and the calling thread.
+		 * Only waits for its own indices, it can be called from a job of the pool, or while other jobs run.
+		 */
+		void ParallelFor(size_t count, const std::function<void(size_t)>& func);
+
+		unsigned int ThreadCount() const { return (static_cast<unsigned int>(m_Workers.size())); }
+
+	private:
+		void WorkerLoop();
+
+	private:
+		std::vector<std::thread> m_Workers;
+		std::deque<Job> m_Jobs;
+		std::mutex m_Mutex;
+		/* Notified when a job is enqueued or when the pool is stopping */
+		std::condition_variable m_JobAvailable;
+		/* Notified when the last running job is finished */
+		std::condition_variable m_AllDone;
+		size_t m_RunningJobs;
+		bool m_Stopping;
+	};
+}